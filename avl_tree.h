@@ -0,0 +1,243 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "stats.h"
+
+// AVL-дерево: двоичное дерево поиска, в котором высоты поддеревьев
+// любого узла различаются не больше чем на 1. Узел - одна пара ключ/значение
+// и два указателя, поэтому поиск проходит ~1.44 log2(n) узлов, разбросанных
+// по памяти. Нужно для сравнения с B- и B+-деревьями (см. help.cpp).
+
+template <typename K, typename V>
+struct AvlNode {
+    typedef K Key;
+    typedef V Value;
+
+    K key;
+    V value;
+    int height;          // лист - 1
+    AvlNode* left;
+    AvlNode* right;
+};
+
+template <typename K, typename V>
+struct AvlTree {
+    typedef K Key;
+    typedef V Value;
+    typedef AvlNode<K, V> Node;
+
+    Node* root;
+    long long node_count;
+    long long key_count;
+};
+
+template <typename Tree>
+void avl_tree_init(Tree* tree) {
+    tree->root = NULL;
+    tree->node_count = 0;
+    tree->key_count = 0;
+}
+
+template <typename Node>
+inline int avl_height(const Node* node) {
+    return node != NULL ? node->height : 0;
+}
+
+template <typename Node>
+inline void avl_update_height(Node* node) {
+    int left = avl_height(node->left);
+    int right = avl_height(node->right);
+    node->height = (left > right ? left : right) + 1;
+}
+
+template <typename Node>
+Node* avl_rotate_right(Node* node) {
+    Node* left = node->left;
+    node->left = left->right;
+    left->right = node;
+    avl_update_height(node);
+    avl_update_height(left);
+    return left;
+}
+
+template <typename Node>
+Node* avl_rotate_left(Node* node) {
+    Node* right = node->right;
+    node->right = right->left;
+    right->left = node;
+    avl_update_height(node);
+    avl_update_height(right);
+    return right;
+}
+
+// Восстановить баланс узла после изменения одного из поддеревьев на 1
+template <typename Node>
+Node* avl_rebalance(Node* node) {
+    avl_update_height(node);
+    int balance = avl_height(node->left) - avl_height(node->right);
+    if (balance > 1) {
+        if (avl_height(node->left->left) < avl_height(node->left->right)) {
+            node->left = avl_rotate_left(node->left);
+        }
+        return avl_rotate_right(node);
+    }
+    if (balance < -1) {
+        if (avl_height(node->right->right) < avl_height(node->right->left)) {
+            node->right = avl_rotate_right(node->right);
+        }
+        return avl_rotate_left(node);
+    }
+    return node;
+}
+
+// Вставка в поддерево; возвращает новый корень поддерева.
+// *inserted = false, если ключ уже был (значение обновляется).
+template <typename Tree>
+typename Tree::Node* avl_insert_into(Tree* tree, typename Tree::Node* node,
+                                     typename Tree::Key key, typename Tree::Value value,
+                                     bool* inserted, int* visits) {
+    typedef typename Tree::Node Node;
+    if (node == NULL) {
+        Node* created = (Node*)malloc(sizeof(Node));
+        created->key = key;
+        created->value = value;
+        created->height = 1;
+        created->left = NULL;
+        created->right = NULL;
+        tree->node_count++;
+        *inserted = true;
+        return created;
+    }
+    (*visits)++;
+    if (key < node->key) {
+        node->left = avl_insert_into(tree, node->left, key, value, inserted, visits);
+    } else if (node->key < key) {
+        node->right = avl_insert_into(tree, node->right, key, value, inserted, visits);
+    } else {
+        node->value = value;
+        *inserted = false;
+        return node;
+    }
+    return avl_rebalance(node);
+}
+
+template <typename Tree>
+bool avl_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    STATS_TIMER(stat, STAT_OP_INSERT);
+    bool inserted = false;
+    int visits = 0;
+    tree->root = avl_insert_into(tree, tree->root, key, value, &inserted, &visits);
+    if (inserted) tree->key_count++;
+    STATS_VISIT(stat, visits);
+    STATS_END(stat);
+    return inserted;
+}
+
+template <typename Tree>
+bool avl_search(Tree* tree, typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_SEARCH);
+    Node* node = tree->root;
+    while (node != NULL) {
+        STATS_VISIT(stat, 1);
+        if (key < node->key) {
+            node = node->left;
+        } else if (node->key < key) {
+            node = node->right;
+        } else {
+            if (value != NULL) *value = node->value;
+            break;
+        }
+    }
+    STATS_END(stat);
+    return node != NULL;
+}
+
+// Удаление из поддерева; возвращает новый корень поддерева.
+// Узел с двумя детьми получает ключ преемника, а преемник удаляется справа.
+template <typename Tree>
+typename Tree::Node* avl_delete_from(Tree* tree, typename Tree::Node* node, typename Tree::Key key,
+                                     bool* deleted, int* visits) {
+    typedef typename Tree::Node Node;
+    if (node == NULL) return NULL;
+    (*visits)++;
+    if (key < node->key) {
+        node->left = avl_delete_from(tree, node->left, key, deleted, visits);
+    } else if (node->key < key) {
+        node->right = avl_delete_from(tree, node->right, key, deleted, visits);
+    } else {
+        *deleted = true;
+        if (node->left == NULL || node->right == NULL) {
+            Node* child = node->left != NULL ? node->left : node->right;
+            free(node);
+            tree->node_count--;
+            return child;
+        }
+        Node* successor = node->right;
+        while (successor->left != NULL) successor = successor->left;
+        node->key = successor->key;
+        node->value = successor->value;
+        node->right = avl_delete_from(tree, node->right, successor->key, deleted, visits);
+    }
+    return avl_rebalance(node);
+}
+
+template <typename Tree>
+bool avl_delete(Tree* tree, typename Tree::Key key) {
+    STATS_TIMER(stat, STAT_OP_DELETE);
+    bool deleted = false;
+    int visits = 0;
+    tree->root = avl_delete_from(tree, tree->root, key, &deleted, &visits);
+    if (deleted) tree->key_count--;
+    STATS_VISIT(stat, visits);
+    STATS_END(stat);
+    return deleted;
+}
+
+// Обход по порядку только тех поддеревьев, что пересекают [start_key, end_key]
+template <typename Node>
+void avl_range_from(const Node* node, typename Node::Key start_key, typename Node::Key end_key,
+                    typename Node::Key* results, int* result_count, int max_results, int* visits) {
+    if (node == NULL || *result_count >= max_results) return;
+    (*visits)++;
+    if (start_key < node->key) {
+        avl_range_from(node->left, start_key, end_key, results, result_count, max_results, visits);
+    }
+    if (!(node->key < start_key) && !(end_key < node->key) && *result_count < max_results) {
+        results[(*result_count)++] = node->key;
+    }
+    if (node->key < end_key) {
+        avl_range_from(node->right, start_key, end_key, results, result_count, max_results, visits);
+    }
+}
+
+// Ключи из [start_key, end_key] по возрастанию, не больше max_results
+template <typename Tree>
+int avl_range_query(Tree* tree, typename Tree::Key start_key, typename Tree::Key end_key,
+                    typename Tree::Key* results, int max_results) {
+    STATS_TIMER(stat, STAT_OP_RANGE);
+    int count = 0;
+    int visits = 0;
+    avl_range_from<typename Tree::Node>(tree->root, start_key, end_key, results, &count, max_results, &visits);
+    STATS_VISIT(stat, visits);
+    STATS_END(stat);
+    return count;
+}
+
+template <typename Node>
+void avl_free_node(Node* node) {
+    if (node == NULL) return;
+    avl_free_node(node->left);
+    avl_free_node(node->right);
+    free(node);
+}
+
+template <typename Tree>
+void avl_tree_free(Tree* tree) {
+    avl_free_node(tree->root);
+    tree->root = NULL;
+    tree->node_count = 0;
+    tree->key_count = 0;
+}
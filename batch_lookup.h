@@ -0,0 +1,205 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <algorithm>
+
+#include "bplus_tree.h"
+
+// Пакетный поиск в B+-дереве: много ключей за один вызов.
+// Два приема, которые можно сочетать:
+//   * общий спуск по отсортированным ключам - соседние ключи проходят
+//     одни и те же верхние узлы, поэтому спуск продолжается от самого
+//     глубокого узла пути, чей диапазон еще покрывает следующий ключ;
+//   * групповая упреждающая выборка - BPLUS_BATCH_GROUP независимых
+//     спусков идут по уровням в ногу: на каждом уровне для всех ключей
+//     группы выбирается ребенок и выдается prefetch, и промахи кэша
+//     разных спусков перекрываются, а не ждутся по очереди.
+// Дерево сбалансировано, поэтому все спуски группы доходят до листьев
+// на одном и том же шаге.
+
+#define BPLUS_BATCH_GROUP 16
+#define BPLUS_BATCH_MAX_HEIGHT 64
+#define BPLUS_BATCH_STACK 256     // до стольких ключей перестановка на стеке
+
+// ---------- Групповая упреждающая выборка ----------
+
+// Листья для count ключей в любом порядке. parents/indexes (могут быть
+// NULL) - родитель листа и номер листа среди его детей, как у курсора.
+template <typename Tree>
+void bplus_batch_descend(Tree* tree, const typename Tree::Key* keys, int count,
+                         typename Tree::Node** leaves, typename Tree::Node** parents, int* indexes) {
+    typedef typename Tree::Node Node;
+    for (int first = 0; first < count; first += BPLUS_BATCH_GROUP) {
+        int n = count - first < BPLUS_BATCH_GROUP ? count - first : BPLUS_BATCH_GROUP;
+        Node** group = leaves + first;
+        for (int i = 0; i < n; i++) {
+            group[i] = tree->root;
+            if (parents != NULL) parents[first + i] = NULL;
+            if (indexes != NULL) indexes[first + i] = 0;
+        }
+        for (int level = 1; level < tree->height; level++) {
+            for (int i = 0; i < n; i++) {
+                Node* node = group[i];
+                int index = node_upper_bound(node->keys, node->key_count, keys[first + i]);
+                if (parents != NULL) parents[first + i] = node;
+                if (indexes != NULL) indexes[first + i] = index;
+                group[i] = (Node*)node->children[index];
+                bplus_prefetch_node(group[i]);
+            }
+        }
+    }
+}
+
+// Точечный поиск count ключей в любом порядке; found[i] - нашелся ли keys[i].
+// Возвращает число найденных.
+template <typename Tree>
+int bplus_search_interleaved(Tree* tree, const typename Tree::Key* keys, int count,
+                             typename Tree::Value* values, bool* found) {
+    typedef typename Tree::Node Node;
+    Node* leaves[BPLUS_BATCH_GROUP];
+    int hits = 0;
+    for (int first = 0; first < count; first += BPLUS_BATCH_GROUP) {
+        int n = count - first < BPLUS_BATCH_GROUP ? count - first : BPLUS_BATCH_GROUP;
+        bplus_batch_descend(tree, keys + first, n, leaves, (Node**)NULL, (int*)NULL);
+        for (int i = 0; i < n; i++) {
+            Node* leaf = leaves[i];
+            typename Tree::Key key = keys[first + i];
+            int pos = node_lower_bound(leaf->keys, leaf->key_count, key);
+            found[first + i] = pos < leaf->key_count && leaf->keys[pos] == key;
+            if (found[first + i]) {
+                if (values != NULL) values[first + i] = leaf->data[pos];
+                hits++;
+            }
+        }
+    }
+    return hits;
+}
+
+// Курсоры для count диапазонов [start_keys[i], end_keys[i]] одним групповым спуском
+template <typename Tree>
+void bplus_cursor_seek_batch(Tree* tree, BPlusCursor<Tree>* cursors, const typename Tree::Key* start_keys,
+                             const typename Tree::Key* end_keys, int count) {
+    typedef typename Tree::Node Node;
+    Node* leaves[BPLUS_BATCH_GROUP];
+    Node* parents[BPLUS_BATCH_GROUP];
+    int indexes[BPLUS_BATCH_GROUP];
+    for (int first = 0; first < count; first += BPLUS_BATCH_GROUP) {
+        int n = count - first < BPLUS_BATCH_GROUP ? count - first : BPLUS_BATCH_GROUP;
+        bplus_batch_descend(tree, start_keys + first, n, leaves, parents, indexes);
+        for (int i = 0; i < n; i++) {
+            BPlusCursor<Tree>* cursor = &cursors[first + i];
+            STATS_BEGIN(cursor->stat, STAT_OP_RANGE);
+            STATS_VISIT(cursor->stat, tree->height);
+            cursor->leaf = leaves[i];
+            cursor->pos = node_lower_bound(leaves[i]->keys, leaves[i]->key_count, start_keys[first + i]);
+            cursor->end_key = end_keys[first + i];
+            cursor->root = tree->root;
+            cursor->parent = parents[i];
+            cursor->child_index = indexes[i];
+            cursor->issued = indexes[i];
+            cursor->read_ahead = 0;
+            bplus_cursor_settle(cursor);
+        }
+    }
+}
+
+// ---------- Общий спуск по отсортированным ключам ----------
+
+// Путь от корня к последнему найденному листу вместе с правой границей
+// диапазона каждого узла. Следующий (не меньший) ключ поднимается только
+// до узла, который его еще покрывает, и спускается оттуда.
+template <typename Tree>
+struct BPlusBatchPath {
+    typename Tree::Node* nodes[BPLUS_BATCH_MAX_HEIGHT];
+    typename Tree::Key high[BPLUS_BATCH_MAX_HEIGHT];  // ключи nodes[l] строго меньше high[l]
+    bool bounded[BPLUS_BATCH_MAX_HEIGHT];             // false - справа граница не ограничена
+    int depth;                                        // nodes[0..depth) действительны
+};
+
+// Лист для key; ключи подаются в неубывающем порядке
+template <typename Tree>
+typename Tree::Node* bplus_batch_path_leaf(Tree* tree, BPlusBatchPath<Tree>* path, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    int depth = path->depth;
+    while (depth > 1 && path->bounded[depth - 1] && !(key < path->high[depth - 1])) depth--;
+    if (depth == 0) {
+        path->nodes[0] = tree->root;
+        path->high[0] = key;
+        path->bounded[0] = false;
+        depth = 1;
+    }
+    Node* node = path->nodes[depth - 1];
+    while (!node->is_leaf) {
+        int i = node_upper_bound(node->keys, node->key_count, key);
+        if (i < node->key_count) {
+            path->high[depth] = node->keys[i];
+            path->bounded[depth] = true;
+        } else {
+            path->high[depth] = path->high[depth - 1];
+            path->bounded[depth] = path->bounded[depth - 1];
+        }
+        node = (Node*)node->children[i];
+        path->nodes[depth++] = node;
+    }
+    path->depth = depth;
+    return node;
+}
+
+// Точечный поиск по неубывающим keys. Возвращает число найденных.
+template <typename Tree>
+int bplus_search_sorted(Tree* tree, const typename Tree::Key* keys, int count,
+                        typename Tree::Value* values, bool* found) {
+    typedef typename Tree::Node Node;
+    BPlusBatchPath<Tree> path;
+    path.depth = 0;
+    int hits = 0;
+    for (int k = 0; k < count; k++) {
+        Node* leaf = bplus_batch_path_leaf(tree, &path, keys[k]);
+        int pos = node_lower_bound(leaf->keys, leaf->key_count, keys[k]);
+        found[k] = pos < leaf->key_count && leaf->keys[pos] == keys[k];
+        if (found[k]) {
+            if (values != NULL) values[k] = leaf->data[pos];
+            hits++;
+        }
+    }
+    return hits;
+}
+
+template <typename K>
+struct BPlusBatchProbe {
+    K key;
+    int index;
+};
+
+// Точечный поиск count ключей в любом порядке: ключи сортируются вместе
+// с исходными номерами, затем общий спуск; результаты - по исходным номерам.
+template <typename Tree>
+int bplus_search_batch(Tree* tree, const typename Tree::Key* keys, int count,
+                       typename Tree::Value* values, bool* found) {
+    typedef typename Tree::Node Node;
+    typedef BPlusBatchProbe<typename Tree::Key> Probe;
+    Probe stack_probes[BPLUS_BATCH_STACK];
+    Probe* probes = count <= BPLUS_BATCH_STACK ? stack_probes : (Probe*)malloc(sizeof(Probe) * count);
+    for (int i = 0; i < count; i++) {
+        probes[i].key = keys[i];
+        probes[i].index = i;
+    }
+    std::sort(probes, probes + count, [](const Probe& a, const Probe& b) { return a.key < b.key; });
+
+    BPlusBatchPath<Tree> path;
+    path.depth = 0;
+    int hits = 0;
+    for (int k = 0; k < count; k++) {
+        Node* leaf = bplus_batch_path_leaf(tree, &path, probes[k].key);
+        int pos = node_lower_bound(leaf->keys, leaf->key_count, probes[k].key);
+        int out = probes[k].index;
+        found[out] = pos < leaf->key_count && leaf->keys[pos] == probes[k].key;
+        if (found[out]) {
+            if (values != NULL) values[out] = leaf->data[pos];
+            hits++;
+        }
+    }
+    if (probes != stack_probes) free(probes);
+    return hits;
+}
@@ -0,0 +1,687 @@
+// Набор бенчмарков для B-дерева и B+-дерева.
+// В отличие от демонстрационных замеров в main.cpp: фиксированный seed,
+// прогрев, время каждой операции (steady_clock или rdtsc), перцентили
+// p50/p99/p999, счетчики DiskSimulator и вывод таблицей, CSV или JSON.
+//
+// Пример: ./bench --keys 1000000 --ops 100000 --seed 42 --format csv --out bench.csv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_RDTSC 1
+#else
+#define BENCH_HAVE_RDTSC 0
+#endif
+
+#include "disk.h"
+#include "btree.h"
+#include "bplus_tree.h"
+#include "buffer_pool.h"
+#include "disk_tree.h"
+
+typedef CacheLineBPlusTree<int, int, 4> MemBPlusTree;
+typedef CacheLineBTree<int, int, 4> MemBTree;
+typedef PageBPlusTree<int, int> DiskBPlusTree;
+typedef PageBTree<int, int> DiskBTree;
+
+// ==================== ГЕНЕРАТОР ====================
+// splitmix64: одинаковый seed дает одинаковые нагрузки на любой машине
+
+struct BenchRng {
+    unsigned long long state;
+};
+
+static void bench_rng_seed(struct BenchRng* rng, unsigned long long seed) {
+    rng->state = seed;
+}
+
+static unsigned long long bench_rng_next(struct BenchRng* rng) {
+    unsigned long long z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Равномерно в [0, n)
+static long long bench_rng_below(struct BenchRng* rng, long long n) {
+    return (long long)(bench_rng_next(rng) % (unsigned long long)n);
+}
+
+// ==================== ТАЙМЕР ====================
+
+enum BenchTimer {
+    TIMER_STEADY,   // std::chrono::steady_clock
+    TIMER_RDTSC     // счетчик тактов, переводится в нс по калибровке
+};
+
+static BenchTimer g_timer = TIMER_STEADY;
+static double g_ns_per_tick = 1.0;
+
+static inline unsigned long long bench_ticks() {
+#if BENCH_HAVE_RDTSC
+    if (g_timer == TIMER_RDTSC) return __rdtsc();
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Для rdtsc: сколько наносекунд в такте (50 мс против steady_clock)
+static void bench_calibrate_timer() {
+    if (g_timer != TIMER_RDTSC) {
+        g_ns_per_tick = 1.0;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long ticks_start = bench_ticks();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50)) {
+    }
+    unsigned long long ticks = bench_ticks() - ticks_start;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    g_ns_per_tick = ticks > 0 ? ns / ticks : 1.0;
+}
+
+// ==================== ПАРАМЕТРЫ ====================
+
+enum BenchFormat { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSON };
+
+struct BenchOptions {
+    int keys;                 // ключей в дереве до начала замеров
+    long long ops;            // измеряемых операций (длинные диапазоны - ops / 100)
+    long long warmup;         // операций прогрева
+    unsigned long long seed;
+    int short_width;          // ключей в коротком диапазоне
+    int long_width;           // ключей в длинном диапазоне
+    int write_percent;        // доля записей в смешанной нагрузке
+    int pool_percent;         // размер буферного пула в процентах от файла
+    BenchFormat format;
+    const char* out_path;     // NULL - stdout
+    const char* tree_filter;  // bplus, btree или NULL - оба
+    const char* storage_filter;  // mem, disk или NULL - оба
+    const char* workload_filter; // point, short, long, mixed или NULL - все
+};
+
+static void bench_default_options(struct BenchOptions* opt) {
+    opt->keys = 1000000;
+    opt->ops = 100000;
+    opt->warmup = 10000;
+    opt->seed = 42;
+    opt->short_width = 16;
+    opt->long_width = 10000;
+    opt->write_percent = 20;
+    opt->pool_percent = 10;
+    opt->format = FORMAT_TABLE;
+    opt->out_path = NULL;
+    opt->tree_filter = NULL;
+    opt->storage_filter = NULL;
+    opt->workload_filter = NULL;
+}
+
+static void bench_usage(const char* program) {
+    printf("Использование: %s [параметры]\n", program);
+    printf("  --keys N          ключей в дереве (1000000)\n");
+    printf("  --ops N           измеряемых операций (100000)\n");
+    printf("  --warmup N        операций прогрева (10000)\n");
+    printf("  --seed N          seed генератора нагрузки (42)\n");
+    printf("  --short-width N   ключей в коротком диапазоне (16)\n");
+    printf("  --long-width N    ключей в длинном диапазоне (10000)\n");
+    printf("  --write-percent N доля записей в mixed (20)\n");
+    printf("  --pool-percent N  буферный пул, %% от файла дерева (10)\n");
+    printf("  --timer steady|rdtsc\n");
+    printf("  --format table|csv|json\n");
+    printf("  --out FILE        вывод в файл вместо stdout\n");
+    printf("  --tree bplus|btree, --storage mem|disk, --workload point|short|long|mixed\n");
+}
+
+// Разбор аргументов; false - ошибка или --help
+static bool bench_parse_options(int argc, char** argv, struct BenchOptions* opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) return false;
+        if (value == NULL) {
+            fprintf(stderr, "Нет значения для %s\n", arg);
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--keys") == 0) opt->keys = atoi(value);
+        else if (strcmp(arg, "--ops") == 0) opt->ops = atoll(value);
+        else if (strcmp(arg, "--warmup") == 0) opt->warmup = atoll(value);
+        else if (strcmp(arg, "--seed") == 0) opt->seed = strtoull(value, NULL, 10);
+        else if (strcmp(arg, "--short-width") == 0) opt->short_width = atoi(value);
+        else if (strcmp(arg, "--long-width") == 0) opt->long_width = atoi(value);
+        else if (strcmp(arg, "--write-percent") == 0) opt->write_percent = atoi(value);
+        else if (strcmp(arg, "--pool-percent") == 0) opt->pool_percent = atoi(value);
+        else if (strcmp(arg, "--out") == 0) opt->out_path = value;
+        else if (strcmp(arg, "--tree") == 0) opt->tree_filter = value;
+        else if (strcmp(arg, "--storage") == 0) opt->storage_filter = value;
+        else if (strcmp(arg, "--workload") == 0) opt->workload_filter = value;
+        else if (strcmp(arg, "--timer") == 0) {
+            if (strcmp(value, "rdtsc") == 0 && BENCH_HAVE_RDTSC) g_timer = TIMER_RDTSC;
+            else if (strcmp(value, "steady") == 0) g_timer = TIMER_STEADY;
+            else {
+                fprintf(stderr, "Таймер %s недоступен\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--format") == 0) {
+            if (strcmp(value, "table") == 0) opt->format = FORMAT_TABLE;
+            else if (strcmp(value, "csv") == 0) opt->format = FORMAT_CSV;
+            else if (strcmp(value, "json") == 0) opt->format = FORMAT_JSON;
+            else {
+                fprintf(stderr, "Неизвестный формат %s\n", value);
+                return false;
+            }
+        } else {
+            fprintf(stderr, "Неизвестный параметр %s\n", arg);
+            return false;
+        }
+    }
+    if (opt->keys < 2 * opt->long_width || opt->short_width < 1 || opt->ops < 1 ||
+        opt->write_percent < 0 || opt->write_percent > 100 || opt->pool_percent < 1) {
+        fprintf(stderr, "Недопустимые параметры: keys >= 2 * long-width, ops >= 1, pool-percent >= 1\n");
+        return false;
+    }
+    return true;
+}
+
+static bool bench_selected(const char* filter, const char* name) {
+    return filter == NULL || strcmp(filter, "all") == 0 || strcmp(filter, name) == 0;
+}
+
+// ==================== НАГРУЗКИ ====================
+// В дереве лежат четные ключи 0, 2, ..., 2 * (keys - 1) со значением = ключу.
+// Операции генерируются заранее: генерация не попадает в замер, и все
+// деревья получают одну и ту же последовательность.
+
+enum BenchWorkload { WORKLOAD_POINT, WORKLOAD_SHORT_RANGE, WORKLOAD_LONG_RANGE, WORKLOAD_MIXED, WORKLOAD_COUNT };
+
+static const char* bench_workload_name(int workload) {
+    switch (workload) {
+        case WORKLOAD_POINT: return "point";
+        case WORKLOAD_SHORT_RANGE: return "short";
+        case WORKLOAD_LONG_RANGE: return "long";
+        case WORKLOAD_MIXED: return "mixed";
+    }
+    return "?";
+}
+
+enum BenchOpKind { OP_POINT, OP_RANGE, OP_WRITE };
+
+struct BenchOp {
+    int kind;
+    int key;      // точечный поиск/начало диапазона - четный; запись - нечетный
+    int end_key;  // конец диапазона (включительно)
+};
+
+static long long bench_workload_ops(const struct BenchOptions* opt, int workload) {
+    if (workload != WORKLOAD_LONG_RANGE) return opt->ops;
+    return opt->ops / 100 > 10 ? opt->ops / 100 : 10;
+}
+
+static void bench_generate(struct BenchRng* rng, const struct BenchOptions* opt, int workload,
+                           struct BenchOp* ops, long long count) {
+    for (long long i = 0; i < count; i++) {
+        struct BenchOp* op = &ops[i];
+        if (workload == WORKLOAD_POINT ||
+            (workload == WORKLOAD_MIXED && bench_rng_below(rng, 100) >= opt->write_percent)) {
+            op->kind = OP_POINT;
+            op->key = 2 * (int)bench_rng_below(rng, opt->keys);
+            op->end_key = op->key;
+        } else if (workload == WORKLOAD_MIXED) {
+            op->kind = OP_WRITE;
+            op->key = 2 * (int)bench_rng_below(rng, opt->keys) + 1;
+            op->end_key = op->key;
+        } else {
+            int width = workload == WORKLOAD_SHORT_RANGE ? opt->short_width : opt->long_width;
+            op->kind = OP_RANGE;
+            op->key = 2 * (int)bench_rng_below(rng, opt->keys - width + 1);
+            op->end_key = op->key + 2 * (width - 1);
+        }
+    }
+}
+
+// ==================== ДЕРЕВЬЯ ПОД НАГРУЗКОЙ ====================
+// Для каждого варианта (дерево x хранилище) - контекст и три операции:
+// bench_point, bench_range, bench_write. Каждая возвращает вклад в
+// контрольную сумму, по которой сверяются результаты деревьев.
+// На диске форма дерева не меняется, поэтому запись - обновление значения
+// соседнего четного ключа; в памяти нечетный ключ вставляется.
+
+struct MemBPlusContext {
+    MemBPlusTree tree;
+};
+
+struct MemBTreeContext {
+    MemBTree tree;
+};
+
+struct DiskBPlusContext {
+    struct DiskSimulator disk;
+    struct BufferPool pool;
+    struct DiskTreeHeader header;
+    int* results;
+    long long max_results;
+};
+
+struct DiskBTreeContext {
+    struct DiskSimulator disk;
+    struct BufferPool pool;
+    struct DiskTreeHeader header;
+    int* results;
+    long long max_results;
+};
+
+static long long bench_point(struct MemBPlusContext* ctx, int key) {
+    int value = 0;
+    return bplus_search(&ctx->tree, key, &value) ? value : -1;
+}
+
+static long long bench_range(struct MemBPlusContext* ctx, int start_key, int end_key) {
+    BPlusCursor<MemBPlusTree> cursor;
+    BPlusSpan<MemBPlusTree> span;
+    long long sum = 0;
+    bplus_cursor_seek(&ctx->tree, &cursor, start_key, end_key);
+    while (bplus_cursor_next_n(&cursor, 256, &span) > 0) {
+        for (int i = 0; i < span.count; i++) sum += span.keys[i];
+    }
+    return sum;
+}
+
+static long long bench_write(struct MemBPlusContext* ctx, int key) {
+    bplus_insert(&ctx->tree, key, key);
+    return 0;
+}
+
+static long long bench_point(struct MemBTreeContext* ctx, int key) {
+    int value = 0;
+    return btree_search(&ctx->tree, key, &value) ? value : -1;
+}
+
+static long long bench_range(struct MemBTreeContext* ctx, int start_key, int end_key) {
+    BTreeCursor<MemBTree> cursor;
+    BTreeSpan<MemBTree> span;
+    long long sum = 0;
+    btree_cursor_seek(&ctx->tree, &cursor, start_key, end_key);
+    while (btree_cursor_next_n(&cursor, 256, &span) > 0) {
+        for (int i = 0; i < span.count; i++) sum += span.keys[i];
+    }
+    return sum;
+}
+
+static long long bench_write(struct MemBTreeContext* ctx, int key) {
+    btree_insert(&ctx->tree, key, key);
+    return 0;
+}
+
+static long long bench_point(struct DiskBPlusContext* ctx, int key) {
+    int value = 0;
+    return bplus_disk_search<DiskBPlusTree>(&ctx->pool, &ctx->header, key, &value) ? value : -1;
+}
+
+static long long bench_range(struct DiskBPlusContext* ctx, int start_key, int end_key) {
+    long long count = bplus_disk_range_query<DiskBPlusTree>(&ctx->pool, &ctx->header, start_key, end_key,
+                                                            ctx->results, ctx->max_results);
+    long long sum = 0;
+    for (long long i = 0; i < count && i < ctx->max_results; i++) sum += ctx->results[i];
+    return sum;
+}
+
+static long long bench_write(struct DiskBPlusContext* ctx, int key) {
+    bplus_disk_update<DiskBPlusTree>(&ctx->pool, &ctx->header, key - 1, -key);
+    return 0;
+}
+
+static long long bench_point(struct DiskBTreeContext* ctx, int key) {
+    int value = 0;
+    return btree_disk_search<DiskBTree>(&ctx->pool, &ctx->header, key, &value) ? value : -1;
+}
+
+static long long bench_range(struct DiskBTreeContext* ctx, int start_key, int end_key) {
+    long long count = btree_disk_range_query<DiskBTree>(&ctx->pool, &ctx->header, start_key, end_key,
+                                                        ctx->results, ctx->max_results);
+    long long sum = 0;
+    for (long long i = 0; i < count && i < ctx->max_results; i++) sum += ctx->results[i];
+    return sum;
+}
+
+static long long bench_write(struct DiskBTreeContext* ctx, int key) {
+    btree_disk_update<DiskBTree>(&ctx->pool, &ctx->header, key - 1, -key);
+    return 0;
+}
+
+// Ключи 0..n-1 в порядке, заданном seed (тасование Фишера-Йетса)
+static int* bench_shuffled_keys(int n, unsigned long long seed) {
+    struct BenchRng rng;
+    bench_rng_seed(&rng, seed);
+    int* keys = (int*)malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)bench_rng_below(&rng, i + 1);
+        int temp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = temp;
+    }
+    return keys;
+}
+
+// Построение: случайный порядок вставок, как у живого дерева
+static bool bench_setup(struct MemBPlusContext* ctx, const struct BenchOptions* opt, const int* order) {
+    bplus_tree_init(&ctx->tree);
+    for (int i = 0; i < opt->keys; i++) bplus_insert(&ctx->tree, 2 * order[i], 2 * order[i]);
+    return true;
+}
+
+static bool bench_setup(struct MemBTreeContext* ctx, const struct BenchOptions* opt, const int* order) {
+    btree_tree_init(&ctx->tree);
+    for (int i = 0; i < opt->keys; i++) btree_insert(&ctx->tree, 2 * order[i], 2 * order[i]);
+    return true;
+}
+
+// Дисковые варианты: дерево строится в памяти, записывается в файл
+// и дальше читается только через буферный пул
+static bool bench_setup(struct DiskBPlusContext* ctx, const struct BenchOptions* opt, const int* order) {
+    DiskBPlusTree tree;
+    bplus_tree_init(&tree);
+    for (int i = 0; i < opt->keys; i++) bplus_insert(&tree, 2 * order[i], 2 * order[i]);
+    const char* path = "bench_bplus.db";
+    bool ok = disk_open(&ctx->disk, path, true) && bplus_persist(&tree, &ctx->disk) &&
+              bplus_disk_open<DiskBPlusTree>(&ctx->disk, &ctx->header);
+    bplus_tree_free(&tree);
+    unlink(path);  // файл исчезнет при закрытии дескриптора
+    if (!ok) return false;
+    ctx->max_results = opt->long_width;
+    ctx->results = (int*)malloc(sizeof(int) * ctx->max_results);
+    int capacity = (int)(ctx->disk.page_count * opt->pool_percent / 100);
+    return buffer_pool_init(&ctx->pool, &ctx->disk, capacity > 16 ? capacity : 16, EVICT_CLOCK);
+}
+
+static bool bench_setup(struct DiskBTreeContext* ctx, const struct BenchOptions* opt, const int* order) {
+    DiskBTree tree;
+    btree_tree_init(&tree);
+    for (int i = 0; i < opt->keys; i++) btree_insert(&tree, 2 * order[i], 2 * order[i]);
+    const char* path = "bench_btree.db";
+    bool ok = disk_open(&ctx->disk, path, true) && btree_persist(&tree, &ctx->disk) &&
+              btree_disk_open<DiskBTree>(&ctx->disk, &ctx->header);
+    btree_tree_free(&tree);
+    unlink(path);
+    if (!ok) return false;
+    ctx->max_results = opt->long_width;
+    ctx->results = (int*)malloc(sizeof(int) * ctx->max_results);
+    int capacity = (int)(ctx->disk.page_count * opt->pool_percent / 100);
+    return buffer_pool_init(&ctx->pool, &ctx->disk, capacity > 16 ? capacity : 16, EVICT_CLOCK);
+}
+
+static void bench_teardown(struct MemBPlusContext* ctx) { bplus_tree_free(&ctx->tree); }
+static void bench_teardown(struct MemBTreeContext* ctx) { btree_tree_free(&ctx->tree); }
+
+static void bench_teardown(struct DiskBPlusContext* ctx) {
+    buffer_pool_destroy(&ctx->pool);
+    disk_close(&ctx->disk);
+    free(ctx->results);
+}
+
+static void bench_teardown(struct DiskBTreeContext* ctx) {
+    buffer_pool_destroy(&ctx->pool);
+    disk_close(&ctx->disk);
+    free(ctx->results);
+}
+
+// Счетчики хранилища: в памяти их нет
+static void bench_reset_counters(struct MemBPlusContext* ctx) {}
+static void bench_reset_counters(struct MemBTreeContext* ctx) {}
+
+static void bench_reset_counters(struct DiskBPlusContext* ctx) {
+    disk_reset_counters(&ctx->disk);
+    buffer_pool_reset_stats(&ctx->pool);
+}
+
+static void bench_reset_counters(struct DiskBTreeContext* ctx) {
+    disk_reset_counters(&ctx->disk);
+    buffer_pool_reset_stats(&ctx->pool);
+}
+
+// ==================== ЗАМЕР ====================
+
+struct BenchResult {
+    const char* tree;
+    const char* storage;
+    const char* workload;
+    long long ops;
+    double total_ns;
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+    double max_ns;
+    long long disk_reads;     // симулированные обращения DiskSimulator
+    long long disk_writes;
+    double pool_hit_rate;     // -1 - пула нет
+    long long checksum;
+};
+
+static int bench_compare_ticks(const void* a, const void* b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// Перцентиль по отсортированной выборке (ближайший ранг)
+static double bench_percentile(const unsigned long long* sorted, long long count, double p) {
+    long long rank = (long long)(p * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1] * g_ns_per_tick;
+}
+
+template <typename Context>
+static long long bench_execute(Context* ctx, const struct BenchOp* ops, long long count,
+                               unsigned long long* latencies) {
+    long long checksum = 0;
+    for (long long i = 0; i < count; i++) {
+        const struct BenchOp* op = &ops[i];
+        unsigned long long start = latencies != NULL ? bench_ticks() : 0;
+        if (op->kind == OP_POINT) checksum += bench_point(ctx, op->key);
+        else if (op->kind == OP_RANGE) checksum += bench_range(ctx, op->key, op->end_key);
+        else checksum += bench_write(ctx, op->key);
+        if (latencies != NULL) latencies[i] = bench_ticks() - start;
+    }
+    return checksum;
+}
+
+static void bench_collect(struct BenchResult* result, unsigned long long* latencies, long long count) {
+    double total = 0;
+    for (long long i = 0; i < count; i++) total += latencies[i];
+    qsort(latencies, count, sizeof(unsigned long long), bench_compare_ticks);
+    result->ops = count;
+    result->total_ns = total * g_ns_per_tick;
+    result->mean_ns = result->total_ns / count;
+    result->p50_ns = bench_percentile(latencies, count, 0.50);
+    result->p99_ns = bench_percentile(latencies, count, 0.99);
+    result->p999_ns = bench_percentile(latencies, count, 0.999);
+    result->max_ns = latencies[count - 1] * g_ns_per_tick;
+}
+
+static void bench_storage_stats(struct BenchResult* result, struct MemBPlusContext* ctx) {
+    result->disk_reads = result->disk_writes = 0;
+    result->pool_hit_rate = -1;
+}
+
+static void bench_storage_stats(struct BenchResult* result, struct MemBTreeContext* ctx) {
+    result->disk_reads = result->disk_writes = 0;
+    result->pool_hit_rate = -1;
+}
+
+// Грязные страницы сбрасываются до снятия счетчиков, чтобы записи учлись
+template <typename Context>
+static void bench_disk_stats(struct BenchResult* result, Context* ctx) {
+    double hit_rate = buffer_pool_hit_rate(&ctx->pool);
+    buffer_pool_flush(&ctx->pool);
+    result->disk_reads = ctx->disk.read_count;
+    result->disk_writes = ctx->disk.write_count;
+    result->pool_hit_rate = hit_rate;
+}
+
+static void bench_storage_stats(struct BenchResult* result, struct DiskBPlusContext* ctx) {
+    bench_disk_stats(result, ctx);
+}
+
+static void bench_storage_stats(struct BenchResult* result, struct DiskBTreeContext* ctx) {
+    bench_disk_stats(result, ctx);
+}
+
+// Все выбранные нагрузки на одном варианте дерева.
+// Каждая нагрузка начинается с нового дерева, чтобы записи mixed не влияли на остальные.
+template <typename Context>
+static int bench_variant(const char* tree_name, const char* storage_name, const struct BenchOptions* opt,
+                         const int* order, struct BenchResult* results) {
+    if (!bench_selected(opt->tree_filter, tree_name) || !bench_selected(opt->storage_filter, storage_name)) {
+        return 0;
+    }
+    int produced = 0;
+    for (int workload = 0; workload < WORKLOAD_COUNT; workload++) {
+        if (!bench_selected(opt->workload_filter, bench_workload_name(workload))) continue;
+
+        Context* ctx = (Context*)malloc(sizeof(Context));
+        if (!bench_setup(ctx, opt, order)) {
+            fprintf(stderr, "ОШИБКА: не удалось построить %s/%s\n", tree_name, storage_name);
+            free(ctx);
+            return produced;
+        }
+
+        // Своя последовательность на каждую нагрузку: от seed и номера нагрузки
+        struct BenchRng rng;
+        bench_rng_seed(&rng, opt->seed * 31 + workload);
+        long long count = bench_workload_ops(opt, workload);
+        long long warmup = workload == WORKLOAD_LONG_RANGE ? opt->warmup / 100 : opt->warmup;
+        struct BenchOp* ops = (struct BenchOp*)malloc(sizeof(struct BenchOp) * (count + warmup));
+        bench_generate(&rng, opt, workload, ops, count + warmup);
+        unsigned long long* latencies = (unsigned long long*)malloc(sizeof(unsigned long long) * count);
+
+        bench_execute(ctx, ops, warmup, NULL);
+        bench_reset_counters(ctx);
+        struct BenchResult* result = &results[produced++];
+        result->tree = tree_name;
+        result->storage = storage_name;
+        result->workload = bench_workload_name(workload);
+        result->checksum = bench_execute(ctx, ops + warmup, count, latencies);
+        bench_collect(result, latencies, count);
+        bench_storage_stats(result, ctx);
+
+        free(latencies);
+        free(ops);
+        bench_teardown(ctx);
+        free(ctx);
+    }
+    return produced;
+}
+
+// ==================== ВЫВОД ====================
+
+static void bench_print_table(FILE* out, const struct BenchOptions* opt, const struct BenchResult* results, int count) {
+    fprintf(out, "Ключей: %d, операций: %lld, прогрев: %lld, seed: %llu, таймер: %s, пул: %d%%\n\n",
+            opt->keys, opt->ops, opt->warmup, opt->seed,
+            g_timer == TIMER_RDTSC ? "rdtsc" : "steady_clock", opt->pool_percent);
+    fprintf(out, "%-6s | %-5s | %-6s | %-8s | %-11s | %-10s | %-10s | %-10s | %-10s | %-9s | %-9s | %-6s\n",
+            "tree", "store", "load", "ops", "ops/s", "mean ns", "p50 ns", "p99 ns", "p999 ns",
+            "reads", "writes", "hit%");
+    fprintf(out, "-------|-------|--------|----------|-------------|------------|------------|"
+                 "------------|------------|-----------|-----------|-------\n");
+    for (int i = 0; i < count; i++) {
+        const struct BenchResult* r = &results[i];
+        char hit[16] = "-";
+        if (r->pool_hit_rate >= 0) snprintf(hit, sizeof(hit), "%.1f", r->pool_hit_rate * 100);
+        fprintf(out, "%-6s | %-5s | %-6s | %-8lld | %-11.0f | %-10.0f | %-10.0f | %-10.0f | %-10.0f | %-9lld | %-9lld | %-6s\n",
+                r->tree, r->storage, r->workload, r->ops, r->ops * 1e9 / r->total_ns,
+                r->mean_ns, r->p50_ns, r->p99_ns, r->p999_ns, r->disk_reads, r->disk_writes, hit);
+    }
+}
+
+static void bench_print_csv(FILE* out, const struct BenchOptions* opt, const struct BenchResult* results, int count) {
+    fprintf(out, "tree,storage,workload,keys,ops,seed,timer,ops_per_sec,mean_ns,p50_ns,p99_ns,p999_ns,max_ns,"
+                 "disk_reads,disk_writes,pool_hit_rate,checksum\n");
+    for (int i = 0; i < count; i++) {
+        const struct BenchResult* r = &results[i];
+        fprintf(out, "%s,%s,%s,%d,%lld,%llu,%s,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%lld,%lld,%.4f,%lld\n",
+                r->tree, r->storage, r->workload, opt->keys, r->ops, opt->seed,
+                g_timer == TIMER_RDTSC ? "rdtsc" : "steady", r->ops * 1e9 / r->total_ns,
+                r->mean_ns, r->p50_ns, r->p99_ns, r->p999_ns, r->max_ns,
+                r->disk_reads, r->disk_writes, r->pool_hit_rate, r->checksum);
+    }
+}
+
+static void bench_print_json(FILE* out, const struct BenchOptions* opt, const struct BenchResult* results, int count) {
+    fprintf(out, "{\n  \"keys\": %d,\n  \"ops\": %lld,\n  \"warmup\": %lld,\n  \"seed\": %llu,\n"
+                 "  \"timer\": \"%s\",\n  \"pool_percent\": %d,\n  \"results\": [\n",
+            opt->keys, opt->ops, opt->warmup, opt->seed,
+            g_timer == TIMER_RDTSC ? "rdtsc" : "steady", opt->pool_percent);
+    for (int i = 0; i < count; i++) {
+        const struct BenchResult* r = &results[i];
+        fprintf(out, "    {\"tree\": \"%s\", \"storage\": \"%s\", \"workload\": \"%s\", \"ops\": %lld, "
+                     "\"ops_per_sec\": %.1f, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, "
+                     "\"p999_ns\": %.1f, \"max_ns\": %.1f, \"disk_reads\": %lld, \"disk_writes\": %lld, "
+                     "\"pool_hit_rate\": %.4f, \"checksum\": %lld}%s\n",
+                r->tree, r->storage, r->workload, r->ops, r->ops * 1e9 / r->total_ns,
+                r->mean_ns, r->p50_ns, r->p99_ns, r->p999_ns, r->max_ns,
+                r->disk_reads, r->disk_writes, r->pool_hit_rate, r->checksum,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// Деревья на одной и той же нагрузке обязаны дать одинаковую контрольную сумму
+static int bench_check_results(const struct BenchResult* results, int count) {
+    int errors = 0;
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            const struct BenchResult* a = &results[i];
+            const struct BenchResult* b = &results[j];
+            if (strcmp(a->storage, b->storage) == 0 && strcmp(a->workload, b->workload) == 0 &&
+                a->checksum != b->checksum) {
+                fprintf(stderr, "ОШИБКА: %s и %s разошлись на %s/%s\n", a->tree, b->tree, a->storage, a->workload);
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char** argv) {
+    struct BenchOptions opt;
+    bench_default_options(&opt);
+    if (!bench_parse_options(argc, argv, &opt)) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+    bench_calibrate_timer();
+
+    FILE* out = stdout;
+    if (opt.out_path != NULL) {
+        out = fopen(opt.out_path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Не удалось открыть %s\n", opt.out_path);
+            return 1;
+        }
+    }
+
+    int* order = bench_shuffled_keys(opt.keys, opt.seed);
+    struct BenchResult results[4 * WORKLOAD_COUNT];
+    int count = 0;
+    count += bench_variant<MemBPlusContext>("bplus", "mem", &opt, order, results + count);
+    count += bench_variant<MemBTreeContext>("btree", "mem", &opt, order, results + count);
+    count += bench_variant<DiskBPlusContext>("bplus", "disk", &opt, order, results + count);
+    count += bench_variant<DiskBTreeContext>("btree", "disk", &opt, order, results + count);
+
+    if (opt.format == FORMAT_TABLE) bench_print_table(out, &opt, results, count);
+    else if (opt.format == FORMAT_CSV) bench_print_csv(out, &opt, results, count);
+    else bench_print_json(out, &opt, results, count);
+
+    int errors = bench_check_results(results, count);
+    if (out != stdout) fclose(out);
+    free(order);
+    return errors == 0 ? 0 : 2;
+}
@@ -0,0 +1,1241 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <type_traits>
+
+#include "disk.h"
+#include "simd_search.h"
+#include "node_arena.h"
+#include "stats.h"
+
+// Вывод ключей для отладочной печати
+inline void print_key(int key) { printf("%d", key); }
+inline void print_key(long long key) { printf("%lld", key); }
+inline void print_key(unsigned int key) { printf("%u", key); }
+inline void print_key(unsigned long long key) { printf("%llu", key); }
+
+// Структура для B+-дерева
+// K - тип ключа, V - тип значения, ORDER - максимальное число детей.
+// Дети внутренних узлов и данные/ссылка на соседа у листьев лежат в разных
+// полях union: next_leaf не перекрывает children[0] и data[].
+// Узел выровнен по кэш-линии, поэтому sizeof кратен 64 байтам.
+template <typename K, typename V, int ORDER>
+struct alignas(CACHE_LINE_SIZE) BPlusNode {
+    static_assert(ORDER >= 3, "порядок B+-дерева должен быть не меньше 3");
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "ключи и значения копируются как байты");
+
+    typedef K Key;
+    typedef V Value;
+    static const int order = ORDER;
+
+    K keys[ORDER - 1];
+    union {
+        long long children[ORDER]; // для внутренних узлов
+        struct {
+            V data[ORDER - 1]; // данные в листьях
+            BPlusNode* next_leaf; // для листьев
+            long long next_offset; // offset соседа (заполняется при записи на диск)
+        };
+    };
+    int key_count;
+    bool is_leaf;
+    long long offset;
+};
+
+// Наибольший порядок, при котором узел помещается в BYTES байт
+// (BYTES = CACHE_LINE_SIZE * n или DISK_PAGE_SIZE)
+template <typename K, typename V, int BYTES, int ORDER = 3>
+constexpr int bplus_order_for() {
+    static_assert(sizeof(BPlusNode<K, V, 3>) <= BYTES, "узел не помещается даже при порядке 3");
+    if constexpr (sizeof(BPlusNode<K, V, ORDER + 1>) > BYTES) return ORDER;
+    else return bplus_order_for<K, V, BYTES, ORDER + 1>();
+}
+
+// arena = NULL - отдельный aligned_alloc на узел
+template <typename Node>
+Node* create_bplus_node(bool is_leaf, long long offset, struct NodeArena* arena = NULL) {
+    Node* node = arena != NULL ? (Node*)node_arena_alloc(arena, is_leaf)
+                               : (Node*)aligned_alloc(alignof(Node), sizeof(Node));
+    node->key_count = 0;
+    node->is_leaf = is_leaf;
+    node->offset = offset;
+    if (is_leaf) node->next_leaf = NULL;
+    else for (int i = 0; i < Node::order; i++) node->children[i] = 0;
+    return node;
+}
+
+// Дерево целиком: корень + счетчики для отчетов
+template <typename K, typename V, int ORDER>
+struct BPlusTree {
+    typedef K Key;
+    typedef V Value;
+    typedef BPlusNode<K, V, ORDER> Node;
+    static const int order = ORDER;
+
+    Node* root;
+    int height;              // число уровней (1 = только корень-лист)
+    long long node_count;
+    long long next_node_offset;  // offset следующего нового узла; только растет
+    long long leaf_count;
+    long long key_count;
+    struct NodeArena* arena;   // NULL - узлы через malloc
+};
+
+// B+-дерево, узел которого занимает LINES кэш-линий
+template <typename K, typename V, int LINES>
+using CacheLineBPlusTree = BPlusTree<K, V, bplus_order_for<K, V, CACHE_LINE_SIZE * LINES>()>;
+
+// B+-дерево, узел которого занимает одну дисковую страницу
+template <typename K, typename V>
+using PageBPlusTree = BPlusTree<K, V, bplus_order_for<K, V, DISK_PAGE_SIZE>()>;
+
+template <typename Tree>
+void bplus_tree_init(Tree* tree) {
+    tree->arena = NULL;
+    tree->root = create_bplus_node<typename Tree::Node>(true, 0);
+    tree->height = 1;
+    tree->node_count = 1;
+    tree->next_node_offset = 1;
+    tree->leaf_count = 1;
+    tree->key_count = 0;
+}
+
+// Дерево, узлы которого берутся из собственной арены
+template <typename Tree>
+void bplus_tree_init_arena(Tree* tree, ArenaPlacement placement, int nodes_per_block = 0) {
+    tree->arena = (struct NodeArena*)malloc(sizeof(struct NodeArena));
+    node_arena_init(tree->arena, sizeof(typename Tree::Node), nodes_per_block, placement);
+    tree->root = create_bplus_node<typename Tree::Node>(true, 0, tree->arena);
+    tree->height = 1;
+    tree->node_count = 1;
+    tree->next_node_offset = 1;
+    tree->leaf_count = 1;
+    tree->key_count = 0;
+}
+
+// offset нового узла - следующий еще не выданный номер (id страницы).
+// Берется не из node_count: тот уменьшается при удалении узлов, и новый
+// узел получил бы offset живого, а запись на диск - две страницы в одну.
+template <typename Tree>
+typename Tree::Node* bplus_tree_new_node(Tree* tree, bool is_leaf) {
+    typename Tree::Node* node = create_bplus_node<typename Tree::Node>(is_leaf, tree->next_node_offset++,
+                                                                       tree->arena);
+    tree->node_count++;
+    if (is_leaf) tree->leaf_count++;
+    return node;
+}
+
+// Освобождение одного узла (в арену или через free)
+template <typename Tree>
+void bplus_tree_release_node(Tree* tree, typename Tree::Node* node) {
+    if (tree->arena != NULL) node_arena_release(tree->arena, node, node->is_leaf);
+    else free(node);
+}
+
+// Вставка в поддерево. Если узел переполнился и разделился, наверх
+// возвращаются разделяющий ключ (split_key) и новый правый узел (split_node).
+// Возвращает false, если ключ уже был (значение обновляется).
+template <typename Tree>
+bool bplus_insert_into(Tree* tree, typename Tree::Node* node,
+                       typename Tree::Key key, typename Tree::Value value,
+                       typename Tree::Key* split_key, typename Tree::Node** split_node) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    typedef typename Tree::Value V;
+    const int ORDER = Tree::order;
+    *split_node = NULL;
+
+    if (node->is_leaf) {
+        int pos = node_lower_bound(node->keys, node->key_count, key);
+        if (pos < node->key_count && node->keys[pos] == key) {
+            node->data[pos] = value;
+            return false;
+        }
+
+        if (node->key_count < ORDER - 1) {
+            for (int i = node->key_count; i > pos; i--) {
+                node->keys[i] = node->keys[i - 1];
+                node->data[i] = node->data[i - 1];
+            }
+            node->keys[pos] = key;
+            node->data[pos] = value;
+            node->key_count++;
+            return true;
+        }
+
+        // Лист полон: собираем ORDER ключей и делим пополам
+        K tmp_keys[ORDER];
+        V tmp_data[ORDER];
+        for (int i = 0, j = 0; i < ORDER; i++) {
+            if (i == pos) {
+                tmp_keys[i] = key;
+                tmp_data[i] = value;
+            } else {
+                tmp_keys[i] = node->keys[j];
+                tmp_data[i] = node->data[j];
+                j++;
+            }
+        }
+
+        int left_count = (ORDER + 1) / 2;
+        Node* right = bplus_tree_new_node(tree, true);
+        node->key_count = 0;
+        for (int i = 0; i < left_count; i++) {
+            node->keys[node->key_count] = tmp_keys[i];
+            node->data[node->key_count++] = tmp_data[i];
+        }
+        for (int i = left_count; i < ORDER; i++) {
+            right->keys[right->key_count] = tmp_keys[i];
+            right->data[right->key_count++] = tmp_data[i];
+        }
+
+        // Встраиваем новый лист в связный список
+        right->next_leaf = node->next_leaf;
+        node->next_leaf = right;
+
+        STATS_COUNT(STAT_SPLITS, 1);
+        *split_key = right->keys[0];
+        *split_node = right;
+        return true;
+    }
+
+    // Внутренний узел: спускаемся в нужного ребенка
+    int i = node_upper_bound(node->keys, node->key_count, key);
+
+    K child_key;
+    Node* child_split;
+    bool inserted = bplus_insert_into(tree, (Node*)node->children[i],
+                                      key, value, &child_key, &child_split);
+    if (child_split == NULL) return inserted;
+
+    if (node->key_count < ORDER - 1) {
+        for (int j = node->key_count; j > i; j--) {
+            node->keys[j] = node->keys[j - 1];
+            node->children[j + 1] = node->children[j];
+        }
+        node->keys[i] = child_key;
+        node->children[i + 1] = (long long)child_split;
+        node->key_count++;
+        return inserted;
+    }
+
+    // Внутренний узел полон: средний ключ уходит наверх
+    K tmp_keys[ORDER];
+    long long tmp_children[ORDER + 1];
+    for (int j = 0, k = 0; j < ORDER; j++) {
+        tmp_keys[j] = (j == i) ? child_key : node->keys[k++];
+    }
+    for (int j = 0, k = 0; j < ORDER + 1; j++) {
+        tmp_children[j] = (j == i + 1) ? (long long)child_split : node->children[k++];
+    }
+
+    int mid = ORDER / 2;
+    Node* right = bplus_tree_new_node(tree, false);
+    node->key_count = mid;
+    for (int j = 0; j < mid; j++) {
+        node->keys[j] = tmp_keys[j];
+        node->children[j] = tmp_children[j];
+    }
+    node->children[mid] = tmp_children[mid];
+    for (int j = mid + 1; j < ORDER; j++) {
+        right->keys[right->key_count] = tmp_keys[j];
+        right->children[right->key_count++] = tmp_children[j];
+    }
+    right->children[right->key_count] = tmp_children[ORDER];
+
+    STATS_COUNT(STAT_SPLITS, 1);
+    *split_key = tmp_keys[mid];
+    *split_node = right;
+    return inserted;
+}
+
+// Вставка ключа в дерево; при расщеплении корня дерево растет вверх
+template <typename Tree>
+bool bplus_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_INSERT);
+    STATS_VISIT(stat, tree->height);
+    typename Tree::Key split_key;
+    Node* split_node;
+    bool inserted = bplus_insert_into(tree, tree->root, key, value, &split_key, &split_node);
+
+    if (split_node != NULL) {
+        Node* new_root = bplus_tree_new_node(tree, false);
+        new_root->keys[0] = split_key;
+        new_root->children[0] = (long long)tree->root;
+        new_root->children[1] = (long long)split_node;
+        new_root->key_count = 1;
+        tree->root = new_root;
+        tree->height++;
+    }
+    if (inserted) tree->key_count++;
+    STATS_END(stat);
+    return inserted;
+}
+
+// Точечный поиск
+template <typename Tree>
+bool bplus_search(Tree* tree, typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_SEARCH);
+    Node* current = tree->root;
+    while (!current->is_leaf) {
+        int i = node_upper_bound(current->keys, current->key_count, key);
+        current = (Node*)current->children[i];
+        STATS_VISIT(stat, 1);
+    }
+    STATS_VISIT(stat, 1);
+    int pos = node_lower_bound(current->keys, current->key_count, key);
+    bool found = pos < current->key_count && current->keys[pos] == key;
+    if (found && value != NULL) *value = current->data[pos];
+    STATS_END(stat);
+    return found;
+}
+
+// Число записей в узле при заданной заполненности, в пределах [min_count, max_count]
+inline int bplus_fill_count(double fill_factor, int max_count, int min_count) {
+    int count = (int)(fill_factor * max_count + 0.5);
+    if (count > max_count) count = max_count;
+    if (count < min_count) count = min_count;
+    return count;
+}
+
+// ==================== УДАЛЕНИЕ ====================
+// Минимум записей вне корня: листу ORDER / 2 ключей, внутреннему узлу
+// (ORDER + 1) / 2 детей - столько оставляет расщепление. Узел, в котором
+// после удаления записей меньше минимума, берет запись у соседа с тем же
+// родителем, а если у соседа лишних нет - сливается с ним. Разделители
+// родителя при удалении ключа из листа не меняются: они остаются верными
+// границами, даже если такого ключа в дереве уже нет.
+// offset освобожденных узлов не выдаются повторно, поэтому в файле дерева
+// после удалений остаются неиспользуемые страницы; bplus_tree_renumber()
+// перед записью нумерует узлы заново подряд.
+
+template <typename Tree>
+inline int bplus_min_keys(bool is_leaf) {
+    return is_leaf ? Tree::order / 2 : (Tree::order + 1) / 2 - 1;
+}
+
+// Удалить узел, опустевший после слияния
+template <typename Tree>
+void bplus_tree_drop_node(Tree* tree, typename Tree::Node* node) {
+    tree->node_count--;
+    if (node->is_leaf) tree->leaf_count--;
+    bplus_tree_release_node(tree, node);
+}
+
+// Слить детей i и i + 1 узла parent в ребенка i
+template <typename Tree>
+void bplus_merge_children(Tree* tree, typename Tree::Node* parent, int i) {
+    typedef typename Tree::Node Node;
+    Node* left = (Node*)parent->children[i];
+    Node* right = (Node*)parent->children[i + 1];
+    if (left->is_leaf) {
+        for (int j = 0; j < right->key_count; j++) {
+            left->keys[left->key_count] = right->keys[j];
+            left->data[left->key_count++] = right->data[j];
+        }
+        left->next_leaf = right->next_leaf;
+    } else {
+        left->keys[left->key_count++] = parent->keys[i];
+        for (int j = 0; j < right->key_count; j++) {
+            left->keys[left->key_count] = right->keys[j];
+            left->children[left->key_count++] = right->children[j];
+        }
+        left->children[left->key_count] = right->children[right->key_count];
+    }
+    for (int j = i; j < parent->key_count - 1; j++) {
+        parent->keys[j] = parent->keys[j + 1];
+        parent->children[j + 1] = parent->children[j + 2];
+    }
+    parent->key_count--;
+    bplus_tree_drop_node(tree, right);
+    STATS_COUNT(STAT_MERGES, 1);
+}
+
+// Ребенок i узла parent недозаполнен: занять запись у соседа или слиться
+template <typename Tree>
+void bplus_fix_child(Tree* tree, typename Tree::Node* parent, int i) {
+    typedef typename Tree::Node Node;
+    Node* child = (Node*)parent->children[i];
+    int min_keys = bplus_min_keys<Tree>(child->is_leaf);
+    if (child->key_count >= min_keys) return;
+
+    Node* left = i > 0 ? (Node*)parent->children[i - 1] : NULL;
+    Node* right = i < parent->key_count ? (Node*)parent->children[i + 1] : NULL;
+    if (left != NULL && left->key_count > min_keys) {
+        // Последняя запись левого соседа переходит в начало child
+        for (int j = child->key_count; j > 0; j--) child->keys[j] = child->keys[j - 1];
+        if (child->is_leaf) {
+            for (int j = child->key_count; j > 0; j--) child->data[j] = child->data[j - 1];
+            child->keys[0] = left->keys[left->key_count - 1];
+            child->data[0] = left->data[left->key_count - 1];
+            parent->keys[i - 1] = child->keys[0];
+        } else {
+            for (int j = child->key_count + 1; j > 0; j--) child->children[j] = child->children[j - 1];
+            child->keys[0] = parent->keys[i - 1];
+            child->children[0] = left->children[left->key_count];
+            parent->keys[i - 1] = left->keys[left->key_count - 1];
+        }
+        child->key_count++;
+        left->key_count--;
+        STATS_COUNT(STAT_BORROWS, 1);
+    } else if (right != NULL && right->key_count > min_keys) {
+        // Первая запись правого соседа переходит в конец child
+        if (child->is_leaf) {
+            child->keys[child->key_count] = right->keys[0];
+            child->data[child->key_count] = right->data[0];
+            for (int j = 0; j < right->key_count - 1; j++) {
+                right->keys[j] = right->keys[j + 1];
+                right->data[j] = right->data[j + 1];
+            }
+            parent->keys[i] = right->keys[0];
+        } else {
+            child->keys[child->key_count] = parent->keys[i];
+            child->children[child->key_count + 1] = right->children[0];
+            parent->keys[i] = right->keys[0];
+            for (int j = 0; j < right->key_count - 1; j++) right->keys[j] = right->keys[j + 1];
+            for (int j = 0; j < right->key_count; j++) right->children[j] = right->children[j + 1];
+        }
+        child->key_count++;
+        right->key_count--;
+        STATS_COUNT(STAT_BORROWS, 1);
+    } else if (left != NULL) {
+        bplus_merge_children(tree, parent, i - 1);
+    } else if (right != NULL) {
+        bplus_merge_children(tree, parent, i);
+    }
+}
+
+// Удаление из поддерева; возвращает false, если ключа не было
+template <typename Tree>
+bool bplus_delete_from(Tree* tree, typename Tree::Node* node, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    if (node->is_leaf) {
+        int pos = node_lower_bound(node->keys, node->key_count, key);
+        if (pos >= node->key_count || node->keys[pos] != key) return false;
+        for (int j = pos; j < node->key_count - 1; j++) {
+            node->keys[j] = node->keys[j + 1];
+            node->data[j] = node->data[j + 1];
+        }
+        node->key_count--;
+        return true;
+    }
+    int i = node_upper_bound(node->keys, node->key_count, key);
+    if (!bplus_delete_from(tree, (Node*)node->children[i], key)) return false;
+    bplus_fix_child(tree, node, i);
+    return true;
+}
+
+// Корень без ключей с единственным ребенком уступает место ребенку
+template <typename Tree>
+void bplus_shrink_root(Tree* tree) {
+    typedef typename Tree::Node Node;
+    while (!tree->root->is_leaf && tree->root->key_count == 0) {
+        Node* old_root = tree->root;
+        tree->root = (Node*)old_root->children[0];
+        bplus_tree_drop_node(tree, old_root);
+        tree->height--;
+    }
+}
+
+template <typename Tree>
+bool bplus_delete(Tree* tree, typename Tree::Key key) {
+    STATS_TIMER(stat, STAT_OP_DELETE);
+    STATS_VISIT(stat, tree->height);
+    bool deleted = bplus_delete_from(tree, tree->root, key);
+    if (deleted) {
+        bplus_shrink_root(tree);
+        tree->key_count--;
+    }
+    STATS_END(stat);
+    return deleted;
+}
+
+// Переназначить offset узлов подряд в порядке обхода в ширину
+template <typename Tree>
+void bplus_tree_renumber(Tree* tree) {
+    typedef typename Tree::Node Node;
+    Node** queue = (Node**)malloc(sizeof(Node*) * tree->node_count);
+    long long head = 0, tail = 0;
+    queue[tail++] = tree->root;
+    while (head < tail) {
+        Node* node = queue[head];
+        node->offset = head++;
+        if (node->is_leaf) continue;
+        for (int i = 0; i <= node->key_count; i++) queue[tail++] = (Node*)node->children[i];
+    }
+    free(queue);
+    tree->next_node_offset = head;
+}
+
+// ==================== ОНЛАЙН-УПЛОТНЕНИЕ ЛИСТЬЕВ ====================
+// После удалений листья держатся на нижней границе заполнения. Уплотнение
+// идет по цепочке next_leaf небольшими шагами: шаг берет детей-листья
+// одного родителя и перекладывает их ключи в меньшее число листьев до
+// заданной заполненности, освобождая лишние. Родитель, потерявший детей,
+// чинится на пути обратно к корню тем же заимствованием и слиянием, что
+// и при удалении. Между шагами дерево целиком согласовано, поэтому
+// запросы можно выполнять вперемешку с шагами: проход не держит дерево
+// дольше, чем требует переупаковка одного родителя.
+
+template <typename Tree>
+struct BPlusCompactor {
+    typename Tree::Key next_key;   // шаг начинается с листа, где лежит этот ключ
+    bool done;
+    int leaf_fill;                 // целевое число ключей в листе
+    long long steps;
+    long long leaves_released;
+};
+
+// Переупаковка детей-листьев parent; возвращает лист после последнего из них
+template <typename Tree>
+typename Tree::Node* bplus_compact_leaves(Tree* tree, typename Tree::Node* parent,
+                                          BPlusCompactor<Tree>* compactor) {
+    typedef typename Tree::Node Node;
+    int children = parent->key_count + 1;
+    Node* next = ((Node*)parent->children[children - 1])->next_leaf;
+    long long total = 0;
+    for (int i = 0; i < children; i++) total += ((Node*)parent->children[i])->key_count;
+
+    // Листьев столько, чтобы каждый был заполнен не выше цели и не ниже минимума
+    int target = (int)((total + compactor->leaf_fill - 1) / compactor->leaf_fill);
+    int most = (int)(total / bplus_min_keys<Tree>(true));
+    if (target > most) target = most;
+    if (target < 1) target = 1;
+    if (target >= children) return next;
+
+    typename Tree::Key* keys = (typename Tree::Key*)malloc(sizeof(typename Tree::Key) * total);
+    typename Tree::Value* data = (typename Tree::Value*)malloc(sizeof(typename Tree::Value) * total);
+    long long pos = 0;
+    for (int i = 0; i < children; i++) {
+        Node* leaf = (Node*)parent->children[i];
+        memcpy(keys + pos, leaf->keys, sizeof(typename Tree::Key) * leaf->key_count);
+        memcpy(data + pos, leaf->data, sizeof(typename Tree::Value) * leaf->key_count);
+        pos += leaf->key_count;
+    }
+    long long base = total / target, extra = total % target;
+    pos = 0;
+    for (int t = 0; t < target; t++) {
+        Node* leaf = (Node*)parent->children[t];
+        leaf->key_count = (int)(base + (t < extra ? 1 : 0));
+        memcpy(leaf->keys, keys + pos, sizeof(typename Tree::Key) * leaf->key_count);
+        memcpy(leaf->data, data + pos, sizeof(typename Tree::Value) * leaf->key_count);
+        pos += leaf->key_count;
+        if (t > 0) parent->keys[t - 1] = leaf->keys[0];
+    }
+    free(keys);
+    free(data);
+    ((Node*)parent->children[target - 1])->next_leaf = next;
+    for (int i = target; i < children; i++) bplus_tree_drop_node(tree, (Node*)parent->children[i]);
+    parent->key_count = target - 1;
+    compactor->leaves_released += children - target;
+    return next;
+}
+
+// Спуск к родителю листа с compactor->next_key, переупаковка его детей и
+// починка недозаполненных узлов на обратном пути
+template <typename Tree>
+typename Tree::Node* bplus_compact_from(Tree* tree, typename Tree::Node* node, BPlusCompactor<Tree>* compactor) {
+    typedef typename Tree::Node Node;
+    if (((Node*)node->children[0])->is_leaf) return bplus_compact_leaves(tree, node, compactor);
+    int i = node_upper_bound(node->keys, node->key_count, compactor->next_key);
+    Node* next = bplus_compact_from(tree, (Node*)node->children[i], compactor);
+    bplus_fix_child(tree, node, i);
+    return next;
+}
+
+// fill_factor - целевая заполненность листьев после уплотнения
+template <typename Tree>
+void bplus_compact_begin(Tree* tree, BPlusCompactor<Tree>* compactor, double fill_factor) {
+    typedef typename Tree::Node Node;
+    Node* leaf = tree->root;
+    while (!leaf->is_leaf) leaf = (Node*)leaf->children[0];
+    compactor->done = tree->root->is_leaf || leaf->key_count == 0;
+    if (!compactor->done) compactor->next_key = leaf->keys[0];
+    compactor->leaf_fill = bplus_fill_count(fill_factor, Tree::order - 1, bplus_min_keys<Tree>(true));
+    compactor->steps = 0;
+    compactor->leaves_released = 0;
+}
+
+// Один шаг: дети-листья одного родителя. false - проход завершен.
+template <typename Tree>
+bool bplus_compact_step(Tree* tree, BPlusCompactor<Tree>* compactor) {
+    if (compactor->done) return false;
+    if (tree->root->is_leaf) {
+        compactor->done = true;
+        return false;
+    }
+    typename Tree::Node* next = bplus_compact_from(tree, tree->root, compactor);
+    bplus_shrink_root(tree);
+    compactor->steps++;
+    if (next == NULL) compactor->done = true;
+    else compactor->next_key = next->keys[0];
+    return !compactor->done;
+}
+
+// Полный проход; возвращает число освобожденных листьев
+template <typename Tree>
+long long bplus_compact(Tree* tree, double fill_factor) {
+    BPlusCompactor<Tree> compactor;
+    bplus_compact_begin(tree, &compactor, fill_factor);
+    while (bplus_compact_step(tree, &compactor)) {}
+    return compactor.leaves_released;
+}
+
+template <typename Node>
+void bplus_free_node(Node* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) {
+            bplus_free_node((Node*)node->children[i]);
+        }
+    }
+    free(node);
+}
+
+// С ареной - один вызов на все дерево, без обхода узлов
+template <typename Tree>
+void bplus_tree_free(Tree* tree) {
+    if (tree->arena != NULL) {
+        node_arena_destroy(tree->arena);
+        free(tree->arena);
+        tree->arena = NULL;
+    } else {
+        bplus_free_node(tree->root);
+    }
+    tree->root = NULL;
+}
+
+// Переложить узлы в новую арену по уровням (обход в ширину): верхние уровни
+// лежат компактно в начале, листья - одной серией в порядке ключей.
+// Старые узлы освобождаются; offset узлов не меняется.
+template <typename Tree>
+bool bplus_tree_relayout(Tree* tree, ArenaPlacement placement) {
+    typedef typename Tree::Node Node;
+    struct NodeArena* arena = (struct NodeArena*)malloc(sizeof(struct NodeArena));
+    Node** queue = (Node**)malloc(sizeof(Node*) * tree->node_count);
+    if (arena == NULL || queue == NULL) {
+        free(arena);
+        free(queue);
+        return false;
+    }
+    node_arena_init(arena, sizeof(Node), 0, placement);
+
+    Node* root = (Node*)node_arena_alloc(arena, tree->root->is_leaf);
+    memcpy(root, tree->root, sizeof(Node));
+    long long head = 0, tail = 0;
+    queue[tail++] = root;
+    Node* prev_leaf = NULL;
+    while (head < tail) {
+        Node* node = queue[head++];
+        if (node->is_leaf) {
+            // Листья одного уровня идут в обходе слева направо
+            node->next_leaf = NULL;
+            if (prev_leaf != NULL) prev_leaf->next_leaf = node;
+            prev_leaf = node;
+            continue;
+        }
+        for (int i = 0; i <= node->key_count; i++) {
+            Node* child = (Node*)node->children[i];
+            Node* copy = (Node*)node_arena_alloc(arena, child->is_leaf);
+            memcpy(copy, child, sizeof(Node));
+            node->children[i] = (long long)copy;
+            queue[tail++] = copy;
+        }
+    }
+    free(queue);
+
+    bplus_tree_free(tree);
+    tree->root = root;
+    tree->arena = arena;
+    return true;
+}
+
+// Range query для B+-дерева с отладочной печатью просмотренных листьев.
+// Найденные ключи печатаются по ходу обхода, поэтому размер диапазона не
+// ограничен; возвращается их число. Для замеров - курсор ниже (без печати).
+template <typename Node>
+long long bplus_range_query(Node* root, typename Node::Key start_key, typename Node::Key end_key) {
+    printf("=== RANGE QUERY [");
+    print_key(start_key);
+    printf(" - ");
+    print_key(end_key);
+    printf("] ===\n");
+
+    // Находим стартовый лист
+    Node* current = root;
+    while (!current->is_leaf) {
+        int i = node_upper_bound(current->keys, current->key_count, start_key);
+        current = (Node*)current->children[i];
+    }
+
+    // Проходим по связному списку листьев
+    long long result_count = 0;
+    while (current != NULL) {
+        printf("Проверяем лист: [");
+        for (int i = 0; i < current->key_count; i++) {
+            print_key(current->keys[i]);
+            if (i < current->key_count - 1) printf(",");
+        }
+        printf("]\n");
+
+        int first, last;
+        node_range_bounds(current->keys, current->key_count, start_key, end_key, &first, &last);
+        for (int i = first; i < last; i++) {
+            result_count++;
+            printf(" Найден: ");
+            print_key(current->keys[i]);
+            printf("\n");
+        }
+
+        if (current->key_count > 0 && current->keys[current->key_count - 1] > end_key) {
+            break;
+        }
+        current = current->next_leaf;
+    }
+
+    printf("Результаты range query: %lld значений\n\n", result_count);
+    return result_count;
+}
+
+// ==================== КУРСОР ДИАПАЗОНА ====================
+// Курсор идет по цепочке next_leaf и отдает ключи/значения прямо из
+// листьев: без копирования, выделения памяти и печати. Представления
+// действительны, пока дерево не меняется.
+
+// Отрезок подряд идущих записей одного листа
+template <typename Tree>
+struct BPlusSpan {
+    const typename Tree::Key* keys;
+    const typename Tree::Value* values;
+    int count;
+};
+
+template <typename Tree>
+struct BPlusCursor {
+    typename Tree::Node* leaf;   // текущий лист (NULL - диапазон исчерпан)
+    int pos;                     // следующая запись в листе
+    int end;                     // граница записей диапазона в текущем листе
+    typename Tree::Key end_key;  // правая граница диапазона (включительно)
+
+    // Упреждающая выборка листьев (read_ahead = 0 - выключена).
+    // Адреса следующих листьев берутся из родителя текущего листа: по
+    // цепочке next_leaf их не узнать, не дождавшись загрузки каждого листа.
+    typename Tree::Node* root;
+    typename Tree::Node* parent; // родитель текущего листа
+    int child_index;             // номер текущего листа среди детей parent
+    int issued;                  // детям parent до этого номера уже выдан prefetch
+    int read_ahead;              // на сколько листьев вперед
+#if TREE_STATS
+    StatOpTimer stat;            // операция range: от seek до исчерпания диапазона
+#endif
+};
+
+// Подсказать процессору загрузить узел в кэш (все его кэш-линии)
+template <typename Node>
+inline void bplus_prefetch_node(const Node* node) {
+    const char* bytes = (const char*)node;
+    for (size_t line = 0; line < sizeof(Node); line += CACHE_LINE_SIZE) {
+        __builtin_prefetch(bytes + line, 0, 1);
+    }
+}
+
+// Найти родителя листа, в котором лежит key, и выдать prefetch на
+// read_ahead листьев вперед (только тех, что могут попасть в диапазон)
+template <typename Tree>
+void bplus_cursor_locate_parent(BPlusCursor<Tree>* cursor, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    Node* parent = NULL;
+    Node* current = cursor->root;
+    int index = 0;
+    while (!current->is_leaf) {
+        parent = current;
+        index = node_upper_bound(current->keys, current->key_count, key);
+        current = (Node*)current->children[index];
+    }
+    cursor->parent = parent;
+    cursor->child_index = index;
+    cursor->issued = index;
+}
+
+template <typename Tree>
+void bplus_cursor_issue_read_ahead(BPlusCursor<Tree>* cursor) {
+    typedef typename Tree::Node Node;
+    Node* parent = cursor->parent;
+    if (parent == NULL) return;
+    int limit = cursor->child_index + cursor->read_ahead;
+    if (limit > parent->key_count) limit = parent->key_count;
+    // Лист i+1 начинается с ключа >= keys[i]: дальше end_key не заглядываем
+    while (cursor->issued < limit && !(cursor->end_key < parent->keys[cursor->issued])) {
+        cursor->issued++;
+        bplus_prefetch_node((const Node*)parent->children[cursor->issued]);
+    }
+}
+
+// Переход к следующему листу с продвижением окна упреждения
+template <typename Tree>
+void bplus_cursor_step_leaf(BPlusCursor<Tree>* cursor) {
+    cursor->leaf = cursor->leaf->next_leaf;
+    cursor->pos = 0;
+    if (cursor->leaf != NULL) STATS_VISIT(cursor->stat, 1);
+    if (cursor->read_ahead <= 0 || cursor->leaf == NULL) return;
+    cursor->child_index++;
+    if (cursor->parent == NULL || cursor->child_index > cursor->parent->key_count) {
+        // Дети родителя кончились: раз в ~ORDER листьев спускаемся заново
+        bplus_cursor_locate_parent(cursor, cursor->leaf->keys[0]);
+    }
+    bplus_cursor_issue_read_ahead(cursor);
+}
+
+// Граница диапазона в текущем листе; если лист кончился, переходим к следующему
+// Диапазон, брошенный до исчерпания, учитывается в bplus_cursor_close.
+template <typename Tree>
+void bplus_cursor_settle(BPlusCursor<Tree>* cursor) {
+    while (cursor->leaf != NULL) {
+        typename Tree::Node* leaf = cursor->leaf;
+        cursor->end = cursor->pos + node_upper_bound(leaf->keys + cursor->pos,
+                                                     leaf->key_count - cursor->pos, cursor->end_key);
+        if (cursor->pos < cursor->end) return;
+        // Записей нет: либо лист пройден целиком, либо встретился ключ > end_key
+        if (cursor->end < leaf->key_count) {
+            cursor->leaf = NULL;
+            break;
+        }
+        bplus_cursor_step_leaf(cursor);
+    }
+    STATS_END(cursor->stat);
+}
+
+// Установить курсор на первый ключ >= start_key; диапазон кончается на end_key.
+// read_ahead > 0 - по ходу сканирования подгружать в кэш столько листьев вперед.
+template <typename Tree>
+void bplus_cursor_seek(Tree* tree, BPlusCursor<Tree>* cursor,
+                       typename Tree::Key start_key, typename Tree::Key end_key,
+                       int read_ahead = 0) {
+    typedef typename Tree::Node Node;
+    STATS_BEGIN(cursor->stat, STAT_OP_RANGE);
+    STATS_VISIT(cursor->stat, tree->height);
+    Node* parent = NULL;
+    Node* current = tree->root;
+    int index = 0;
+    while (!current->is_leaf) {
+        parent = current;
+        index = node_upper_bound(current->keys, current->key_count, start_key);
+        current = (Node*)current->children[index];
+    }
+    cursor->leaf = current;
+    cursor->pos = node_lower_bound(current->keys, current->key_count, start_key);
+    cursor->end_key = end_key;
+    cursor->root = tree->root;
+    cursor->parent = parent;
+    cursor->child_index = index;
+    cursor->issued = index;
+    cursor->read_ahead = read_ahead;
+    if (read_ahead > 0) bplus_cursor_issue_read_ahead(cursor);
+    bplus_cursor_settle(cursor);
+}
+
+// Следующая запись; key/value указывают внутрь листа
+template <typename Tree>
+bool bplus_cursor_next(BPlusCursor<Tree>* cursor, const typename Tree::Key** key,
+                       const typename Tree::Value** value) {
+    if (cursor->leaf == NULL) return false;
+    *key = &cursor->leaf->keys[cursor->pos];
+    *value = &cursor->leaf->data[cursor->pos];
+    if (++cursor->pos == cursor->end) bplus_cursor_settle(cursor);
+    return true;
+}
+
+// Пакетная выдача: до max_count записей одним отрезком листа.
+// Возвращает число записей в span (0 - диапазон исчерпан).
+template <typename Tree>
+int bplus_cursor_next_n(BPlusCursor<Tree>* cursor, int max_count, BPlusSpan<Tree>* span) {
+    if (cursor->leaf == NULL) {
+        span->count = 0;
+        return 0;
+    }
+    int count = cursor->end - cursor->pos;
+    if (count > max_count) count = max_count;
+    span->keys = &cursor->leaf->keys[cursor->pos];
+    span->values = &cursor->leaf->data[cursor->pos];
+    span->count = count;
+    cursor->pos += count;
+    if (cursor->pos == cursor->end) bplus_cursor_settle(cursor);
+    return count;
+}
+
+// Завершить сканирование до исчерпания диапазона: засчитать операцию range
+// с уже посещенными узлами. После исчерпания вызов ничего не делает.
+template <typename Tree>
+void bplus_cursor_close(BPlusCursor<Tree>* cursor) {
+    cursor->leaf = NULL;
+    STATS_END(cursor->stat);
+}
+
+// ==================== ПАКЕТНАЯ ЗАГРУЗКА (BULK LOAD) ====================
+// Построение дерева снизу вверх из отсортированного потока ключей:
+// листья заполняются подряд до fill_factor, внутренние уровни строятся
+// в bplus_bulk_finish() по минимальным ключам узлов нижнего уровня.
+
+template <typename Tree>
+struct BPlusBulkLoader {
+    Tree* tree;
+    int leaf_fill;               // ключей в листе при загрузке
+    int inner_fill;              // детей во внутреннем узле при загрузке
+    typename Tree::Node* prev_leaf;
+    typename Tree::Node* leaf;   // текущий заполняемый лист
+    typename Tree::Key* level_keys; // минимальный ключ каждого узла уровня
+    long long* level_nodes;      // сами узлы уровня
+    long long level_count;
+    long long level_capacity;
+    bool has_last;
+    typename Tree::Key last_key;
+};
+
+template <typename Tree>
+void bplus_bulk_push_node(BPlusBulkLoader<Tree>* loader, typename Tree::Key min_key,
+                          typename Tree::Node* node) {
+    typedef typename Tree::Key K;
+    if (loader->level_count == loader->level_capacity) {
+        loader->level_capacity = loader->level_capacity ? loader->level_capacity * 2 : 64;
+        loader->level_keys = (K*)realloc(loader->level_keys, sizeof(K) * loader->level_capacity);
+        loader->level_nodes = (long long*)realloc(loader->level_nodes,
+                                                  sizeof(long long) * loader->level_capacity);
+    }
+    loader->level_keys[loader->level_count] = min_key;
+    loader->level_nodes[loader->level_count++] = (long long)node;
+}
+
+// Начало загрузки: дерево создается заново (tree не должен содержать узлов).
+// use_arena - узлы из собственной арены дерева: листья создаются по
+// порядку ключей и лежат в ней одной непрерывной серией.
+template <typename Tree>
+void bplus_bulk_begin(BPlusBulkLoader<Tree>* loader, Tree* tree, double fill_factor,
+                      bool use_arena = false) {
+    const int ORDER = Tree::order;
+    loader->tree = tree;
+    loader->leaf_fill = bplus_fill_count(fill_factor, ORDER - 1, ORDER / 2);
+    loader->inner_fill = bplus_fill_count(fill_factor, ORDER, (ORDER + 1) / 2);
+    loader->prev_leaf = NULL;
+    loader->leaf = NULL;
+    loader->level_keys = NULL;
+    loader->level_nodes = NULL;
+    loader->level_count = 0;
+    loader->level_capacity = 0;
+    loader->has_last = false;
+
+    tree->arena = NULL;
+    if (use_arena) {
+        tree->arena = (struct NodeArena*)malloc(sizeof(struct NodeArena));
+        node_arena_init(tree->arena, sizeof(typename Tree::Node), 0, ARENA_LEAF_CONTIGUOUS);
+    }
+    tree->root = NULL;
+    tree->height = 1;
+    tree->node_count = 0;
+    tree->next_node_offset = 0;
+    tree->leaf_count = 0;
+    tree->key_count = 0;
+}
+
+// Добавление очередного ключа; ключи должны строго возрастать
+template <typename Tree>
+bool bplus_bulk_add(BPlusBulkLoader<Tree>* loader, typename Tree::Key key,
+                    typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    if (loader->has_last && key <= loader->last_key) return false;
+
+    if (loader->leaf == NULL || loader->leaf->key_count == loader->leaf_fill) {
+        Node* leaf = bplus_tree_new_node(loader->tree, true);
+        if (loader->leaf != NULL) loader->leaf->next_leaf = leaf;
+        loader->prev_leaf = loader->leaf;
+        loader->leaf = leaf;
+        bplus_bulk_push_node(loader, key, leaf);
+    }
+
+    Node* leaf = loader->leaf;
+    leaf->keys[leaf->key_count] = key;
+    leaf->data[leaf->key_count++] = value;
+    loader->tree->key_count++;
+    loader->has_last = true;
+    loader->last_key = key;
+    return true;
+}
+
+// Завершение: выравниваем последний лист и строим внутренние уровни
+template <typename Tree>
+void bplus_bulk_finish(BPlusBulkLoader<Tree>* loader) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    const int ORDER = Tree::order;
+    Tree* tree = loader->tree;
+
+    if (loader->leaf == NULL) {
+        bplus_tree_init(tree);
+        return;
+    }
+
+    // Последний лист может оказаться почти пустым: делим ключи с соседом
+    Node* last = loader->leaf;
+    Node* prev = loader->prev_leaf;
+    int min_leaf = ORDER / 2;
+    if (prev != NULL && last->key_count < min_leaf) {
+        int total = prev->key_count + last->key_count;
+        int keep = (total >= 2 * min_leaf) ? total - min_leaf : total;
+        int move = prev->key_count - keep;
+        if (move > 0) {
+            for (int i = last->key_count - 1; i >= 0; i--) {
+                last->keys[i + move] = last->keys[i];
+                last->data[i + move] = last->data[i];
+            }
+            for (int i = 0; i < move; i++) {
+                last->keys[i] = prev->keys[keep + i];
+                last->data[i] = prev->data[keep + i];
+            }
+            last->key_count += move;
+            prev->key_count = keep;
+            loader->level_keys[loader->level_count - 1] = last->keys[0];
+        } else {
+            // Ключей на два листа не хватает: сливаем в предыдущий
+            for (int i = 0; i < last->key_count; i++) {
+                prev->keys[prev->key_count] = last->keys[i];
+                prev->data[prev->key_count++] = last->data[i];
+            }
+            prev->next_leaf = NULL;
+            bplus_tree_release_node(tree, last);
+            tree->node_count--;
+            tree->leaf_count--;
+            loader->level_count--;
+        }
+    }
+
+    // Уровни строятся, пока не останется один узел - корень.
+    // Дети распределяются между узлами уровня равномерно, чтобы
+    // правый край не оказался недозаполненным.
+    while (loader->level_count > 1) {
+        long long count = loader->level_count;
+        long long groups = (count + loader->inner_fill - 1) / loader->inner_fill;
+        // Недозаполненным может остаться только корень (groups == 1)
+        if (groups > 1 && count / groups < (ORDER + 1) / 2) groups = count / ((ORDER + 1) / 2);
+        long long base = count / groups;
+        long long extra = count % groups;
+
+        long long src = 0;
+        loader->level_count = 0;
+        for (long long g = 0; g < groups; g++) {
+            int children = (int)(base + (g < extra ? 1 : 0));
+            Node* node = bplus_tree_new_node(tree, false);
+            K min_key = loader->level_keys[src];
+            node->children[0] = loader->level_nodes[src];
+            for (int c = 1; c < children; c++) {
+                node->keys[c - 1] = loader->level_keys[src + c];
+                node->children[c] = loader->level_nodes[src + c];
+            }
+            node->key_count = children - 1;
+            src += children;
+            // src всегда >= записываемой позиции, перезапись безопасна
+            loader->level_keys[loader->level_count] = min_key;
+            loader->level_nodes[loader->level_count++] = (long long)node;
+        }
+        tree->height++;
+    }
+
+    tree->root = (Node*)loader->level_nodes[0];
+    free(loader->level_keys);
+    free(loader->level_nodes);
+    loader->level_keys = NULL;
+    loader->level_nodes = NULL;
+}
+
+// Загрузка из отсортированного массива; values == NULL - значением будет сам ключ
+template <typename Tree>
+void bplus_bulk_load(Tree* tree, const typename Tree::Key* keys,
+                     const typename Tree::Value* values, int count, double fill_factor,
+                     bool use_arena = false) {
+    BPlusBulkLoader<Tree> loader;
+    bplus_bulk_begin(&loader, tree, fill_factor, use_arena);
+    for (int i = 0; i < count; i++) {
+        bplus_bulk_add(&loader, keys[i],
+                       values != NULL ? values[i] : (typename Tree::Value)keys[i]);
+    }
+    bplus_bulk_finish(&loader);
+}
+
+// ==================== ДОПИСЫВАНИЕ В КОНЕЦ (APPEND) ====================
+// Временные метки приходят почти по возрастанию, и каждый новый ключ
+// больше всех ключей дерева. Такой ключ всегда попадает в самый правый
+// лист, поэтому путь к нему (правый край дерева) запоминается, и вставка
+// идет без спуска от корня. Полный узел правого края делится не пополам:
+// слева остается leaf_fill / inner_fill его записей, а в новый правый
+// узел уходит только хвост - левая часть больше никогда не получит
+// ключей, и половина ее места при делении пополам пропала бы навсегда.
+// Правый край при этом недозаполнен, пока его не заполнят следующие
+// ключи. Ключ левее правого листа вставляется обычным bplus_insert,
+// после чего путь находится заново. Если дерево менялось не через
+// bplus_append (удаления, обычные вставки), перед продолжением нужен
+// bplus_append_begin.
+
+#define BPLUS_APPEND_MAX_HEIGHT 64   // при порядке 3 - больше 2^62 ключей
+
+template <typename Tree>
+struct BPlusAppender {
+    typename Tree::Node* path[BPLUS_APPEND_MAX_HEIGHT]; // правый край: [0] - корень, [height - 1] - лист
+    int height;                  // 0 - путь надо найти заново
+    int leaf_fill;               // ключей остается в левом листе при делении
+    int inner_fill;              // ключей остается в левом внутреннем узле
+    long long appended;          // ключей вставлено без спуска
+    long long fallbacks;         // ключей левее правого листа - через bplus_insert
+};
+
+template <typename Tree>
+void bplus_append_locate(Tree* tree, BPlusAppender<Tree>* appender) {
+    typedef typename Tree::Node Node;
+    Node* node = tree->root;
+    int depth = 0;
+    appender->path[depth++] = node;
+    while (!node->is_leaf) {
+        node = (Node*)node->children[node->key_count];
+        appender->path[depth++] = node;
+    }
+    appender->height = depth;
+}
+
+// fill_factor - доля записей, остающаяся в левом узле при делении
+// (1.0 - узлы упаковываются полностью)
+template <typename Tree>
+void bplus_append_begin(Tree* tree, BPlusAppender<Tree>* appender, double fill_factor) {
+    const int ORDER = Tree::order;
+    appender->leaf_fill = bplus_fill_count(fill_factor, ORDER - 1, ORDER / 2);
+    appender->inner_fill = bplus_fill_count(fill_factor, ORDER - 1, (ORDER + 1) / 2 - 1);
+    appender->appended = 0;
+    appender->fallbacks = 0;
+    bplus_append_locate(tree, appender);
+}
+
+// Новый правый узел child с разделителем key - в конец внутреннего узла
+// уровня level правого края; полные узлы делятся вверх по пути
+template <typename Tree>
+void bplus_append_push_up(Tree* tree, BPlusAppender<Tree>* appender, int level,
+                          typename Tree::Key key, typename Tree::Node* child) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    const int ORDER = Tree::order;
+    while (level >= 0) {
+        Node* node = appender->path[level];
+        if (node->key_count < ORDER - 1) {
+            node->keys[node->key_count] = key;
+            node->children[++node->key_count] = (long long)child;
+            appender->path[level + 1] = child;
+            return;
+        }
+        // Слева остается inner_fill ключей, ключ inner_fill уходит наверх
+        int keep = appender->inner_fill;
+        Node* right = bplus_tree_new_node(tree, false);
+        K up = keep < ORDER - 1 ? node->keys[keep] : key;
+        for (int j = keep + 1; j < ORDER - 1; j++) {
+            right->keys[right->key_count] = node->keys[j];
+            right->children[right->key_count++] = node->children[j];
+        }
+        if (keep < ORDER - 1) {
+            right->keys[right->key_count] = key;
+            right->children[right->key_count++] = node->children[ORDER - 1];
+        }
+        right->children[right->key_count] = (long long)child;
+        node->key_count = keep;
+        STATS_COUNT(STAT_SPLITS, 1);
+        appender->path[level + 1] = child;
+        key = up;
+        child = right;
+        level--;
+    }
+    // Разделился корень: дерево растет вверх
+    Node* root = bplus_tree_new_node(tree, false);
+    root->keys[0] = key;
+    root->children[0] = (long long)tree->root;
+    root->children[1] = (long long)child;
+    root->key_count = 1;
+    tree->root = root;
+    tree->height++;
+    for (int i = appender->height; i > 0; i--) appender->path[i] = appender->path[i - 1];
+    appender->path[0] = root;
+    appender->path[1] = child;
+    appender->height++;
+}
+
+// Ключ не меньше первого ключа правого листа принадлежит этому листу:
+// обычно он самый большой и дописывается в конец, немного опоздавший
+// встает на свое место внутри листа. Возвращает false, если ключ уже
+// был (значение обновляется).
+template <typename Tree>
+bool bplus_append(Tree* tree, BPlusAppender<Tree>* appender, typename Tree::Key key,
+                  typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    typedef typename Tree::Value V;
+    const int ORDER = Tree::order;
+    if (appender->height == 0) bplus_append_locate(tree, appender);
+    Node* leaf = appender->path[appender->height - 1];
+    if (leaf->key_count > 0 && key < leaf->keys[0]) {
+        appender->fallbacks++;
+        appender->height = 0;
+        return bplus_insert(tree, key, value);
+    }
+
+    STATS_TIMER(stat, STAT_OP_INSERT);
+    STATS_VISIT(stat, 1);
+    int pos = leaf->key_count;
+    if (pos > 0 && !(leaf->keys[pos - 1] < key)) {
+        pos = node_lower_bound(leaf->keys, leaf->key_count, key);
+        if (leaf->keys[pos] == key) {
+            leaf->data[pos] = value;
+            STATS_END(stat);
+            return false;
+        }
+    }
+    appender->appended++;
+    tree->key_count++;
+    if (leaf->key_count < ORDER - 1) {
+        for (int j = leaf->key_count; j > pos; j--) {
+            leaf->keys[j] = leaf->keys[j - 1];
+            leaf->data[j] = leaf->data[j - 1];
+        }
+        leaf->keys[pos] = key;
+        leaf->data[pos] = value;
+        leaf->key_count++;
+        STATS_END(stat);
+        return true;
+    }
+
+    // Лист полон: слева остается leaf_fill ключей, остальные - в новый лист
+    K tmp_keys[ORDER];
+    V tmp_data[ORDER];
+    for (int i = 0, j = 0; i < ORDER; i++) {
+        if (i == pos) {
+            tmp_keys[i] = key;
+            tmp_data[i] = value;
+        } else {
+            tmp_keys[i] = leaf->keys[j];
+            tmp_data[i] = leaf->data[j];
+            j++;
+        }
+    }
+    Node* right = bplus_tree_new_node(tree, true);
+    leaf->key_count = appender->leaf_fill;
+    for (int i = 0; i < leaf->key_count; i++) {
+        leaf->keys[i] = tmp_keys[i];
+        leaf->data[i] = tmp_data[i];
+    }
+    for (int i = appender->leaf_fill; i < ORDER; i++) {
+        right->keys[right->key_count] = tmp_keys[i];
+        right->data[right->key_count++] = tmp_data[i];
+    }
+    right->next_leaf = leaf->next_leaf;
+    leaf->next_leaf = right;
+    STATS_COUNT(STAT_SPLITS, 1);
+    bplus_append_push_up(tree, appender, appender->height - 2, right->keys[0], right);
+    STATS_VISIT(stat, appender->height - 1);
+    STATS_END(stat);
+    return true;
+}
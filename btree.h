@@ -0,0 +1,615 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <type_traits>
+
+#include "disk.h"
+#include "simd_search.h"
+#include "node_arena.h"
+#include "stats.h"
+
+// Структура для B-дерева
+// K - тип ключа, V - тип значения, ORDER - максимальное число детей.
+// В отличие от B+-дерева значения хранятся во всех узлах.
+template <typename K, typename V, int ORDER>
+struct alignas(CACHE_LINE_SIZE) BTreeNode {
+    static_assert(ORDER >= 3, "порядок B-дерева должен быть не меньше 3");
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "ключи и значения копируются как байты");
+
+    typedef K Key;
+    typedef V Value;
+    static const int order = ORDER;
+
+    K keys[ORDER - 1];
+    V values[ORDER - 1];
+    long long children[ORDER];
+    int key_count;
+    bool is_leaf;
+    long long offset;
+};
+
+// Наибольший порядок, при котором узел помещается в BYTES байт
+template <typename K, typename V, int BYTES, int ORDER = 3>
+constexpr int btree_order_for() {
+    static_assert(sizeof(BTreeNode<K, V, 3>) <= BYTES, "узел не помещается даже при порядке 3");
+    if constexpr (sizeof(BTreeNode<K, V, ORDER + 1>) > BYTES) return ORDER;
+    else return btree_order_for<K, V, BYTES, ORDER + 1>();
+}
+
+// arena = NULL - отдельный aligned_alloc на узел
+template <typename Node>
+Node* create_btree_node(bool is_leaf, long long offset, struct NodeArena* arena = NULL) {
+    Node* node = arena != NULL ? (Node*)node_arena_alloc(arena, is_leaf)
+                               : (Node*)aligned_alloc(alignof(Node), sizeof(Node));
+    node->key_count = 0;
+    node->is_leaf = is_leaf;
+    node->offset = offset;
+    for (int i = 0; i < Node::order; i++) node->children[i] = -1;
+    return node;
+}
+
+template <typename K, typename V, int ORDER>
+struct BTree {
+    typedef K Key;
+    typedef V Value;
+    typedef BTreeNode<K, V, ORDER> Node;
+    static const int order = ORDER;
+
+    Node* root;
+    int height;
+    long long node_count;
+    long long next_node_offset;  // offset следующего нового узла; только растет
+    long long key_count;
+    struct NodeArena* arena;   // NULL - узлы через malloc
+};
+
+template <typename K, typename V, int LINES>
+using CacheLineBTree = BTree<K, V, btree_order_for<K, V, CACHE_LINE_SIZE * LINES>()>;
+
+template <typename K, typename V>
+using PageBTree = BTree<K, V, btree_order_for<K, V, DISK_PAGE_SIZE>()>;
+
+template <typename Tree>
+void btree_tree_init(Tree* tree) {
+    tree->arena = NULL;
+    tree->root = create_btree_node<typename Tree::Node>(true, 0);
+    tree->height = 1;
+    tree->node_count = 1;
+    tree->next_node_offset = 1;
+    tree->key_count = 0;
+}
+
+// Дерево, узлы которого берутся из собственной арены
+template <typename Tree>
+void btree_tree_init_arena(Tree* tree, ArenaPlacement placement, int nodes_per_block = 0) {
+    tree->arena = (struct NodeArena*)malloc(sizeof(struct NodeArena));
+    node_arena_init(tree->arena, sizeof(typename Tree::Node), nodes_per_block, placement);
+    tree->root = create_btree_node<typename Tree::Node>(true, 0, tree->arena);
+    tree->height = 1;
+    tree->node_count = 1;
+    tree->next_node_offset = 1;
+    tree->key_count = 0;
+}
+
+// Вставка пары (key, value) и правого ребенка right_child в позицию pos.
+// При переполнении узел делится, средний ключ уходит наверх.
+template <typename Tree>
+void btree_insert_entry(Tree* tree, typename Tree::Node* node, int pos,
+                        typename Tree::Key key, typename Tree::Value value, long long right_child,
+                        typename Tree::Key* up_key, typename Tree::Value* up_value,
+                        typename Tree::Node** split_node) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    typedef typename Tree::Value V;
+    const int ORDER = Tree::order;
+
+    if (node->key_count < ORDER - 1) {
+        for (int i = node->key_count; i > pos; i--) {
+            node->keys[i] = node->keys[i - 1];
+            node->values[i] = node->values[i - 1];
+            node->children[i + 1] = node->children[i];
+        }
+        node->keys[pos] = key;
+        node->values[pos] = value;
+        node->children[pos + 1] = right_child;
+        node->key_count++;
+        return;
+    }
+
+    K tmp_keys[ORDER];
+    V tmp_values[ORDER];
+    long long tmp_children[ORDER + 1];
+    for (int i = 0, j = 0; i < ORDER; i++) {
+        if (i == pos) {
+            tmp_keys[i] = key;
+            tmp_values[i] = value;
+        } else {
+            tmp_keys[i] = node->keys[j];
+            tmp_values[i] = node->values[j];
+            j++;
+        }
+    }
+    for (int i = 0, j = 0; i < ORDER + 1; i++) {
+        tmp_children[i] = (i == pos + 1) ? right_child : node->children[j++];
+    }
+
+    int mid = ORDER / 2;
+    Node* right = create_btree_node<Node>(node->is_leaf, tree->next_node_offset++, tree->arena);
+    tree->node_count++;
+    node->key_count = mid;
+    for (int i = 0; i < mid; i++) {
+        node->keys[i] = tmp_keys[i];
+        node->values[i] = tmp_values[i];
+        node->children[i] = tmp_children[i];
+    }
+    node->children[mid] = tmp_children[mid];
+    for (int i = mid + 1; i < ORDER; i++) {
+        right->keys[right->key_count] = tmp_keys[i];
+        right->values[right->key_count] = tmp_values[i];
+        right->children[right->key_count++] = tmp_children[i];
+    }
+    right->children[right->key_count] = tmp_children[ORDER];
+
+    STATS_COUNT(STAT_SPLITS, 1);
+    *up_key = tmp_keys[mid];
+    *up_value = tmp_values[mid];
+    *split_node = right;
+}
+
+// Вставка в поддерево; возвращает false, если ключ уже был (значение обновляется)
+template <typename Tree>
+bool btree_insert_into(Tree* tree, typename Tree::Node* node,
+                       typename Tree::Key key, typename Tree::Value value,
+                       typename Tree::Key* up_key, typename Tree::Value* up_value,
+                       typename Tree::Node** split_node) {
+    typedef typename Tree::Node Node;
+    *split_node = NULL;
+
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    if (pos < node->key_count && node->keys[pos] == key) {
+        node->values[pos] = value;
+        return false;
+    }
+
+    if (node->is_leaf) {
+        btree_insert_entry(tree, node, pos, key, value, -1, up_key, up_value, split_node);
+        return true;
+    }
+
+    typename Tree::Key child_key;
+    typename Tree::Value child_value;
+    Node* child_split;
+    bool inserted = btree_insert_into(tree, (Node*)node->children[pos], key, value,
+                                      &child_key, &child_value, &child_split);
+    if (child_split != NULL) {
+        btree_insert_entry(tree, node, pos, child_key, child_value, (long long)child_split,
+                           up_key, up_value, split_node);
+    }
+    return inserted;
+}
+
+template <typename Tree>
+bool btree_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_INSERT);
+    STATS_VISIT(stat, tree->height);
+    typename Tree::Key up_key;
+    typename Tree::Value up_value;
+    Node* split_node;
+    bool inserted = btree_insert_into(tree, tree->root, key, value, &up_key, &up_value, &split_node);
+
+    if (split_node != NULL) {
+        Node* new_root = create_btree_node<Node>(false, tree->next_node_offset++, tree->arena);
+        tree->node_count++;
+        new_root->keys[0] = up_key;
+        new_root->values[0] = up_value;
+        new_root->children[0] = (long long)tree->root;
+        new_root->children[1] = (long long)split_node;
+        new_root->key_count = 1;
+        tree->root = new_root;
+        tree->height++;
+    }
+    if (inserted) tree->key_count++;
+    STATS_END(stat);
+    return inserted;
+}
+
+// Точечный поиск: может завершиться в любом узле
+template <typename Tree>
+bool btree_search(Tree* tree, typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_SEARCH);
+    Node* current = tree->root;
+    bool found = false;
+    while (true) {
+        STATS_VISIT(stat, 1);
+        int i = node_lower_bound(current->keys, current->key_count, key);
+        if (i < current->key_count && current->keys[i] == key) {
+            if (value != NULL) *value = current->values[i];
+            found = true;
+            break;
+        }
+        if (current->is_leaf) break;
+        current = (Node*)current->children[i];
+    }
+    STATS_END(stat);
+    return found;
+}
+
+// ==================== УДАЛЕНИЕ ====================
+// Минимум ключей вне корня - (ORDER - 1) / 2, столько оставляет
+// расщепление. Ключ внутреннего узла заменяется предшественником (самым
+// правым ключом левого поддерева), который затем удаляется из листа.
+// Недозаполненный ребенок берет ключ у соседа через родителя или
+// сливается с соседом и разделителем. offset освобожденных узлов не
+// выдаются повторно (см. next_node_offset), btree_tree_renumber() перед
+// записью на диск убирает пропуски в нумерации.
+
+template <typename Tree>
+inline int btree_min_keys() {
+    return (Tree::order - 1) / 2;
+}
+
+// Освобождение одного узла (в арену или через free)
+template <typename Tree>
+void btree_tree_release_node(Tree* tree, typename Tree::Node* node) {
+    tree->node_count--;
+    if (tree->arena != NULL) node_arena_release(tree->arena, node, node->is_leaf);
+    else free(node);
+}
+
+// Слить ребенка i + 1, разделитель i и ребенка i узла parent в ребенка i
+template <typename Tree>
+void btree_merge_children(Tree* tree, typename Tree::Node* parent, int i) {
+    typedef typename Tree::Node Node;
+    Node* left = (Node*)parent->children[i];
+    Node* right = (Node*)parent->children[i + 1];
+    left->keys[left->key_count] = parent->keys[i];
+    left->values[left->key_count++] = parent->values[i];
+    for (int j = 0; j < right->key_count; j++) {
+        left->keys[left->key_count] = right->keys[j];
+        left->values[left->key_count] = right->values[j];
+        left->children[left->key_count++] = right->children[j];
+    }
+    left->children[left->key_count] = right->children[right->key_count];
+    for (int j = i; j < parent->key_count - 1; j++) {
+        parent->keys[j] = parent->keys[j + 1];
+        parent->values[j] = parent->values[j + 1];
+        parent->children[j + 1] = parent->children[j + 2];
+    }
+    parent->children[parent->key_count] = -1;
+    parent->key_count--;
+    btree_tree_release_node(tree, right);
+    STATS_COUNT(STAT_MERGES, 1);
+}
+
+// Ребенок i узла parent недозаполнен: занять ключ через родителя или слиться
+template <typename Tree>
+void btree_fix_child(Tree* tree, typename Tree::Node* parent, int i) {
+    typedef typename Tree::Node Node;
+    Node* child = (Node*)parent->children[i];
+    const int min_keys = btree_min_keys<Tree>();
+    if (child->key_count >= min_keys) return;
+
+    Node* left = i > 0 ? (Node*)parent->children[i - 1] : NULL;
+    Node* right = i < parent->key_count ? (Node*)parent->children[i + 1] : NULL;
+    if (left != NULL && left->key_count > min_keys) {
+        // Разделитель опускается в начало child, последний ключ левого соседа поднимается
+        for (int j = child->key_count; j > 0; j--) {
+            child->keys[j] = child->keys[j - 1];
+            child->values[j] = child->values[j - 1];
+        }
+        for (int j = child->key_count + 1; j > 0; j--) child->children[j] = child->children[j - 1];
+        child->keys[0] = parent->keys[i - 1];
+        child->values[0] = parent->values[i - 1];
+        child->children[0] = left->children[left->key_count];
+        child->key_count++;
+        parent->keys[i - 1] = left->keys[left->key_count - 1];
+        parent->values[i - 1] = left->values[left->key_count - 1];
+        left->children[left->key_count] = -1;
+        left->key_count--;
+        STATS_COUNT(STAT_BORROWS, 1);
+    } else if (right != NULL && right->key_count > min_keys) {
+        child->keys[child->key_count] = parent->keys[i];
+        child->values[child->key_count] = parent->values[i];
+        child->children[child->key_count + 1] = right->children[0];
+        child->key_count++;
+        parent->keys[i] = right->keys[0];
+        parent->values[i] = right->values[0];
+        for (int j = 0; j < right->key_count - 1; j++) {
+            right->keys[j] = right->keys[j + 1];
+            right->values[j] = right->values[j + 1];
+        }
+        for (int j = 0; j < right->key_count; j++) right->children[j] = right->children[j + 1];
+        right->children[right->key_count] = -1;
+        right->key_count--;
+        STATS_COUNT(STAT_BORROWS, 1);
+    } else if (left != NULL) {
+        btree_merge_children(tree, parent, i - 1);
+    } else if (right != NULL) {
+        btree_merge_children(tree, parent, i);
+    }
+}
+
+// Удаление из поддерева; возвращает false, если ключа не было
+template <typename Tree>
+bool btree_delete_from(Tree* tree, typename Tree::Node* node, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    bool here = pos < node->key_count && node->keys[pos] == key;
+    if (node->is_leaf) {
+        if (!here) return false;
+        for (int j = pos; j < node->key_count - 1; j++) {
+            node->keys[j] = node->keys[j + 1];
+            node->values[j] = node->values[j + 1];
+        }
+        node->key_count--;
+        return true;
+    }
+    if (here) {
+        Node* leaf = (Node*)node->children[pos];
+        while (!leaf->is_leaf) leaf = (Node*)leaf->children[leaf->key_count];
+        node->keys[pos] = leaf->keys[leaf->key_count - 1];
+        node->values[pos] = leaf->values[leaf->key_count - 1];
+        key = node->keys[pos];
+    }
+    // Предшественник лежит в левом поддереве того же разделителя
+    if (!btree_delete_from(tree, (Node*)node->children[pos], key)) return false;
+    btree_fix_child(tree, node, pos);
+    return true;
+}
+
+template <typename Tree>
+bool btree_delete(Tree* tree, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_DELETE);
+    STATS_VISIT(stat, tree->height);
+    bool deleted = btree_delete_from(tree, tree->root, key);
+    if (deleted) {
+        while (!tree->root->is_leaf && tree->root->key_count == 0) {
+            Node* old_root = tree->root;
+            tree->root = (Node*)old_root->children[0];
+            btree_tree_release_node(tree, old_root);
+            tree->height--;
+        }
+        tree->key_count--;
+    }
+    STATS_END(stat);
+    return deleted;
+}
+
+// Переназначить offset узлов подряд в порядке обхода в ширину
+template <typename Tree>
+void btree_tree_renumber(Tree* tree) {
+    typedef typename Tree::Node Node;
+    Node** queue = (Node**)malloc(sizeof(Node*) * tree->node_count);
+    long long head = 0, tail = 0;
+    queue[tail++] = tree->root;
+    while (head < tail) {
+        Node* node = queue[head];
+        node->offset = head++;
+        if (node->is_leaf) continue;
+        for (int i = 0; i <= node->key_count; i++) queue[tail++] = (Node*)node->children[i];
+    }
+    free(queue);
+    tree->next_node_offset = head;
+}
+
+template <typename Node>
+void btree_free_node(Node* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) {
+            btree_free_node((Node*)node->children[i]);
+        }
+    }
+    free(node);
+}
+
+// С ареной - один вызов на все дерево, без обхода узлов
+template <typename Tree>
+void btree_tree_free(Tree* tree) {
+    if (tree->arena != NULL) {
+        node_arena_destroy(tree->arena);
+        free(tree->arena);
+        tree->arena = NULL;
+    } else {
+        btree_free_node(tree->root);
+    }
+    tree->root = NULL;
+}
+
+// Переложить узлы в новую арену по уровням (обход в ширину): узлы
+// верхних уровней, через которые идет каждый поиск, лежат рядом.
+// Старые узлы освобождаются; offset узлов не меняется.
+template <typename Tree>
+bool btree_tree_relayout(Tree* tree, ArenaPlacement placement) {
+    typedef typename Tree::Node Node;
+    struct NodeArena* arena = (struct NodeArena*)malloc(sizeof(struct NodeArena));
+    Node** queue = (Node**)malloc(sizeof(Node*) * tree->node_count);
+    if (arena == NULL || queue == NULL) {
+        free(arena);
+        free(queue);
+        return false;
+    }
+    node_arena_init(arena, sizeof(Node), 0, placement);
+
+    Node* root = (Node*)node_arena_alloc(arena, tree->root->is_leaf);
+    memcpy(root, tree->root, sizeof(Node));
+    long long head = 0, tail = 0;
+    queue[tail++] = root;
+    while (head < tail) {
+        Node* node = queue[head++];
+        if (node->is_leaf) continue;
+        for (int i = 0; i <= node->key_count; i++) {
+            Node* child = (Node*)node->children[i];
+            Node* copy = (Node*)node_arena_alloc(arena, child->is_leaf);
+            memcpy(copy, child, sizeof(Node));
+            node->children[i] = (long long)copy;
+            queue[tail++] = copy;
+        }
+    }
+    free(queue);
+
+    btree_tree_free(tree);
+    tree->root = root;
+    tree->arena = arena;
+    return true;
+}
+
+// Range query для обычного B-дерева (для сравнения): в results попадает
+// не больше max_results ключей, возвращается число всех ключей диапазона
+template <typename Node>
+long long btree_range_query(Node* node, typename Node::Key start_key, typename Node::Key end_key,
+                            typename Node::Key* results, long long max_results) {
+    if (node == NULL) return 0;
+
+    long long count = 0;
+    for (int i = 0; i <= node->key_count; i++) {
+        if (!node->is_leaf) {
+            long long stored = count < max_results ? count : max_results;
+            count += btree_range_query((Node*)node->children[i], start_key, end_key,
+                                       results + stored, max_results - stored);
+        }
+        if (i < node->key_count && node->keys[i] >= start_key && node->keys[i] <= end_key) {
+            if (count < max_results) results[count] = node->keys[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+// ==================== КУРСОР ДИАПАЗОНА ====================
+// Обход по порядку без рекурсии: стек (узел, позиция) от корня до текущего
+// узла. Ключи и значения отдаются указателями в узлы, без копирования.
+
+#define BTREE_MAX_HEIGHT 64
+
+// Отрезок подряд идущих записей одного узла
+template <typename Tree>
+struct BTreeSpan {
+    const typename Tree::Key* keys;
+    const typename Tree::Value* values;
+    int count;
+};
+
+template <typename Tree>
+struct BTreeCursor {
+    typename Tree::Node* nodes[BTREE_MAX_HEIGHT];
+    int pos[BTREE_MAX_HEIGHT];   // следующий ключ узла на этом уровне
+    int depth;                   // 0 - диапазон исчерпан
+    typename Tree::Key end_key;
+#if TREE_STATS
+    StatOpTimer stat;            // операция range: узлы, попавшие на стек
+#endif
+};
+
+// Спуск к самому левому листу поддерева
+template <typename Tree>
+void btree_cursor_push_leftmost(BTreeCursor<Tree>* cursor, typename Tree::Node* node) {
+    typedef typename Tree::Node Node;
+    while (true) {
+        cursor->nodes[cursor->depth] = node;
+        cursor->pos[cursor->depth] = 0;
+        cursor->depth++;
+        STATS_VISIT(cursor->stat, 1);
+        if (node->is_leaf) return;
+        node = (Node*)node->children[0];
+    }
+}
+
+// Снять со стека пройденные узлы; после вызова на вершине есть следующий ключ.
+// Диапазон, брошенный до исчерпания, учитывается в btree_cursor_close.
+template <typename Tree>
+void btree_cursor_settle(BTreeCursor<Tree>* cursor) {
+    while (cursor->depth > 0) {
+        int top = cursor->depth - 1;
+        if (cursor->pos[top] < cursor->nodes[top]->key_count) {
+            if (!(cursor->nodes[top]->keys[cursor->pos[top]] > cursor->end_key)) return;
+            cursor->depth = 0;
+            break;
+        }
+        cursor->depth--;
+    }
+    STATS_END(cursor->stat);
+}
+
+// Переход за ключ на вершине стека
+template <typename Tree>
+void btree_cursor_advance(BTreeCursor<Tree>* cursor, int count) {
+    typedef typename Tree::Node Node;
+    int top = cursor->depth - 1;
+    Node* node = cursor->nodes[top];
+    cursor->pos[top] += count;
+    if (!node->is_leaf) {
+        // После ключа i внутреннего узла идет поддерево children[i + 1]
+        btree_cursor_push_leftmost(cursor, (Node*)node->children[cursor->pos[top]]);
+    }
+    btree_cursor_settle(cursor);
+}
+
+template <typename Tree>
+void btree_cursor_seek(Tree* tree, BTreeCursor<Tree>* cursor,
+                       typename Tree::Key start_key, typename Tree::Key end_key) {
+    typedef typename Tree::Node Node;
+    STATS_BEGIN(cursor->stat, STAT_OP_RANGE);
+    cursor->depth = 0;
+    cursor->end_key = end_key;
+    Node* node = tree->root;
+    while (true) {
+        int i = node_lower_bound(node->keys, node->key_count, start_key);
+        cursor->nodes[cursor->depth] = node;
+        cursor->pos[cursor->depth] = i;
+        cursor->depth++;
+        STATS_VISIT(cursor->stat, 1);
+        // Совпадение во внутреннем узле: левое поддерево целиком меньше start_key
+        if (node->is_leaf || (i < node->key_count && node->keys[i] == start_key)) break;
+        node = (Node*)node->children[i];
+    }
+    btree_cursor_settle(cursor);
+}
+
+template <typename Tree>
+bool btree_cursor_next(BTreeCursor<Tree>* cursor, const typename Tree::Key** key,
+                       const typename Tree::Value** value) {
+    if (cursor->depth == 0) return false;
+    int top = cursor->depth - 1;
+    *key = &cursor->nodes[top]->keys[cursor->pos[top]];
+    *value = &cursor->nodes[top]->values[cursor->pos[top]];
+    btree_cursor_advance(cursor, 1);
+    return true;
+}
+
+// Пакетная выдача: в листе - до max_count записей подряд, во внутреннем
+// узле - одна запись (дальше идет следующее поддерево)
+template <typename Tree>
+int btree_cursor_next_n(BTreeCursor<Tree>* cursor, int max_count, BTreeSpan<Tree>* span) {
+    typedef typename Tree::Node Node;
+    if (cursor->depth == 0) {
+        span->count = 0;
+        return 0;
+    }
+    int top = cursor->depth - 1;
+    Node* node = cursor->nodes[top];
+    int pos = cursor->pos[top];
+    int count = 1;
+    if (node->is_leaf) {
+        count = node_upper_bound(node->keys + pos, node->key_count - pos, cursor->end_key);
+        if (count > max_count) count = max_count;
+    }
+    span->keys = &node->keys[pos];
+    span->values = &node->values[pos];
+    span->count = count;
+    btree_cursor_advance(cursor, count);
+    return count;
+}
+
+// Завершить сканирование до исчерпания диапазона: засчитать операцию range
+// с уже посещенными узлами. После исчерпания вызов ничего не делает.
+template <typename Tree>
+void btree_cursor_close(BTreeCursor<Tree>* cursor) {
+    cursor->depth = 0;
+    STATS_END(cursor->stat);
+}
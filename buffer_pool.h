@@ -0,0 +1,365 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "disk.h"
+
+// Буферный пул фиксированной емкости между деревьями и файлом страниц.
+// Страница закрепляется (pin) на время работы с ней и открепляется (unpin)
+// с флагом dirty; вытеснять можно только незакрепленные страницы, грязные
+// при вытеснении записываются на диск. Политика вытеснения - LRU или CLOCK.
+
+enum EvictionPolicy {
+    EVICT_LRU = 0,
+    EVICT_CLOCK = 1
+};
+
+inline const char* eviction_policy_name(EvictionPolicy policy) {
+    return policy == EVICT_LRU ? "LRU" : "CLOCK";
+}
+
+struct BufferFrame {
+    long long page_id;         // -1 - кадр свободен
+    int pin_count;
+    bool dirty;
+    bool referenced;           // бит обращения для CLOCK
+    int lru_prev;              // соседи в списке LRU (индексы кадров)
+    int lru_next;
+    int hash_next;             // следующий кадр в цепочке хеш-таблицы
+};
+
+struct BufferPool {
+    struct DiskSimulator* disk;
+    EvictionPolicy policy;
+    int capacity;
+    int* free_frames;          // стек свободных кадров
+    int free_count;
+    unsigned char* pages;      // capacity * page_size байт
+    struct BufferFrame* frames;
+    int* buckets;              // хеш-таблица page_id -> первый кадр цепочки
+    int bucket_mask;
+    int lru_head;              // самый недавно использованный
+    int lru_tail;              // самый давно использованный
+    int clock_hand;
+
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long write_backs;
+    long long prefetched;      // страниц, загруженных упреждающим чтением
+};
+
+inline int buffer_pool_bucket(struct BufferPool* pool, long long page_id) {
+    unsigned long long h = (unsigned long long)page_id * 0x9E3779B97F4A7C15ULL;
+    return (int)(h >> 32) & pool->bucket_mask;
+}
+
+inline bool buffer_pool_init(struct BufferPool* pool, struct DiskSimulator* disk,
+                             int capacity, EvictionPolicy policy) {
+    if (capacity < 1) capacity = 1;
+    pool->disk = disk;
+    pool->policy = policy;
+    pool->capacity = capacity;
+    pool->pages = (unsigned char*)aligned_alloc(CACHE_LINE_SIZE, (size_t)capacity * disk->page_size);
+    pool->frames = (struct BufferFrame*)malloc(sizeof(struct BufferFrame) * capacity);
+
+    int bucket_count = 1;
+    while (bucket_count < capacity * 2) bucket_count <<= 1;
+    pool->buckets = (int*)malloc(sizeof(int) * bucket_count);
+    pool->bucket_mask = bucket_count - 1;
+    pool->free_frames = (int*)malloc(sizeof(int) * capacity);
+    if (pool->pages == NULL || pool->frames == NULL || pool->buckets == NULL ||
+        pool->free_frames == NULL) return false;
+
+    for (int i = 0; i < bucket_count; i++) pool->buckets[i] = -1;
+    for (int i = 0; i < capacity; i++) {
+        pool->frames[i].page_id = -1;
+        pool->frames[i].pin_count = 0;
+        pool->frames[i].dirty = false;
+        pool->frames[i].referenced = false;
+        pool->frames[i].lru_prev = -1;
+        pool->frames[i].lru_next = -1;
+        pool->frames[i].hash_next = -1;
+        pool->free_frames[i] = capacity - 1 - i;
+    }
+    pool->free_count = capacity;
+    pool->lru_head = -1;
+    pool->lru_tail = -1;
+    pool->clock_hand = 0;
+    pool->hits = 0;
+    pool->misses = 0;
+    pool->evictions = 0;
+    pool->write_backs = 0;
+    pool->prefetched = 0;
+    return true;
+}
+
+inline void* buffer_pool_frame_data(struct BufferPool* pool, int frame) {
+    return pool->pages + (size_t)frame * pool->disk->page_size;
+}
+
+inline int buffer_pool_lookup(struct BufferPool* pool, long long page_id) {
+    int frame = pool->buckets[buffer_pool_bucket(pool, page_id)];
+    while (frame != -1 && pool->frames[frame].page_id != page_id) {
+        frame = pool->frames[frame].hash_next;
+    }
+    return frame;
+}
+
+inline void buffer_pool_hash_remove(struct BufferPool* pool, int frame) {
+    int* link = &pool->buckets[buffer_pool_bucket(pool, pool->frames[frame].page_id)];
+    while (*link != frame) link = &pool->frames[*link].hash_next;
+    *link = pool->frames[frame].hash_next;
+    pool->frames[frame].hash_next = -1;
+}
+
+inline void buffer_pool_lru_unlink(struct BufferPool* pool, int frame) {
+    struct BufferFrame* f = &pool->frames[frame];
+    if (f->lru_prev != -1) pool->frames[f->lru_prev].lru_next = f->lru_next;
+    else pool->lru_head = f->lru_next;
+    if (f->lru_next != -1) pool->frames[f->lru_next].lru_prev = f->lru_prev;
+    else pool->lru_tail = f->lru_prev;
+    f->lru_prev = -1;
+    f->lru_next = -1;
+}
+
+inline void buffer_pool_lru_push_front(struct BufferPool* pool, int frame) {
+    struct BufferFrame* f = &pool->frames[frame];
+    f->lru_prev = -1;
+    f->lru_next = pool->lru_head;
+    if (pool->lru_head != -1) pool->frames[pool->lru_head].lru_prev = frame;
+    pool->lru_head = frame;
+    if (pool->lru_tail == -1) pool->lru_tail = frame;
+}
+
+// Отметить обращение к кадру для выбранной политики
+inline void buffer_pool_touch(struct BufferPool* pool, int frame) {
+    if (pool->policy == EVICT_LRU) {
+        if (pool->lru_head != frame) {
+            buffer_pool_lru_unlink(pool, frame);
+            buffer_pool_lru_push_front(pool, frame);
+        }
+    } else {
+        pool->frames[frame].referenced = true;
+    }
+}
+
+// Выбор жертвы среди незакрепленных кадров; -1, если закреплено все
+inline int buffer_pool_choose_victim(struct BufferPool* pool) {
+    if (pool->policy == EVICT_LRU) {
+        for (int frame = pool->lru_tail; frame != -1; frame = pool->frames[frame].lru_prev) {
+            if (pool->frames[frame].pin_count == 0) return frame;
+        }
+        return -1;
+    }
+
+    // CLOCK: за два оборота стрелки все биты обращения будут сброшены
+    for (int step = 0; step < 2 * pool->capacity; step++) {
+        int frame = pool->clock_hand;
+        pool->clock_hand = (pool->clock_hand + 1) % pool->capacity;
+        struct BufferFrame* f = &pool->frames[frame];
+        if (f->pin_count > 0) continue;
+        if (f->referenced) {
+            f->referenced = false;
+            continue;
+        }
+        return frame;
+    }
+    return -1;
+}
+
+// Освободить кадр: грязная страница сначала записывается на диск
+inline bool buffer_pool_evict(struct BufferPool* pool, int frame) {
+    struct BufferFrame* f = &pool->frames[frame];
+    if (f->dirty) {
+        if (!disk_write_page(pool->disk, f->page_id, buffer_pool_frame_data(pool, frame))) return false;
+        pool->write_backs++;
+        f->dirty = false;
+    }
+    buffer_pool_hash_remove(pool, frame);
+    if (pool->policy == EVICT_LRU) buffer_pool_lru_unlink(pool, frame);
+    f->page_id = -1;
+    pool->evictions++;
+    return true;
+}
+
+// Поставить загруженный кадр в хеш-таблицу и очередь вытеснения
+inline void buffer_pool_register(struct BufferPool* pool, int frame, long long page_id, int pin_count) {
+    struct BufferFrame* f = &pool->frames[frame];
+    f->page_id = page_id;
+    f->pin_count = pin_count;
+    f->dirty = false;
+    f->referenced = true;
+    int bucket = buffer_pool_bucket(pool, page_id);
+    f->hash_next = pool->buckets[bucket];
+    pool->buckets[bucket] = frame;
+    if (pool->policy == EVICT_LRU) buffer_pool_lru_push_front(pool, frame);
+}
+
+// Свободный кадр: из запаса или вытеснением; -1, если все закреплены
+inline int buffer_pool_take_frame(struct BufferPool* pool) {
+    if (pool->free_count > 0) return pool->free_frames[--pool->free_count];
+    int frame = buffer_pool_choose_victim(pool);
+    if (frame == -1 || !buffer_pool_evict(pool, frame)) return -1;
+    return frame;
+}
+
+// Закрепить страницу и получить указатель на ее содержимое в пуле.
+// NULL - страницы нет на диске или все кадры закреплены.
+inline void* buffer_pool_pin(struct BufferPool* pool, long long page_id) {
+    int frame = buffer_pool_lookup(pool, page_id);
+    if (frame != -1) {
+        pool->hits++;
+        STATS_COUNT(STAT_POOL_HITS, 1);
+        pool->frames[frame].pin_count++;
+        buffer_pool_touch(pool, frame);
+        return buffer_pool_frame_data(pool, frame);
+    }
+
+    pool->misses++;
+    STATS_COUNT(STAT_POOL_MISSES, 1);
+    frame = buffer_pool_take_frame(pool);
+    if (frame == -1) return NULL;
+
+    void* data = buffer_pool_frame_data(pool, frame);
+    if (!disk_read_page(pool->disk, page_id, data)) {
+        pool->free_frames[pool->free_count++] = frame;
+        return NULL;
+    }
+    buffer_pool_register(pool, frame, page_id, 1);
+    return data;
+}
+
+// Упреждающее чтение для пула. Отсутствующие страницы сначала заказываются
+// у ядра асинхронно; серии подряд идущих страниц сразу читаются в кадры
+// одним preadv (не закрепляя их), одиночные страницы подтянет pin.
+// Возвращает число загруженных в пул страниц.
+inline int buffer_pool_prefetch(struct BufferPool* pool, const long long* page_ids, int count) {
+    // Не вытесняем больше половины пула ради упреждения
+    if (count > pool->capacity / 2) count = pool->capacity / 2;
+
+    long long missing[64];
+    int missing_count = 0;
+    for (int i = 0; i < count && missing_count < 64; i++) {
+        if (buffer_pool_lookup(pool, page_ids[i]) == -1) missing[missing_count++] = page_ids[i];
+    }
+    disk_advise_pages(pool->disk, missing, missing_count);
+
+    int loaded = 0;
+    int i = 0;
+    while (i < missing_count) {
+        int run = 1;
+        while (i + run < missing_count && missing[i + run] == missing[i] + run) run++;
+        if (run < 2) {
+            i++;
+            continue;
+        }
+
+        int frames[64];
+        void* bufs[64];
+        int taken = 0;
+        while (taken < run) {
+            int frame = buffer_pool_take_frame(pool);
+            if (frame == -1) break;
+            frames[taken] = frame;
+            bufs[taken++] = buffer_pool_frame_data(pool, frame);
+        }
+        if (taken == 0 || !disk_read_pages(pool->disk, missing[i], bufs, taken)) {
+            for (int j = 0; j < taken; j++) pool->free_frames[pool->free_count++] = frames[j];
+            return loaded;
+        }
+        for (int j = 0; j < taken; j++) buffer_pool_register(pool, frames[j], missing[i] + j, 0);
+        loaded += taken;
+        pool->prefetched += taken;
+        i += run;
+    }
+    return loaded;
+}
+
+inline void buffer_pool_unpin(struct BufferPool* pool, long long page_id, bool dirty) {
+    int frame = buffer_pool_lookup(pool, page_id);
+    if (frame == -1) return;
+    struct BufferFrame* f = &pool->frames[frame];
+    if (f->pin_count > 0) f->pin_count--;
+    if (dirty) f->dirty = true;
+}
+
+// Записать все грязные страницы (страницы остаются в пуле)
+inline bool buffer_pool_flush(struct BufferPool* pool) {
+    for (int i = 0; i < pool->capacity; i++) {
+        struct BufferFrame* f = &pool->frames[i];
+        if (f->page_id != -1 && f->dirty) {
+            if (!disk_write_page(pool->disk, f->page_id, buffer_pool_frame_data(pool, i))) return false;
+            pool->write_backs++;
+            f->dirty = false;
+        }
+    }
+    return true;
+}
+
+inline void buffer_pool_reset_stats(struct BufferPool* pool) {
+    pool->hits = 0;
+    pool->misses = 0;
+    pool->evictions = 0;
+    pool->write_backs = 0;
+    pool->prefetched = 0;
+}
+
+inline double buffer_pool_hit_rate(struct BufferPool* pool) {
+    long long total = pool->hits + pool->misses;
+    return total > 0 ? (double)pool->hits / total : 0.0;
+}
+
+// Сбрасывает грязные страницы и освобождает память пула
+inline bool buffer_pool_destroy(struct BufferPool* pool) {
+    bool ok = buffer_pool_flush(pool);
+    free(pool->pages);
+    free(pool->frames);
+    free(pool->buckets);
+    free(pool->free_frames);
+    pool->pages = NULL;
+    pool->frames = NULL;
+    pool->buckets = NULL;
+    return ok;
+}
+
+// ==================== ДОСТУП К СТРАНИЦАМ ДЛЯ ДЕРЕВЬЕВ ====================
+// Одинаковый интерфейс для чтения напрямую из файла (DiskSimulator,
+// страница копируется в scratch) и через пул (страница закрепляется в кадре).
+
+inline void* storage_pin(struct DiskSimulator* disk, long long page_id, void* scratch) {
+    return disk_read_page(disk, page_id, scratch) ? scratch : NULL;
+}
+
+inline void storage_unpin(struct DiskSimulator* disk, long long page_id, void* page, bool dirty) {
+    if (dirty) disk_write_page(disk, page_id, page);
+}
+
+inline void* storage_pin(struct BufferPool* pool, long long page_id, void* scratch) {
+    return buffer_pool_pin(pool, page_id);
+}
+
+inline void storage_unpin(struct BufferPool* pool, long long page_id, void* page, bool dirty) {
+    buffer_pool_unpin(pool, page_id, dirty);
+}
+
+// Страниц в файле: ссылки из прочитанных узлов проверяются по нему
+inline long long storage_page_count(struct DiskSimulator* disk) {
+    return disk->page_count;
+}
+
+inline long long storage_page_count(struct BufferPool* pool) {
+    return pool->disk->page_count;
+}
+
+// Упреждающее чтение: для файла - асинхронная подсказка ядру,
+// для пула - подсказка плюс пакетная загрузка серий страниц в кадры
+inline void storage_prefetch(struct DiskSimulator* disk, const long long* page_ids, int count) {
+    disk_advise_pages(disk, page_ids, count);
+}
+
+inline void storage_prefetch(struct BufferPool* pool, const long long* page_ids, int count) {
+    buffer_pool_prefetch(pool, page_ids, count);
+}
@@ -0,0 +1,448 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <type_traits>
+
+#include "disk.h"
+#include "simd_search.h"
+#include "buffer_pool.h"
+#include "bplus_tree.h"
+#include "disk_tree.h"
+
+// Сжатые листья B+-дерева в файле страниц (целые ключи).
+// Плотные монотонные ключи (даты, отметки времени) в листе отличаются от
+// минимального ключа листа на небольшую величину, поэтому лист хранит
+// base = минимальный ключ и разности key - base, упакованные по bits бит
+// (frame of reference + bit-packing). В страницу помещается в 1.5-2 раза
+// больше ключей, чем в BPlusNode: листьев и страниц меньше, дерево ниже,
+// диапазон читает меньше страниц. Внутренние узлы хранятся как обычные
+// BPlusNode, лист узнается по глубине (header->height).
+// Формат только для записи целиком (как *_persist), обновлений на месте нет.
+//
+// Страница листа: PackedLeafHeader | значения V[key_count] | упакованные
+// разности | PACKED_LEAF_SLACK байт запаса. Декодер AVX2 достает 8 разностей
+// одной сборкой (gather) по байтовым смещениям и сдвигает их на место.
+
+struct PackedLeafHeader {
+    long long next_page;       // следующий лист или -1
+    unsigned long long base;   // минимальный ключ листа
+    int key_count;
+    int bits;                  // ширина одной разности, 0..64
+};
+
+// Декодер читает словами по 8 байт, начиная с байта последней разности
+#define PACKED_LEAF_SLACK 16
+
+// Верхняя граница числа ключей в листе (разности нулевой ширины)
+template <typename Tree>
+constexpr int packed_leaf_max_keys() {
+    return (int)((DISK_PAGE_SIZE - sizeof(PackedLeafHeader) - PACKED_LEAF_SLACK) / sizeof(typename Tree::Value));
+}
+
+template <typename Tree>
+constexpr long long packed_leaf_bytes(long long count, int bits) {
+    return (long long)sizeof(PackedLeafHeader) + count * (long long)sizeof(typename Tree::Value)
+           + (count * bits + 7) / 8 + PACKED_LEAF_SLACK;
+}
+
+inline int packed_bits_for(unsigned long long delta) {
+    return delta == 0 ? 0 : 64 - __builtin_clzll(delta);
+}
+
+// ---------- Упаковка ----------
+
+// Записать bits младших бит value с бита bit; буфер заранее обнулен
+inline void packed_put(unsigned char* data, long long bit, int bits, unsigned long long value) {
+    while (bits > 0) {
+        int shift = (int)(bit & 7);
+        int take = 8 - shift < bits ? 8 - shift : bits;
+        data[bit >> 3] |= (unsigned char)((value & ((1u << take) - 1)) << shift);
+        value >>= take;
+        bit += take;
+        bits -= take;
+    }
+}
+
+// ---------- Распаковка ----------
+
+// i-я разность
+inline unsigned long long packed_get(const unsigned char* data, int bits, int i) {
+    long long bit = (long long)i * bits;
+    unsigned long long word;
+    memcpy(&word, data + (bit >> 3), sizeof(word));
+    int shift = (int)(bit & 7);
+    unsigned long long delta = word >> shift;
+    if (shift + bits > 64) delta |= (unsigned long long)data[(bit >> 3) + 8] << (64 - shift);
+    return bits == 64 ? delta : delta & ((1ULL << bits) - 1);
+}
+
+template <typename K>
+inline void packed_decode_scalar(const unsigned char* data, int bits, int from, int count, K base, K* out) {
+    typedef typename std::make_unsigned<K>::type U;
+    for (int i = from; i < count; i++) out[i] = (K)((U)base + (U)packed_get(data, bits, i));
+}
+
+#if SIMD_X86
+
+// Разности шириной до 25 бит: сдвиг внутри байта + ширина помещаются
+// в 32-битное слово, прочитанное с байта начала разности
+#define PACKED_AVX2_MAX_BITS 25
+
+__attribute__((target("avx2")))
+inline __m256i packed_gather8_avx2(const unsigned char* data, __m256i offsets, __m256i mask) {
+    __m256i bytes = _mm256_srli_epi32(offsets, 3);
+    __m256i shift = _mm256_and_si256(offsets, _mm256_set1_epi32(7));
+    __m256i words = _mm256_i32gather_epi32((const int*)data, bytes, 1);
+    return _mm256_and_si256(_mm256_srlv_epi32(words, shift), mask);
+}
+
+__attribute__((target("avx2")))
+inline void packed_decode_avx2(const unsigned char* data, int bits, int count, unsigned int base, unsigned int* out) {
+    __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(bits));
+    __m256i step = _mm256_set1_epi32(bits * 8);
+    __m256i mask = _mm256_set1_epi32((int)((1u << bits) - 1));
+    __m256i vbase = _mm256_set1_epi32((int)base);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i delta = packed_gather8_avx2(data, offsets, mask);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi32(delta, vbase));
+        offsets = _mm256_add_epi32(offsets, step);
+    }
+    packed_decode_scalar(data, bits, i, count, base, out);
+}
+
+__attribute__((target("avx2")))
+inline void packed_decode_avx2(const unsigned char* data, int bits, int count,
+                               unsigned long long base, unsigned long long* out) {
+    __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(bits));
+    __m256i step = _mm256_set1_epi32(bits * 8);
+    __m256i mask = _mm256_set1_epi32((int)((1u << bits) - 1));
+    __m256i vbase = _mm256_set1_epi64x((long long)base);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i delta = packed_gather8_avx2(data, offsets, mask);
+        __m256i lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(delta));
+        __m256i hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(delta, 1));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi64(lo, vbase));
+        _mm256_storeu_si256((__m256i*)(out + i + 4), _mm256_add_epi64(hi, vbase));
+        offsets = _mm256_add_epi32(offsets, step);
+    }
+    packed_decode_scalar(data, bits, i, count, base, out);
+}
+
+#endif // SIMD_X86
+
+// Распаковка count ключей: AVX2 для 32- и 64-битных ключей с узкими
+// разностями, иначе скалярный цикл
+template <typename K>
+inline void packed_decode(const unsigned char* data, int bits, int count, K base, K* out) {
+#if SIMD_X86
+    if (g_simd_level == SIMD_AVX2 && bits <= PACKED_AVX2_MAX_BITS) {
+        if constexpr (sizeof(K) == 4) {
+            packed_decode_avx2(data, bits, count, (unsigned int)base, (unsigned int*)out);
+            return;
+        } else if constexpr (sizeof(K) == 8) {
+            packed_decode_avx2(data, bits, count, (unsigned long long)base, (unsigned long long*)out);
+            return;
+        }
+    }
+#endif
+    packed_decode_scalar(data, bits, 0, count, base, out);
+}
+
+template <typename Tree>
+inline const typename Tree::Value* packed_leaf_values(const unsigned char* page) {
+    return (const typename Tree::Value*)(page + sizeof(PackedLeafHeader));
+}
+
+template <typename Tree>
+inline const unsigned char* packed_leaf_keys(const unsigned char* page) {
+    return page + sizeof(PackedLeafHeader)
+           + (size_t)((const PackedLeafHeader*)page)->key_count * sizeof(typename Tree::Value);
+}
+
+// Позиция первого ключа >= key двоичным поиском прямо по упакованным
+// разностям, без распаковки листа
+template <typename Tree>
+inline int packed_leaf_lower_bound(const unsigned char* page, typename Tree::Key key) {
+    typedef typename Tree::Key K;
+    typedef typename std::make_unsigned<K>::type U;
+    const PackedLeafHeader* leaf = (const PackedLeafHeader*)page;
+    if (leaf->key_count == 0 || !((K)leaf->base < key)) return 0;
+    const unsigned char* packed = packed_leaf_keys<Tree>(page);
+    unsigned long long delta = (U)key - (U)(K)leaf->base;
+    int lo = 0, hi = leaf->key_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (packed_get(packed, leaf->bits, mid) < delta) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Ключи листа в keys (не меньше packed_leaf_max_keys элементов); возвращает их число
+template <typename Tree>
+inline int packed_leaf_decode(const unsigned char* page, typename Tree::Key* keys) {
+    const PackedLeafHeader* leaf = (const PackedLeafHeader*)page;
+    packed_decode(packed_leaf_keys<Tree>(page), leaf->bits, leaf->key_count, (typename Tree::Key)leaf->base, keys);
+    return leaf->key_count;
+}
+
+// ---------- Запись дерева ----------
+
+// Накопленные, но еще не записанные ключи листа и уровень разделителей
+template <typename Tree>
+struct PackedWriter {
+    struct DiskSimulator* disk;
+    typename Tree::Key* keys;         // ключи текущего листа
+    typename Tree::Value* values;
+    int count;
+    int bits;
+    long long next_page_id;
+    typename Tree::Key* level_keys;   // минимальный ключ каждого записанного узла уровня
+    long long* level_pages;
+    long long level_count;
+    long long level_capacity;
+    bool ok;
+};
+
+template <typename Tree>
+void packed_writer_push_level(PackedWriter<Tree>* w, typename Tree::Key min_key, long long page_id) {
+    if (w->level_count == w->level_capacity) {
+        w->level_capacity = w->level_capacity > 0 ? w->level_capacity * 2 : 1024;
+        w->level_keys = (typename Tree::Key*)realloc(w->level_keys, sizeof(typename Tree::Key) * w->level_capacity);
+        w->level_pages = (long long*)realloc(w->level_pages, sizeof(long long) * w->level_capacity);
+    }
+    w->level_keys[w->level_count] = min_key;
+    w->level_pages[w->level_count] = page_id;
+    w->level_count++;
+}
+
+// Записать накопленный лист; листья идут подряд, поэтому сосед - следующая страница
+template <typename Tree>
+void packed_writer_flush(PackedWriter<Tree>* w, bool last) {
+    typedef typename Tree::Key K;
+    typedef typename std::make_unsigned<K>::type U;
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE] = {0};
+    PackedLeafHeader* leaf = (PackedLeafHeader*)page;
+    long long page_id = w->next_page_id++;
+    leaf->next_page = last ? -1 : page_id + 1;
+    leaf->base = w->count > 0 ? (unsigned long long)w->keys[0] : 0;
+    leaf->key_count = w->count;
+    leaf->bits = w->bits;
+    memcpy(page + sizeof(PackedLeafHeader), w->values, sizeof(typename Tree::Value) * w->count);
+    unsigned char* packed = page + sizeof(PackedLeafHeader) + sizeof(typename Tree::Value) * w->count;
+    for (int i = 0; i < w->count; i++) {
+        packed_put(packed, (long long)i * w->bits, w->bits, (U)w->keys[i] - (U)w->keys[0]);
+    }
+    if (!disk_write_page(w->disk, page_id, page)) w->ok = false;
+    packed_writer_push_level(w, w->count > 0 ? w->keys[0] : K(), page_id);
+    w->count = 0;
+    w->bits = 0;
+}
+
+// Ключ добавляется в текущий лист, если лист с ним еще помещается в страницу
+template <typename Tree>
+void packed_writer_add(PackedWriter<Tree>* w, typename Tree::Key key, typename Tree::Value value) {
+    typedef typename std::make_unsigned<typename Tree::Key>::type U;
+    if (w->count > 0) {
+        int bits = packed_bits_for((U)key - (U)w->keys[0]);
+        if (bits < w->bits) bits = w->bits;
+        if (packed_leaf_bytes<Tree>(w->count + 1, bits) > DISK_PAGE_SIZE) {
+            packed_writer_flush(w, false);
+        } else {
+            w->bits = bits;
+        }
+    }
+    w->keys[w->count] = key;
+    w->values[w->count] = value;
+    w->count++;
+}
+
+// Запись дерева со сжатыми листьями и заголовка; disk должен быть открыт.
+// Листья заполняются до конца страницы, внутренние узлы строятся снизу
+// вверх с равномерным распределением детей.
+template <typename Tree>
+bool bplus_persist_packed(Tree* tree, struct DiskSimulator* disk) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    static_assert(std::is_integral<K>::value, "сжимаются только целые ключи");
+    static_assert(sizeof(Node) <= DISK_PAGE_SIZE, "внутренний узел должен помещаться в страницу");
+
+    PackedWriter<Tree> w;
+    w.disk = disk;
+    w.keys = (K*)malloc(sizeof(K) * packed_leaf_max_keys<Tree>());
+    w.values = (typename Tree::Value*)malloc(sizeof(typename Tree::Value) * packed_leaf_max_keys<Tree>());
+    w.count = 0;
+    w.bits = 0;
+    w.next_page_id = 1;
+    w.level_keys = NULL;
+    w.level_pages = NULL;
+    w.level_count = 0;
+    w.level_capacity = 0;
+    w.ok = true;
+
+    Node* leaf = tree->root;
+    while (!leaf->is_leaf) leaf = (Node*)leaf->children[0];
+    for (; leaf != NULL; leaf = leaf->next_leaf) {
+        for (int i = 0; i < leaf->key_count; i++) packed_writer_add(&w, leaf->keys[i], leaf->data[i]);
+    }
+    packed_writer_flush(&w, true);
+    long long leaf_count = w.level_count;
+
+    // Внутренние уровни: детей поровну, пока не останется один корень
+    int height = 1;
+    while (w.level_count > 1) {
+        long long count = w.level_count;
+        long long groups = (count + Tree::order - 1) / Tree::order;
+        K* keys = w.level_keys;
+        long long* pages = w.level_pages;
+        w.level_keys = NULL;
+        w.level_pages = NULL;
+        w.level_count = 0;
+        w.level_capacity = 0;
+        for (long long g = 0; g < groups; g++) {
+            long long first = count * g / groups;
+            long long last = count * (g + 1) / groups;
+            alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE] = {0};
+            Node* node = (Node*)page;
+            long long page_id = w.next_page_id++;
+            node->is_leaf = false;
+            node->key_count = (int)(last - first - 1);
+            node->offset = page_id - 1;
+            for (long long j = first; j < last; j++) {
+                node->children[j - first] = pages[j];
+                if (j > first) node->keys[j - first - 1] = keys[j];
+            }
+            if (!disk_write_page(disk, page_id, page)) w.ok = false;
+            packed_writer_push_level(&w, keys[first], page_id);
+        }
+        free(keys);
+        free(pages);
+        height++;
+    }
+
+    struct DiskTreeHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DISK_TREE_MAGIC;
+    header.version = DISK_TREE_VERSION;
+    header.page_size = disk->page_size;
+    header.kind = DISK_TREE_BPLUS_PACKED;
+    header.order = Tree::order;
+    header.key_size = sizeof(K);
+    header.value_size = sizeof(typename Tree::Value);
+    header.height = height;
+    header.root_page = w.level_pages[0];
+    header.first_leaf_page = 1;
+    header.node_count = w.next_page_id - 1;
+    header.leaf_count = leaf_count;
+    header.key_count = tree->key_count;
+
+    free(w.keys);
+    free(w.values);
+    free(w.level_keys);
+    free(w.level_pages);
+    if (!w.ok || !disk_write_header(disk, &header)) return false;
+    return disk_sync(disk);
+}
+
+template <typename Tree>
+bool bplus_packed_open(struct DiskSimulator* disk, struct DiskTreeHeader* header) {
+    return disk_read_header(disk, header, DISK_TREE_BPLUS_PACKED, Tree::order,
+                            sizeof(typename Tree::Key), sizeof(typename Tree::Value));
+}
+
+// ---------- Запросы с диска ----------
+
+// Заголовок сжатого листа из файла: ключи помещаются в страницу и в буфер
+// распаковки, сосед - существующая страница
+template <typename Tree>
+bool packed_leaf_valid(const unsigned char* page, long long page_count) {
+    const PackedLeafHeader* leaf = (const PackedLeafHeader*)page;
+    if (leaf->key_count < 0 || leaf->key_count > packed_leaf_max_keys<Tree>()) return false;
+    if (leaf->bits < 0 || leaf->bits > 64) return false;
+    if (packed_leaf_bytes<Tree>(leaf->key_count, leaf->bits) > DISK_PAGE_SIZE) return false;
+    return leaf->next_page == -1 || disk_page_id_valid(leaf->next_page, page_count);
+}
+
+// Закрепить и проверить сжатый лист. NULL - ошибка чтения или поврежденная
+// страница (закрепление тогда уже снято).
+template <typename Tree, typename Storage>
+unsigned char* bplus_packed_pin_leaf(Storage* storage, long long page_id, void* scratch) {
+    unsigned char* page = (unsigned char*)storage_pin(storage, page_id, scratch);
+    if (page == NULL) return NULL;
+    if (!packed_leaf_valid<Tree>(page, storage_page_count(storage))) {
+        storage_unpin(storage, page_id, page, false);
+        return NULL;
+    }
+    return page;
+}
+
+// Спуск по внутренним узлам к листу, где должен лежать key; -1 - ошибка
+// чтения или поврежденный узел
+template <typename Tree, typename Storage>
+long long bplus_packed_find_leaf(Storage* storage, const struct DiskTreeHeader* header,
+                                 typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+    long long page_id = header->root_page;
+    for (int depth = 0; depth + 1 < header->height; depth++) {
+        Node* node = bplus_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return -1;
+        long long child = node->children[node_upper_bound(node->keys, node->key_count, key)];
+        storage_unpin(storage, page_id, node, false);
+        page_id = child;
+    }
+    return page_id;
+}
+
+template <typename Tree, typename Storage>
+bool bplus_packed_search(Storage* storage, const struct DiskTreeHeader* header,
+                         typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename std::make_unsigned<typename Tree::Key>::type U;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+
+    long long page_id = bplus_packed_find_leaf<Tree>(storage, header, key);
+    if (page_id < 0) return false;
+    unsigned char* page = bplus_packed_pin_leaf<Tree>(storage, page_id, scratch);
+    if (page == NULL) return false;
+    const PackedLeafHeader* leaf = (const PackedLeafHeader*)page;
+    int pos = packed_leaf_lower_bound<Tree>(page, key);
+    bool found = pos < leaf->key_count &&
+                 packed_get(packed_leaf_keys<Tree>(page), leaf->bits, pos) == (U)key - (U)(typename Tree::Key)leaf->base;
+    if (found && value != NULL) *value = packed_leaf_values<Tree>(page)[pos];
+    storage_unpin(storage, page_id, page, false);
+    return found;
+}
+
+// Range query по сжатым листьям: тот же контракт, что у bplus_disk_range_query
+template <typename Tree, typename Storage>
+long long bplus_packed_range_query(Storage* storage, const struct DiskTreeHeader* header,
+                                   typename Tree::Key start_key, typename Tree::Key end_key,
+                                   typename Tree::Key* results, long long max_results) {
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+    alignas(CACHE_LINE_SIZE) typename Tree::Key keys[packed_leaf_max_keys<Tree>()];
+
+    long long page_id = bplus_packed_find_leaf<Tree>(storage, header, start_key);
+    if (page_id < 0) return -1;
+    long long count = 0;
+    long long leaves = 0;   // цепочка next_page длиннее числа листьев - цикл
+    while (page_id >= 0) {
+        if (++leaves > header->leaf_count) return -1;
+        unsigned char* page = bplus_packed_pin_leaf<Tree>(storage, page_id, scratch);
+        if (page == NULL) return -1;
+        int n = packed_leaf_decode<Tree>(page, keys);
+        int first, last;
+        node_range_bounds(keys, n, start_key, end_key, &first, &last);
+        for (int i = first; i < last; i++) {
+            if (count < max_results) results[count] = keys[i];
+            count++;
+        }
+        long long next = last < n ? -1 : ((PackedLeafHeader*)page)->next_page;
+        storage_unpin(storage, page_id, page, false);
+        page_id = next;
+    }
+    return count;
+}
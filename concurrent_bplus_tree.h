@@ -0,0 +1,438 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <atomic>
+#include <new>
+
+#include "disk.h"
+#include "simd_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OLC_PAUSE() _mm_pause()
+#else
+#define OLC_PAUSE() ((void)0)
+#endif
+
+// Потокобезопасное B+-дерево с оптимистичной блокировкой узлов
+// (optimistic lock coupling). У каждого узла есть слово версии:
+//   бит 1 - узел заблокирован писателем, бит 0 - узел устарел,
+//   остальные биты - счетчик изменений.
+// Читатель не пишет в общую память: запоминает версию, читает узел и
+// проверяет, что версия не изменилась; иначе начинает спуск заново.
+// Писатель блокирует только узлы, которые меняет (лист или пару
+// родитель/узел при расщеплении). Полные узлы расщепляются по пути вниз,
+// поэтому родитель всегда имеет место для разделяющего ключа.
+// Узлы не удаляются до olc_bplus_free(), так что устаревший указатель
+// никогда не ведет в освобожденную память.
+
+template <typename K, typename V, int ORDER>
+struct alignas(CACHE_LINE_SIZE) OlcBPlusNode {
+    static_assert(ORDER >= 4, "для расщепления по пути вниз нужен ORDER >= 4");
+    typedef K Key;
+    typedef V Value;
+    static const int order = ORDER;
+
+    std::atomic<unsigned long long> version;
+    int key_count;
+    bool is_leaf;
+    K keys[ORDER - 1];
+    union {
+        long long children[ORDER];
+        struct {
+            V data[ORDER - 1];
+            OlcBPlusNode* next_leaf;
+        };
+    };
+};
+
+// Наибольший порядок, при котором узел помещается в BYTES байт
+template <typename K, typename V, int BYTES, int ORDER = 4>
+constexpr int olc_bplus_order_for() {
+    static_assert(sizeof(OlcBPlusNode<K, V, 4>) <= BYTES, "узел не помещается даже при порядке 4");
+    if constexpr (sizeof(OlcBPlusNode<K, V, ORDER + 1>) > BYTES) return ORDER;
+    else return olc_bplus_order_for<K, V, BYTES, ORDER + 1>();
+}
+
+template <typename K, typename V, int ORDER>
+struct OlcBPlusTree {
+    typedef K Key;
+    typedef V Value;
+    typedef OlcBPlusNode<K, V, ORDER> Node;
+    static const int order = ORDER;
+
+    std::atomic<Node*> root;
+    std::atomic<long long> node_count;
+    std::atomic<long long> key_count;
+    std::atomic<long long> restarts;   // повторных спусков из-за конфликтов
+};
+
+template <typename K, typename V, int LINES>
+using CacheLineOlcBPlusTree = OlcBPlusTree<K, V, olc_bplus_order_for<K, V, CACHE_LINE_SIZE * LINES>()>;
+
+// ==================== ВЕРСИИ УЗЛОВ ====================
+
+#define OLC_LOCKED 2ULL
+#define OLC_OBSOLETE 1ULL
+
+// Версия для оптимистичного чтения; ждет, пока писатель отпустит узел.
+// false - узел устарел, нужен новый спуск.
+template <typename Node>
+inline bool olc_read_lock(Node* node, unsigned long long* version) {
+    unsigned long long v = node->version.load(std::memory_order_acquire);
+    while (v & OLC_LOCKED) {
+        OLC_PAUSE();
+        v = node->version.load(std::memory_order_acquire);
+    }
+    *version = v;
+    return !(v & OLC_OBSOLETE);
+}
+
+// Узел не менялся с момента olc_read_lock
+template <typename Node>
+inline bool olc_validate(Node* node, unsigned long long version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return node->version.load(std::memory_order_relaxed) == version;
+}
+
+// Переход от чтения к записи без промежуточных изменений
+template <typename Node>
+inline bool olc_upgrade(Node* node, unsigned long long version) {
+    return node->version.compare_exchange_strong(version, version + OLC_LOCKED,
+                                                 std::memory_order_acquire);
+}
+
+// Снять блокировку: бит блокировки сбрасывается переносом в счетчик
+template <typename Node>
+inline void olc_write_unlock(Node* node) {
+    node->version.fetch_add(OLC_LOCKED, std::memory_order_release);
+}
+
+// Число ключей при оптимистичном чтении может быть мусорным: ограничиваем,
+// чтобы не выйти за массив до проверки версии
+template <typename Node>
+inline int olc_key_count(const Node* node) {
+    int count = node->key_count;
+    if (count < 0) return 0;
+    return count < Node::order - 1 ? count : Node::order - 1;
+}
+
+// ==================== СОЗДАНИЕ И ОСВОБОЖДЕНИЕ ====================
+
+template <typename Tree>
+typename Tree::Node* olc_bplus_new_node(Tree* tree, bool is_leaf) {
+    typedef typename Tree::Node Node;
+    Node* node = (Node*)aligned_alloc(alignof(Node), sizeof(Node));
+    new (&node->version) std::atomic<unsigned long long>(0);
+    node->key_count = 0;
+    node->is_leaf = is_leaf;
+    if (is_leaf) node->next_leaf = NULL;
+    tree->node_count.fetch_add(1, std::memory_order_relaxed);
+    return node;
+}
+
+template <typename Tree>
+void olc_bplus_init(Tree* tree) {
+    tree->node_count.store(0);
+    tree->key_count.store(0);
+    tree->restarts.store(0);
+    tree->root.store(olc_bplus_new_node(tree, true));
+}
+
+template <typename Node>
+void olc_bplus_free_node(Node* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) olc_bplus_free_node((Node*)node->children[i]);
+    }
+    free(node);
+}
+
+// Только когда с деревом больше никто не работает
+template <typename Tree>
+void olc_bplus_free(Tree* tree) {
+    olc_bplus_free_node(tree->root.load());
+    tree->root.store(NULL);
+}
+
+// ==================== РАСЩЕПЛЕНИЕ ====================
+// Вызываются под блокировкой записи на node (и на родителе).
+
+// Правая половина полного узла уходит в новый узел; возвращается разделитель
+template <typename Tree>
+typename Tree::Key olc_bplus_split(Tree* tree, typename Tree::Node* node, typename Tree::Node** right_out) {
+    typedef typename Tree::Node Node;
+    Node* right = olc_bplus_new_node(tree, node->is_leaf);
+    typename Tree::Key separator;
+    int n = node->key_count;
+    if (node->is_leaf) {
+        int left = (n + 1) / 2;
+        right->key_count = n - left;
+        for (int i = 0; i < right->key_count; i++) {
+            right->keys[i] = node->keys[left + i];
+            right->data[i] = node->data[left + i];
+        }
+        separator = right->keys[0];
+        // Новый лист вставляется в цепочку до публикации: сканирующий
+        // читатель увидит либо старый лист целиком, либо обе половины
+        right->next_leaf = node->next_leaf;
+        node->next_leaf = right;
+        node->key_count = left;
+    } else {
+        int mid = n / 2;
+        separator = node->keys[mid];
+        right->key_count = n - mid - 1;
+        for (int i = 0; i < right->key_count; i++) right->keys[i] = node->keys[mid + 1 + i];
+        for (int i = 0; i <= right->key_count; i++) right->children[i] = node->children[mid + 1 + i];
+        node->key_count = mid;
+    }
+    *right_out = right;
+    return separator;
+}
+
+// Вставка разделителя и правого узла в неполный внутренний узел
+template <typename Node>
+void olc_bplus_insert_separator(Node* parent, typename Node::Key separator, Node* right) {
+    int pos = node_upper_bound(parent->keys, parent->key_count, separator);
+    for (int i = parent->key_count; i > pos; i--) {
+        parent->keys[i] = parent->keys[i - 1];
+        parent->children[i + 1] = parent->children[i];
+    }
+    parent->keys[pos] = separator;
+    parent->children[pos + 1] = (long long)right;
+    parent->key_count++;
+}
+
+// Расщепить полный node; parent == NULL - node корень.
+// false - версии изменились, операцию нужно повторить.
+template <typename Tree>
+bool olc_bplus_split_locked(Tree* tree, typename Tree::Node* parent, unsigned long long parent_version,
+                            typename Tree::Node* node, unsigned long long version) {
+    typedef typename Tree::Node Node;
+    if (parent != NULL && !olc_upgrade(parent, parent_version)) return false;
+    if (!olc_upgrade(node, version)) {
+        if (parent != NULL) olc_write_unlock(parent);
+        return false;
+    }
+
+    Node* right;
+    typename Tree::Key separator = olc_bplus_split(tree, node, &right);
+    if (parent != NULL) {
+        olc_bplus_insert_separator(parent, separator, right);
+    } else {
+        Node* new_root = olc_bplus_new_node(tree, false);
+        new_root->keys[0] = separator;
+        new_root->children[0] = (long long)node;
+        new_root->children[1] = (long long)right;
+        new_root->key_count = 1;
+        tree->root.store(new_root, std::memory_order_release);
+    }
+    olc_write_unlock(node);
+    if (parent != NULL) olc_write_unlock(parent);
+    return true;
+}
+
+// ==================== СПУСК ====================
+
+// Оптимистичный спуск к листу, в котором должен лежать key.
+// false - конфликт, спуск нужно начать заново.
+template <typename Tree>
+bool olc_bplus_find_leaf(Tree* tree, typename Tree::Key key, typename Tree::Node** leaf,
+                         unsigned long long* leaf_version) {
+    typedef typename Tree::Node Node;
+    Node* node = tree->root.load(std::memory_order_acquire);
+    unsigned long long version;
+    if (!olc_read_lock(node, &version) || node != tree->root.load(std::memory_order_acquire)) return false;
+
+    while (!node->is_leaf) {
+        Node* child = (Node*)node->children[node_upper_bound(node->keys, olc_key_count(node), key)];
+        if (!olc_validate(node, version)) return false;
+        unsigned long long child_version;
+        if (!olc_read_lock(child, &child_version)) return false;
+        // Ребенок мог расщепиться между чтением указателя и его версией
+        if (!olc_validate(node, version)) return false;
+        node = child;
+        version = child_version;
+    }
+    *leaf = node;
+    *leaf_version = version;
+    return true;
+}
+
+// ==================== ОПЕРАЦИИ ====================
+
+template <typename Tree>
+bool olc_bplus_search(Tree* tree, typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    while (true) {
+        Node* leaf;
+        unsigned long long version;
+        if (olc_bplus_find_leaf(tree, key, &leaf, &version)) {
+            int count = olc_key_count(leaf);
+            int pos = node_lower_bound(leaf->keys, count, key);
+            bool found = pos < count && leaf->keys[pos] == key;
+            typename Tree::Value result = found ? leaf->data[pos] : typename Tree::Value();
+            if (olc_validate(leaf, version)) {
+                if (found && value != NULL) *value = result;
+                return found;
+            }
+        }
+        tree->restarts.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Вставка; false - ключ уже был (значение обновлено)
+template <typename Tree>
+bool olc_bplus_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    const int ORDER = Tree::order;
+    while (true) {
+        Node* parent = NULL;
+        unsigned long long parent_version = 0;
+        Node* node = tree->root.load(std::memory_order_acquire);
+        unsigned long long version;
+        if (!olc_read_lock(node, &version) || node != tree->root.load(std::memory_order_acquire)) {
+            tree->restarts.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        bool restart = false;
+        while (!node->is_leaf) {
+            if (node->key_count == ORDER - 1) {
+                // Полный внутренний узел расщепляется сразу, и спуск повторяется
+                olc_bplus_split_locked(tree, parent, parent_version, node, version);
+                restart = true;
+                break;
+            }
+            Node* child = (Node*)node->children[node_upper_bound(node->keys, olc_key_count(node), key)];
+            if (!olc_validate(node, version)) {
+                restart = true;
+                break;
+            }
+            unsigned long long child_version;
+            if (!olc_read_lock(child, &child_version) || !olc_validate(node, version)) {
+                restart = true;
+                break;
+            }
+            parent = node;
+            parent_version = version;
+            node = child;
+            version = child_version;
+        }
+        if (restart) {
+            tree->restarts.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (node->key_count == ORDER - 1) {
+            olc_bplus_split_locked(tree, parent, parent_version, node, version);
+            tree->restarts.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (!olc_upgrade(node, version)) {
+            tree->restarts.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        int pos = node_lower_bound(node->keys, node->key_count, key);
+        if (pos < node->key_count && node->keys[pos] == key) {
+            node->data[pos] = value;
+            olc_write_unlock(node);
+            return false;
+        }
+        for (int i = node->key_count; i > pos; i--) {
+            node->keys[i] = node->keys[i - 1];
+            node->data[i] = node->data[i - 1];
+        }
+        node->keys[pos] = key;
+        node->data[pos] = value;
+        node->key_count++;
+        olc_write_unlock(node);
+        tree->key_count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+// Range query по цепочке next_leaf. Каждый лист копируется в локальный
+// буфер и принимается только после проверки его версии; при конфликте
+// спуск повторяется с последнего выданного ключа, так что ключи не
+// теряются и не дублируются, даже если листья расщепляются во время обхода.
+// Возвращает число записанных ключей (не больше max_results).
+template <typename Tree>
+long long olc_bplus_range_query(Tree* tree, typename Tree::Key start_key, typename Tree::Key end_key,
+                                typename Tree::Key* keys_out, typename Tree::Value* values_out,
+                                long long max_results) {
+    typedef typename Tree::Node Node;
+    typename Tree::Key buffer_keys[Tree::order - 1];
+    typename Tree::Value buffer_values[Tree::order - 1];
+    long long count = 0;
+    typename Tree::Key resume = start_key;
+    bool exclusive = false;    // resume уже выдан, начинать строго после него
+
+    while (count < max_results) {
+        Node* leaf;
+        unsigned long long version;
+        if (!olc_bplus_find_leaf(tree, resume, &leaf, &version)) {
+            tree->restarts.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        while (true) {
+            int n = olc_key_count(leaf);
+            int first = exclusive ? node_upper_bound(leaf->keys, n, resume)
+                                  : node_lower_bound(leaf->keys, n, resume);
+            int copied = 0;
+            bool done = false;
+            for (int i = first; i < n; i++) {
+                if (end_key < leaf->keys[i] || count + copied == max_results) {
+                    done = true;
+                    break;
+                }
+                buffer_keys[copied] = leaf->keys[i];
+                buffer_values[copied++] = leaf->data[i];
+            }
+            Node* next = leaf->next_leaf;
+            if (!olc_validate(leaf, version)) break;
+
+            for (int i = 0; i < copied; i++) {
+                if (keys_out != NULL) keys_out[count] = buffer_keys[i];
+                if (values_out != NULL) values_out[count] = buffer_values[i];
+                count++;
+            }
+            if (copied > 0) {
+                resume = buffer_keys[copied - 1];
+                exclusive = true;
+            }
+            if (done || next == NULL || count == max_results) return count;
+
+            unsigned long long next_version;
+            if (!olc_read_lock(next, &next_version)) break;
+            leaf = next;
+            version = next_version;
+        }
+        tree->restarts.fetch_add(1, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+// Проверка структуры без конкурентов: ключи в цепочке листьев строго
+// возрастают, их число совпадает со счетчиком дерева
+template <typename Tree>
+bool olc_bplus_check(Tree* tree) {
+    typedef typename Tree::Node Node;
+    Node* node = tree->root.load();
+    while (!node->is_leaf) node = (Node*)node->children[0];
+    long long count = 0;
+    bool has_prev = false;
+    typename Tree::Key prev = typename Tree::Key();
+    for (; node != NULL; node = node->next_leaf) {
+        for (int i = 0; i < node->key_count; i++) {
+            if (has_prev && !(prev < node->keys[i])) return false;
+            prev = node->keys[i];
+            has_prev = true;
+            count++;
+        }
+    }
+    return count == tree->key_count.load();
+}
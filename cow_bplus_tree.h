@@ -0,0 +1,615 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "disk.h"
+#include "simd_search.h"
+
+// Иммутабельное (copy-on-write) B+-дерево со снимками для читателей.
+// Опубликованные узлы никогда не меняются. Писатель копирует путь от
+// корня до листа, правит копии и публикует новый корень одной атомарной
+// записью, поэтому читатель, взявший корень, видит согласованный снимок
+// всего дерева без блокировок, сколько бы ни длился его обход.
+// Пакет изменений (cow_bplus_batch_begin/commit) - вставки и удаления -
+// публикуется целиком: узлы, уже скопированные в этом пакете, правятся на месте.
+// У листьев нет ссылок на соседей - при копировании пути их пришлось бы
+// копировать по цепочке, - диапазон обходится спуском со стеком пути.
+// Старые версии узлов освобождаются по эпохам (epoch-based reclamation):
+// читатель на время работы со снимком объявляет текущую эпоху в своем
+// слоте, а узел, замененный в эпоху E, освобождается, когда ни один
+// активный читатель не объявил эпоху <= E.
+
+#define COW_MAX_READERS 64
+#define COW_MAX_HEIGHT 32
+
+template <typename K, typename V, int ORDER>
+struct alignas(CACHE_LINE_SIZE) CowBPlusNode {
+    static_assert(ORDER >= 4, "для расщепления по пути вниз нужен ORDER >= 4");
+    typedef K Key;
+    typedef V Value;
+    static const int order = ORDER;
+
+    long long version;      // пакет, создавший узел; в своем пакете узел можно менять
+    int key_count;
+    bool is_leaf;
+    K keys[ORDER - 1];
+    union {
+        long long children[ORDER];
+        V data[ORDER - 1];
+    };
+};
+
+// Наибольший порядок, при котором узел помещается в BYTES байт
+template <typename K, typename V, int BYTES, int ORDER = 4>
+constexpr int cow_bplus_order_for() {
+    static_assert(sizeof(CowBPlusNode<K, V, 4>) <= BYTES, "узел не помещается даже при порядке 4");
+    if constexpr (sizeof(CowBPlusNode<K, V, ORDER + 1>) > BYTES) return ORDER;
+    else return cow_bplus_order_for<K, V, BYTES, ORDER + 1>();
+}
+
+// Слот читателя: 0 - читатель вне снимка, иначе эпоха начала снимка.
+// Каждый слот на своей кэш-линии, чтобы читатели не делили линии.
+struct alignas(CACHE_LINE_SIZE) CowEpochSlot {
+    std::atomic<unsigned long long> epoch;
+    std::atomic<bool> used;
+};
+
+struct CowRetired {
+    void* node;
+    unsigned long long epoch;   // эпоха, в которой узел перестал быть достижим
+};
+
+template <typename K, typename V, int ORDER>
+struct CowBPlusTree {
+    typedef K Key;
+    typedef V Value;
+    typedef CowBPlusNode<K, V, ORDER> Node;
+    static const int order = ORDER;
+
+    std::atomic<Node*> root;          // опубликованная версия
+    std::atomic<unsigned long long> epoch;
+    CowEpochSlot slots[COW_MAX_READERS];
+
+    // Состояние писателя - только под writer
+    std::mutex writer;
+    Node* draft;                      // корень готовящейся версии
+    long long version;
+    long long key_count;              // ключей в draft (после commit - в root)
+    CowRetired* retired;              // очередь по возрастанию эпох: [retired_head, retired_count)
+    long long retired_head;
+    long long retired_count;
+    long long retired_capacity;
+    long long pending_from;           // узлы текущего пакета, эпоха назначается в commit
+
+    std::atomic<long long> node_count;  // выделенных узлов, включая ждущие освобождения
+    std::atomic<long long> freed;       // освобождено старых версий за все время
+};
+
+template <typename K, typename V, int LINES>
+using CacheLineCowBPlusTree = CowBPlusTree<K, V, cow_bplus_order_for<K, V, CACHE_LINE_SIZE * LINES>()>;
+
+// Снимок: корень версии и слот эпохи, удерживающий ее узлы
+template <typename Tree>
+struct CowSnapshot {
+    Tree* tree;
+    int slot;
+    typename Tree::Node* root;
+};
+
+// ==================== СОЗДАНИЕ И ОСВОБОЖДЕНИЕ ====================
+
+template <typename Tree>
+typename Tree::Node* cow_bplus_new_node(Tree* tree, bool is_leaf) {
+    typedef typename Tree::Node Node;
+    Node* node = (Node*)aligned_alloc(alignof(Node), sizeof(Node));
+    node->version = tree->version;
+    node->key_count = 0;
+    node->is_leaf = is_leaf;
+    tree->node_count.fetch_add(1, std::memory_order_relaxed);
+    return node;
+}
+
+template <typename Tree>
+void cow_bplus_init(Tree* tree) {
+    tree->epoch.store(1);
+    for (int i = 0; i < COW_MAX_READERS; i++) {
+        tree->slots[i].epoch.store(0);
+        tree->slots[i].used.store(false);
+    }
+    tree->version = 1;
+    tree->key_count = 0;
+    tree->retired = NULL;
+    tree->retired_head = 0;
+    tree->retired_count = 0;
+    tree->retired_capacity = 0;
+    tree->pending_from = 0;
+    tree->node_count.store(0);
+    tree->freed.store(0);
+    tree->draft = cow_bplus_new_node(tree, true);
+    tree->root.store(tree->draft);
+}
+
+template <typename Node>
+void cow_bplus_free_node(Node* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) cow_bplus_free_node((Node*)node->children[i]);
+    }
+    free(node);
+}
+
+// Только когда с деревом больше никто не работает. Замененные узлы
+// освобождаются по одному: их дети могут принадлежать текущей версии.
+template <typename Tree>
+void cow_bplus_free(Tree* tree) {
+    for (long long i = tree->retired_head; i < tree->retired_count; i++) free(tree->retired[i].node);
+    free(tree->retired);
+    tree->retired = NULL;
+    tree->retired_head = tree->retired_count = tree->retired_capacity = 0;
+    cow_bplus_free_node(tree->root.load());
+    tree->root.store(NULL);
+    tree->draft = NULL;
+}
+
+// ==================== ЧИТАТЕЛИ И ЭПОХИ ====================
+
+// Занять слот эпохи для потока-читателя; -1 - все слоты заняты
+template <typename Tree>
+int cow_bplus_reader_register(Tree* tree) {
+    for (int i = 0; i < COW_MAX_READERS; i++) {
+        bool expected = false;
+        if (tree->slots[i].used.compare_exchange_strong(expected, true)) return i;
+    }
+    return -1;
+}
+
+template <typename Tree>
+void cow_bplus_reader_unregister(Tree* tree, int slot) {
+    tree->slots[slot].epoch.store(0);
+    tree->slots[slot].used.store(false);
+}
+
+// Взять снимок. Слот объявляется до чтения корня (обе операции
+// seq_cst): писатель, не увидевший слот, опубликовал новый корень раньше,
+// и читатель получит именно его, а не освобождаемые узлы.
+template <typename Tree>
+void cow_bplus_snapshot_begin(Tree* tree, int slot, CowSnapshot<Tree>* snapshot) {
+    tree->slots[slot].epoch.store(tree->epoch.load());
+    snapshot->tree = tree;
+    snapshot->slot = slot;
+    snapshot->root = tree->root.load();
+}
+
+template <typename Tree>
+void cow_bplus_snapshot_end(CowSnapshot<Tree>* snapshot) {
+    snapshot->tree->slots[snapshot->slot].epoch.store(0, std::memory_order_release);
+    snapshot->root = NULL;
+}
+
+// Освободить замененные узлы, которые не может видеть ни один снимок.
+// Вызывается писателем (под writer); возвращает число освобожденных узлов.
+template <typename Tree>
+long long cow_bplus_reclaim(Tree* tree) {
+    unsigned long long oldest = tree->epoch.load();
+    for (int i = 0; i < COW_MAX_READERS; i++) {
+        unsigned long long e = tree->slots[i].epoch.load();
+        if (e != 0 && e < oldest) oldest = e;
+    }
+    long long freed = 0;
+    while (tree->retired_head < tree->pending_from && tree->retired[tree->retired_head].epoch < oldest) {
+        free(tree->retired[tree->retired_head].node);
+        tree->retired_head++;
+        freed++;
+    }
+    // Сдвигаем очередь к началу, когда освобожденная голова занимает половину
+    if (tree->retired_head > tree->retired_capacity / 2) {
+        long long live = tree->retired_count - tree->retired_head;
+        memmove(tree->retired, tree->retired + tree->retired_head, sizeof(CowRetired) * live);
+        tree->pending_from -= tree->retired_head;
+        tree->retired_count = live;
+        tree->retired_head = 0;
+    }
+    tree->node_count.fetch_sub(freed, std::memory_order_relaxed);
+    tree->freed.fetch_add(freed, std::memory_order_relaxed);
+    return freed;
+}
+
+// Узлов старых версий, ждущих освобождения
+template <typename Tree>
+long long cow_bplus_retired(const Tree* tree) {
+    return tree->retired_count - tree->retired_head;
+}
+
+// ==================== ПАКЕТ ИЗМЕНЕНИЙ ====================
+
+template <typename Tree>
+void cow_bplus_retire(Tree* tree, typename Tree::Node* node) {
+    if (tree->retired_count == tree->retired_capacity) {
+        tree->retired_capacity = tree->retired_capacity > 0 ? tree->retired_capacity * 2 : 256;
+        tree->retired = (CowRetired*)realloc(tree->retired, sizeof(CowRetired) * tree->retired_capacity);
+    }
+    tree->retired[tree->retired_count].node = node;
+    tree->retired[tree->retired_count].epoch = 0;
+    tree->retired_count++;
+}
+
+// Узел, который можно менять в текущем пакете: свой - как есть,
+// опубликованный - копия, а оригинал уходит в очередь на освобождение
+template <typename Tree>
+typename Tree::Node* cow_bplus_own(Tree* tree, typename Tree::Node* node) {
+    typedef typename Tree::Node Node;
+    if (node->version == tree->version) return node;
+    Node* copy = (Node*)aligned_alloc(alignof(Node), sizeof(Node));
+    memcpy((void*)copy, (const void*)node, sizeof(Node));
+    copy->version = tree->version;
+    tree->node_count.fetch_add(1, std::memory_order_relaxed);
+    cow_bplus_retire(tree, node);
+    return copy;
+}
+
+// Начать пакет: захватывает писателя до cow_bplus_batch_commit
+template <typename Tree>
+void cow_bplus_batch_begin(Tree* tree) {
+    tree->writer.lock();
+    tree->version++;
+    tree->draft = tree->root.load(std::memory_order_relaxed);
+}
+
+// Опубликовать пакет: новый корень, эпоха для замененных узлов, сборка
+template <typename Tree>
+void cow_bplus_batch_commit(Tree* tree) {
+    tree->root.store(tree->draft);
+    // Замененные узлы видны только снимкам с эпохой <= E
+    unsigned long long e = tree->epoch.fetch_add(1);
+    for (long long i = tree->pending_from; i < tree->retired_count; i++) tree->retired[i].epoch = e;
+    tree->pending_from = tree->retired_count;
+    cow_bplus_reclaim(tree);
+    tree->writer.unlock();
+}
+
+// Правая половина узла (своего в пакете) уходит в новый узел; возвращается разделитель
+template <typename Tree>
+typename Tree::Key cow_bplus_split(Tree* tree, typename Tree::Node* node, typename Tree::Node** right_out) {
+    typedef typename Tree::Node Node;
+    Node* right = cow_bplus_new_node(tree, node->is_leaf);
+    typename Tree::Key separator;
+    int n = node->key_count;
+    if (node->is_leaf) {
+        int left = (n + 1) / 2;
+        right->key_count = n - left;
+        memcpy(right->keys, node->keys + left, sizeof(typename Tree::Key) * right->key_count);
+        memcpy(right->data, node->data + left, sizeof(typename Tree::Value) * right->key_count);
+        separator = right->keys[0];
+        node->key_count = left;
+    } else {
+        int mid = n / 2;
+        separator = node->keys[mid];
+        right->key_count = n - mid - 1;
+        memcpy(right->keys, node->keys + mid + 1, sizeof(typename Tree::Key) * right->key_count);
+        memcpy(right->children, node->children + mid + 1, sizeof(long long) * (right->key_count + 1));
+        node->key_count = mid;
+    }
+    *right_out = right;
+    return separator;
+}
+
+// Вставка внутри пакета. Путь копируется сверху вниз, полные узлы
+// расщепляются по дороге, поэтому родитель всегда вмещает разделитель.
+// Возвращает true, если ключ новый (иначе значение заменено).
+template <typename Tree>
+bool cow_bplus_batch_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    const int max_keys = Tree::order - 1;
+
+    Node* node = cow_bplus_own(tree, tree->draft);
+    if (node->key_count == max_keys) {
+        Node* right;
+        typename Tree::Key separator = cow_bplus_split(tree, node, &right);
+        Node* new_root = cow_bplus_new_node(tree, false);
+        new_root->keys[0] = separator;
+        new_root->children[0] = (long long)node;
+        new_root->children[1] = (long long)right;
+        new_root->key_count = 1;
+        node = new_root;
+    }
+    tree->draft = node;
+
+    while (!node->is_leaf) {
+        int i = node_upper_bound(node->keys, node->key_count, key);
+        Node* child = cow_bplus_own(tree, (Node*)node->children[i]);
+        node->children[i] = (long long)child;
+        if (child->key_count == max_keys) {
+            Node* right;
+            typename Tree::Key separator = cow_bplus_split(tree, child, &right);
+            for (int j = node->key_count; j > i; j--) {
+                node->keys[j] = node->keys[j - 1];
+                node->children[j + 1] = node->children[j];
+            }
+            node->keys[i] = separator;
+            node->children[i + 1] = (long long)right;
+            node->key_count++;
+            if (!(key < separator)) child = right;
+        }
+        node = child;
+    }
+
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    if (pos < node->key_count && node->keys[pos] == key) {
+        node->data[pos] = value;
+        return false;
+    }
+    for (int j = node->key_count; j > pos; j--) {
+        node->keys[j] = node->keys[j - 1];
+        node->data[j] = node->data[j - 1];
+    }
+    node->keys[pos] = key;
+    node->data[pos] = value;
+    node->key_count++;
+    tree->key_count++;
+    return true;
+}
+
+// Одиночная вставка - пакет из одного ключа
+template <typename Tree>
+bool cow_bplus_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    cow_bplus_batch_begin(tree);
+    bool inserted = cow_bplus_batch_insert(tree, key, value);
+    cow_bplus_batch_commit(tree);
+    return inserted;
+}
+
+// Узел, выпавший из дерева: свой в пакете еще не опубликован и
+// освобождается сразу, опубликованный уходит в очередь эпох
+template <typename Tree>
+void cow_bplus_discard(Tree* tree, typename Tree::Node* node) {
+    if (node->version != tree->version) {
+        cow_bplus_retire(tree, node);
+        return;
+    }
+    free(node);
+    tree->node_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Меньше ключей ребенку перед спуском давать нельзя: после удаления
+// (или слияния его собственного ребенка) он не опустеет, а два узла
+// с минимумом всегда помещаются в один вместе с разделителем
+template <typename Node>
+inline int cow_bplus_min_keys(const Node* node) {
+    return node->is_leaf ? (Node::order - 1) / 2 : (Node::order - 2) / 2;
+}
+
+// Ребенок i узла node (оба свои в пакете) на минимуме: занять запись
+// у соседа или слиться с ним. Копируется только сосед, который меняется;
+// запас ключей смотрится у опубликованного узла.
+// Возвращает узел, в который теперь попадает поддерево ребенка i.
+template <typename Tree>
+typename Tree::Node* cow_bplus_fill_child(Tree* tree, typename Tree::Node* node, int i) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key K;
+    typedef typename Tree::Value V;
+    Node* child = (Node*)node->children[i];
+
+    if (i > 0) {
+        Node* left = (Node*)node->children[i - 1];
+        if (left->key_count > cow_bplus_min_keys(left)) {
+            left = cow_bplus_own(tree, left);
+            node->children[i - 1] = (long long)left;
+            // Последняя запись левого соседа переходит в начало ребенка
+            memmove(child->keys + 1, child->keys, sizeof(K) * child->key_count);
+            if (child->is_leaf) {
+                memmove(child->data + 1, child->data, sizeof(V) * child->key_count);
+                child->keys[0] = left->keys[left->key_count - 1];
+                child->data[0] = left->data[left->key_count - 1];
+                node->keys[i - 1] = child->keys[0];
+            } else {
+                memmove(child->children + 1, child->children, sizeof(long long) * (child->key_count + 1));
+                child->keys[0] = node->keys[i - 1];
+                child->children[0] = left->children[left->key_count];
+                node->keys[i - 1] = left->keys[left->key_count - 1];
+            }
+            child->key_count++;
+            left->key_count--;
+            return child;
+        }
+    }
+    if (i < node->key_count) {
+        Node* right = (Node*)node->children[i + 1];
+        if (right->key_count > cow_bplus_min_keys(right)) {
+            right = cow_bplus_own(tree, right);
+            node->children[i + 1] = (long long)right;
+            // Первая запись правого соседа переходит в конец ребенка
+            if (child->is_leaf) {
+                child->keys[child->key_count] = right->keys[0];
+                child->data[child->key_count] = right->data[0];
+                memmove(right->data, right->data + 1, sizeof(V) * (right->key_count - 1));
+                memmove(right->keys, right->keys + 1, sizeof(K) * (right->key_count - 1));
+                node->keys[i] = right->keys[0];
+            } else {
+                child->keys[child->key_count] = node->keys[i];
+                child->children[child->key_count + 1] = right->children[0];
+                node->keys[i] = right->keys[0];
+                memmove(right->keys, right->keys + 1, sizeof(K) * (right->key_count - 1));
+                memmove(right->children, right->children + 1, sizeof(long long) * right->key_count);
+            }
+            child->key_count++;
+            right->key_count--;
+            return child;
+        }
+    }
+
+    // Оба соседа на минимуме: правый из пары (sep + 1) вливается в левый (sep).
+    // Меняется только левый; правый выпадает из дерева без копирования.
+    int sep = i > 0 ? i - 1 : i;
+    Node* left = cow_bplus_own(tree, (Node*)node->children[sep]);
+    node->children[sep] = (long long)left;
+    Node* right = (Node*)node->children[sep + 1];
+    if (left->is_leaf) {
+        memcpy(left->keys + left->key_count, right->keys, sizeof(K) * right->key_count);
+        memcpy(left->data + left->key_count, right->data, sizeof(V) * right->key_count);
+        left->key_count += right->key_count;
+    } else {
+        left->keys[left->key_count] = node->keys[sep];
+        memcpy(left->keys + left->key_count + 1, right->keys, sizeof(K) * right->key_count);
+        memcpy(left->children + left->key_count + 1, right->children, sizeof(long long) * (right->key_count + 1));
+        left->key_count += right->key_count + 1;
+    }
+    memmove(node->keys + sep, node->keys + sep + 1, sizeof(K) * (node->key_count - sep - 1));
+    memmove(node->children + sep + 1, node->children + sep + 2, sizeof(long long) * (node->key_count - sep - 1));
+    node->key_count--;
+    cow_bplus_discard(tree, right);
+    return left;
+}
+
+// Удаление внутри пакета, зеркально вставке: путь копируется сверху вниз,
+// и ребенок на минимуме до спуска в него пополняется у соседа или
+// сливается с ним, поэтому лист не опустеет, а родитель не потребует
+// починки на обратном пути. Оригиналы путей и соседей уходят в очередь
+// на освобождение. Корень без ключей заменяется единственным ребенком.
+// Возвращает true, если ключ был.
+template <typename Tree>
+bool cow_bplus_batch_delete(Tree* tree, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    Node* node = cow_bplus_own(tree, tree->draft);
+    tree->draft = node;
+
+    while (!node->is_leaf) {
+        int i = node_upper_bound(node->keys, node->key_count, key);
+        Node* child = cow_bplus_own(tree, (Node*)node->children[i]);
+        node->children[i] = (long long)child;
+        if (child->key_count <= cow_bplus_min_keys(child)) child = cow_bplus_fill_child(tree, node, i);
+        if (node == tree->draft && node->key_count == 0) {
+            tree->draft = child;
+            cow_bplus_discard(tree, node);
+        }
+        node = child;
+    }
+
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    if (pos >= node->key_count || node->keys[pos] != key) return false;
+    memmove(node->keys + pos, node->keys + pos + 1, sizeof(typename Tree::Key) * (node->key_count - pos - 1));
+    memmove(node->data + pos, node->data + pos + 1, sizeof(typename Tree::Value) * (node->key_count - pos - 1));
+    node->key_count--;
+    tree->key_count--;
+    return true;
+}
+
+// Одиночное удаление - пакет из одного ключа
+template <typename Tree>
+bool cow_bplus_delete(Tree* tree, typename Tree::Key key) {
+    cow_bplus_batch_begin(tree);
+    bool deleted = cow_bplus_batch_delete(tree, key);
+    cow_bplus_batch_commit(tree);
+    return deleted;
+}
+
+// ==================== ЧТЕНИЕ СНИМКА ====================
+
+template <typename Tree>
+bool cow_bplus_snapshot_search(const CowSnapshot<Tree>* snapshot, typename Tree::Key key,
+                               typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    const Node* node = snapshot->root;
+    while (!node->is_leaf) {
+        node = (const Node*)node->children[node_upper_bound(node->keys, node->key_count, key)];
+    }
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    if (pos >= node->key_count || node->keys[pos] != key) return false;
+    if (value != NULL) *value = node->data[pos];
+    return true;
+}
+
+// Range query [start_key, end_key] по снимку. Соседний лист ищется через
+// стек пути: подъем до первого предка с непройденным правым ребенком.
+template <typename Tree>
+long long cow_bplus_snapshot_range(const CowSnapshot<Tree>* snapshot, typename Tree::Key start_key,
+                                   typename Tree::Key end_key, typename Tree::Key* keys,
+                                   typename Tree::Value* values, long long max_results) {
+    typedef typename Tree::Node Node;
+    if (end_key < start_key) return 0;
+    const Node* path[COW_MAX_HEIGHT];
+    int slot[COW_MAX_HEIGHT];
+    int depth = 0;
+    const Node* node = snapshot->root;
+    while (!node->is_leaf) {
+        int i = node_upper_bound(node->keys, node->key_count, start_key);
+        path[depth] = node;
+        slot[depth] = i;
+        depth++;
+        node = (const Node*)node->children[i];
+    }
+
+    long long count = 0;
+    int pos = node_lower_bound(node->keys, node->key_count, start_key);
+    while (count < max_results) {
+        for (; pos < node->key_count && count < max_results; pos++) {
+            if (end_key < node->keys[pos]) return count;
+            if (keys != NULL) keys[count] = node->keys[pos];
+            if (values != NULL) values[count] = node->data[pos];
+            count++;
+        }
+        if (count >= max_results) break;
+        while (depth > 0 && slot[depth - 1] == path[depth - 1]->key_count) depth--;
+        if (depth == 0) break;
+        // Все ключи правого поддерева не меньше разделителя
+        if (end_key < path[depth - 1]->keys[slot[depth - 1]]) break;
+        slot[depth - 1]++;
+        node = (const Node*)path[depth - 1]->children[slot[depth - 1]];
+        while (!node->is_leaf) {
+            path[depth] = node;
+            slot[depth] = 0;
+            depth++;
+            node = (const Node*)node->children[0];
+        }
+        pos = 0;
+    }
+    return count;
+}
+
+// Поиск в текущей версии: снимок на время одного спуска
+template <typename Tree>
+bool cow_bplus_search(Tree* tree, int slot, typename Tree::Key key, typename Tree::Value* value) {
+    CowSnapshot<Tree> snapshot;
+    cow_bplus_snapshot_begin(tree, slot, &snapshot);
+    bool found = cow_bplus_snapshot_search(&snapshot, key, value);
+    cow_bplus_snapshot_end(&snapshot);
+    return found;
+}
+
+// ==================== ПРОВЕРКА ====================
+
+template <typename Node>
+long long cow_bplus_check_node(const Node* node, long long* keys, bool* has_prev, typename Node::Key* prev) {
+    if (node->is_leaf) {
+        for (int i = 0; i < node->key_count; i++) {
+            if (*has_prev && !(*prev < node->keys[i])) return -1;
+            *prev = node->keys[i];
+            *has_prev = true;
+        }
+        *keys += node->key_count;
+        return 1;
+    }
+    long long nodes = 1;
+    for (int i = 0; i <= node->key_count; i++) {
+        long long child = cow_bplus_check_node((const Node*)node->children[i], keys, has_prev, prev);
+        if (child < 0) return -1;
+        nodes += child;
+    }
+    return nodes;
+}
+
+// Ключи опубликованной версии упорядочены, их число сходится со счетчиком,
+// а выделенные узлы - это узлы версии плюс ждущие освобождения.
+// Только без параллельных писателей.
+template <typename Tree>
+bool cow_bplus_check(Tree* tree) {
+    long long keys = 0;
+    bool has_prev = false;
+    typename Tree::Key prev = typename Tree::Key();
+    long long nodes = cow_bplus_check_node(tree->root.load(), &keys, &has_prev, &prev);
+    return nodes >= 0 && keys == tree->key_count
+           && nodes + cow_bplus_retired(tree) == tree->node_count.load();
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "stats.h"
+
+// Размер страницы диска; известен на этапе компиляции, чтобы порядок
+// деревьев можно было подобрать под одну страницу
+#define DISK_PAGE_SIZE 4096
+#define CACHE_LINE_SIZE 64
+
+// Симулятор дисковых операций.
+// Без файла (fd = -1) только считает обращения. После disk_open() страницы
+// читаются и пишутся в настоящий файл через pread/pwrite, и рядом с
+// симулированными read_count/write_count копятся реальные file_reads/file_writes.
+struct DiskSimulator {
+    int read_count;
+    int write_count;
+    int page_size;
+    int fd;                    // файл страниц или -1
+    long long page_count;      // страниц в файле
+    long long file_reads;      // выполненных pread
+    long long file_writes;     // выполненных pwrite
+    long long bytes_read;
+    long long bytes_written;
+};
+
+inline void disk_init(struct DiskSimulator* disk) {
+    disk->read_count = 0;
+    disk->write_count = 0;
+    disk->page_size = DISK_PAGE_SIZE;
+    disk->fd = -1;
+    disk->page_count = 0;
+    disk->file_reads = 0;
+    disk->file_writes = 0;
+    disk->bytes_read = 0;
+    disk->bytes_written = 0;
+}
+
+// Обнулить счетчики, не закрывая файл
+inline void disk_reset_counters(struct DiskSimulator* disk) {
+    disk->read_count = 0;
+    disk->write_count = 0;
+    disk->file_reads = 0;
+    disk->file_writes = 0;
+    disk->bytes_read = 0;
+    disk->bytes_written = 0;
+}
+
+inline void disk_read(struct DiskSimulator* disk, long long offset) {
+    disk->read_count++;
+}
+
+inline void disk_write(struct DiskSimulator* disk, long long offset) {
+    disk->write_count++;
+}
+
+// Открыть файл страниц; truncate = true - начать с пустого файла
+inline bool disk_open(struct DiskSimulator* disk, const char* path, bool truncate) {
+    disk_init(disk);
+    disk->fd = open(path, O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if (disk->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(disk->fd, &st) != 0) {
+        close(disk->fd);
+        disk->fd = -1;
+        return false;
+    }
+    disk->page_count = st.st_size / disk->page_size;
+    return true;
+}
+
+inline void disk_close(struct DiskSimulator* disk) {
+    if (disk->fd >= 0) close(disk->fd);
+    disk->fd = -1;
+}
+
+inline bool disk_sync(struct DiskSimulator* disk) {
+    return disk->fd >= 0 && fsync(disk->fd) == 0;
+}
+
+// Новая страница в конце файла
+inline long long disk_allocate_page(struct DiskSimulator* disk) {
+    return disk->page_count++;
+}
+
+// Чтение страницы page_id в buf (page_size байт)
+inline bool disk_read_page(struct DiskSimulator* disk, long long page_id, void* buf) {
+    disk_read(disk, page_id * disk->page_size);
+    if (disk->fd < 0 || page_id < 0 || page_id >= disk->page_count) return false;
+
+    ssize_t done = pread(disk->fd, buf, disk->page_size, (off_t)page_id * disk->page_size);
+    disk->file_reads++;
+    if (done != disk->page_size) return false;
+    disk->bytes_read += done;
+    STATS_COUNT(STAT_PAGES_READ, 1);
+    STATS_COUNT(STAT_BYTES_READ, done);
+    return true;
+}
+
+// Запись страницы page_id из buf; файл растет при записи за его конец
+inline bool disk_write_page(struct DiskSimulator* disk, long long page_id, const void* buf) {
+    disk_write(disk, page_id * disk->page_size);
+    if (disk->fd < 0 || page_id < 0) return false;
+
+    ssize_t done = pwrite(disk->fd, buf, disk->page_size, (off_t)page_id * disk->page_size);
+    disk->file_writes++;
+    if (done != disk->page_size) return false;
+    disk->bytes_written += done;
+    STATS_COUNT(STAT_PAGES_WRITTEN, 1);
+    STATS_COUNT(STAT_BYTES_WRITTEN, done);
+    if (page_id >= disk->page_count) disk->page_count = page_id + 1;
+    return true;
+}
+
+// Чтение count подряд идущих страниц одним вызовом preadv (пакетное чтение)
+inline bool disk_read_pages(struct DiskSimulator* disk, long long first_page, void** bufs, int count) {
+    for (int i = 0; i < count; i++) disk_read(disk, (first_page + i) * disk->page_size);
+    if (disk->fd < 0 || first_page < 0 || first_page + count > disk->page_count) return false;
+
+    struct iovec iov[64];
+    int done_pages = 0;
+    while (done_pages < count) {
+        int batch = count - done_pages < 64 ? count - done_pages : 64;
+        for (int i = 0; i < batch; i++) {
+            iov[i].iov_base = bufs[done_pages + i];
+            iov[i].iov_len = disk->page_size;
+        }
+        ssize_t done = preadv(disk->fd, iov, batch, (off_t)(first_page + done_pages) * disk->page_size);
+        disk->file_reads++;
+        if (done != (ssize_t)batch * disk->page_size) return false;
+        disk->bytes_read += done;
+        STATS_COUNT(STAT_PAGES_READ, batch);
+        STATS_COUNT(STAT_BYTES_READ, done);
+        done_pages += batch;
+    }
+    return true;
+}
+
+// Подсказка ядру, что страницы скоро понадобятся: чтение идет асинхронно,
+// соседние номера страниц объединяются в один запрос
+inline void disk_advise_pages(struct DiskSimulator* disk, const long long* page_ids, int count) {
+    if (disk->fd < 0) return;
+    int i = 0;
+    while (i < count) {
+        int run = 1;
+        while (i + run < count && page_ids[i + run] == page_ids[i] + run) run++;
+        posix_fadvise(disk->fd, (off_t)page_ids[i] * disk->page_size,
+                      (off_t)run * disk->page_size, POSIX_FADV_WILLNEED);
+        i += run;
+    }
+}
+
+// Выгрузить страницы файла из кэша ОС (для замеров "холодного" чтения)
+inline void disk_drop_cache(struct DiskSimulator* disk) {
+    if (disk->fd < 0) return;
+    fdatasync(disk->fd);
+    posix_fadvise(disk->fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+// ==================== ФОРМАТ ФАЙЛА ДЕРЕВА ====================
+// Страница 0 - заголовок, узел с offset = N лежит на странице N + 1.
+// Ссылки на детей и соседние листья хранятся как номера страниц.
+
+#define DISK_TREE_MAGIC 0x384D4553   // "SEM8"
+#define DISK_TREE_VERSION 1
+#define DISK_TREE_BTREE 1
+#define DISK_TREE_BPLUS 2
+#define DISK_TREE_BPLUS_PACKED 3   // B+-дерево со сжатыми листьями (compressed_leaf.h)
+
+struct DiskTreeHeader {
+    unsigned int magic;
+    int version;
+    int page_size;
+    int kind;                  // DISK_TREE_BTREE, DISK_TREE_BPLUS или DISK_TREE_BPLUS_PACKED
+    int order;
+    int key_size;
+    int value_size;
+    int height;
+    long long root_page;
+    long long first_leaf_page; // -1 для B-дерева
+    long long node_count;
+    long long leaf_count;
+    long long key_count;
+};
+
+// Выше не бывает: при порядке >= 3 у узла не меньше двух детей
+#define DISK_TREE_MAX_HEIGHT 64
+
+inline long long disk_node_page(long long offset) {
+    return offset + 1;
+}
+
+// Ссылка из файла указывает на страницу узла внутри файла
+inline bool disk_page_id_valid(long long page_id, long long page_count) {
+    return page_id >= 1 && page_id < page_count;
+}
+
+inline bool disk_write_header(struct DiskSimulator* disk, const struct DiskTreeHeader* header) {
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE] = {0};
+    *(struct DiskTreeHeader*)page = *header;
+    return disk_write_page(disk, 0, page);
+}
+
+// Чтение и проверка заголовка: тип, порядок и размеры должны совпадать,
+// высота и корень - быть правдоподобными
+inline bool disk_read_header(struct DiskSimulator* disk, struct DiskTreeHeader* header,
+                             int kind, int order, int key_size, int value_size) {
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE];
+    if (!disk_read_page(disk, 0, page)) return false;
+    *header = *(struct DiskTreeHeader*)page;
+    return header->magic == DISK_TREE_MAGIC && header->version == DISK_TREE_VERSION &&
+           header->page_size == disk->page_size && header->kind == kind &&
+           header->order == order && header->key_size == key_size &&
+           header->value_size == value_size &&
+           header->height >= 1 && header->height <= DISK_TREE_MAX_HEIGHT &&
+           disk_page_id_valid(header->root_page, disk->page_count);
+}
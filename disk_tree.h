@@ -0,0 +1,538 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "disk.h"
+#include "buffer_pool.h"
+#include "btree.h"
+#include "bplus_tree.h"
+
+// Хранение деревьев в файле страниц (см. формат в disk.h).
+// Каждый узел занимает одну страницу, поэтому узел должен в нее помещаться:
+// для дисковых сценариев используются PageBTree/PageBPlusTree.
+// *_persist пишет дерево целиком, *_load поднимает его обратно в память,
+// *_disk_search / *_disk_range_query отвечают на запросы прямо с диска,
+// читая по странице на каждый посещенный узел. Запросы принимают любое
+// хранилище со storage_pin/storage_unpin: DiskSimulator (чтение из файла)
+// или BufferPool (страницы закрепляются в пуле).
+
+// ==================== B+-ДЕРЕВО ====================
+
+// Запись одного узла в его страницу: указатели заменяются номерами страниц
+template <typename Node>
+bool bplus_write_node_page(struct DiskSimulator* disk, const Node* node) {
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE] = {0};
+    Node* copy = (Node*)page;
+    memcpy(copy, node, sizeof(Node));
+
+    if (node->is_leaf) {
+        copy->next_leaf = NULL;
+        copy->next_offset = node->next_leaf != NULL ? disk_node_page(node->next_leaf->offset) : -1;
+    } else {
+        for (int i = 0; i <= node->key_count; i++) {
+            copy->children[i] = disk_node_page(((Node*)node->children[i])->offset);
+        }
+    }
+    return disk_write_page(disk, disk_node_page(node->offset), page);
+}
+
+template <typename Node>
+bool bplus_persist_node(struct DiskSimulator* disk, Node* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) {
+            if (!bplus_persist_node(disk, (Node*)node->children[i])) return false;
+        }
+    }
+    return bplus_write_node_page(disk, node);
+}
+
+// Запись всего дерева и заголовка; disk должен быть открыт
+template <typename Tree>
+bool bplus_persist(Tree* tree, struct DiskSimulator* disk) {
+    typedef typename Tree::Node Node;
+    static_assert(sizeof(Node) <= DISK_PAGE_SIZE, "узел должен помещаться в страницу");
+
+    if (!bplus_persist_node(disk, tree->root)) return false;
+
+    Node* first_leaf = tree->root;
+    while (!first_leaf->is_leaf) first_leaf = (Node*)first_leaf->children[0];
+
+    struct DiskTreeHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DISK_TREE_MAGIC;
+    header.version = DISK_TREE_VERSION;
+    header.page_size = disk->page_size;
+    header.kind = DISK_TREE_BPLUS;
+    header.order = Tree::order;
+    header.key_size = sizeof(typename Tree::Key);
+    header.value_size = sizeof(typename Tree::Value);
+    header.height = tree->height;
+    header.root_page = disk_node_page(tree->root->offset);
+    header.first_leaf_page = disk_node_page(first_leaf->offset);
+    header.node_count = tree->node_count;
+    header.leaf_count = tree->leaf_count;
+    header.key_count = tree->key_count;
+    if (!disk_write_header(disk, &header)) return false;
+    return disk_sync(disk);
+}
+
+// Открытие файла дерева: проверка заголовка под тип Tree
+template <typename Tree>
+bool bplus_disk_open(struct DiskSimulator* disk, struct DiskTreeHeader* header) {
+    return disk_read_header(disk, header, DISK_TREE_BPLUS, Tree::order,
+                            sizeof(typename Tree::Key), sizeof(typename Tree::Value));
+}
+
+// Узел, прочитанный из файла, не доверяется: ключей не больше порядка,
+// дети и соседний лист - страницы внутри файла. is_leaf сверяется с
+// глубиной, поэтому ссылка вверх по дереву не зациклит спуск.
+template <typename Node>
+bool bplus_disk_node_valid(const Node* node, int depth, int height, long long page_count) {
+    unsigned char leaf_byte;
+    memcpy(&leaf_byte, &node->is_leaf, 1);
+    if (leaf_byte > 1 || (leaf_byte == 1) != (depth == height - 1)) return false;
+    if (node->key_count < 0 || node->key_count > Node::order - 1) return false;
+    if (node->is_leaf) return node->next_offset == -1 || disk_page_id_valid(node->next_offset, page_count);
+    for (int i = 0; i <= node->key_count; i++) {
+        if (!disk_page_id_valid(node->children[i], page_count)) return false;
+    }
+    return true;
+}
+
+// Закрепить и проверить узел на глубине depth. NULL - ошибка чтения или
+// поврежденная страница (закрепление тогда уже снято).
+template <typename Tree, typename Storage>
+typename Tree::Node* bplus_disk_pin(Storage* storage, const struct DiskTreeHeader* header,
+                                    long long page_id, int depth, void* scratch) {
+    typedef typename Tree::Node Node;
+    Node* node = (Node*)storage_pin(storage, page_id, scratch);
+    if (node == NULL) return NULL;
+    if (!bplus_disk_node_valid(node, depth, header->height, storage_page_count(storage))) {
+        storage_unpin(storage, page_id, node, false);
+        return NULL;
+    }
+    return node;
+}
+
+// Точечный поиск с диска: одна страница на уровень
+template <typename Tree, typename Storage>
+bool bplus_disk_search(Storage* storage, const struct DiskTreeHeader* header,
+                       typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+
+    long long page_id = header->root_page;
+    Node* node;
+    for (int depth = 0; ; depth++) {
+        node = bplus_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return false;
+        if (node->is_leaf) break;
+        long long child = node->children[node_upper_bound(node->keys, node->key_count, key)];
+        storage_unpin(storage, page_id, node, false);
+        page_id = child;
+    }
+
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    bool found = pos < node->key_count && node->keys[pos] == key;
+    if (found && value != NULL) *value = node->data[pos];
+    storage_unpin(storage, page_id, node, false);
+    return found;
+}
+
+// Обновление значения существующего ключа на месте: лист помечается грязным
+template <typename Tree, typename Storage>
+bool bplus_disk_update(Storage* storage, const struct DiskTreeHeader* header,
+                       typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+
+    long long page_id = header->root_page;
+    Node* node;
+    for (int depth = 0; ; depth++) {
+        node = bplus_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return false;
+        if (node->is_leaf) break;
+        long long child = node->children[node_upper_bound(node->keys, node->key_count, key)];
+        storage_unpin(storage, page_id, node, false);
+        page_id = child;
+    }
+
+    int pos = node_lower_bound(node->keys, node->key_count, key);
+    bool found = pos < node->key_count && node->keys[pos] == key;
+    if (found) node->data[pos] = value;
+    storage_unpin(storage, page_id, node, found);
+    return found;
+}
+
+// Упреждающее чтение листьев при сканировании с диска. Номер следующего
+// листа (next_offset) известен только после чтения текущего, поэтому
+// номера страниц берутся из родителя: он сразу дает window листьев вперед.
+template <typename Tree>
+struct BPlusDiskReadAhead {
+    long long pages[Tree::order]; // следующие листья того же родителя
+    int count;
+    int pos;                      // индекс следующего листа в pages
+    int issued;                   // на pages[0..issued) упреждение уже выдано
+    int window;
+};
+
+// Запомнить детей родителя правее child_index, которые могут попасть в диапазон
+template <typename Tree>
+void bplus_disk_read_ahead_fill(BPlusDiskReadAhead<Tree>* ra, const typename Tree::Node* parent,
+                                int child_index, typename Tree::Key end_key) {
+    ra->count = 0;
+    ra->pos = 0;
+    ra->issued = 0;
+    for (int i = child_index; i < parent->key_count && !(end_key < parent->keys[i]); i++) {
+        ra->pages[ra->count++] = parent->children[i + 1];
+    }
+}
+
+// Выдать упреждение пачкой, когда израсходована половина окна
+template <typename Tree, typename Storage>
+void bplus_disk_read_ahead_issue(Storage* storage, BPlusDiskReadAhead<Tree>* ra) {
+    if (ra->issued - ra->pos > ra->window / 2) return;
+    int limit = ra->pos + ra->window;
+    if (limit > ra->count) limit = ra->count;
+    if (limit <= ra->issued) return;
+    storage_prefetch(storage, ra->pages + ra->issued, limit - ra->issued);
+    ra->issued = limit;
+}
+
+// Дети родителя кончились: спуск до родителя листа, где лежит key
+template <typename Tree, typename Storage>
+void bplus_disk_read_ahead_refill(Storage* storage, const struct DiskTreeHeader* header,
+                                  BPlusDiskReadAhead<Tree>* ra, typename Tree::Key key,
+                                  typename Tree::Key end_key) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+    ra->count = ra->pos = ra->issued = 0;
+
+    long long page_id = header->root_page;
+    for (int depth = 0; depth + 1 < header->height; depth++) {
+        Node* node = bplus_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return;
+        int index = node_upper_bound(node->keys, node->key_count, key);
+        long long child = node->children[index];
+        if (depth + 2 == header->height) bplus_disk_read_ahead_fill(ra, node, index, end_key);
+        storage_unpin(storage, page_id, node, false);
+        page_id = child;
+    }
+}
+
+// Range query с диска: спуск к первому листу и проход по next_offset.
+// В results пишется не больше max_results ключей; возвращается общее число
+// найденных, -1 - ошибка чтения или поврежденная страница.
+// read_ahead > 0 - заранее запрашивать столько следующих листьев
+// (storage_prefetch: подсказка ядру для файла, пакетное чтение для пула).
+template <typename Tree, typename Storage>
+long long bplus_disk_range_query(Storage* storage, const struct DiskTreeHeader* header,
+                                 typename Tree::Key start_key, typename Tree::Key end_key,
+                                 typename Tree::Key* results, long long max_results,
+                                 int read_ahead = 0) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+    BPlusDiskReadAhead<Tree> ra;
+    ra.count = ra.pos = ra.issued = 0;
+    ra.window = read_ahead;
+
+    long long page_id = header->root_page;
+    Node* node;
+    for (int depth = 0; ; depth++) {
+        node = bplus_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return -1;
+        if (node->is_leaf) break;
+        int index = node_upper_bound(node->keys, node->key_count, start_key);
+        long long child = node->children[index];
+        if (read_ahead > 0) bplus_disk_read_ahead_fill(&ra, node, index, end_key);
+        storage_unpin(storage, page_id, node, false);
+        page_id = child;
+    }
+    if (read_ahead > 0) bplus_disk_read_ahead_issue(storage, &ra);
+
+    long long count = 0;
+    long long leaves = 1;   // цепочка next_offset длиннее числа листьев - цикл
+    while (true) {
+        int first, last;
+        node_range_bounds(node->keys, node->key_count, start_key, end_key, &first, &last);
+        for (int i = first; i < last; i++) {
+            if (count < max_results) results[count] = node->keys[i];
+            count++;
+        }
+        long long next = (last < node->key_count) ? -1 : node->next_offset;
+        storage_unpin(storage, page_id, node, false);
+        if (next < 0) break;
+        if (++leaves > header->leaf_count) return -1;
+        bool refill = false;
+        if (read_ahead > 0) {
+            if (ra.pos < ra.count) {
+                ra.pos++;
+                bplus_disk_read_ahead_issue(storage, &ra);
+            } else {
+                refill = true;
+            }
+        }
+        page_id = next;
+        node = bplus_disk_pin<Tree>(storage, header, page_id, header->height - 1, scratch);
+        if (node == NULL) return -1;
+        if (refill && node->key_count > 0) {
+            bplus_disk_read_ahead_refill(storage, header, &ra, node->keys[0], end_key);
+            bplus_disk_read_ahead_issue(storage, &ra);
+        }
+    }
+    return count;
+}
+
+// budget - сколько узлов еще можно прочитать (не больше node_count из
+// заголовка): ссылки на одну и ту же страницу не раздуют загрузку
+template <typename Tree>
+typename Tree::Node* bplus_load_node(struct DiskSimulator* disk, const struct DiskTreeHeader* header,
+                                     long long page_id, int depth, long long* budget,
+                                     typename Tree::Node** prev_leaf) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE];
+    if (--*budget < 0 || !disk_read_page(disk, page_id, page)) return NULL;
+    if (!bplus_disk_node_valid((const Node*)page, depth, header->height, disk->page_count)) return NULL;
+    Node* node = create_bplus_node<Node>(true, page_id - 1);
+    memcpy(node, page, sizeof(Node));
+
+    if (node->is_leaf) {
+        // Листья читаются слева направо, связываем их по порядку
+        node->next_leaf = NULL;
+        if (*prev_leaf != NULL) (*prev_leaf)->next_leaf = node;
+        *prev_leaf = node;
+        return node;
+    }
+
+    for (int i = 0; i <= node->key_count; i++) {
+        Node* child = bplus_load_node<Tree>(disk, header, node->children[i], depth + 1, budget, prev_leaf);
+        if (child == NULL) {
+            for (int j = 0; j < i; j++) bplus_free_node((Node*)node->children[j]);
+            free(node);
+            return NULL;
+        }
+        node->children[i] = (long long)child;
+    }
+    return node;
+}
+
+// Полная загрузка дерева из файла в память
+template <typename Tree>
+bool bplus_load(Tree* tree, struct DiskSimulator* disk) {
+    typedef typename Tree::Node Node;
+    struct DiskTreeHeader header;
+    if (!bplus_disk_open<Tree>(disk, &header)) return false;
+
+    Node* prev_leaf = NULL;
+    long long budget = header.node_count;
+    Node* root = bplus_load_node<Tree>(disk, &header, header.root_page, 0, &budget, &prev_leaf);
+    if (root == NULL) return false;
+
+    tree->root = root;
+    tree->arena = NULL;
+    tree->height = header.height;
+    tree->node_count = header.node_count;
+    tree->next_node_offset = disk->page_count - 1;   // за последней страницей файла
+    tree->leaf_count = header.leaf_count;
+    tree->key_count = header.key_count;
+    return true;
+}
+
+// ==================== B-ДЕРЕВО ====================
+
+template <typename Node>
+bool btree_persist_node(struct DiskSimulator* disk, Node* node) {
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE] = {0};
+    Node* copy = (Node*)page;
+    memcpy(copy, node, sizeof(Node));
+
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) {
+            Node* child = (Node*)node->children[i];
+            copy->children[i] = disk_node_page(child->offset);
+            if (!btree_persist_node(disk, child)) return false;
+        }
+    }
+    return disk_write_page(disk, disk_node_page(node->offset), page);
+}
+
+template <typename Tree>
+bool btree_persist(Tree* tree, struct DiskSimulator* disk) {
+    static_assert(sizeof(typename Tree::Node) <= DISK_PAGE_SIZE, "узел должен помещаться в страницу");
+
+    if (!btree_persist_node(disk, tree->root)) return false;
+
+    struct DiskTreeHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DISK_TREE_MAGIC;
+    header.version = DISK_TREE_VERSION;
+    header.page_size = disk->page_size;
+    header.kind = DISK_TREE_BTREE;
+    header.order = Tree::order;
+    header.key_size = sizeof(typename Tree::Key);
+    header.value_size = sizeof(typename Tree::Value);
+    header.height = tree->height;
+    header.root_page = disk_node_page(tree->root->offset);
+    header.first_leaf_page = -1;
+    header.node_count = tree->node_count;
+    header.key_count = tree->key_count;
+    if (!disk_write_header(disk, &header)) return false;
+    return disk_sync(disk);
+}
+
+template <typename Tree>
+bool btree_disk_open(struct DiskSimulator* disk, struct DiskTreeHeader* header) {
+    return disk_read_header(disk, header, DISK_TREE_BTREE, Tree::order,
+                            sizeof(typename Tree::Key), sizeof(typename Tree::Value));
+}
+
+template <typename Node>
+bool btree_disk_node_valid(const Node* node, int depth, int height, long long page_count) {
+    unsigned char leaf_byte;
+    memcpy(&leaf_byte, &node->is_leaf, 1);
+    if (leaf_byte > 1 || (leaf_byte == 1) != (depth == height - 1)) return false;
+    if (node->key_count < 0 || node->key_count > Node::order - 1) return false;
+    if (node->is_leaf) return true;
+    for (int i = 0; i <= node->key_count; i++) {
+        if (!disk_page_id_valid(node->children[i], page_count)) return false;
+    }
+    return true;
+}
+
+template <typename Tree, typename Storage>
+typename Tree::Node* btree_disk_pin(Storage* storage, const struct DiskTreeHeader* header,
+                                    long long page_id, int depth, void* scratch) {
+    typedef typename Tree::Node Node;
+    Node* node = (Node*)storage_pin(storage, page_id, scratch);
+    if (node == NULL) return NULL;
+    if (!btree_disk_node_valid(node, depth, header->height, storage_page_count(storage))) {
+        storage_unpin(storage, page_id, node, false);
+        return NULL;
+    }
+    return node;
+}
+
+template <typename Tree, typename Storage>
+bool btree_disk_search(Storage* storage, const struct DiskTreeHeader* header,
+                       typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+
+    long long page_id = header->root_page;
+    for (int depth = 0; ; depth++) {
+        Node* node = btree_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return false;
+        int i = node_lower_bound(node->keys, node->key_count, key);
+        bool found = i < node->key_count && node->keys[i] == key;
+        if (found && value != NULL) *value = node->values[i];
+        long long child = node->is_leaf ? -1 : node->children[i];
+        storage_unpin(storage, page_id, node, false);
+        if (found) return true;
+        if (child < 0) return false;
+        page_id = child;
+    }
+}
+
+// Обновление значения существующего ключа на месте: узел помечается грязным
+template <typename Tree, typename Storage>
+bool btree_disk_update(Storage* storage, const struct DiskTreeHeader* header,
+                       typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+
+    long long page_id = header->root_page;
+    for (int depth = 0; ; depth++) {
+        Node* node = btree_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+        if (node == NULL) return false;
+        int i = node_lower_bound(node->keys, node->key_count, key);
+        bool found = i < node->key_count && node->keys[i] == key;
+        if (found) node->values[i] = value;
+        long long child = node->is_leaf ? -1 : node->children[i];
+        storage_unpin(storage, page_id, node, found);
+        if (found) return true;
+        if (child < 0) return false;
+        page_id = child;
+    }
+}
+
+// Обход с диска по порядку; в поддеревья вне диапазона не спускаемся.
+// Страница остается закрепленной, пока обходятся ее дети.
+// false - ошибка чтения или поврежденная страница.
+template <typename Tree, typename Storage>
+bool btree_disk_range_node(Storage* storage, const struct DiskTreeHeader* header, long long page_id,
+                           int depth, typename Tree::Key start_key, typename Tree::Key end_key,
+                           typename Tree::Key* results, long long max_results, long long* count) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char scratch[DISK_PAGE_SIZE];
+    Node* node = btree_disk_pin<Tree>(storage, header, page_id, depth, scratch);
+    if (node == NULL) return false;
+
+    bool ok = true;
+    int first, last;
+    node_range_bounds(node->keys, node->key_count, start_key, end_key, &first, &last);
+    for (int i = first; i <= last && ok; i++) {
+        if (!node->is_leaf) {
+            ok = btree_disk_range_node<Tree>(storage, header, node->children[i], depth + 1,
+                                             start_key, end_key, results, max_results, count);
+        }
+        if (i < last) {
+            if (*count < max_results) results[*count] = node->keys[i];
+            (*count)++;
+        }
+    }
+    storage_unpin(storage, page_id, node, false);
+    return ok;
+}
+
+// Возвращает число найденных, -1 - ошибка чтения или поврежденная страница
+template <typename Tree, typename Storage>
+long long btree_disk_range_query(Storage* storage, const struct DiskTreeHeader* header,
+                                 typename Tree::Key start_key, typename Tree::Key end_key,
+                                 typename Tree::Key* results, long long max_results) {
+    long long count = 0;
+    if (!btree_disk_range_node<Tree>(storage, header, header->root_page, 0, start_key, end_key,
+                                     results, max_results, &count)) return -1;
+    return count;
+}
+
+template <typename Tree>
+typename Tree::Node* btree_load_node(struct DiskSimulator* disk, const struct DiskTreeHeader* header,
+                                     long long page_id, int depth, long long* budget) {
+    typedef typename Tree::Node Node;
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE];
+    if (--*budget < 0 || !disk_read_page(disk, page_id, page)) return NULL;
+    if (!btree_disk_node_valid((const Node*)page, depth, header->height, disk->page_count)) return NULL;
+    Node* node = create_btree_node<Node>(true, page_id - 1);
+    memcpy(node, page, sizeof(Node));
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) {
+            Node* child = btree_load_node<Tree>(disk, header, node->children[i], depth + 1, budget);
+            if (child == NULL) {
+                for (int j = 0; j < i; j++) btree_free_node((Node*)node->children[j]);
+                free(node);
+                return NULL;
+            }
+            node->children[i] = (long long)child;
+        }
+    }
+    return node;
+}
+
+template <typename Tree>
+bool btree_load(Tree* tree, struct DiskSimulator* disk) {
+    struct DiskTreeHeader header;
+    if (!btree_disk_open<Tree>(disk, &header)) return false;
+
+    long long budget = header.node_count;
+    typename Tree::Node* root = btree_load_node<Tree>(disk, &header, header.root_page, 0, &budget);
+    if (root == NULL) return false;
+
+    tree->root = root;
+    tree->arena = NULL;
+    tree->height = header.height;
+    tree->node_count = header.node_count;
+    tree->next_node_offset = disk->page_count - 1;
+    tree->key_count = header.key_count;
+    return true;
+}
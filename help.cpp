@@ -1,154 +1,414 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "avl_tree.h"
+#include "rb_tree.h"
+#include "btree.h"
+#include "bplus_tree.h"
+#include "stats.h"
+
+// Выбор структуры по измерениям: каждый кандидат строится на этой машине
+// и прогоняется на смеси операций, описанной требованиями системы.
+// Баллы считаются из измеренной пропускной способности, задержки и
+// байт на ключ (на диске - еще и из числа узлов-блоков на операцию).
 
 // Требования системы (что нужно нашей программе)
 struct SystemRequirements {
     const char* system_name;      // Название системы
     int search_frequency;         // Как часто ищем (1-10)
-    int update_frequency;         // Как часто добавляем/удаляем (1-10)  
+    int update_frequency;         // Как часто добавляем/удаляем (1-10)
     int range_queries_needed;     // Нужны ли поиски по диапазону (1-10)
-    int memory_limited;           // Ограничена ли память (1-10)
+    int memory_limited;           // Ограничена ли память (1-10) - вес байт на ключ
     const char* storage_type;     // "memory" или "disk"
 };
 
-// Кандидат (структура данных, которую мы рассматриваем)
+// ==================== НАГРУЗКА ====================
+
+#define SELECTOR_KEYS 100000          // ключей в структуре
+#define SELECTOR_OPS 400000           // длина последовательности операций
+#define SELECTOR_LATENCY_OPS 20000    // операций в проходе замера задержки
+#define SELECTOR_RANGE_KEYS 100       // ключей в одном диапазоне
+#define SELECTOR_MIN_SECONDS 0.05     // проход пропускной способности не короче
+#define SELECTOR_CHUNK 256
+
+enum SelectorOpType {
+    SELECTOR_SEARCH,
+    SELECTOR_UPDATE,                  // удалить key, вставить new_key
+    SELECTOR_RANGE
+};
+
+struct SelectorOp {
+    int type;
+    int key;
+    int new_key;
+};
+
+// Одна и та же последовательность для всех кандидатов. Начальные ключи
+// четные, новые - нечетные; поиск и удаление всегда идут по живым ключам,
+// так что любой промах - ошибка структуры.
+struct SelectorWorkload {
+    int* initial_keys;
+    int initial_count;
+    struct SelectorOp* ops;
+    int op_count;
+};
+
+static void selector_shuffle(int* keys, int n) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int temp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = temp;
+    }
+}
+
+void selector_workload_init(struct SelectorWorkload* workload, struct SystemRequirements system) {
+    int n = SELECTOR_KEYS;
+    workload->initial_keys = (int*)malloc(sizeof(int) * n);
+    workload->initial_count = n;
+    workload->ops = (struct SelectorOp*)malloc(sizeof(struct SelectorOp) * SELECTOR_OPS);
+    workload->op_count = SELECTOR_OPS;
+
+    int* live = (int*)malloc(sizeof(int) * n);
+    int* fresh = (int*)malloc(sizeof(int) * SELECTOR_OPS);
+    for (int i = 0; i < n; i++) live[i] = 2 * i;
+    for (int i = 0; i < SELECTOR_OPS; i++) fresh[i] = 2 * i + 1;
+    selector_shuffle(live, n);
+    selector_shuffle(fresh, SELECTOR_OPS);
+    memcpy(workload->initial_keys, live, sizeof(int) * n);
+
+    int weights[3] = {system.search_frequency, system.update_frequency, system.range_queries_needed};
+    int total = 0;
+    for (int i = 0; i < 3; i++) {
+        if (weights[i] < 0) weights[i] = 0;
+        total += weights[i];
+    }
+    if (total == 0) {
+        weights[0] = 1;
+        total = 1;
+    }
+    int next_fresh = 0;
+    for (int i = 0; i < SELECTOR_OPS; i++) {
+        struct SelectorOp* op = &workload->ops[i];
+        int r = rand() % total;
+        int slot = rand() % n;
+        op->key = live[slot];
+        op->new_key = 0;
+        if (r < weights[0]) {
+            op->type = SELECTOR_SEARCH;
+        } else if (r < weights[0] + weights[1]) {
+            op->type = SELECTOR_UPDATE;
+            op->new_key = fresh[next_fresh++];
+            live[slot] = op->new_key;
+        } else {
+            op->type = SELECTOR_RANGE;
+        }
+    }
+    free(live);
+    free(fresh);
+}
+
+void selector_workload_free(struct SelectorWorkload* workload) {
+    free(workload->initial_keys);
+    free(workload->ops);
+}
+
+// ==================== КАНДИДАТЫ ====================
+// Одинаковый набор операций для каждой структуры
+
+template <int ORDER>
+void selector_init(BPlusTree<int, int, ORDER>* tree) { bplus_tree_init(tree); }
+template <int ORDER>
+void selector_insert(BPlusTree<int, int, ORDER>* tree, int key) { bplus_insert(tree, key, key); }
+template <int ORDER>
+bool selector_delete(BPlusTree<int, int, ORDER>* tree, int key) { return bplus_delete(tree, key); }
+template <int ORDER>
+bool selector_search(BPlusTree<int, int, ORDER>* tree, int key) { return bplus_search(tree, key, NULL); }
+template <int ORDER>
+int selector_range(BPlusTree<int, int, ORDER>* tree, int from, int to, int* results) {
+    BPlusCursor<BPlusTree<int, int, ORDER> > cursor;
+    const int* key;
+    const int* value;
+    int count = 0;
+    bplus_cursor_seek(tree, &cursor, from, to);
+    while (count < SELECTOR_RANGE_KEYS && bplus_cursor_next(&cursor, &key, &value)) results[count++] = *key;
+    bplus_cursor_close(&cursor);
+    return count;
+}
+template <int ORDER>
+void selector_free(BPlusTree<int, int, ORDER>* tree) { bplus_tree_free(tree); }
+
+template <int ORDER>
+void selector_init(BTree<int, int, ORDER>* tree) { btree_tree_init(tree); }
+template <int ORDER>
+void selector_insert(BTree<int, int, ORDER>* tree, int key) { btree_insert(tree, key, key); }
+template <int ORDER>
+bool selector_delete(BTree<int, int, ORDER>* tree, int key) { return btree_delete(tree, key); }
+template <int ORDER>
+bool selector_search(BTree<int, int, ORDER>* tree, int key) { return btree_search(tree, key, NULL); }
+template <int ORDER>
+int selector_range(BTree<int, int, ORDER>* tree, int from, int to, int* results) {
+    BTreeCursor<BTree<int, int, ORDER> > cursor;
+    const int* key;
+    const int* value;
+    int count = 0;
+    btree_cursor_seek(tree, &cursor, from, to);
+    while (count < SELECTOR_RANGE_KEYS && btree_cursor_next(&cursor, &key, &value)) results[count++] = *key;
+    btree_cursor_close(&cursor);
+    return count;
+}
+template <int ORDER>
+void selector_free(BTree<int, int, ORDER>* tree) { btree_tree_free(tree); }
+
+void selector_init(AvlTree<int, int>* tree) { avl_tree_init(tree); }
+void selector_insert(AvlTree<int, int>* tree, int key) { avl_insert(tree, key, key); }
+bool selector_delete(AvlTree<int, int>* tree, int key) { return avl_delete(tree, key); }
+bool selector_search(AvlTree<int, int>* tree, int key) { return avl_search(tree, key, NULL); }
+int selector_range(AvlTree<int, int>* tree, int from, int to, int* results) {
+    return avl_range_query(tree, from, to, results, SELECTOR_RANGE_KEYS);
+}
+void selector_free(AvlTree<int, int>* tree) { avl_tree_free(tree); }
+
+void selector_init(RbTree<int, int>* tree) { rb_tree_init(tree); }
+void selector_insert(RbTree<int, int>* tree, int key) { rb_insert(tree, key, key); }
+bool selector_delete(RbTree<int, int>* tree, int key) { return rb_delete(tree, key); }
+bool selector_search(RbTree<int, int>* tree, int key) { return rb_search(tree, key, NULL); }
+int selector_range(RbTree<int, int>* tree, int from, int to, int* results) {
+    return rb_range_query(tree, from, to, results, SELECTOR_RANGE_KEYS);
+}
+void selector_free(RbTree<int, int>* tree) { rb_tree_free(tree); }
+
+// Измерения одного кандидата на смеси операций системы
+struct StructureMeasurement {
+    double ops_per_second;        // операций смеси в секунду
+    long long p50_ns;             // задержка одной операции смеси
+    long long p99_ns;
+    double bytes_per_key;         // выделено кучей при построении, с заголовками malloc
+    double nodes_per_op;          // узлов на операцию смеси; 0 - статистика выключена
+    int errors;                   // промахи поиска и неудачные удаления
+};
+
+static double selector_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+template <typename Tree>
+static int selector_run_op(Tree* tree, const struct SelectorOp* op, int* results) {
+    if (op->type == SELECTOR_SEARCH) return selector_search(tree, op->key) ? 0 : 1;
+    if (op->type == SELECTOR_UPDATE) {
+        int errors = selector_delete(tree, op->key) ? 0 : 1;
+        selector_insert(tree, op->new_key);
+        return errors;
+    }
+    // Четные и нечетные ключи вперемешку: ~SELECTOR_RANGE_KEYS ключей на диапазон
+    int count = selector_range(tree, op->key, op->key + 2 * SELECTOR_RANGE_KEYS, results);
+    return count > 0 && results[0] == op->key ? 0 : 1;
+}
+
+static int selector_compare_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// Построить структуру, затем два прохода по последовательности: без
+// статистики - пропускная способность (не короче SELECTOR_MIN_SECONDS),
+// со статистикой - задержка каждой операции и посещенные узлы
+template <typename Tree>
+void selector_measure(const struct SelectorWorkload* workload, struct StructureMeasurement* m) {
+    int results[SELECTOR_RANGE_KEYS];
+    memset(m, 0, sizeof(*m));
+    stats_enable(false);
+
+    size_t heap_before = mallinfo2().uordblks;
+    Tree* tree = (Tree*)malloc(sizeof(Tree));
+    selector_init(tree);
+    for (int i = 0; i < workload->initial_count; i++) selector_insert(tree, workload->initial_keys[i]);
+    size_t heap_bytes = mallinfo2().uordblks - heap_before;
+    // Чужой аллокатор (например, под санитайзером) mallinfo2 не ведет:
+    // тогда считаем только сами узлы, без заголовков malloc
+    if (heap_bytes == 0) heap_bytes = tree->node_count * sizeof(typename Tree::Node);
+    m->bytes_per_key = (double)heap_bytes / workload->initial_count;
+
+    int throughput_limit = workload->op_count - SELECTOR_LATENCY_OPS;
+    int done = 0;
+    double start = selector_seconds();
+    double elapsed = 0;
+    while (done < throughput_limit && elapsed < SELECTOR_MIN_SECONDS) {
+        int end = done + SELECTOR_CHUNK < throughput_limit ? done + SELECTOR_CHUNK : throughput_limit;
+        for (; done < end; done++) m->errors += selector_run_op(tree, &workload->ops[done], results);
+        elapsed = selector_seconds() - start;
+    }
+    m->ops_per_second = done / elapsed;
+
+    // Время меряем сами вокруг операции смеси; от статистики нужны только узлы
+    long long* latencies = (long long*)malloc(sizeof(long long) * SELECTOR_LATENCY_OPS);
+    stats_reset();
+    stats_set_latency_sampling(1u << 30);
+    stats_enable(true);
+    for (int i = 0; i < SELECTOR_LATENCY_OPS; i++) {
+        long long op_start = stats_now_ns();
+        m->errors += selector_run_op(tree, &workload->ops[done + i], results);
+        latencies[i] = stats_now_ns() - op_start;
+    }
+    stats_enable(false);
+    stats_set_latency_sampling(STAT_DEFAULT_SAMPLING);
+    StatsSnapshot snapshot;
+    stats_snapshot(&snapshot);
+    long long nodes = 0;
+    for (int op = 0; op < STAT_OP_COUNT; op++) nodes += snapshot.nodes[op];
+    m->nodes_per_op = (double)nodes / SELECTOR_LATENCY_OPS;
+    qsort(latencies, SELECTOR_LATENCY_OPS, sizeof(long long), selector_compare_ll);
+    m->p50_ns = latencies[SELECTOR_LATENCY_OPS / 2];
+    m->p99_ns = latencies[SELECTOR_LATENCY_OPS * 99 / 100];
+    free(latencies);
+
+    selector_free(tree);
+    free(tree);
+}
+
+// Кандидат (структура данных, которую мы рассматриваем).
+// На диске узел B- и B+-дерева занимает страницу, в памяти - 4 кэш-линии;
+// у двоичных деревьев и 2-3 дерева каждый узел - отдельный блок.
 struct StructureCandidate {
     const char* name;             // Название структуры
-    int search_speed;             // Скорость поиска (1-10)
-    int insert_speed;             // Скорость вставки (1-10)
-    int range_query_speed;        // Скорость поиска по диапазону (1-10)
-    int memory_efficiency;        // Эффективность использования памяти (1-10)
+    void (*measure_memory)(const struct SelectorWorkload*, struct StructureMeasurement*);
+    void (*measure_disk)(const struct SelectorWorkload*, struct StructureMeasurement*);
     const char* best_use_case;    // Для чего лучше всего подходит
     const char* worst_use_case;   // Для чего не подходит
 };
 
-// Функция оценки пригодности структуры для системы
-void evaluate_structure(struct SystemRequirements system, 
-                       struct StructureCandidate candidate) {
-    printf("Оцениваем %s для %s:\n", candidate.name, system.system_name);
-    
-    int total_score = 0;
-    
-    // Умножаем возможности структуры на потребности системы
-    total_score += candidate.search_speed * system.search_frequency;
-    total_score += candidate.insert_speed * system.update_frequency;
-    total_score += candidate.range_query_speed * system.range_queries_needed;
-    total_score += candidate.memory_efficiency * system.memory_limited;
-    
-    // Дополнительные бонусы/штрафы
-    if (strcmp(system.storage_type, "disk") == 0) {
-        if (strstr(candidate.name, "B+") != NULL) total_score += 20;
-        if (strstr(candidate.name, "B-tree") != NULL) total_score += 15;
-    } else {
-        if (strstr(candidate.name, "AVL") != NULL) total_score += 10;
-        if (strstr(candidate.name, "RBT") != NULL) total_score += 8;
+// ==================== ОЦЕНКА ====================
+
+// Лучшие значения среди кандидатов - от них считаются относительные оценки
+struct SelectorBest {
+    double ops_per_second;
+    long long p99_ns;
+    double bytes_per_key;
+    double nodes_per_op;
+};
+
+// Балл 0..100: доля от лучшей пропускной способности, умноженная на
+// (лучшая p99 / p99)^0.5, (лучшие байт на ключ / байт на ключ)^(память/10)
+// и, для диска, на (лучшие узлов на операцию / узлов на операцию) -
+// каждый узел там отдельное чтение блока
+double evaluate_structure(struct SystemRequirements system, const struct StructureMeasurement* m,
+                          const struct SelectorBest* best) {
+    double score = m->ops_per_second / best->ops_per_second;
+    score *= sqrt((double)(best->p99_ns > 0 ? best->p99_ns : 1) / (m->p99_ns > 0 ? m->p99_ns : 1));
+    score *= pow(best->bytes_per_key / m->bytes_per_key, system.memory_limited / 10.0);
+    if (strcmp(system.storage_type, "disk") == 0 && m->nodes_per_op > 0) {
+        score *= best->nodes_per_op / m->nodes_per_op;
     }
-    
-    printf("  Итоговый балл: %d\n", total_score);
-    printf("  Лучше всего для: %s\n", candidate.best_use_case);
-    printf("  Не рекомендуется для: %s\n\n", candidate.worst_use_case);
+    return 100.0 * score;
 }
 
 // Сравнение всех структур для одной системы
-void compare_for_system(struct SystemRequirements system, 
-                       struct StructureCandidate candidates[], 
+void compare_for_system(struct SystemRequirements system,
+                       struct StructureCandidate candidates[],
                        int count) {
+    bool disk = strcmp(system.storage_type, "disk") == 0;
     printf("=== СИСТЕМА: %s ===\n", system.system_name);
-    printf("Требования: поиск=%d/10, обновления=%d/10, диапазоны=%d/10\n", 
+    printf("Требования: поиск=%d/10, обновления=%d/10, диапазоны=%d/10\n",
            system.search_frequency, system.update_frequency, system.range_queries_needed);
-    printf("Память: %s, Хранилище: %s\n\n", 
+    printf("Память: %s (вес байт на ключ %d/10), Хранилище: %s\n",
            system.memory_limited >= 7 ? "ограничена" : "не ограничена",
-           system.storage_type);
-    
-    int best_score = -1;
-    const char* best_candidate = NULL;
-    
+           system.memory_limited, system.storage_type);
+    printf("Нагрузка: %d ключей, обновление - удаление + вставка, диапазон - %d ключей\n\n",
+           SELECTOR_KEYS, SELECTOR_RANGE_KEYS);
+
+    struct SelectorWorkload workload;
+    selector_workload_init(&workload, system);
+    struct StructureMeasurement* measurements =
+        (struct StructureMeasurement*)malloc(sizeof(struct StructureMeasurement) * count);
+    struct SelectorBest best = {0, 0, 0, 0};
     for (int i = 0; i < count; i++) {
-        // Вычисляем балл для каждого кандидата
-        int score = candidates[i].search_speed * system.search_frequency +
-                   candidates[i].insert_speed * system.update_frequency +
-                   candidates[i].range_query_speed * system.range_queries_needed +
-                   candidates[i].memory_efficiency * system.memory_limited;
-        
-        // Бонусы за специализацию
-        if (strcmp(system.storage_type, "disk") == 0) {
-            if (strstr(candidates[i].name, "B+") != NULL) score += 20;
-            if (strstr(candidates[i].name, "B-tree") != NULL) score += 15;
-        }
-        
-        printf("%s: %d баллов\n", candidates[i].name, score);
-        
+        struct StructureMeasurement* m = &measurements[i];
+        if (disk) candidates[i].measure_disk(&workload, m);
+        else candidates[i].measure_memory(&workload, m);
+        if (i == 0 || m->ops_per_second > best.ops_per_second) best.ops_per_second = m->ops_per_second;
+        if (i == 0 || m->p99_ns < best.p99_ns) best.p99_ns = m->p99_ns;
+        if (i == 0 || m->bytes_per_key < best.bytes_per_key) best.bytes_per_key = m->bytes_per_key;
+        if (i == 0 || m->nodes_per_op < best.nodes_per_op) best.nodes_per_op = m->nodes_per_op;
+    }
+
+    printf("%-16s | %-10s | %-8s | %-8s | %-10s | %-10s | %-6s\n",
+           "Структура", "оп/с", "p50, нс", "p99, нс", "байт/ключ", disk ? "блоков/оп" : "узлов/оп", "Балл");
+    printf("-----------------|------------|----------|----------|------------|------------|-------\n");
+    double best_score = -1;
+    int best_candidate = 0;
+    for (int i = 0; i < count; i++) {
+        struct StructureMeasurement* m = &measurements[i];
+        double score = evaluate_structure(system, m, &best);
+        printf("%-16s | %-10.0f | %-8lld | %-8lld | %-10.1f | %-10.1f | %-6.1f\n",
+               candidates[i].name, m->ops_per_second, m->p50_ns, m->p99_ns, m->bytes_per_key,
+               m->nodes_per_op, score);
+        if (m->errors > 0) printf("ОШИБКА: %s - %d неверных результатов\n", candidates[i].name, m->errors);
         if (score > best_score) {
             best_score = score;
-            best_candidate = candidates[i].name;
+            best_candidate = i;
         }
     }
-    
-    printf("\n🏆 ПОБЕДИТЕЛЬ: %s (%d баллов)\n", best_candidate, best_score);
+#if !TREE_STATS
+    printf("(сборка с TREE_STATS=0: узлы не считаются и в балл не входят)\n");
+#endif
+
+    printf("\n🏆 ПОБЕДИТЕЛЬ: %s (%.1f баллов)\n", candidates[best_candidate].name, best_score);
+    printf("  Лучше всего для: %s\n", candidates[best_candidate].best_use_case);
+    printf("  Не рекомендуется для: %s\n", candidates[best_candidate].worst_use_case);
     printf("=========================================\n\n");
+    free(measurements);
+    selector_workload_free(&workload);
 }
 
 int main() {
+    srand(time(NULL));
     printf("=== АРХИТЕКТУРНЫЙ БАТТЛ: Выбор структуры данных ===\n\n");
-    
+
     // Наши кандидаты (структуры данных)
     struct StructureCandidate candidates[] = {
-        // AVL Tree
         {
             "AVL Tree",
-            10,    // Отличный поиск
-            6,     // Средние вставки (много вращений)
-            4,     // Плохие диапазонные запросы
-            7,     // Нормальная память
+            selector_measure<AvlTree<int, int> >,
+            selector_measure<AvlTree<int, int> >,
             "Системы с частым поиском и редкими изменениями",
             "Системы с частыми вставками/удалениями"
         },
-        
-        // Red-Black Tree
         {
-            "Red-Black Tree", 
-            8,     // Хороший поиск
-            8,     // Хорошие вставки
-            5,     // Средние диапазонные запросы
-            7,     // Нормальная память
+            "Red-Black Tree",
+            selector_measure<RbTree<int, int> >,
+            selector_measure<RbTree<int, int> >,
             "Сбалансированные нагрузки (поиск и обновления)",
             "Системы с частыми поисками по диапазону"
         },
-        
-        // B-tree
         {
             "B-tree",
-            7,     // Средний поиск
-            7,     // Средние вставки
-            6,     // Нормальные диапазонные запросы
-            8,     // Хорошая эффективность памяти
+            selector_measure<CacheLineBTree<int, int, 4> >,
+            selector_measure<PageBTree<int, int> >,
             "Дисковые хранилища, базы данных",
             "In-memory приложения"
         },
-        
-        // B+ tree
         {
             "B+ tree",
-            8,     // Хороший поиск
-            7,     // Средние вставки
-            10,    // Отличные диапазонные запросы!
-            9,     // Отличная эффективность памяти
+            selector_measure<CacheLineBPlusTree<int, int, 4> >,
+            selector_measure<PageBPlusTree<int, int> >,
             "Базы данных, системы с range queries",
             "Простые in-memory кеши"
         },
-        
-        // 2-3 Tree
         {
             "2-3 Tree",
-            7,     // Средний поиск
-            7,     // Средние вставки
-            4,     // Плохие диапазонные запросы
-            6,     // Средняя эффективность памяти
+            selector_measure<BTree<int, int, 3> >,
+            selector_measure<BTree<int, int, 3> >,
             "Учебные проекты, простые системы",
             "Высоконагруженные production-системы"
         }
     };
-    
+
     // Примеры реальных систем
     struct SystemRequirements systems[] = {
         // 1. DNS кеш-сервер
@@ -160,17 +420,17 @@ int main() {
             8,  // Память ограничена (кеш в RAM)
             "memory"
         },
-        
+
         // 2. Хранилище логов
         {
-            "Хранилище логов с временными метками", 
+            "Хранилище логов с временными метками",
             6,  // Средний поиск
             8,  // Частые добавления новых логов
             9,  // Очень частые запросы "логи за период"
             3,  // Память не сильно ограничена
             "disk"
         },
-        
+
         // 3. In-memory кеш сессий
         {
             "In-memory кеш сессий пользователей",
@@ -180,7 +440,7 @@ int main() {
             9,  // Память сильно ограничена
             "memory"
         },
-        
+
         // 4. Гео-индекс для карт
         {
             "Гео-индекс для картографии",
@@ -191,44 +451,51 @@ int main() {
             "memory"
         }
     };
-    
+
     int num_candidates = sizeof(candidates) / sizeof(candidates[0]);
     int num_systems = sizeof(systems) / sizeof(systems[0]);
-    
+
     // Сравниваем для каждой системы
     for (int i = 0; i < num_systems; i++) {
         compare_for_system(systems[i], candidates, num_candidates);
     }
-    
+
     // Интерактивная часть: пользователь создает свою систему
     printf("=== СОЗДАЙТЕ СВОЮ СИСТЕМУ ===\n");
-    
+
     struct SystemRequirements custom_system;
     custom_system.system_name = "Моя кастомная система";
-    
+
     printf("Опишите вашу систему:\n");
-    
+    int answered = 0;
+
     printf("Как часто будет поиск? (1-10, где 10=очень часто): ");
-    scanf("%d", &custom_system.search_frequency);
-    
+    answered += scanf("%d", &custom_system.search_frequency);
+
     printf("Как часто будут вставки/удаления? (1-10): ");
-    scanf("%d", &custom_system.update_frequency);
-    
+    answered += scanf("%d", &custom_system.update_frequency);
+
     printf("Как часто нужны поиски по диапазону? (1-10): ");
-    scanf("%d", &custom_system.range_queries_needed);
-    
+    answered += scanf("%d", &custom_system.range_queries_needed);
+
     printf("Память ограничена? (1-10, где 10=сильно ограничена): ");
-    scanf("%d", &custom_system.memory_limited);
-    
+    answered += scanf("%d", &custom_system.memory_limited);
+
     printf("Тип хранилища (1=memory, 2=disk): ");
     int storage_choice;
-    scanf("%d", &storage_choice);
+    answered += scanf("%d", &storage_choice);
     custom_system.storage_type = (storage_choice == 2) ? "disk" : "memory";
    printf("\n");
-    compare_for_system(custom_system, candidates, num_candidates);
+    if (answered == 5) {
+        compare_for_system(custom_system, candidates, num_candidates);
+    } else {
+        printf("Ответы не прочитаны - своя система пропущена\n");
+    }
    printf("\n=== ОБЪЯСНЕНИЕ РЕЗУЛЬТАТОВ ===\n");
-    printf("• AVL Tree: идеален когда поиск >> вставок\n");
-    printf("• Red-Black Tree: универсальный выбор для сбалансированных нагрузок\n");
+    printf("• Баллы - из измерений на этой машине, а не из таблицы: пропускная способность,\n");
+    printf("  p99 задержки, байт на ключ (с весом по ограничению памяти), на диске - блоков на операцию\n");
+    printf("• AVL Tree: самая низкая высота среди двоичных деревьев, но узел на каждый ключ\n");
+    printf("• Red-Black Tree: дешевле перестраивается при обновлениях, поиск чуть длиннее\n");
     printf("• B-tree: для дисковых систем, минимизирует I/O операции\n");
     printf("• B+ tree: король баз данных и range queries\n");
     printf("• 2-3 Tree: учебная структура, редко используется на практике\n");
@@ -0,0 +1,606 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <type_traits>
+
+#include "disk.h"
+#include "simd_search.h"
+#include "bplus_tree.h"
+
+// LSM-дерево: второй движок, оптимизированный под запись.
+// Вставка попадает в memtable - B+-дерево в памяти (CacheLineBPlusTree).
+// Заполненная memtable сбрасывается в неизменяемый отсортированный прогон
+// (SSTable) из страниц файла DiskSimulator; для каждого прогона в памяти
+// остаются первые ключи страниц (fence) и фильтр Блума. Прогоны
+// сливаются (compaction) по одной из политик:
+//   LSM_LEVELED - L0 до l0_runs прогонов, на уровнях 1.. по одному прогону
+//                 размером до memtable_limit * ratio^i;
+//   LSM_TIERED  - на каждом уровне до ratio прогонов, полный уровень
+//                 сливается в один прогон следующего уровня.
+// При слиянии и чтении из нескольких прогонов побеждает самая новая запись.
+// Страницы слитых прогонов возвращаются в список свободных и используются снова.
+
+enum LsmCompaction {
+    LSM_LEVELED = 0,
+    LSM_TIERED = 1
+};
+
+inline const char* lsm_compaction_name(LsmCompaction policy) {
+    return policy == LSM_LEVELED ? "leveled" : "tiered";
+}
+
+#define LSM_MAX_LEVELS 16
+#define LSM_MAX_RUNS 32
+#define LSM_BLOOM_BITS_PER_KEY 10
+#define LSM_BLOOM_HASHES 7
+
+// Страница прогона: LsmPageHeader | ключи [capacity] | значения [capacity]
+struct LsmPageHeader {
+    int count;
+    int reserved[3];
+};
+
+template <typename K, typename V>
+constexpr int lsm_page_capacity() {
+    return (int)((DISK_PAGE_SIZE - sizeof(LsmPageHeader)) / (sizeof(K) + sizeof(V)));
+}
+
+// Неизменяемый отсортированный прогон
+template <typename K, typename V>
+struct LsmRun {
+    long long* pages;          // страницы данных по порядку ключей
+    K* fences;                 // первый ключ каждой страницы
+    int page_count;
+    long long entry_count;
+    K min_key;
+    K max_key;
+    unsigned long long* bloom; // bloom_bits бит, bloom_bits - степень двойки
+    long long bloom_bits;
+};
+
+template <typename K, typename V>
+struct LsmLevel {
+    LsmRun<K, V>* runs[LSM_MAX_RUNS];   // от нового к старому
+    int run_count;
+};
+
+template <typename K, typename V>
+struct LsmTree {
+    typedef K Key;
+    typedef V Value;
+    typedef CacheLineBPlusTree<K, V, 4> Memtable;
+    typedef LsmRun<K, V> Run;
+    static const int page_capacity = lsm_page_capacity<K, V>();
+
+    struct DiskSimulator* disk;
+    Memtable memtable;
+    long long memtable_limit;  // записей в memtable до сброса
+    LsmCompaction policy;
+    int ratio;                 // рост уровней / прогонов на уровень
+    int l0_runs;               // прогонов L0 до слияния (LSM_LEVELED)
+    LsmLevel<K, V> levels[LSM_MAX_LEVELS];
+    int level_count;
+
+    long long* free_pages;     // страницы слитых прогонов
+    long long free_count;
+    long long free_capacity;
+
+    // Счетчики
+    long long user_bytes;      // байт ключей и значений, переданных в lsm_insert
+    long long flushes;
+    long long compactions;
+    long long compaction_entries;   // записей, переписанных слияниями
+    long long bloom_checks;
+    long long bloom_negatives;      // прогонов, отсеянных фильтром
+    long long run_probes;           // чтений страниц прогонов точечным поиском
+};
+
+// ---------- Фильтр Блума ----------
+
+inline unsigned long long lsm_mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+template <typename K>
+inline unsigned long long lsm_key_hash(K key) {
+    static_assert(sizeof(K) <= sizeof(unsigned long long), "ключ хешируется как 8 байт");
+    unsigned long long bits = 0;
+    memcpy(&bits, &key, sizeof(K));
+    return lsm_mix64(bits);
+}
+
+// Двойное хеширование: i-й бит = h1 + i * h2
+template <typename K, typename V>
+inline void lsm_bloom_add(LsmRun<K, V>* run, K key) {
+    unsigned long long h1 = lsm_key_hash(key);
+    unsigned long long h2 = (h1 >> 32) | 1;
+    for (int i = 0; i < LSM_BLOOM_HASHES; i++) {
+        unsigned long long bit = (h1 + i * h2) & (run->bloom_bits - 1);
+        run->bloom[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+template <typename K, typename V>
+inline bool lsm_bloom_may_contain(const LsmRun<K, V>* run, K key) {
+    unsigned long long h1 = lsm_key_hash(key);
+    unsigned long long h2 = (h1 >> 32) | 1;
+    for (int i = 0; i < LSM_BLOOM_HASHES; i++) {
+        unsigned long long bit = (h1 + i * h2) & (run->bloom_bits - 1);
+        if (!(run->bloom[bit >> 6] & (1ULL << (bit & 63)))) return false;
+    }
+    return true;
+}
+
+// ---------- Страницы ----------
+
+template <typename Tree>
+inline typename Tree::Key* lsm_page_keys(unsigned char* page) {
+    return (typename Tree::Key*)(page + sizeof(LsmPageHeader));
+}
+
+template <typename Tree>
+inline typename Tree::Value* lsm_page_values(unsigned char* page) {
+    return (typename Tree::Value*)(page + sizeof(LsmPageHeader) + sizeof(typename Tree::Key) * Tree::page_capacity);
+}
+
+template <typename Tree>
+long long lsm_allocate_page(Tree* tree) {
+    if (tree->free_count > 0) return tree->free_pages[--tree->free_count];
+    return disk_allocate_page(tree->disk);
+}
+
+template <typename Tree>
+void lsm_release_run(Tree* tree, typename Tree::Run* run) {
+    if (tree->free_count + run->page_count > tree->free_capacity) {
+        tree->free_capacity = (tree->free_count + run->page_count) * 2;
+        tree->free_pages = (long long*)realloc(tree->free_pages, sizeof(long long) * tree->free_capacity);
+    }
+    for (int i = 0; i < run->page_count; i++) tree->free_pages[tree->free_count++] = run->pages[i];
+    free(run->pages);
+    free(run->fences);
+    free(run->bloom);
+    free(run);
+}
+
+// ---------- Запись прогона ----------
+
+template <typename Tree>
+struct LsmRunWriter {
+    Tree* tree;
+    typename Tree::Run* run;
+    int page_capacity;         // емкость массивов pages/fences
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE];
+    int count;                 // записей в текущей странице
+};
+
+// expected - верхняя оценка числа записей (для размера фильтра)
+template <typename Tree>
+void lsm_run_writer_begin(Tree* tree, LsmRunWriter<Tree>* writer, long long expected) {
+    typedef typename Tree::Run Run;
+    Run* run = (Run*)malloc(sizeof(Run));
+    writer->page_capacity = (int)((expected + Tree::page_capacity - 1) / Tree::page_capacity) + 1;
+    run->pages = (long long*)malloc(sizeof(long long) * writer->page_capacity);
+    run->fences = (typename Tree::Key*)malloc(sizeof(typename Tree::Key) * writer->page_capacity);
+    run->page_count = 0;
+    run->entry_count = 0;
+    run->bloom_bits = 64;
+    while (run->bloom_bits < expected * LSM_BLOOM_BITS_PER_KEY) run->bloom_bits *= 2;
+    run->bloom = (unsigned long long*)calloc(run->bloom_bits / 64, sizeof(unsigned long long));
+    writer->tree = tree;
+    writer->run = run;
+    writer->count = 0;
+    memset(writer->page, 0, DISK_PAGE_SIZE);
+}
+
+template <typename Tree>
+void lsm_run_writer_flush_page(LsmRunWriter<Tree>* writer) {
+    if (writer->count == 0) return;
+    typename Tree::Run* run = writer->run;
+    ((LsmPageHeader*)writer->page)->count = writer->count;
+    long long page_id = lsm_allocate_page(writer->tree);
+    disk_write_page(writer->tree->disk, page_id, writer->page);
+    run->fences[run->page_count] = lsm_page_keys<Tree>(writer->page)[0];
+    run->pages[run->page_count++] = page_id;
+    writer->count = 0;
+}
+
+// Записи подаются по возрастанию ключа
+template <typename Tree>
+void lsm_run_writer_add(LsmRunWriter<Tree>* writer, typename Tree::Key key, typename Tree::Value value) {
+    typename Tree::Run* run = writer->run;
+    if (writer->count == Tree::page_capacity) lsm_run_writer_flush_page(writer);
+    lsm_page_keys<Tree>(writer->page)[writer->count] = key;
+    lsm_page_values<Tree>(writer->page)[writer->count] = value;
+    writer->count++;
+    if (run->entry_count == 0) run->min_key = key;
+    run->max_key = key;
+    run->entry_count++;
+    lsm_bloom_add(run, key);
+}
+
+// Готовый прогон; NULL, если записей не было
+template <typename Tree>
+typename Tree::Run* lsm_run_writer_finish(LsmRunWriter<Tree>* writer) {
+    lsm_run_writer_flush_page(writer);
+    typename Tree::Run* run = writer->run;
+    if (run->entry_count == 0) {
+        lsm_release_run(writer->tree, run);
+        return NULL;
+    }
+    return run;
+}
+
+// ---------- Чтение прогона ----------
+
+// Страница прогона, где может лежать key (последний fence <= key)
+template <typename K, typename V>
+inline int lsm_run_find_page(const LsmRun<K, V>* run, K key) {
+    int lo = 0, hi = run->page_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (key < run->fences[mid]) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+// Курсор по прогону в диапазоне [start_key, end_key]
+template <typename Tree>
+struct LsmRunCursor {
+    const typename Tree::Run* run;
+    int page_index;
+    int pos;
+    int count;
+    typename Tree::Key end_key;
+    bool valid;
+    unsigned char* page;       // DISK_PAGE_SIZE байт, выровнено по кэш-линии
+};
+
+template <typename Tree>
+void lsm_run_cursor_load(Tree* tree, LsmRunCursor<Tree>* cursor) {
+    cursor->valid = false;
+    if (cursor->page_index >= cursor->run->page_count) return;
+    if (!disk_read_page(tree->disk, cursor->run->pages[cursor->page_index], cursor->page)) return;
+    cursor->count = ((LsmPageHeader*)cursor->page)->count;
+    cursor->valid = true;
+}
+
+// Проверить границу и при необходимости перейти на следующую страницу
+template <typename Tree>
+void lsm_run_cursor_settle(Tree* tree, LsmRunCursor<Tree>* cursor) {
+    while (cursor->valid && cursor->pos == cursor->count) {
+        cursor->page_index++;
+        cursor->pos = 0;
+        lsm_run_cursor_load(tree, cursor);
+    }
+    if (cursor->valid && cursor->end_key < lsm_page_keys<Tree>(cursor->page)[cursor->pos]) cursor->valid = false;
+}
+
+template <typename Tree>
+void lsm_run_cursor_seek(Tree* tree, LsmRunCursor<Tree>* cursor, const typename Tree::Run* run,
+                         typename Tree::Key start_key, typename Tree::Key end_key) {
+    cursor->run = run;
+    cursor->end_key = end_key;
+    cursor->valid = false;
+    if (run->max_key < start_key || end_key < run->min_key) return;
+    cursor->page_index = lsm_run_find_page(run, start_key);
+    lsm_run_cursor_load(tree, cursor);
+    if (!cursor->valid) return;
+    cursor->pos = node_lower_bound(lsm_page_keys<Tree>(cursor->page), cursor->count, start_key);
+    lsm_run_cursor_settle(tree, cursor);
+}
+
+// ---------- Слияние источников ----------
+// Источник 0 - memtable (если включена), дальше прогоны от нового к старому.
+// Из записей с одинаковым ключом выдается запись источника с меньшим номером.
+
+template <typename Tree>
+struct LsmMergeSource {
+    bool is_memtable;
+    bool valid;
+    const typename Tree::Key* key;
+    const typename Tree::Value* value;
+    BPlusCursor<typename Tree::Memtable> memtable;
+    LsmRunCursor<Tree> run;
+};
+
+template <typename Tree>
+struct LsmMerge {
+    Tree* tree;
+    LsmMergeSource<Tree>* sources;
+    int source_count;
+    unsigned char* pages;      // страницы курсоров прогонов
+};
+
+template <typename Tree>
+void lsm_merge_source_refresh(Tree* tree, LsmMergeSource<Tree>* source) {
+    if (source->is_memtable) {
+        source->valid = bplus_cursor_next(&source->memtable, &source->key, &source->value);
+    } else {
+        source->valid = source->run.valid;
+        if (source->valid) {
+            source->key = &lsm_page_keys<Tree>(source->run.page)[source->run.pos];
+            source->value = &lsm_page_values<Tree>(source->run.page)[source->run.pos];
+        }
+    }
+}
+
+template <typename Tree>
+void lsm_merge_begin(Tree* tree, LsmMerge<Tree>* merge, typename Tree::Run* const* runs, int run_count,
+                     bool with_memtable, typename Tree::Key start_key, typename Tree::Key end_key) {
+    merge->tree = tree;
+    merge->source_count = run_count + (with_memtable ? 1 : 0);
+    merge->sources = (LsmMergeSource<Tree>*)malloc(sizeof(LsmMergeSource<Tree>) * (merge->source_count + 1));
+    merge->pages = (unsigned char*)aligned_alloc(CACHE_LINE_SIZE, (size_t)DISK_PAGE_SIZE * (run_count + 1));
+    int s = 0;
+    if (with_memtable) {
+        LsmMergeSource<Tree>* source = &merge->sources[s++];
+        source->is_memtable = true;
+        bplus_cursor_seek(&tree->memtable, &source->memtable, start_key, end_key);
+        lsm_merge_source_refresh(tree, source);
+    }
+    for (int i = 0; i < run_count; i++) {
+        LsmMergeSource<Tree>* source = &merge->sources[s++];
+        source->is_memtable = false;
+        source->run.page = merge->pages + (size_t)DISK_PAGE_SIZE * i;
+        lsm_run_cursor_seek(tree, &source->run, runs[i], start_key, end_key);
+        lsm_merge_source_refresh(tree, source);
+    }
+}
+
+template <typename Tree>
+void lsm_merge_advance(Tree* tree, LsmMergeSource<Tree>* source) {
+    if (!source->is_memtable) {
+        source->run.pos++;
+        lsm_run_cursor_settle(tree, &source->run);
+    }
+    lsm_merge_source_refresh(tree, source);
+}
+
+// Следующая запись по возрастанию ключа; false - источники исчерпаны.
+// key/value действительны до следующего вызова.
+template <typename Tree>
+bool lsm_merge_next(LsmMerge<Tree>* merge, typename Tree::Key* key, typename Tree::Value* value) {
+    int best = -1;
+    for (int i = 0; i < merge->source_count; i++) {
+        LsmMergeSource<Tree>* source = &merge->sources[i];
+        if (source->valid && (best < 0 || *source->key < *merge->sources[best].key)) best = i;
+    }
+    if (best < 0) return false;
+    *key = *merge->sources[best].key;
+    *value = *merge->sources[best].value;
+    // Более старые версии того же ключа пропускаются
+    for (int i = 0; i < merge->source_count; i++) {
+        LsmMergeSource<Tree>* source = &merge->sources[i];
+        if (source->valid && !(*key < *source->key)) lsm_merge_advance(merge->tree, source);
+    }
+    return true;
+}
+
+template <typename Tree>
+void lsm_merge_end(LsmMerge<Tree>* merge) {
+    free(merge->sources);
+    free(merge->pages);
+}
+
+// ---------- Дерево ----------
+
+// disk должен быть открыт; страницы прогонов выделяются в нем
+template <typename Tree>
+void lsm_tree_init(Tree* tree, struct DiskSimulator* disk, long long memtable_limit,
+                   LsmCompaction policy, int ratio = 10, int l0_runs = 4) {
+    tree->disk = disk;
+    bplus_tree_init(&tree->memtable);
+    tree->memtable_limit = memtable_limit > 0 ? memtable_limit : 1;
+    tree->policy = policy;
+    tree->ratio = ratio > 1 ? ratio : 2;
+    if (tree->ratio > LSM_MAX_RUNS - 1) tree->ratio = LSM_MAX_RUNS - 1;
+    tree->l0_runs = l0_runs > 0 && l0_runs < LSM_MAX_RUNS ? l0_runs : 4;
+    for (int i = 0; i < LSM_MAX_LEVELS; i++) tree->levels[i].run_count = 0;
+    tree->level_count = 0;
+    tree->free_pages = NULL;
+    tree->free_count = 0;
+    tree->free_capacity = 0;
+    tree->user_bytes = 0;
+    tree->flushes = 0;
+    tree->compactions = 0;
+    tree->compaction_entries = 0;
+    tree->bloom_checks = 0;
+    tree->bloom_negatives = 0;
+    tree->run_probes = 0;
+}
+
+template <typename Tree>
+void lsm_tree_free(Tree* tree) {
+    for (int l = 0; l < tree->level_count; l++) {
+        for (int r = 0; r < tree->levels[l].run_count; r++) lsm_release_run(tree, tree->levels[l].runs[r]);
+        tree->levels[l].run_count = 0;
+    }
+    tree->level_count = 0;
+    bplus_tree_free(&tree->memtable);
+    free(tree->free_pages);
+    tree->free_pages = NULL;
+    tree->free_count = tree->free_capacity = 0;
+}
+
+template <typename Tree>
+long long lsm_level_entries(const LsmLevel<typename Tree::Key, typename Tree::Value>* level) {
+    long long entries = 0;
+    for (int r = 0; r < level->run_count; r++) entries += level->runs[r]->entry_count;
+    return entries;
+}
+
+// Новый прогон - самый новый на уровне
+template <typename Tree>
+void lsm_level_push(Tree* tree, int level_index, typename Tree::Run* run) {
+    LsmLevel<typename Tree::Key, typename Tree::Value>* level = &tree->levels[level_index];
+    memmove(level->runs + 1, level->runs, sizeof(level->runs[0]) * level->run_count);
+    level->runs[0] = run;
+    level->run_count++;
+    if (level_index >= tree->level_count) tree->level_count = level_index + 1;
+}
+
+// Слить runs (от нового к старому) в один прогон; исходные прогоны освобождаются
+template <typename Tree>
+typename Tree::Run* lsm_merge_runs(Tree* tree, typename Tree::Run** runs, int run_count) {
+    typename Tree::Key start_key = runs[0]->min_key, end_key = runs[0]->max_key;
+    long long expected = 0;
+    for (int i = 0; i < run_count; i++) {
+        if (runs[i]->min_key < start_key) start_key = runs[i]->min_key;
+        if (end_key < runs[i]->max_key) end_key = runs[i]->max_key;
+        expected += runs[i]->entry_count;
+    }
+
+    LsmRunWriter<Tree>* writer = (LsmRunWriter<Tree>*)aligned_alloc(alignof(LsmRunWriter<Tree>), sizeof(LsmRunWriter<Tree>));
+    lsm_run_writer_begin(tree, writer, expected);
+    LsmMerge<Tree> merge;
+    lsm_merge_begin(tree, &merge, runs, run_count, false, start_key, end_key);
+    typename Tree::Key key;
+    typename Tree::Value value;
+    while (lsm_merge_next(&merge, &key, &value)) lsm_run_writer_add(writer, key, value);
+    lsm_merge_end(&merge);
+    typename Tree::Run* merged = lsm_run_writer_finish(writer);
+    free(writer);
+
+    for (int i = 0; i < run_count; i++) lsm_release_run(tree, runs[i]);
+    tree->compactions++;
+    tree->compaction_entries += merged != NULL ? merged->entry_count : 0;
+    return merged;
+}
+
+// Слияния после появления нового прогона на L0
+template <typename Tree>
+void lsm_compact(Tree* tree) {
+    typedef typename Tree::Run Run;
+    if (tree->policy == LSM_TIERED) {
+        // Полный уровень целиком уходит одним прогоном на следующий
+        for (int l = 0; l + 1 < LSM_MAX_LEVELS && tree->levels[l].run_count >= tree->ratio; l++) {
+            Run* merged = lsm_merge_runs(tree, tree->levels[l].runs, tree->levels[l].run_count);
+            tree->levels[l].run_count = 0;
+            if (merged != NULL) lsm_level_push(tree, l + 1, merged);
+        }
+        return;
+    }
+
+    // Leveled: L0 + L1 -> L1, затем L_i + L_{i+1} -> L_{i+1}, пока уровень больше емкости
+    if (tree->levels[0].run_count < tree->l0_runs) return;
+    long long capacity = tree->memtable_limit * tree->ratio;
+    for (int l = 0; l + 1 < LSM_MAX_LEVELS; l++) {
+        LsmLevel<typename Tree::Key, typename Tree::Value>* level = &tree->levels[l];
+        if (l > 0) {
+            if (lsm_level_entries<Tree>(level) <= capacity) break;
+            capacity *= tree->ratio;
+        }
+        Run* runs[LSM_MAX_RUNS + 1];
+        int count = 0;
+        for (int r = 0; r < level->run_count; r++) runs[count++] = level->runs[r];
+        LsmLevel<typename Tree::Key, typename Tree::Value>* next = &tree->levels[l + 1];
+        for (int r = 0; r < next->run_count; r++) runs[count++] = next->runs[r];
+        level->run_count = 0;
+        next->run_count = 0;
+        Run* merged = lsm_merge_runs(tree, runs, count);
+        if (merged != NULL) lsm_level_push(tree, l + 1, merged);
+    }
+}
+
+// Сбросить memtable в прогон L0 (и выполнить нужные слияния)
+template <typename Tree>
+void lsm_flush(Tree* tree) {
+    typedef typename Tree::Memtable::Node Node;
+    if (tree->memtable.key_count == 0) return;
+
+    LsmRunWriter<Tree>* writer = (LsmRunWriter<Tree>*)aligned_alloc(alignof(LsmRunWriter<Tree>), sizeof(LsmRunWriter<Tree>));
+    lsm_run_writer_begin(tree, writer, tree->memtable.key_count);
+    Node* leaf = tree->memtable.root;
+    while (!leaf->is_leaf) leaf = (Node*)leaf->children[0];
+    for (; leaf != NULL; leaf = leaf->next_leaf) {
+        for (int i = 0; i < leaf->key_count; i++) lsm_run_writer_add(writer, leaf->keys[i], leaf->data[i]);
+    }
+    typename Tree::Run* run = lsm_run_writer_finish(writer);
+    free(writer);
+
+    bplus_tree_free(&tree->memtable);
+    bplus_tree_init(&tree->memtable);
+    tree->flushes++;
+    if (run != NULL) lsm_level_push(tree, 0, run);
+    lsm_compact(tree);
+}
+
+// Запись вслепую: без чтения старой версии, поэтому, в отличие от
+// bplus_insert, не сообщает, был ли ключ. Всегда true.
+template <typename Tree>
+bool lsm_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    bplus_insert(&tree->memtable, key, value);
+    tree->user_bytes += sizeof(typename Tree::Key) + sizeof(typename Tree::Value);
+    if (tree->memtable.key_count >= tree->memtable_limit) lsm_flush(tree);
+    return true;
+}
+
+// Точечный поиск: memtable, затем прогоны от нового к старому.
+// Прогон читается (одна страница), только если ключ в его диапазоне и фильтр не отсеял его.
+template <typename Tree>
+bool lsm_search(Tree* tree, typename Tree::Key key, typename Tree::Value* value) {
+    if (bplus_search(&tree->memtable, key, value)) return true;
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE];
+    for (int l = 0; l < tree->level_count; l++) {
+        for (int r = 0; r < tree->levels[l].run_count; r++) {
+            const typename Tree::Run* run = tree->levels[l].runs[r];
+            if (key < run->min_key || run->max_key < key) continue;
+            tree->bloom_checks++;
+            if (!lsm_bloom_may_contain(run, key)) {
+                tree->bloom_negatives++;
+                continue;
+            }
+            tree->run_probes++;
+            if (!disk_read_page(tree->disk, run->pages[lsm_run_find_page(run, key)], page)) continue;
+            int count = ((LsmPageHeader*)page)->count;
+            const typename Tree::Key* keys = lsm_page_keys<Tree>(page);
+            int pos = node_lower_bound(keys, count, key);
+            if (pos < count && keys[pos] == key) {
+                if (value != NULL) *value = lsm_page_values<Tree>(page)[pos];
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Range query: слияние memtable и всех прогонов, пересекающих диапазон.
+// Контракт как у bplus_disk_range_query: в results не больше max_results
+// ключей, возвращается общее число найденных.
+template <typename Tree>
+long long lsm_range_query(Tree* tree, typename Tree::Key start_key, typename Tree::Key end_key,
+                          typename Tree::Key* results, long long max_results) {
+    typename Tree::Run* runs[LSM_MAX_LEVELS * LSM_MAX_RUNS];
+    int run_count = 0;
+    for (int l = 0; l < tree->level_count; l++) {
+        for (int r = 0; r < tree->levels[l].run_count; r++) {
+            typename Tree::Run* run = tree->levels[l].runs[r];
+            if (!(run->max_key < start_key || end_key < run->min_key)) runs[run_count++] = run;
+        }
+    }
+    LsmMerge<Tree> merge;
+    lsm_merge_begin(tree, &merge, runs, run_count, true, start_key, end_key);
+    long long count = 0;
+    typename Tree::Key key;
+    typename Tree::Value value;
+    while (lsm_merge_next(&merge, &key, &value)) {
+        if (count < max_results) results[count] = key;
+        count++;
+    }
+    lsm_merge_end(&merge);
+    return count;
+}
+
+// Прогонов на всех уровнях
+template <typename Tree>
+int lsm_run_count(const Tree* tree) {
+    int runs = 0;
+    for (int l = 0; l < tree->level_count; l++) runs += tree->levels[l].run_count;
+    return runs;
+}
@@ -3,70 +3,30 @@
 #include <time.h>
 #include <stdbool.h>
 #include <math.h>
+#include <malloc.h>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <signal.h>
+#include <sys/wait.h>
 
-#define BPLUS_ORDER 4
-#define B_ORDER 4  // Добавлено определение для B-дерева
+#include "disk.h"
+#include "btree.h"
+#include "bplus_tree.h"
+#include "disk_tree.h"
+#include "concurrent_bplus_tree.h"
+#include "parallel_range.h"
+#include "static_tree.h"
+#include "compressed_leaf.h"
+#include "lsm_tree.h"
+#include "wal.h"
+#include "cow_bplus_tree.h"
+#include "batch_lookup.h"
+#include "mapped_tree.h"
 
-// Симулятор дисковых операций
-struct DiskSimulator {
-    int read_count;
-    int write_count;
-    int page_size;
-};
-
-void disk_init(struct DiskSimulator* disk) {
-    disk->read_count = 0;
-    disk->write_count = 0;
-    disk->page_size = 4096;
-}
-
-void disk_read(struct DiskSimulator* disk, long long offset) {
-    disk->read_count++;
-}
-
-void disk_write(struct DiskSimulator* disk, long long offset) {
-    disk->write_count++;
-}
-
-// Структура для B-дерева (добавлено)
-struct BTreeNode {
-    int keys[B_ORDER - 1];
-    long long children[B_ORDER];
-    int key_count;
-    bool is_leaf;
-    long long offset;
-};
-
-struct BTreeNode* create_btree_node(bool is_leaf, long long offset) {
-    struct BTreeNode* node = (struct BTreeNode*)malloc(sizeof(struct BTreeNode));
-    node->key_count = 0;
-    node->is_leaf = is_leaf;
-    node->offset = offset;
-    for (int i = 0; i < B_ORDER; i++) node->children[i] = -1;
-    return node;
-}
-
-// Структура для B+-дерева
-struct BPlusNode {
-    int keys[BPLUS_ORDER - 1];
-    union {
-        long long children[BPLUS_ORDER]; // для внутренних узлов
-        struct BPlusNode* next_leaf; // для листьев
-        int data[BPLUS_ORDER - 1]; // данные в листьях
-    };
-    int key_count;
-    bool is_leaf;
-    long long offset;
-};
-
-struct BPlusNode* create_bplus_node(bool is_leaf, long long offset) {
-    struct BPlusNode* node = (struct BPlusNode*)malloc(sizeof(struct BPlusNode));
-    node->key_count = 0;
-    node->is_leaf = is_leaf;
-    node->offset = offset;
-    if (is_leaf) node->next_leaf = NULL;
-    return node;
-}
+// Конфигурация демонстрационных тестов: порядок 4, как в исходной версии
+typedef BPlusTree<int, int, 4> DemoBPlusTree;
+typedef BTree<int, int, 4> DemoBTree;
 
 // ==================== ТЕСТЫ ДЛЯ B+-ДЕРЕВА ====================
 
@@ -74,13 +34,13 @@ struct BPlusNode* create_bplus_node(bool is_leaf, long long offset) {
 void test_structure_comparison() {
     printf("\n=== ТЕСТ 1: Сравнение структур B-дерева и B+-дерева ===\n\n");
     
-    printf("B-дерево (ORDER=%d):\n", B_ORDER);
+    printf("B-дерево (ORDER=%d):\n", DemoBTree::order);
     printf("• Ключи хранятся во всех узлах\n");
     printf("• Каждый узел содержит и ключи, и указатели\n");
     printf("• Поиск может завершиться в любом узле\n");
     printf("• Нет связей между листьями\n\n");
     
-    printf("B+-дерево (ORDER=%d):\n", BPLUS_ORDER);
+    printf("B+-дерево (ORDER=%d):\n", DemoBPlusTree::order);
     printf("• Ключи хранятся только в листьях\n");
     printf("• Внутренние узлы - только индекс\n");
     printf("• Все данные в последовательных листьях\n");
@@ -98,13 +58,13 @@ void test_structure_comparison() {
 void test_memory_efficiency() {
     printf("=== ТЕСТ 2: Эффективность использования памяти ===\n\n");
     
-    int typical_keys = (BPLUS_ORDER - 1) * 2 / 3; // типичная заполненность 66%
+    int typical_keys = (DemoBPlusTree::order - 1) * 2 / 3; // типичная заполненность 66%
     
-    printf("B+-дерево ORDER=%d:\n", BPLUS_ORDER);
-    printf("• Максимум ключей в узле: %d\n", BPLUS_ORDER - 1);
+    printf("B+-дерево ORDER=%d:\n", DemoBPlusTree::order);
+    printf("• Максимум ключей в узле: %d\n", DemoBPlusTree::order - 1);
     printf("• Типичных ключей в листе: %d\n", typical_keys);
-    printf("• Высота для 1M элементов: ~%.1f\n", log(1000000) / log(BPLUS_ORDER));
-    printf("• Эффективность хранения: ~%.1f%%\n\n", (typical_keys * 100.0) / (BPLUS_ORDER - 1));
+    printf("• Высота для 1M элементов: ~%.1f\n", log(1000000) / log(DemoBPlusTree::order));
+    printf("• Эффективность хранения: ~%.1f%%\n\n", (typical_keys * 100.0) / (DemoBPlusTree::order - 1));
     
     printf("Сравнение с B-деревом:\n");
     printf("• B+-дерево: все данные в листьях + индекс отдельно\n");
@@ -152,92 +112,64 @@ void test_bplus_practical_recommendations() {
     printf("анные полностью в памяти\n\n");
 }
 
+// Ключи 0..n-1 в случайном порядке (тасование Фишера-Йетса)
+static int* make_shuffled_keys(int n) {
+    int* keys = (int*)malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int temp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = temp;
+    }
+    return keys;
+}
+
 // ТЕСТ 5: Масштабируемость B+-дерева
+// Высота B+-дерева измеряется на реально построенных деревьях
 void test_bplus_performance_scaling() {
     printf("=== ТЕСТ 5: Масштабируемость B+-дерева ===\n\n");
     
     int sizes[] = {1000, 10000, 100000, 1000000, 10000000};
     int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const int LOOKUPS = 100000;
     
     printf("Сравнение высоты деревьев:\n");
-    printf("%-10s | %-15s | %-15s | %-15s\n", 
-           "Элементов", "B-дерево", "B+-дерево", "Выигрыш");
-    printf("-----------|-----------------|-----------------|-----------------\n");
+    printf("%-10s | %-10s | %-10s | %-10s | %-10s | %-12s | %-12s\n", 
+           "Элементов", "B (оц.)", "B+ (оц.)", "B+ (факт)", "Узлов", "Вставка, ms", "Поиск, нс");
+    printf("-----------|------------|------------|------------|------------|--------------|-------------\n");
     
     for (int i = 0; i < num_sizes; i++) {
         int size = sizes[i];
-        float btree_h = log(size) / log(B_ORDER);
-        float bplus_h = log(size) / log(BPLUS_ORDER);
-        float advantage = btree_h / bplus_h;
+        float btree_h = log(size) / log(DemoBTree::order);
+        float bplus_h = log(size) / log(DemoBPlusTree::order);
         
-        printf("%-10d | %-15.1f | %-15.1f | %-15.1f\n", 
-               size, btree_h, bplus_h, advantage);
-    }
-    printf("\n");
-}
-
-// Range query для B+-дерева
-void bplus_range_query(struct BPlusNode* root, int start_key, int end_key) {
-    printf("=== RANGE QUERY [%d - %d] ===\n", start_key, end_key);
-    
-    // Находим стартовый лист
-    struct BPlusNode* current = root;
-    while (!current->is_leaf) {
-        int i = 0;
-        while (i < current->key_count && start_key >= current->keys[i]) i++;
-        current = (struct BPlusNode*)current->children[i];
-    }
-    
-    // Проходим по связному списку листьев
-    int results[100];
-    int result_count = 0;
-    while (current != NULL) {
-        printf("Проверяем лист: [");
-        for (int i = 0; i < current->key_count; i++) {
-            printf("%d", current->keys[i]);
-            if (i < current->key_count - 1) printf(",");
-        }
-        printf("]\n");
+        int* keys = make_shuffled_keys(size);
+        DemoBPlusTree tree;
+        bplus_tree_init(&tree);
         
-        for (int i = 0; i < current->key_count; i++) {
-            if (current->keys[i] >= start_key && current->keys[i] <= end_key) {
-                results[result_count++] = current->keys[i];
-                printf(" Найден: %d\n", current->keys[i]);
-            }
-        }
+        clock_t start = clock();
+        for (int k = 0; k < size; k++) bplus_insert(&tree, keys[k], keys[k]);
+        clock_t end = clock();
+        double build_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
         
-        if (current->key_count > 0 && current->keys[current->key_count - 1] > end_key) {
-            break;
-        }
-        current = current->next_leaf;
-    }
-    
-    printf("Результаты range query (%d значений): ", result_count);
-    for (int i = 0; i < result_count; i++) printf("%d ", results[i]);
-    printf("\n\n");
-}
-
-// Range query для обычного B-дерева (для сравнения)
-void btree_range_query(struct BTreeNode* node, int start_key, int end_key,
-                      int* results, int* result_count) {
-    if (node == NULL) return;
-    
-    int i = 0;
-    while (i < node->key_count) {
-        if (!node->is_leaf) {
-            btree_range_query((struct BTreeNode*)node->children[i], start_key, end_key,
-                             results, result_count);
-        }
-        if (node->keys[i] >= start_key && node->keys[i] <= end_key) {
-            results[(*result_count)++] = node->keys[i];
+        int found = 0;
+        start = clock();
+        for (int k = 0; k < LOOKUPS; k++) {
+            int value;
+            if (bplus_search(&tree, keys[k % size], &value)) found++;
         }
-        i++;
-    }
-    
-    if (!node->is_leaf) {
-        btree_range_query((struct BTreeNode*)node->children[i], start_key, end_key,
-                         results, result_count);
+        end = clock();
+        double lookup_ns = (double)(end - start) * 1e9 / CLOCKS_PER_SEC / LOOKUPS;
+        
+        printf("%-10d | %-10.1f | %-10.1f | %-10d | %-10lld | %-12.1f | %-12.1f\n", 
+               size, btree_h, bplus_h, tree.height, tree.node_count, build_ms, lookup_ns);
+        if (found != LOOKUPS) printf("ОШИБКА: найдено %d из %d ключей\n", found, LOOKUPS);
+        
+        bplus_tree_free(&tree);
+        free(keys);
     }
+    printf("\n");
 }
 
 void benchmark_range_queries() {
@@ -254,35 +186,27 @@ void benchmark_range_queries() {
     for (int i = 0; i < DATA_SIZE; i++) printf("%d ", test_data[i]);
     printf("\n\n");
     
-    // Создаем простое B+-дерево для демонстрации
-    struct BPlusNode* bplus_root = create_bplus_node(true, 1000);
-    
-    // Заполняем данными (упрощенная версия)
+    // Строим B+-дерево обычными вставками (повторы ключей отбрасываются)
+    DemoBPlusTree bplus_tree;
+    bplus_tree_init(&bplus_tree);
     for (int i = 0; i < DATA_SIZE; i++) {
-        if (bplus_root->key_count < BPLUS_ORDER - 1) {
-            bplus_root->keys[bplus_root->key_count++] = test_data[i];
-        }
+        bplus_insert(&bplus_tree, test_data[i], i);
     }
+    DemoBPlusTree::Node* bplus_root = bplus_tree.root;
     
-    // Сортируем ключи для наглядности
-    for (int i = 0; i < bplus_root->key_count - 1; i++) {
-        for (int j = i + 1; j < bplus_root->key_count; j++) {
-            if (bplus_root->keys[j] < bplus_root->keys[i]) {
-                int temp = bplus_root->keys[i];
-                bplus_root->keys[i] = bplus_root->keys[j];
-                bplus_root->keys[j] = temp;
-            }
+    printf("B+-дерево: высота %d, узлов %lld, уникальных ключей %lld\n",
+           bplus_tree.height, bplus_tree.node_count, bplus_tree.key_count);
+    DemoBPlusTree::Node* leaf = bplus_root;
+    while (!leaf->is_leaf) leaf = (DemoBPlusTree::Node*)leaf->children[0];
+    for (int n = 1; leaf != NULL; n++, leaf = leaf->next_leaf) {
+        printf("Лист %d: [", n);
+        for (int i = 0; i < leaf->key_count; i++) {
+            printf("%d", leaf->keys[i]);
+            if (i < leaf->key_count - 1) printf(",");
         }
+        printf("]\n");
     }
     
-    printf("B+-дерево (только листья для демонстрации):\n");
-    printf("Лист 1: [");
-    for (int i = 0; i < bplus_root->key_count; i++) {
-        printf("%d", bplus_root->keys[i]);
-        if (i < bplus_root->key_count - 1) printf(",");
-    }
-    printf("]\n");
-    
     // Тестируем range queries
     int ranges[][2] = {{10, 30}, {40, 60}, {0, 100}};
     for (int r = 0; r < 3; r++) {
@@ -293,32 +217,2607 @@ void benchmark_range_queries() {
                (double)(end - start) * 1000 / CLOCKS_PER_SEC);
         
         // Для сравнения с обычным B-tree
-        struct BTreeNode* btree_root = create_btree_node(true, 2000);
+        DemoBTree btree;
+        btree_tree_init(&btree);
         for (int i = 0; i < DATA_SIZE; i++) {
-            if (btree_root->key_count < B_ORDER - 1) {
-                btree_root->keys[btree_root->key_count++] = test_data[i];
-            }
+            btree_insert(&btree, test_data[i], i);
         }
         
         int btree_results[100];
-        int btree_count = 0;
         start = clock();
-        btree_range_query(btree_root, ranges[r][0], ranges[r][1], btree_results, &btree_count);
+        long long btree_count = btree_range_query(btree.root, ranges[r][0], ranges[r][1], btree_results,
+                                                  (long long)(sizeof(btree_results) / sizeof(btree_results[0])));
         end = clock();
         
         printf("B-tree время: %.3f ms\n", 
                (double)(end - start) * 1000 / CLOCKS_PER_SEC);
-        printf("B-tree результаты (%d значений)\n\n", btree_count);
+        printf("B-tree результаты (%lld значений)\n\n", btree_count);
         
-        free(btree_root);
+        btree_tree_free(&btree);
     }
     
     printf("Вывод: B+-дерево эффективнее для range queries благодаря:\n");
     printf(" – Связный список  между листьями\n");
     printf(" - Все данные хранятся в листьях\n");
-    printf(" - Линейный обход вместо рекурсивного\n");
+    printf(" - Линейный обход вместо рекурсивного\n\n");
+    
+    bplus_tree_free(&bplus_tree);
+    
+    // Те же запросы на большом дереве: реальная высота вместо одного листа.
+    // Замеряется обход курсором; печать результатов - вне замера.
+    const int BIG_SIZE = 1000000;
+    int* big_keys = make_shuffled_keys(BIG_SIZE);
+    DemoBPlusTree big_tree;
+    bplus_tree_init(&big_tree);
+    DemoBTree big_btree;
+    btree_tree_init(&big_btree);
+    for (int i = 0; i < BIG_SIZE; i++) {
+        bplus_insert(&big_tree, big_keys[i], big_keys[i]);
+        btree_insert(&big_btree, big_keys[i], big_keys[i]);
+    }
+    free(big_keys);
+    
+    printf("Большое B+-дерево: %lld ключей, высота %d, узлов %lld (листьев %lld)\n\n",
+           big_tree.key_count, big_tree.height, big_tree.node_count, big_tree.leaf_count);
+    int big_ranges[][2] = {{500000, 500009}, {250000, 250999}, {0, 499999}};
+    for (int r = 0; r < 3; r++) {
+        long long bplus_count = 0, bplus_sum = 0;
+        clock_t start = clock();
+        BPlusCursor<DemoBPlusTree> cursor;
+        BPlusSpan<DemoBPlusTree> span;
+        bplus_cursor_seek(&big_tree, &cursor, big_ranges[r][0], big_ranges[r][1]);
+        while (bplus_cursor_next_n(&cursor, 1 << 30, &span) > 0) {
+            for (int i = 0; i < span.count; i++) bplus_sum += span.keys[i];
+            bplus_count += span.count;
+        }
+        clock_t end = clock();
+        double bplus_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+        
+        long long btree_count = 0, btree_sum = 0;
+        start = clock();
+        BTreeCursor<DemoBTree> btree_cursor;
+        BTreeSpan<DemoBTree> btree_span;
+        btree_cursor_seek(&big_btree, &btree_cursor, big_ranges[r][0], big_ranges[r][1]);
+        while (btree_cursor_next_n(&btree_cursor, 1 << 30, &btree_span) > 0) {
+            for (int i = 0; i < btree_span.count; i++) btree_sum += btree_span.keys[i];
+            btree_count += btree_span.count;
+        }
+        end = clock();
+        double btree_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+        
+        printf("[%d - %d]: B+-tree %lld значений за %.3f ms, B-tree %lld значений за %.3f ms\n",
+               big_ranges[r][0], big_ranges[r][1], bplus_count, bplus_ms, btree_count, btree_ms);
+        if (bplus_sum != btree_sum) printf("ОШИБКА: результаты деревьев расходятся\n");
+    }
+    printf("\n");
+    
+    bplus_tree_free(&big_tree);
+    btree_tree_free(&big_btree);
+}
+
+// Курсоры B+- и B-дерева: обход диапазонов без копирования и печати
+void benchmark_cursor_scans() {
+    printf("=== Курсоры: обход диапазонов без копирования ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> ScanBPlusTree;
+    typedef CacheLineBTree<int, int, 4> ScanBTree;
+    const int SIZE = 1000000;
+    const int QUERIES = 200;
+    int* keys = make_shuffled_keys(SIZE);
+    ScanBPlusTree bplus;
+    bplus_tree_init(&bplus);
+    ScanBTree btree;
+    btree_tree_init(&btree);
+    for (int i = 0; i < SIZE; i++) {
+        bplus_insert(&bplus, keys[i], keys[i]);
+        btree_insert(&btree, keys[i], keys[i]);
+    }
+    
+    printf("%-10s | %-14s | %-14s | %-14s | %-14s\n",
+           "Диапазон", "B+ next, нс/кл", "B+ next_n", "B next, нс/кл", "B next_n");
+    printf("-----------|----------------|----------------|----------------|---------------\n");
+    
+    int widths[] = {10, 100, 1000, 10000, 100000};
+    for (int w = 0; w < 5; w++) {
+        double ns[4];
+        long long sums[4];
+        for (int mode = 0; mode < 4; mode++) {
+            long long sum = 0, total = 0;
+            clock_t start = clock();
+            for (int q = 0; q < QUERIES; q++) {
+                int from = keys[q] % (SIZE - widths[w]);
+                int to = from + widths[w] - 1;
+                if (mode == 0) {
+                    BPlusCursor<ScanBPlusTree> c;
+                    const int* key;
+                    const int* value;
+                    bplus_cursor_seek(&bplus, &c, from, to);
+                    while (bplus_cursor_next(&c, &key, &value)) { sum += *key; total++; }
+                } else if (mode == 1) {
+                    BPlusCursor<ScanBPlusTree> c;
+                    BPlusSpan<ScanBPlusTree> span;
+                    bplus_cursor_seek(&bplus, &c, from, to);
+                    while (bplus_cursor_next_n(&c, 256, &span) > 0) {
+                        for (int i = 0; i < span.count; i++) sum += span.keys[i];
+                        total += span.count;
+                    }
+                } else if (mode == 2) {
+                    BTreeCursor<ScanBTree> c;
+                    const int* key;
+                    const int* value;
+                    btree_cursor_seek(&btree, &c, from, to);
+                    while (btree_cursor_next(&c, &key, &value)) { sum += *key; total++; }
+                } else {
+                    BTreeCursor<ScanBTree> c;
+                    BTreeSpan<ScanBTree> span;
+                    btree_cursor_seek(&btree, &c, from, to);
+                    while (btree_cursor_next_n(&c, 256, &span) > 0) {
+                        for (int i = 0; i < span.count; i++) sum += span.keys[i];
+                        total += span.count;
+                    }
+                }
+            }
+            clock_t end = clock();
+            ns[mode] = (double)(end - start) * 1e9 / CLOCKS_PER_SEC / (total > 0 ? total : 1);
+            sums[mode] = sum;
+        }
+        printf("%-10d | %-14.2f | %-14.2f | %-14.2f | %-14.2f\n", widths[w], ns[0], ns[1], ns[2], ns[3]);
+        if (sums[0] != sums[1] || sums[0] != sums[2] || sums[0] != sums[3]) {
+            printf("ОШИБКА: курсоры вернули разные ключи\n");
+        }
+    }
+    printf("\n");
+    
+    bplus_tree_free(&bplus);
+    btree_tree_free(&btree);
+    free(keys);
+}
+
+// Пакетная загрузка против вставок по одному ключу
+void benchmark_bulk_load() {
+    printf("=== Пакетная загрузка B+-дерева (bulk load) ===\n\n");
+    
+    const int SIZE = 1000000;
+    int* sorted_keys = (int*)malloc(sizeof(int) * SIZE);
+    for (int i = 0; i < SIZE; i++) sorted_keys[i] = i * 2; // например, даты с шагом
+    int* shuffled = make_shuffled_keys(SIZE);
+    for (int i = 0; i < SIZE; i++) shuffled[i] *= 2;
+    
+    printf("%-26s | %-10s | %-8s | %-10s | %-10s | %-8s\n",
+           "Способ", "Время, ms", "Высота", "Узлов", "Листьев", "Заполн.");
+    printf("---------------------------|------------|----------|------------|------------|---------\n");
+    
+    for (int mode = 0; mode < 5; mode++) {
+        const char* name = "";
+        double fill_factors[] = {0, 0, 1.0, 0.9, 0.7};
+        DemoBPlusTree tree;
+        
+        clock_t start = clock();
+        if (mode < 2) {
+            name = (mode == 0) ? "вставки по возрастанию" : "вставки в случ. порядке";
+            const int* keys = (mode == 0) ? sorted_keys : shuffled;
+            bplus_tree_init(&tree);
+            for (int i = 0; i < SIZE; i++) bplus_insert(&tree, keys[i], i);
+        } else {
+            name = (mode == 2) ? "bulk load, fill=1.0" : (mode == 3) ? "bulk load, fill=0.9" : "bulk load, fill=0.7";
+            bplus_bulk_load(&tree, sorted_keys, NULL, SIZE, fill_factors[mode]);
+        }
+        clock_t end = clock();
+        
+        // Проверка: все ключи находятся
+        int missing = 0;
+        for (int i = 0; i < SIZE; i += 997) {
+            if (!bplus_search(&tree, sorted_keys[i], NULL)) missing++;
+        }
+        
+        double fill = (double)tree.key_count / (tree.leaf_count * (DemoBPlusTree::order - 1)) * 100;
+        printf("%-26s | %-10.1f | %-8d | %-10lld | %-10lld | %-7.1f%%\n",
+               name, (double)(end - start) * 1000 / CLOCKS_PER_SEC,
+               tree.height, tree.node_count, tree.leaf_count, fill);
+        if (missing > 0) printf("ОШИБКА: не найдено %d ключей\n", missing);
+        
+        bplus_tree_free(&tree);
+    }
+    
+    // Загрузка из потока: ключи поступают по одному, размер заранее неизвестен
+    DemoBPlusTree stream_tree;
+    BPlusBulkLoader<DemoBPlusTree> loader;
+    bplus_bulk_begin(&loader, &stream_tree, 1.0);
+    for (int day = 0; day < 3650; day++) bplus_bulk_add(&loader, 20000000 + day, day);
+    bplus_bulk_finish(&loader);
+    printf("\nПоток из 3650 дат: высота %d, узлов %lld, ключей %lld\n\n",
+           stream_tree.height, stream_tree.node_count, stream_tree.key_count);
+    bplus_tree_free(&stream_tree);
+    
+    free(sorted_keys);
+    free(shuffled);
+}
+
+// Одна строка перебора конфигураций: построение, высота, память, поиск
+template <typename Tree>
+void sweep_bplus_row(const char* name, const int* keys, int n) {
+    typedef typename Tree::Key K;
+    typedef typename Tree::Value V;
+    Tree tree;
+    bplus_tree_init(&tree);
+    
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) bplus_insert(&tree, (K)keys[i], (V)i);
+    clock_t end = clock();
+    double build_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+    
+    const int LOOKUPS = 200000;
+    int found = 0;
+    start = clock();
+    for (int i = 0; i < LOOKUPS; i++) {
+        if (bplus_search(&tree, (K)keys[i % n], (V*)NULL)) found++;
+    }
+    end = clock();
+    double lookup_ns = (double)(end - start) * 1e9 / CLOCKS_PER_SEC / LOOKUPS;
+    
+    double memory_mb = (double)tree.node_count * sizeof(typename Tree::Node) / (1024 * 1024);
+    printf("%-28s | %-6d | %-7d | %-6d | %-9lld | %-9.1f | %-11.1f | %-9.1f\n",
+           name, Tree::order, (int)sizeof(typename Tree::Node), tree.height,
+           tree.node_count, memory_mb, build_ms, lookup_ns);
+    if (found != LOOKUPS) printf("ОШИБКА: найдено %d из %d ключей\n", found, LOOKUPS);
+    
+    bplus_tree_free(&tree);
+}
+
+template <typename Tree>
+void sweep_btree_row(const char* name, const int* keys, int n) {
+    typedef typename Tree::Key K;
+    typedef typename Tree::Value V;
+    Tree tree;
+    btree_tree_init(&tree);
+    
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) btree_insert(&tree, (K)keys[i], (V)i);
+    clock_t end = clock();
+    double build_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+    
+    const int LOOKUPS = 200000;
+    int found = 0;
+    start = clock();
+    for (int i = 0; i < LOOKUPS; i++) {
+        if (btree_search(&tree, (K)keys[i % n], (V*)NULL)) found++;
+    }
+    end = clock();
+    double lookup_ns = (double)(end - start) * 1e9 / CLOCKS_PER_SEC / LOOKUPS;
+    
+    double memory_mb = (double)tree.node_count * sizeof(typename Tree::Node) / (1024 * 1024);
+    printf("%-28s | %-6d | %-7d | %-6d | %-9lld | %-9.1f | %-11.1f | %-9.1f\n",
+           name, Tree::order, (int)sizeof(typename Tree::Node), tree.height,
+           tree.node_count, memory_mb, build_ms, lookup_ns);
+    if (found != LOOKUPS) printf("ОШИБКА: найдено %d из %d ключей\n", found, LOOKUPS);
+    
+    btree_tree_free(&tree);
+}
+
+// Перебор порядков: узел в одну/несколько кэш-линий, m=100 из README, страница 4 KiB
+void benchmark_order_sweep() {
+    printf("=== Перебор порядков деревьев (1M ключей, случайный порядок) ===\n\n");
+    
+    const int SIZE = 1000000;
+    int* keys = make_shuffled_keys(SIZE);
+    
+    printf("%-28s | %-6s | %-7s | %-6s | %-9s | %-9s | %-11s | %-9s\n",
+           "Конфигурация", "ORDER", "Узел, Б", "Высота", "Узлов", "Память,МБ", "Вставка, ms", "Поиск, нс");
+    printf("-----------------------------|--------|---------|--------|-----------|-----------|-------------|----------\n");
+    
+    sweep_bplus_row<DemoBPlusTree>("B+ int, ORDER=4", keys, SIZE);
+    sweep_bplus_row<CacheLineBPlusTree<int, int, 1> >("B+ int, 1 кэш-линия", keys, SIZE);
+    sweep_bplus_row<CacheLineBPlusTree<int, int, 2> >("B+ int, 2 кэш-линии", keys, SIZE);
+    sweep_bplus_row<CacheLineBPlusTree<int, int, 4> >("B+ int, 4 кэш-линии", keys, SIZE);
+    sweep_bplus_row<BPlusTree<int, int, 100> >("B+ int, m=100 (README)", keys, SIZE);
+    sweep_bplus_row<PageBPlusTree<int, int> >("B+ int, страница 4 KiB", keys, SIZE);
+    sweep_bplus_row<PageBPlusTree<long long, long long> >("B+ int64, страница 4 KiB", keys, SIZE);
+    
+    sweep_btree_row<DemoBTree>("B int, ORDER=4", keys, SIZE);
+    sweep_btree_row<CacheLineBTree<int, int, 1> >("B int, 1 кэш-линия", keys, SIZE);
+    sweep_btree_row<CacheLineBTree<int, int, 4> >("B int, 4 кэш-линии", keys, SIZE);
+    sweep_btree_row<BTree<int, int, 100> >("B int, m=100 (README)", keys, SIZE);
+    sweep_btree_row<PageBTree<int, int> >("B int, страница 4 KiB", keys, SIZE);
+    printf("\n");
+    
+    free(keys);
+}
+
+// Микробенчмарк поиска внутри узла: скалярный цикл против SSE4.2/AVX2
+void benchmark_simd_search() {
+    printf("=== Поиск внутри узла: скаляр / SSE4.2 / AVX2 ===\n\n");
+    printf("Процессор поддерживает: %s\n\n", simd_level_name(simd_detect()));
+    
+    const int PROBES = 4096;
+    const int CALLS = 2000000;
+    const int PAGE_KEYS = PageBPlusTree<int, int>::order - 1;   // ключей в узле на страницу
+    int sizes[] = {16, 64, 128, 256, PAGE_KEYS};
+    SimdLevel levels[] = {SIMD_SCALAR, SIMD_SSE42, SIMD_AVX2};
+    
+    printf("%-7s | %-8s | %-18s | %-18s\n", "Ключей", "Путь", "Спуск (upper), нс", "Фильтр листа, нс");
+    printf("--------|----------|--------------------|-------------------\n");
+    
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        int n = sizes[s];
+        int keys[PAGE_KEYS];
+        for (int i = 0; i < n; i++) keys[i] = i * 4 + rand() % 4;
+        int probes[PROBES];
+        for (int i = 0; i < PROBES; i++) probes[i] = rand() % (n * 4 + 8) - 4;
+        
+        long long expected = -1;
+        for (int l = 0; l < 3; l++) {
+            if (!simd_set_level(levels[l])) continue;
+            
+            long long checksum = 0;
+            clock_t start = clock();
+            for (int c = 0; c < CALLS; c++) {
+                checksum += node_upper_bound(keys, n, probes[c & (PROBES - 1)]);
+            }
+            clock_t end = clock();
+            double upper_ns = (double)(end - start) * 1e9 / CLOCKS_PER_SEC / CALLS;
+            
+            start = clock();
+            for (int c = 0; c < CALLS; c++) {
+                int key = probes[c & (PROBES - 1)];
+                int first, last;
+                node_range_bounds(keys, n, key, key + 40, &first, &last);
+                checksum += last - first;
+            }
+            end = clock();
+            double range_ns = (double)(end - start) * 1e9 / CLOCKS_PER_SEC / CALLS;
+            
+            printf("%-7d | %-8s | %-18.2f | %-18.2f\n", n, simd_level_name(levels[l]), upper_ns, range_ns);
+            if (expected == -1) expected = checksum;
+            else if (checksum != expected) printf("ОШИБКА: результат %s расходится со скалярным\n",
+                                                  simd_level_name(levels[l]));
+        }
+    }
+    
+    // Сквозной замер: точечный поиск в дереве со страничными узлами
+    const int SIZE = 1000000;
+    const int LOOKUPS = 1000000;
+    int* keys = make_shuffled_keys(SIZE);
+    PageBPlusTree<int, int> tree;
+    bplus_tree_init(&tree);
+    for (int i = 0; i < SIZE; i++) bplus_insert(&tree, keys[i], i);
+    
+    printf("\nB+-дерево ORDER=%d, %d ключей, точечный поиск:\n", PageBPlusTree<int, int>::order, SIZE);
+    for (int l = 0; l < 3; l++) {
+        if (!simd_set_level(levels[l])) continue;
+        int found = 0;
+        clock_t start = clock();
+        for (int i = 0; i < LOOKUPS; i++) {
+            if (bplus_search(&tree, keys[i], (int*)NULL)) found++;
+        }
+        clock_t end = clock();
+        printf("  %-8s: %.1f нс/поиск%s\n", simd_level_name(levels[l]),
+               (double)(end - start) * 1e9 / CLOCKS_PER_SEC / LOOKUPS,
+               found == LOOKUPS ? "" : " (ОШИБКА: найдены не все ключи)");
+    }
+    printf("\n");
+    
+    simd_set_level(simd_detect());
+    bplus_tree_free(&tree);
+    free(keys);
+}
+
+// Строка отчета о дисковых операциях: симулированные счетчики рядом с реальным I/O
+static void print_disk_row(const char* tree_name, const char* operation, double ms,
+                           struct DiskSimulator* disk, int queries) {
+    printf("%-8s | %-24s | %-10.1f | %-12.1f | %-10.1f | %-10.2f\n",
+           tree_name, operation, ms,
+           (double)(disk->read_count + disk->write_count) / queries,
+           (double)(disk->file_reads + disk->file_writes) / queries,
+           (double)(disk->bytes_read + disk->bytes_written) / (1024 * 1024));
+}
+
+// Деревья в файле страниц: запись, повторное открытие и запросы с диска
+void benchmark_disk_storage() {
+    printf("=== Хранение деревьев в файле страниц (%d байт) ===\n\n", DISK_PAGE_SIZE);
+    
+    typedef PageBPlusTree<int, int> DiskBPlusTree;
+    typedef PageBTree<int, int> DiskBTree;
+    const char* BPLUS_FILE = "bplus_tree.db";
+    const char* BTREE_FILE = "btree.db";
+    const int SIZE = 1000000;
+    const int LOOKUPS = 10000;
+    int* keys = make_shuffled_keys(SIZE);
+    
+    DiskBPlusTree bplus;
+    bplus_tree_init(&bplus);
+    DiskBTree btree;
+    btree_tree_init(&btree);
+    for (int i = 0; i < SIZE; i++) {
+        bplus_insert(&bplus, keys[i], keys[i]);
+        btree_insert(&btree, keys[i], keys[i]);
+    }
+    
+    printf("%-8s | %-24s | %-10s | %-12s | %-10s | %-10s\n",
+           "Дерево", "Операция", "Время, ms", "Обращ./запр.", "I/O/запр.", "МБ");
+    printf("---------|--------------------------|------------|--------------|------------|-----------\n");
+    
+    // Запись на диск
+    struct DiskSimulator disk;
+    clock_t start = clock();
+    bool ok = disk_open(&disk, BPLUS_FILE, true) && bplus_persist(&bplus, &disk);
+    clock_t end = clock();
+    print_disk_row("B+", "запись дерева", (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, 1);
+    disk_close(&disk);
+    
+    start = clock();
+    ok = ok && disk_open(&disk, BTREE_FILE, true) && btree_persist(&btree, &disk);
+    end = clock();
+    print_disk_row("B", "запись дерева", (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, 1);
+    disk_close(&disk);
+    if (!ok) {
+        printf("ОШИБКА: не удалось записать деревья на диск\n\n");
+        free(keys);
+        return;
+    }
+    
+    // Повторное открытие и точечные запросы прямо с диска
+    struct DiskTreeHeader header;
+    int found = 0;
+    disk_open(&disk, BPLUS_FILE, false);
+    bplus_disk_open<DiskBPlusTree>(&disk, &header);
+    disk_reset_counters(&disk);
+    start = clock();
+    for (int i = 0; i < LOOKUPS; i++) {
+        int value;
+        if (bplus_disk_search<DiskBPlusTree>(&disk, &header, keys[i], &value) && value == keys[i]) found++;
+    }
+    end = clock();
+    print_disk_row("B+", "точечный поиск", (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, LOOKUPS);
+    
+    int widths[] = {10, 100, 1000, 10000};
+    int* results = (int*)malloc(sizeof(int) * 10001);
+    long long range_found = 0;
+    for (int w = 0; w < 4; w++) {
+        disk_reset_counters(&disk);
+        start = clock();
+        for (int q = 0; q < 100; q++) {
+            int from = keys[q] % (SIZE - widths[w]);
+            range_found += bplus_disk_range_query<DiskBPlusTree>(&disk, &header, from, from + widths[w] - 1,
+                                                               results, 10001);
+        }
+        end = clock();
+        char name[64];
+        snprintf(name, sizeof(name), "диапазон %d ключей", widths[w]);
+        print_disk_row("B+", name, (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, 100);
+    }
+    disk_close(&disk);
+    
+    disk_open(&disk, BTREE_FILE, false);
+    btree_disk_open<DiskBTree>(&disk, &header);
+    disk_reset_counters(&disk);
+    start = clock();
+    for (int i = 0; i < LOOKUPS; i++) {
+        int value;
+        if (btree_disk_search<DiskBTree>(&disk, &header, keys[i], &value) && value == keys[i]) found++;
+    }
+    end = clock();
+    print_disk_row("B", "точечный поиск", (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, LOOKUPS);
+    
+    for (int w = 0; w < 4; w++) {
+        disk_reset_counters(&disk);
+        start = clock();
+        for (int q = 0; q < 100; q++) {
+            int from = keys[q] % (SIZE - widths[w]);
+            range_found += btree_disk_range_query<DiskBTree>(&disk, &header, from, from + widths[w] - 1,
+                                                           results, 10001);
+        }
+        end = clock();
+        char name[64];
+        snprintf(name, sizeof(name), "диапазон %d ключей", widths[w]);
+        print_disk_row("B", name, (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, 100);
+    }
+    disk_close(&disk);
+    
+    if (found != 2 * LOOKUPS) printf("ОШИБКА: с диска найдено %d из %d ключей\n", found, 2 * LOOKUPS);
+    if (range_found != 2LL * 100 * (10 + 100 + 1000 + 10000)) printf("ОШИБКА: диапазоны с диска неполные\n");
+    
+    // Полная загрузка обратно в память
+    DiskBPlusTree reloaded;
+    disk_open(&disk, BPLUS_FILE, false);
+    start = clock();
+    ok = bplus_load(&reloaded, &disk);
+    end = clock();
+    print_disk_row("B+", "загрузка в память", (double)(end - start) * 1000 / CLOCKS_PER_SEC, &disk, 1);
+    disk_close(&disk);
+    if (ok) {
+        int value;
+        if (reloaded.key_count != SIZE || !bplus_search(&reloaded, keys[0], &value) || value != keys[0]) {
+            printf("ОШИБКА: загруженное дерево не совпадает с исходным\n");
+        }
+        bplus_tree_free(&reloaded);
+    } else {
+        printf("ОШИБКА: не удалось загрузить B+-дерево\n");
+    }
+    printf("(обращения - симулированные disk_read/disk_write, I/O - реальные pread/pwrite)\n\n");
+    
+    unlink(BPLUS_FILE);
+    unlink(BTREE_FILE);
+    free(results);
+    bplus_tree_free(&bplus);
+    btree_tree_free(&btree);
+    free(keys);
+}
+
+// Буферный пул перед файлом страниц: доля попаданий и задержка в зависимости от размера
+void benchmark_buffer_pool() {
+    printf("=== Буферный пул: range queries при разном размере пула ===\n\n");
+    
+    typedef PageBPlusTree<int, int> DiskBPlusTree;
+    const char* FILE_NAME = "bplus_pool.db";
+    const int SIZE = 1000000;
+    const int QUERIES = 2000;
+    const int WIDTH = 1000;
+    int* keys = make_shuffled_keys(SIZE);
+    
+    DiskBPlusTree tree;
+    bplus_tree_init(&tree);
+    for (int i = 0; i < SIZE; i++) bplus_insert(&tree, keys[i], keys[i]);
+    
+    struct DiskSimulator disk;
+    if (!disk_open(&disk, FILE_NAME, true) || !bplus_persist(&tree, &disk)) {
+        printf("ОШИБКА: не удалось записать дерево на диск\n\n");
+        bplus_tree_free(&tree);
+        free(keys);
+        return;
+    }
+    long long tree_pages = disk.page_count;
+    struct DiskTreeHeader header;
+    bplus_disk_open<DiskBPlusTree>(&disk, &header);
+    
+    printf("Дерево: %lld страниц, запросы по %d ключей, %d запросов\n\n", tree_pages, WIDTH, QUERIES);
+    printf("%-6s | %-6s | %-7s | %-10s | %-10s | %-12s | %-10s\n",
+           "Пул", "Кадров", "Полит.", "Попадания", "мкс/запр.", "pread/запр.", "Вытеснений");
+    printf("-------|--------|---------|------------|------------|--------------|-----------\n");
+    
+    int percents[] = {1, 5, 10, 25, 50, 100};
+    EvictionPolicy policies[] = {EVICT_LRU, EVICT_CLOCK};
+    int* results = (int*)malloc(sizeof(int) * WIDTH);
+    for (int p = 0; p < 2; p++) {
+        for (int pc = 0; pc < 6; pc++) {
+            struct BufferPool pool;
+            int capacity = (int)(tree_pages * percents[pc] / 100);
+            buffer_pool_init(&pool, &disk, capacity, policies[p]);
+            
+            // Прогрев: половина запросов без замера
+            for (int q = 0; q < QUERIES / 2; q++) {
+                int from = keys[q] % (SIZE - WIDTH);
+                bplus_disk_range_query<DiskBPlusTree>(&pool, &header, from, from + WIDTH - 1, results, WIDTH);
+            }
+            buffer_pool_reset_stats(&pool);
+            disk_reset_counters(&disk);
+            
+            long long found = 0;
+            clock_t start = clock();
+            for (int q = 0; q < QUERIES; q++) {
+                int from = keys[SIZE - 1 - q] % (SIZE - WIDTH);
+                found += bplus_disk_range_query<DiskBPlusTree>(&pool, &header, from, from + WIDTH - 1,
+                                                               results, WIDTH);
+            }
+            clock_t end = clock();
+            
+            char pool_size[16];
+            snprintf(pool_size, sizeof(pool_size), "%d%%", percents[pc]);
+            printf("%-6s | %-6d | %-7s | %-9.1f%% | %-10.1f | %-12.2f | %-10lld\n",
+                   pool_size, capacity, eviction_policy_name(policies[p]),
+                   buffer_pool_hit_rate(&pool) * 100,
+                   (double)(end - start) * 1e6 / CLOCKS_PER_SEC / QUERIES,
+                   (double)disk.file_reads / QUERIES, pool.evictions);
+            if (found != (long long)QUERIES * WIDTH) printf("ОШИБКА: найдено %lld ключей\n", found);
+            
+            buffer_pool_destroy(&pool);
+        }
+    }
+    
+    // Обновления через пул: грязные страницы пишутся при вытеснении и flush
+    struct BufferPool pool;
+    buffer_pool_init(&pool, &disk, (int)(tree_pages / 10), EVICT_CLOCK);
+    disk_reset_counters(&disk);
+    for (int i = 0; i < 20000; i++) {
+        bplus_disk_update<DiskBPlusTree>(&pool, &header, keys[i], -keys[i]);
+    }
+    long long write_backs_before_flush = pool.write_backs;
+    buffer_pool_flush(&pool);
+    int value = 0;
+    bool updated = bplus_disk_search<DiskBPlusTree>(&disk, &header, keys[0], &value) && value == -keys[0];
+    printf("\n20000 обновлений через пул (10%%): записано при вытеснении %lld, при flush %lld страниц%s\n\n",
+           write_backs_before_flush, pool.write_backs - write_backs_before_flush,
+           updated ? "" : " (ОШИБКА: обновление не попало на диск)");
+    buffer_pool_destroy(&pool);
+    
+    disk_close(&disk);
+    unlink(FILE_NAME);
+    free(results);
+    bplus_tree_free(&tree);
+    free(keys);
+}
+
+// Настенное время: ожидание диска в clock() не попадает
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Упреждающее чтение листьев на длинных диапазонах
+void benchmark_read_ahead() {
+    printf("=== Упреждающее чтение листьев (read-ahead) ===\n\n");
+    
+    // В памяти: __builtin_prefetch следующих листьев через их родителя
+    typedef CacheLineBPlusTree<int, int, 4> ScanBPlusTree;
+    const int SIZE = 2000000;
+    const int WIDTH = 200000;
+    const int QUERIES = 20;
+    int* keys = make_shuffled_keys(SIZE);
+    ScanBPlusTree tree;
+    bplus_tree_init(&tree);
+    for (int i = 0; i < SIZE; i++) bplus_insert(&tree, keys[i], keys[i]);
+    
+    printf("В памяти: %d ключей, %lld листьев, запросы по %d ключей\n", SIZE, tree.leaf_count, WIDTH);
+    printf("%-8s | %-12s | %-10s\n", "Окно", "млн кл./с", "Ускорение");
+    printf("---------|--------------|-----------\n");
+    int windows[] = {0, 1, 2, 4, 8, 16};
+    double base_rate = 0;
+    long long base_sum = 0;
+    for (int w = 0; w < 6; w++) {
+        long long sum = 0, total = 0;
+        double start = wall_seconds();
+        for (int q = 0; q < QUERIES; q++) {
+            int from = keys[q] % (SIZE - WIDTH);
+            BPlusCursor<ScanBPlusTree> c;
+            BPlusSpan<ScanBPlusTree> span;
+            bplus_cursor_seek(&tree, &c, from, from + WIDTH - 1, windows[w]);
+            while (bplus_cursor_next_n(&c, 256, &span) > 0) {
+                for (int i = 0; i < span.count; i++) sum += span.keys[i];
+                total += span.count;
+            }
+        }
+        double rate = total / (wall_seconds() - start) / 1e6;
+        if (w == 0) {
+            base_rate = rate;
+            base_sum = sum;
+        }
+        char speedup[16];
+        snprintf(speedup, sizeof(speedup), "%.2fx", rate / base_rate);
+        printf("%-8d | %-12.1f | %-10s\n", windows[w], rate, speedup);
+        if (total != (long long)QUERIES * WIDTH || sum != base_sum) {
+            printf("ОШИБКА: read-ahead изменил результат сканирования\n");
+        }
+    }
+    bplus_tree_free(&tree);
+    
+    // С диска: кэш ОС сбрасывается перед каждым запросом
+    typedef PageBPlusTree<int, int> DiskBPlusTree;
+    const char* FILE_NAME = "bplus_readahead.db";
+    const int DISK_SIZE = 1000000;
+    const int DISK_WIDTH = 100000;
+    const int DISK_QUERIES = 10;
+    free(keys);
+    keys = make_shuffled_keys(DISK_SIZE);
+    DiskBPlusTree disk_tree;
+    bplus_tree_init(&disk_tree);
+    for (int i = 0; i < DISK_SIZE; i++) bplus_insert(&disk_tree, keys[i], keys[i]);
+    
+    struct DiskSimulator disk;
+    if (!disk_open(&disk, FILE_NAME, true) || !bplus_persist(&disk_tree, &disk)) {
+        printf("ОШИБКА: не удалось записать дерево на диск\n\n");
+        bplus_tree_free(&disk_tree);
+        free(keys);
+        return;
+    }
+    struct DiskTreeHeader header;
+    bplus_disk_open<DiskBPlusTree>(&disk, &header);
+    int* results = (int*)malloc(sizeof(int) * DISK_WIDTH);
+    
+    printf("\nС диска: %d ключей, %lld страниц, запросы по %d ключей, холодный кэш ОС\n",
+           DISK_SIZE, disk.page_count, DISK_WIDTH);
+    printf("%-14s | %-6s | %-12s | %-10s | %-12s\n",
+           "Хранилище", "Окно", "млн кл./с", "мс/запр.", "чтений/запр.");
+    printf("---------------|--------|--------------|------------|-------------\n");
+    int disk_windows[] = {0, 8, 32};
+    for (int mode = 0; mode < 2; mode++) {
+        for (int w = 0; w < 3; w++) {
+            struct BufferPool pool;
+            if (mode == 1) buffer_pool_init(&pool, &disk, 1024, EVICT_LRU);
+            disk_reset_counters(&disk);
+            long long found = 0;
+            double elapsed = 0;
+            for (int q = 0; q < DISK_QUERIES; q++) {
+                int from = keys[DISK_SIZE - 1 - q] % (DISK_SIZE - DISK_WIDTH);
+                disk_drop_cache(&disk);
+                double start = wall_seconds();
+                if (mode == 0) {
+                    found += bplus_disk_range_query<DiskBPlusTree>(&disk, &header, from, from + DISK_WIDTH - 1,
+                                                                   results, DISK_WIDTH, disk_windows[w]);
+                } else {
+                    found += bplus_disk_range_query<DiskBPlusTree>(&pool, &header, from, from + DISK_WIDTH - 1,
+                                                                   results, DISK_WIDTH, disk_windows[w]);
+                }
+                elapsed += wall_seconds() - start;
+            }
+            printf("%-14s | %-6d | %-12.2f | %-10.2f | %-12.1f\n",
+                   mode == 0 ? "файл" : "пул 1024", disk_windows[w],
+                   found / elapsed / 1e6, elapsed * 1000 / DISK_QUERIES,
+                   (double)disk.file_reads / DISK_QUERIES);
+            if (found != (long long)DISK_QUERIES * DISK_WIDTH) printf("ОШИБКА: найдено %lld ключей\n", found);
+            if (mode == 1) buffer_pool_destroy(&pool);
+        }
+    }
+    printf("\n");
+    
+    disk_close(&disk);
+    unlink(FILE_NAME);
+    free(results);
+    bplus_tree_free(&disk_tree);
+    free(keys);
+}
+
+// Резидентная память процесса (RSS) в байтах
+static long long current_rss_bytes() {
+    long long pages_total = 0, pages_resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f == NULL) return 0;
+    if (fscanf(f, "%lld %lld", &pages_total, &pages_resident) != 2) pages_resident = 0;
+    fclose(f);
+    return pages_resident * sysconf(_SC_PAGESIZE);
+}
+
+// Строка отчета арены: сборка, поиск, скан, освобождение.
+// mode: 0 - malloc, 1 - арена (общие блоки), 2 - арена (листья отдельно),
+// 3 - арена + перекладка по уровням
+template <typename Tree>
+void arena_bplus_row(const char* name, int mode, const int* keys, int n) {
+    malloc_trim(0);
+    long long rss_before = current_rss_bytes();
+    clock_t start = clock();
+    Tree tree;
+    if (mode == 0) bplus_tree_init(&tree);
+    else bplus_tree_init_arena(&tree, mode == 2 ? ARENA_LEAF_CONTIGUOUS : ARENA_MIXED);
+    for (int i = 0; i < n; i++) bplus_insert(&tree, keys[i], keys[i]);
+    if (mode == 3) bplus_tree_relayout(&tree, ARENA_LEAF_CONTIGUOUS);
+    double build_ms = (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+    malloc_trim(0);  // память, освобожденную при перекладке, не считаем
+    long long rss = current_rss_bytes() - rss_before;
+    long long calls = tree.arena != NULL ? tree.arena->block_allocations : tree.node_count;
+    
+    long long found = 0;
+    start = clock();
+    for (int i = 0; i < n; i++) found += bplus_search(&tree, keys[n - 1 - i], (int*)NULL);
+    double search_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+    
+    long long sum = 0;
+    start = clock();
+    BPlusCursor<Tree> cursor;
+    BPlusSpan<Tree> span;
+    bplus_cursor_seek(&tree, &cursor, 0, n - 1);
+    while (bplus_cursor_next_n(&cursor, 256, &span) > 0) {
+        for (int i = 0; i < span.count; i++) sum += span.keys[i];
+    }
+    double scan_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+    
+    start = clock();
+    bplus_tree_free(&tree);
+    double free_ms = (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+    
+    printf("%-26s | %-10lld | %-9.1f | %-9.0f | %-9.1f | %-9.2f | %-8.2f\n",
+           name, calls, rss / 1048576.0, build_ms, search_ns, scan_ns, free_ms);
+    if (found != n || sum != (long long)n * (n - 1) / 2) printf("ОШИБКА: дерево потеряло ключи\n");
+}
+
+template <typename Tree>
+void arena_btree_row(const char* name, int mode, const int* keys, int n) {
+    malloc_trim(0);
+    long long rss_before = current_rss_bytes();
+    clock_t start = clock();
+    Tree tree;
+    if (mode == 0) btree_tree_init(&tree);
+    else btree_tree_init_arena(&tree, mode == 2 ? ARENA_LEAF_CONTIGUOUS : ARENA_MIXED);
+    for (int i = 0; i < n; i++) btree_insert(&tree, keys[i], keys[i]);
+    if (mode == 3) btree_tree_relayout(&tree, ARENA_LEAF_CONTIGUOUS);
+    double build_ms = (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+    malloc_trim(0);  // память, освобожденную при перекладке, не считаем
+    long long rss = current_rss_bytes() - rss_before;
+    long long calls = tree.arena != NULL ? tree.arena->block_allocations : tree.node_count;
+    
+    long long found = 0;
+    start = clock();
+    for (int i = 0; i < n; i++) found += btree_search(&tree, keys[n - 1 - i], (int*)NULL);
+    double search_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+    
+    long long sum = 0;
+    start = clock();
+    BTreeCursor<Tree> cursor;
+    BTreeSpan<Tree> span;
+    btree_cursor_seek(&tree, &cursor, 0, n - 1);
+    while (btree_cursor_next_n(&cursor, 256, &span) > 0) {
+        for (int i = 0; i < span.count; i++) sum += span.keys[i];
+    }
+    double scan_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+    
+    start = clock();
+    btree_tree_free(&tree);
+    double free_ms = (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+    
+    printf("%-26s | %-10lld | %-9.1f | %-9.0f | %-9.1f | %-9.2f | %-8.2f\n",
+           name, calls, rss / 1048576.0, build_ms, search_ns, scan_ns, free_ms);
+    if (found != n || sum != (long long)n * (n - 1) / 2) printf("ОШИБКА: дерево потеряло ключи\n");
+}
+
+// Арена узлов против отдельного malloc на каждый узел
+void benchmark_node_arena() {
+    printf("=== Арена узлов против malloc ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> ArenaBPlusTree;
+    typedef CacheLineBTree<int, int, 4> ArenaBTree;
+    const int SIZE = 2000000;
+    int* keys = make_shuffled_keys(SIZE);
+    
+    printf("%d случайных вставок, узел %zu байт (B+) / %zu байт (B)\n",
+           SIZE, sizeof(ArenaBPlusTree::Node), sizeof(ArenaBTree::Node));
+    printf("Вызовов - обращений к системному аллокатору, RSS - прирост после сборки\n\n");
+    printf("%-26s | %-10s | %-9s | %-9s | %-9s | %-9s | %-8s\n",
+           "Вариант", "Вызовов", "RSS, МБ", "Сборка,мс", "Поиск, нс", "Скан,нс/кл", "free, мс");
+    printf("---------------------------|------------|-----------|-----------|-----------|-----------|---------\n");
+    arena_bplus_row<ArenaBPlusTree>("B+ malloc", 0, keys, SIZE);
+    arena_bplus_row<ArenaBPlusTree>("B+ арена", 1, keys, SIZE);
+    arena_bplus_row<ArenaBPlusTree>("B+ арена, листья отдельно", 2, keys, SIZE);
+    arena_bplus_row<ArenaBPlusTree>("B+ арена + по уровням", 3, keys, SIZE);
+    arena_btree_row<ArenaBTree>("B malloc", 0, keys, SIZE);
+    arena_btree_row<ArenaBTree>("B арена", 1, keys, SIZE);
+    arena_btree_row<ArenaBTree>("B арена + по уровням", 3, keys, SIZE);
+    
+    // Пакетная загрузка в арену: листья одной серией в порядке ключей
+    int* sorted_keys = (int*)malloc(sizeof(int) * SIZE);
+    for (int i = 0; i < SIZE; i++) sorted_keys[i] = i;
+    ArenaBPlusTree bulk;
+    bplus_bulk_load(&bulk, sorted_keys, NULL, SIZE, 1.0, true);
+    printf("\nbulk load в арену: %lld узлов, %lld блоков по %d узлов\n\n",
+           bulk.node_count, bulk.arena->block_allocations, bulk.arena->nodes_per_block);
+    bplus_tree_free(&bulk);
+    
+    free(sorted_keys);
+    free(keys);
+}
+
+// ==================== ПАРАЛЛЕЛЬНЫЙ ДОСТУП ====================
+
+typedef CacheLineOlcBPlusTree<int, int, 4> SharedOlcTree;
+typedef CacheLineBPlusTree<int, int, 4> SharedLockedTree;
+
+// Задание одного потока: смесь поиска, коротких диапазонов и вставок.
+// В дереве заранее лежат четные ключи; вставляются нечетные.
+struct ConcurrentWorker {
+    SharedOlcTree* olc_tree;        // NULL - работаем с locked_tree под мьютексом
+    SharedLockedTree* locked_tree;
+    std::mutex* lock;
+    int preload;
+    long long ops;
+    unsigned long long seed;
+    long long inserted;             // вставок новых ключей
+    long long checksum;
+    long long violations;           // несогласованных результатов диапазона
+};
+
+static unsigned int concurrent_next(unsigned long long* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (unsigned int)(*state >> 16);
+}
+
+static void concurrent_worker_run(ConcurrentWorker* w) {
+    unsigned long long state = w->seed;
+    int keys[100];
+    for (long long i = 0; i < w->ops; i++) {
+        unsigned int r = concurrent_next(&state);
+        int kind = r % 100;
+        int key = 2 * (int)(concurrent_next(&state) % w->preload);
+        if (kind < 70) {
+            int value = 0;
+            if (w->olc_tree != NULL) {
+                w->checksum += olc_bplus_search(w->olc_tree, key, &value);
+            } else {
+                std::lock_guard<std::mutex> guard(*w->lock);
+                w->checksum += bplus_search(w->locked_tree, key, &value);
+            }
+        } else if (kind < 80) {
+            // Короткий диапазон: 100 четных ключей плюс вставленные между ними
+            if (w->olc_tree != NULL) {
+                long long count = olc_bplus_range_query(w->olc_tree, key, key + 199, keys, (int*)NULL, 100);
+                // Ключи строго возрастают, и ни один четный ключ не пропущен,
+                // даже если листья расщеплялись во время обхода
+                int expected_even = key;
+                for (long long j = 0; j < count; j++) {
+                    if (j > 0 && keys[j] <= keys[j - 1]) w->violations++;
+                    if (keys[j] % 2 == 0) {
+                        if (keys[j] != expected_even) w->violations++;
+                        expected_even = keys[j] + 2;
+                    }
+                }
+                w->checksum += count;
+            } else {
+                std::lock_guard<std::mutex> guard(*w->lock);
+                BPlusCursor<SharedLockedTree> cursor;
+                BPlusSpan<SharedLockedTree> span;
+                long long count = 0;
+                bplus_cursor_seek(w->locked_tree, &cursor, key, key + 199);
+                while (count < 100 && bplus_cursor_next_n(&cursor, (int)(100 - count), &span) > 0) {
+                    for (int j = 0; j < span.count; j++) keys[count + j] = span.keys[j];
+                    count += span.count;
+                }
+                bplus_cursor_close(&cursor);
+                w->checksum += count;
+            }
+        } else {
+            if (w->olc_tree != NULL) {
+                w->inserted += olc_bplus_insert(w->olc_tree, key + 1, key + 1);
+            } else {
+                std::lock_guard<std::mutex> guard(*w->lock);
+                w->inserted += bplus_insert(w->locked_tree, key + 1, key + 1);
+            }
+        }
+    }
+}
+
+// Запуск threads потоков на одном дереве; возвращает млн операций в секунду
+static double concurrent_run(SharedOlcTree* olc_tree, SharedLockedTree* locked_tree, int threads,
+                             int preload, long long total_ops, long long* inserted, long long* violations) {
+    std::mutex lock;
+    ConcurrentWorker* workers = (ConcurrentWorker*)malloc(sizeof(ConcurrentWorker) * threads);
+    std::thread* pool = new std::thread[threads];
+    for (int t = 0; t < threads; t++) {
+        workers[t].olc_tree = olc_tree;
+        workers[t].locked_tree = locked_tree;
+        workers[t].lock = &lock;
+        workers[t].preload = preload;
+        workers[t].ops = total_ops / threads;
+        workers[t].seed = 0x9E3779B97F4A7C15ULL * (t + 1);
+        workers[t].inserted = 0;
+        workers[t].checksum = 0;
+        workers[t].violations = 0;
+    }
+    double start = wall_seconds();
+    for (int t = 0; t < threads; t++) pool[t] = std::thread(concurrent_worker_run, &workers[t]);
+    for (int t = 0; t < threads; t++) pool[t].join();
+    double elapsed = wall_seconds() - start;
+    
+    *inserted = 0;
+    *violations = 0;
+    for (int t = 0; t < threads; t++) {
+        *inserted += workers[t].inserted;
+        *violations += workers[t].violations;
+    }
+    delete[] pool;
+    free(workers);
+    return (double)(total_ops / threads) * threads / elapsed / 1e6;
+}
+
+// Масштабирование по потокам: OLC-дерево против одного мьютекса на дерево
+void benchmark_concurrent_bplus() {
+    printf("=== Параллельный доступ: optimistic lock coupling ===\n\n");
+    
+    const int PRELOAD = 500000;
+    const long long TOTAL_OPS = 400000;
+    int* keys = make_shuffled_keys(PRELOAD);
+    unsigned int hardware = std::thread::hardware_concurrency();
+    printf("Аппаратных потоков: %u; %d ключей заранее, %lld операций на прогон\n",
+           hardware, PRELOAD, TOTAL_OPS);
+    printf("Смесь: 70%% поиск, 10%% диапазон 100 ключей, 20%% вставка\n\n");
+    printf("%-7s | %-14s | %-14s | %-10s | %-12s\n",
+           "Потоков", "OLC, млн оп/с", "Мьютекс, млн", "OLC/мьютекс", "Перезапусков");
+    printf("--------|----------------|----------------|------------|-------------\n");
+    
+    int max_threads = hardware > 8 ? (int)hardware : 8;
+    if (max_threads > 64) max_threads = 64;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        SharedOlcTree olc_tree;
+        olc_bplus_init(&olc_tree);
+        SharedLockedTree locked_tree;
+        bplus_tree_init(&locked_tree);
+        for (int i = 0; i < PRELOAD; i++) {
+            olc_bplus_insert(&olc_tree, 2 * keys[i], 2 * keys[i]);
+            bplus_insert(&locked_tree, 2 * keys[i], 2 * keys[i]);
+        }
+        olc_tree.restarts.store(0);
+        
+        long long olc_inserted, locked_inserted, violations, unused;
+        double olc_rate = concurrent_run(&olc_tree, NULL, threads, PRELOAD, TOTAL_OPS,
+                                         &olc_inserted, &violations);
+        double locked_rate = concurrent_run(NULL, &locked_tree, threads, PRELOAD, TOTAL_OPS,
+                                            &locked_inserted, &unused);
+        printf("%-7d | %-14.2f | %-14.2f | %-10.2f | %-12lld\n",
+               threads, olc_rate, locked_rate, olc_rate / locked_rate, olc_tree.restarts.load());
+        
+        if (!olc_bplus_check(&olc_tree) || olc_tree.key_count.load() != PRELOAD + olc_inserted) {
+            printf("ОШИБКА: OLC-дерево повреждено после %d потоков\n", threads);
+        }
+        if (violations > 0) printf("ОШИБКА: %lld несогласованных диапазонов\n", violations);
+        if (locked_tree.key_count != PRELOAD + locked_inserted) {
+            printf("ОШИБКА: дерево под мьютексом потеряло вставки\n");
+        }
+        olc_bplus_free(&olc_tree);
+        bplus_tree_free(&locked_tree);
+    }
+    printf("\n");
+    free(keys);
+}
+
+// Параллельные агрегаты по диапазону: масштабирование по числу потоков
+void benchmark_parallel_range() {
+    printf("=== Параллельные range queries с агрегатами ===\n\n");
     
-    free(bplus_root);
+    typedef PageBPlusTree<int, int> AnalyticTree;
+    const int SIZE = 10000000;
+    const int REPEATS = 5;
+    int* sorted_keys = (int*)malloc(sizeof(int) * SIZE);
+    for (int i = 0; i < SIZE; i++) sorted_keys[i] = i;
+    AnalyticTree tree;
+    bplus_bulk_load(&tree, sorted_keys, NULL, SIZE, 1.0);
+    free(sorted_keys);
+    
+    unsigned int hardware = std::thread::hardware_concurrency();
+    int max_threads = hardware > 8 ? (int)hardware : 8;
+    if (max_threads > 64) max_threads = 64;
+    printf("%d ключей, высота %d; аппаратных потоков: %u; время - среднее из %d запусков\n",
+           SIZE, tree.height, hardware, REPEATS);
+    printf("Агрегаты count/sum/min/max без выдачи записей\n\n");
+    printf("%-8s | %-7s | %-10s | %-9s | %-12s | %-9s\n",
+           "Диапазон", "Потоков", "Время, мс", "Ускорение", "млн кл./с", "Перехваты");
+    printf("---------|---------|------------|-----------|--------------|----------\n");
+    
+    int percents[] = {1, 10, 50, 100};
+    for (int p = 0; p < 4; p++) {
+        int width = (int)((long long)SIZE * percents[p] / 100);
+        int start_key = (SIZE - width) / 2;
+        int end_key = start_key + width - 1;
+        
+        double start = wall_seconds();
+        RangeAggregate<AnalyticTree> expected;
+        for (int r = 0; r < REPEATS; r++) expected = bplus_range_aggregate(&tree, start_key, end_key);
+        double serial_ms = (wall_seconds() - start) * 1000 / REPEATS;
+        char range_name[16];
+        snprintf(range_name, sizeof(range_name), "%d%%", percents[p]);
+        printf("%-8s | %-7s | %-10.2f | %-9s | %-12.1f | %-9s\n",
+               range_name, "послед.", serial_ms, "1.00x", width / serial_ms / 1000, "-");
+        
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            struct WorkPool pool;
+            work_pool_init(&pool, threads);
+            RangeAggregate<AnalyticTree> result;
+            start = wall_seconds();
+            for (int r = 0; r < REPEATS; r++) {
+                result = bplus_parallel_range_aggregate(&tree, &pool, start_key, end_key);
+            }
+            double ms = (wall_seconds() - start) * 1000 / REPEATS;
+            char speedup[16];
+            snprintf(speedup, sizeof(speedup), "%.2fx", serial_ms / ms);
+            printf("%-8s | %-7d | %-10.2f | %-9s | %-12.1f | %-9lld\n",
+                   "", threads, ms, speedup, width / ms / 1000, pool.steals.load());
+            if (result.count != expected.count || result.sum != expected.sum ||
+                result.min != expected.min || result.max != expected.max || result.count != width) {
+                printf("ОШИБКА: параллельный агрегат не совпал с последовательным\n");
+            }
+            work_pool_destroy(&pool);
+        }
+    }
+    printf("\n");
+    bplus_tree_free(&tree);
+}
+
+// Замороженное S+-дерево против изменяемого на том же наборе ключей
+void benchmark_static_tree() {
+    printf("=== Статическое S+-дерево (заморозка) против изменяемого ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> MutableTree;
+    typedef StaticBPlusTree<int, int> FrozenTree;
+    const int LOOKUPS = 1000000;
+    const int QUERIES = 2000;
+    int sizes[] = {100000, 1000000, 10000000};
+    int widths[] = {100, 10000};
+    
+    printf("Изменяемое: ORDER=%d, вставки в случайном порядке; статическое: %d ключей в узле\n",
+           MutableTree::order, FrozenTree::block);
+    printf("Range: сумма значений диапазона (курсор next_n против отрезка массива)\n\n");
+    printf("%-9s | %-11s | %-6s | %-10s | %-13s | %-10s | %-14s | %-14s\n",
+           "Ключей", "Дерево", "Высота", "Память, МБ", "Заморозка, мс", "Поиск, нс",
+           "Range 100, нс", "Range 10000, нс");
+    printf("----------|-------------|--------|------------|---------------|------------|----------------|----------------\n");
+    
+    for (int s = 0; s < 3; s++) {
+        int size = sizes[s];
+        int* keys = make_shuffled_keys(size);
+        MutableTree tree;
+        bplus_tree_init(&tree);
+        for (int i = 0; i < size; i++) bplus_insert(&tree, keys[i], keys[i]);
+        
+        double start = wall_seconds();
+        FrozenTree frozen;
+        if (!bplus_tree_freeze(&tree, &frozen)) {
+            printf("ОШИБКА: не хватило памяти на заморозку %d ключей\n", size);
+            bplus_tree_free(&tree);
+            free(keys);
+            continue;
+        }
+        double freeze_ms = (wall_seconds() - start) * 1000;
+        
+        // Точечный поиск
+        double lookup_ns[2];
+        int found[2];
+        for (int mode = 0; mode < 2; mode++) {
+            found[mode] = 0;
+            start = wall_seconds();
+            for (int i = 0; i < LOOKUPS; i++) {
+                int key = keys[i % size];
+                if (mode == 0 ? bplus_search(&tree, key, (int*)NULL)
+                              : static_tree_search(&frozen, key, (int*)NULL)) found[mode]++;
+            }
+            lookup_ns[mode] = (wall_seconds() - start) * 1e9 / LOOKUPS;
+        }
+        
+        // Range queries
+        double range_ns[2][2];
+        long long sums[2][2];
+        for (int w = 0; w < 2; w++) {
+            for (int mode = 0; mode < 2; mode++) {
+                long long sum = 0;
+                start = wall_seconds();
+                for (int q = 0; q < QUERIES; q++) {
+                    int from = keys[q] % (size - widths[w]);
+                    int to = from + widths[w] - 1;
+                    if (mode == 0) {
+                        BPlusCursor<MutableTree> c;
+                        BPlusSpan<MutableTree> span;
+                        bplus_cursor_seek(&tree, &c, from, to);
+                        while (bplus_cursor_next_n(&c, 256, &span) > 0) {
+                            for (int i = 0; i < span.count; i++) sum += span.values[i];
+                        }
+                    } else {
+                        long long first, last;
+                        static_tree_range_bounds(&frozen, from, to, &first, &last);
+                        for (long long i = first; i < last; i++) sum += frozen.values[i];
+                    }
+                }
+                range_ns[w][mode] = (wall_seconds() - start) * 1e9 / QUERIES;
+                sums[w][mode] = sum;
+            }
+        }
+        
+        double mutable_mb = (double)tree.node_count * sizeof(MutableTree::Node) / (1024 * 1024);
+        double frozen_mb = (double)static_tree_bytes(&frozen) / (1024 * 1024);
+        char freeze_text[16];
+        snprintf(freeze_text, sizeof(freeze_text), "%.1f", freeze_ms);
+        printf("%-9d | %-11s | %-6d | %-10.1f | %-13s | %-10.1f | %-14.1f | %-14.1f\n",
+               size, "изменяемое", tree.height, mutable_mb, "-", lookup_ns[0], range_ns[0][0], range_ns[1][0]);
+        printf("%-9s | %-11s | %-6d | %-10.1f | %-13s | %-10.1f | %-14.1f | %-14.1f\n",
+               "", "статическое", frozen.height, frozen_mb, freeze_text, lookup_ns[1],
+               range_ns[0][1], range_ns[1][1]);
+        if (found[0] != LOOKUPS || found[1] != LOOKUPS) {
+            printf("ОШИБКА: найдено %d и %d из %d ключей\n", found[0], found[1], LOOKUPS);
+        }
+        if (sums[0][0] != sums[0][1] || sums[1][0] != sums[1][1]) {
+            printf("ОШИБКА: диапазоны статического дерева расходятся с изменяемым\n");
+        }
+        if (static_tree_search(&frozen, -1, (int*)NULL) || static_tree_search(&frozen, size, (int*)NULL)) {
+            printf("ОШИБКА: статическое дерево нашло отсутствующий ключ\n");
+        }
+        
+        static_tree_free(&frozen);
+        bplus_tree_free(&tree);
+        free(keys);
+    }
+    printf("\n");
+}
+
+// Сжатые листья (frame of reference + bit-packing) против обычных в файле страниц
+void benchmark_compressed_leaves() {
+    printf("=== Сжатые листья: разности от минимума листа, упакованные по битам ===\n\n");
+    
+    typedef PageBPlusTree<int, int> DiskBPlusTree;
+    const char* PLAIN_FILE = "bplus_plain.db";
+    const char* PACKED_FILE = "bplus_packed.db";
+    const int SIZE = 1000000;
+    const int LOOKUPS = 10000;
+    const int QUERIES = 100;
+    const int WIDTH = 10000;
+    const char* names[] = {"минуты", "разреженные"};
+    
+    printf("%d ключей, ORDER=%d; листья обычного дерева заполнены полностью\n", SIZE, DiskBPlusTree::order);
+    printf("Ключи: минуты - отметки времени с шагом 60, разреженные - шаг 2000 со случайным сдвигом\n\n");
+    printf("%-11s | %-15s | %-7s | %-7s | %-6s | %-9s | %-11s | %-14s | %-14s\n",
+           "Ключи", "Листья", "Листов", "Страниц", "Высота", "Байт/кл.", "Поиск, мкс",
+           "Range: чтений", "Скан, млн кл/с");
+    printf("------------|-----------------|---------|---------|--------|-----------|-------------|----------------|---------------\n");
+    
+    int* sorted = (int*)malloc(sizeof(int) * SIZE);
+    int* results = (int*)malloc(sizeof(int) * (WIDTH + 1));
+    int* probes = (int*)malloc(sizeof(int) * LOOKUPS);
+    for (int d = 0; d < 2; d++) {
+        for (int i = 0; i < SIZE; i++) {
+            sorted[i] = d == 0 ? 1700000000 + i * 60 : i * 2000 + rand() % 2000;
+        }
+        for (int i = 0; i < LOOKUPS; i++) probes[i] = sorted[rand() % SIZE];
+        DiskBPlusTree tree;
+        bplus_bulk_load(&tree, sorted, sorted, SIZE, 1.0);
+        
+        struct DiskSimulator disk;
+        bool ok = disk_open(&disk, PLAIN_FILE, true) && bplus_persist(&tree, &disk);
+        disk_close(&disk);
+        ok = ok && disk_open(&disk, PACKED_FILE, true) && bplus_persist_packed(&tree, &disk);
+        disk_close(&disk);
+        if (!ok) {
+            printf("ОШИБКА: не удалось записать деревья на диск\n");
+            bplus_tree_free(&tree);
+            continue;
+        }
+        
+        // 0 - обычные листья, 1 - сжатые с AVX2, 2 - сжатые со скалярной распаковкой
+        for (int mode = 0; mode < 3; mode++) {
+            if (mode == 2 && !simd_set_level(SIMD_SCALAR)) continue;
+            struct DiskTreeHeader header;
+            disk_open(&disk, mode == 0 ? PLAIN_FILE : PACKED_FILE, false);
+            bool opened = mode == 0 ? bplus_disk_open<DiskBPlusTree>(&disk, &header)
+                                    : bplus_packed_open<DiskBPlusTree>(&disk, &header);
+            if (!opened) {
+                printf("ОШИБКА: не удалось открыть файл дерева\n");
+                disk_close(&disk);
+                continue;
+            }
+            
+            int found = 0;
+            double start = wall_seconds();
+            for (int i = 0; i < LOOKUPS; i++) {
+                int value;
+                bool hit = mode == 0 ? bplus_disk_search<DiskBPlusTree>(&disk, &header, probes[i], &value)
+                                     : bplus_packed_search<DiskBPlusTree>(&disk, &header, probes[i], &value);
+                if (hit && value == probes[i]) found++;
+            }
+            double lookup_us = (wall_seconds() - start) * 1e6 / LOOKUPS;
+            
+            long long total = 0;
+            disk_reset_counters(&disk);
+            for (int q = 0; q < QUERIES; q++) {
+                int from = (int)((long long)q * 7919 % (SIZE - WIDTH));
+                int lo = sorted[from], hi = sorted[from + WIDTH - 1];
+                total += mode == 0 ? bplus_disk_range_query<DiskBPlusTree>(&disk, &header, lo, hi, results, WIDTH + 1)
+                                   : bplus_packed_range_query<DiskBPlusTree>(&disk, &header, lo, hi, results, WIDTH + 1);
+            }
+            double range_reads = (double)disk.read_count / QUERIES;
+            
+            // Полный скан: все листья с распаковкой
+            start = wall_seconds();
+            long long scanned = mode == 0
+                ? bplus_disk_range_query<DiskBPlusTree>(&disk, &header, sorted[0], sorted[SIZE - 1], results, 0)
+                : bplus_packed_range_query<DiskBPlusTree>(&disk, &header, sorted[0], sorted[SIZE - 1], results, 0);
+            double scan_rate = scanned / (wall_seconds() - start) / 1e6;
+            
+            const char* leaf_name = mode == 0 ? "обычные" : mode == 1 ? "сжатые AVX2" : "сжатые скаляр";
+            printf("%-11s | %-15s | %-7lld | %-7lld | %-6d | %-9.2f | %-11.2f | %-14.1f | %-14.1f\n",
+                   mode == 0 ? names[d] : "", leaf_name, header.leaf_count, header.node_count, header.height,
+                   (double)(header.node_count + 1) * DISK_PAGE_SIZE / SIZE, lookup_us, range_reads, scan_rate);
+            if (found != LOOKUPS) printf("ОШИБКА: найдено %d из %d ключей\n", found, LOOKUPS);
+            if (total != (long long)QUERIES * WIDTH || scanned != SIZE) {
+                printf("ОШИБКА: диапазоны вернули не все ключи\n");
+            }
+            disk_close(&disk);
+        }
+        simd_set_level(simd_detect());
+        bplus_tree_free(&tree);
+    }
+    printf("(чтений - симулированные disk_read на запрос из %d ключей)\n\n", WIDTH);
+    
+    unlink(PLAIN_FILE);
+    unlink(PACKED_FILE);
+    free(sorted);
+    free(results);
+    free(probes);
+}
+
+// B+-дерево с обновлением страниц на месте: узлы, измененные вставкой,
+// помечаются грязными и пишутся по разу на каждой контрольной точке.
+// При сплите помечается весь путь и левые соседи на нем (сплит меняет обе половины).
+template <typename Tree>
+static void bplus_mark_dirty(Tree* tree, typename Tree::Key key, long long offsets_before, unsigned char* dirty) {
+    typedef typename Tree::Node Node;
+    bool split = tree->next_node_offset != offsets_before;
+    Node* node = tree->root;
+    while (!node->is_leaf) {
+        int i = node_upper_bound(node->keys, node->key_count, key);
+        if (split) {
+            dirty[node->offset] = 1;
+            if (i > 0) dirty[((Node*)node->children[i - 1])->offset] = 1;
+        }
+        node = (Node*)node->children[i];
+    }
+    dirty[node->offset] = 1;
+    for (long long o = offsets_before; o < tree->next_node_offset; o++) dirty[o] = 1;
+}
+
+template <typename Node>
+static void bplus_checkpoint(struct DiskSimulator* disk, Node* node, unsigned char* dirty) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->key_count; i++) bplus_checkpoint(disk, (Node*)node->children[i], dirty);
+    }
+    if (dirty[node->offset]) {
+        bplus_write_node_page(disk, node);
+        dirty[node->offset] = 0;
+    }
+}
+
+// LSM-дерево (leveled и tiered) против B+-дерева на диске
+void benchmark_lsm_tree() {
+    printf("=== LSM-дерево против B+-дерева: усиление записи и чтения ===\n\n");
+    
+    typedef LsmTree<int, int> Lsm;
+    typedef PageBPlusTree<int, int> DiskBPlusTree;
+    const char* FILES[] = {"bplus_inplace.db", "lsm_leveled.db", "lsm_tiered.db"};
+    const int SIZE = 1000000;
+    const int UPDATES = SIZE / 10;
+    const int MEMTABLE = 32768;
+    const int LOOKUPS = 20000;
+    const int QUERIES = 200;
+    const int WIDTH = 1000;
+    
+    // Четные ключи вставляются, нечетные - заведомые промахи
+    int* keys = make_shuffled_keys(SIZE);
+    int* results = (int*)malloc(sizeof(int) * WIDTH);
+    printf("%d вставок в случайном порядке + %d перезаписей; memtable и контрольная точка B+ - каждые %d записей\n",
+           SIZE, UPDATES, MEMTABLE);
+    printf("LSM: страница прогона - %d записей, фильтр Блума %d бит/ключ; B+: ORDER=%d, страница на узел\n\n",
+           Lsm::page_capacity, LSM_BLOOM_BITS_PER_KEY, DiskBPlusTree::order);
+    printf("%-14s | %-12s | %-12s | %-15s | %-8s | %-7s\n",
+           "Движок", "Запись, мкс", "Записано, МБ", "Усиление записи", "Прогонов", "Слияний");
+    printf("---------------|--------------|--------------|-----------------|----------|--------\n");
+    
+    double read_stats[3][6];
+    bool ok = true;
+    for (int engine = 0; engine < 3; engine++) {
+        struct DiskSimulator disk;
+        if (!disk_open(&disk, FILES[engine], true)) {
+            printf("ОШИБКА: не удалось открыть %s\n", FILES[engine]);
+            ok = false;
+            break;
+        }
+        Lsm lsm;
+        DiskBPlusTree bplus;
+        unsigned char* dirty = NULL;
+        if (engine == 0) {
+            bplus_tree_init(&bplus);
+            dirty = (unsigned char*)calloc(SIZE, 1);
+        } else {
+            lsm_tree_init(&lsm, &disk, MEMTABLE, engine == 1 ? LSM_LEVELED : LSM_TIERED);
+        }
+        
+        // Запись: вставки, затем перезапись первых UPDATES ключей значением key + 1
+        double start = wall_seconds();
+        for (int i = 0; i < SIZE + UPDATES; i++) {
+            int key = keys[i % SIZE] * 2;
+            int value = i < SIZE ? key : key + 1;
+            if (engine == 0) {
+                long long offsets_before = bplus.next_node_offset;
+                bplus_insert(&bplus, key, value);
+                bplus_mark_dirty(&bplus, key, offsets_before, dirty);
+                if ((i + 1) % MEMTABLE == 0) bplus_checkpoint(&disk, bplus.root, dirty);
+            } else {
+                lsm_insert(&lsm, key, value);
+            }
+        }
+        double write_us = (wall_seconds() - start) * 1e6 / (SIZE + UPDATES);
+        double user_bytes = (double)(SIZE + UPDATES) * (sizeof(int) + sizeof(int));
+        
+        const char* name = engine == 0 ? "B+ на месте" : engine == 1 ? "LSM leveled" : "LSM tiered";
+        char runs[16], merges[16];
+        snprintf(runs, sizeof(runs), "%d", engine == 0 ? 0 : lsm_run_count(&lsm));
+        snprintf(merges, sizeof(merges), "%lld", engine == 0 ? 0 : lsm.compactions);
+        printf("%-14s | %-12.2f | %-12.1f | %-15.2f | %-8s | %-7s\n", name, write_us,
+               disk.bytes_written / (1024.0 * 1024), disk.bytes_written / user_bytes,
+               engine == 0 ? "-" : runs, engine == 0 ? "-" : merges);
+        
+        // Чтение: B+ - с диска после полной записи, LSM - memtable + прогоны
+        struct DiskTreeHeader header;
+        if (engine == 0) {
+            bplus_checkpoint(&disk, bplus.root, dirty);
+            disk_close(&disk);
+            ok = disk_open(&disk, FILES[0], true) && bplus_persist(&bplus, &disk) &&
+                 bplus_disk_open<DiskBPlusTree>(&disk, &header);
+        }
+        int found = 0, false_hits = 0;
+        long long range_total = 0;
+        for (int phase = 0; phase < 3; phase++) {
+            disk_reset_counters(&disk);
+            start = wall_seconds();
+            int ops = phase == 2 ? QUERIES : LOOKUPS;
+            for (int q = 0; q < ops; q++) {
+                int key = keys[(q * 7919) % SIZE] * 2 + (phase == 1 ? 1 : 0);
+                int value = 0;
+                if (phase < 2) {
+                    bool hit = engine == 0 ? bplus_disk_search<DiskBPlusTree>(&disk, &header, key, &value)
+                                           : lsm_search(&lsm, key, &value);
+                    if (phase == 0 && hit) found++;
+                    if (phase == 1 && hit) false_hits++;
+                } else {
+                    int from = (key / 2) % (SIZE - WIDTH) * 2;
+                    range_total += engine == 0
+                        ? bplus_disk_range_query<DiskBPlusTree>(&disk, &header, from, from + 2 * WIDTH - 1, results, WIDTH)
+                        : lsm_range_query(&lsm, from, from + 2 * WIDTH - 1, results, WIDTH);
+                }
+            }
+            read_stats[engine][phase * 2] = (wall_seconds() - start) * 1e6 / ops;
+            read_stats[engine][phase * 2 + 1] = (double)disk.read_count / ops;
+        }
+        if (found != LOOKUPS || false_hits != 0 || range_total != (long long)QUERIES * WIDTH) {
+            printf("ОШИБКА: %s вернул неверные результаты (найдено %d из %d, ложных %d)\n",
+                   name, found, LOOKUPS, false_hits);
+        }
+        
+        // Каждый ключ - последняя записанная версия
+        int wrong = 0;
+        for (int i = 0; i < SIZE; i += 97) {
+            int key = keys[i] * 2, value = -1;
+            if (engine == 0) bplus_search(&bplus, key, &value);
+            else lsm_search(&lsm, key, &value);
+            if (value != (i < UPDATES ? key + 1 : key)) wrong++;
+        }
+        if (wrong > 0) printf("ОШИБКА: %s вернул %d устаревших значений\n", name, wrong);
+        
+        if (engine == 0) {
+            bplus_tree_free(&bplus);
+            free(dirty);
+        } else {
+            lsm_tree_free(&lsm);
+        }
+        disk_close(&disk);
+        unlink(FILES[engine]);
+    }
+    
+    if (ok) {
+        printf("\n%-14s | %-11s | %-13s | %-11s | %-14s | %-14s | %-13s\n",
+               "Движок", "Поиск, мкс", "Чтений/поиск", "Промах, мкс", "Чтений/промах",
+               "Range, мкс", "Чтений/range");
+        printf("---------------|-------------|---------------|-------------|----------------|----------------|--------------\n");
+        const char* names[] = {"B+ на месте", "LSM leveled", "LSM tiered"};
+        for (int engine = 0; engine < 3; engine++) {
+            double* r = read_stats[engine];
+            printf("%-14s | %-11.2f | %-13.2f | %-11.2f | %-14.2f | %-14.1f | %-13.1f\n",
+                   names[engine], r[0], r[1], r[2], r[3], r[4], r[5]);
+        }
+    }
+    printf("(усиление записи = байт, записанных в файл страниц / байт ключей и значений; range - %d ключей)\n\n",
+           WIDTH);
+    
+    free(results);
+    free(keys);
+}
+
+// Журнал с групповой фиксацией: пропускная способность, задержка и проверка kill -9
+typedef PageBPlusTree<int, int> WalTree;
+
+struct WalWorker {
+    DurableBPlusTree<WalTree>* db;
+    int first_key;
+    int count;
+    double* latencies_us;
+    bool ok;
+};
+
+static void wal_worker_run(WalWorker* w) {
+    w->ok = true;
+    for (int i = 0; i < w->count; i++) {
+        double start = wall_seconds();
+        if (!durable_bplus_insert(w->db, w->first_key + i, w->first_key + i)) w->ok = false;
+        w->latencies_us[i] = (wall_seconds() - start) * 1e6;
+    }
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+void benchmark_wal() {
+    printf("=== Журнал упреждающей записи с групповой фиксацией ===\n\n");
+    
+    const char* TREE_FILE = "wal_tree.db";
+    const char* WAL_FILE = "wal_tree.log";
+    const int OPS = 4000;
+    struct WalConfig {
+        WalSyncPolicy policy;
+        int threads;
+        int group_size;
+        int group_wait_us;
+    } configs[] = {
+        {WAL_SYNC_NONE, 1, 1, 0},
+        {WAL_SYNC_FDATASYNC, 1, 1, 0},
+        {WAL_SYNC_FSYNC, 1, 1, 0},
+        {WAL_SYNC_FDATASYNC, 16, 1, 0},
+        {WAL_SYNC_FDATASYNC, 16, 8, 200},
+        {WAL_SYNC_FDATASYNC, 16, 16, 500},
+        {WAL_SYNC_FSYNC, 16, 16, 500},
+    };
+    int config_count = sizeof(configs) / sizeof(configs[0]);
+    
+    printf("%d вставок на конфигурацию; вставка подтверждается после сброса ее записи журнала\n", OPS);
+    printf("Группа: сколько записей лидер ждет перед sync (и сколько мкс готов ждать)\n\n");
+    printf("%-10s | %-7s | %-12s | %-11s | %-9s | %-9s | %-6s | %-13s\n",
+           "Sync", "Потоков", "Группа", "Вставок/с", "p50, мкс", "p99, мкс", "Sync", "Записей/sync");
+    printf("-----------|---------|--------------|-------------|-----------|-----------|--------|--------------\n");
+    
+    double* latencies = (double*)malloc(sizeof(double) * OPS);
+    for (int c = 0; c < config_count; c++) {
+        struct WalConfig* config = &configs[c];
+        unlink(TREE_FILE);
+        unlink(WAL_FILE);
+        DurableBPlusTree<WalTree> db;
+        if (!durable_bplus_open(&db, TREE_FILE, WAL_FILE, config->policy, config->group_size, config->group_wait_us)) {
+            printf("ОШИБКА: не удалось открыть журнал\n");
+            break;
+        }
+        
+        WalWorker workers[16];
+        std::thread threads[16];
+        double start = wall_seconds();
+        for (int t = 0; t < config->threads; t++) {
+            int first = (int)((long long)OPS * t / config->threads);
+            int last = (int)((long long)OPS * (t + 1) / config->threads);
+            workers[t].db = &db;
+            workers[t].first_key = first;
+            workers[t].count = last - first;
+            workers[t].latencies_us = latencies + first;
+            threads[t] = std::thread(wal_worker_run, &workers[t]);
+        }
+        bool ok = true;
+        for (int t = 0; t < config->threads; t++) {
+            threads[t].join();
+            ok = ok && workers[t].ok;
+        }
+        double seconds = wall_seconds() - start;
+        long long syncs = db.wal.syncs;
+        durable_bplus_close(&db);
+        
+        qsort(latencies, OPS, sizeof(double), compare_doubles);
+        char group[32];
+        if (config->group_size > 1) snprintf(group, sizeof(group), "%d (%d мкс)", config->group_size, config->group_wait_us);
+        else snprintf(group, sizeof(group), "1");
+        printf("%-10s | %-7d | %-12s | %-11.0f | %-9.1f | %-9.1f | %-6lld | %-13.1f\n",
+               wal_sync_policy_name(config->policy), config->threads, group, OPS / seconds,
+               latencies[OPS / 2], latencies[OPS * 99 / 100], syncs, syncs > 0 ? (double)OPS / syncs : 0.0);
+        
+        // Повторное открытие: все вставки восстанавливаются проигрышем журнала
+        bool recovered = ok && durable_bplus_open(&db, TREE_FILE, WAL_FILE, config->policy);
+        if (recovered) {
+            recovered = db.replayed == OPS && db.tree.key_count == OPS;
+            durable_bplus_close(&db);
+        }
+        if (!recovered) printf("ОШИБКА: после повторного открытия восстановлены не все вставки\n");
+    }
+    free(latencies);
+    
+    // Проверка долговечности: дочерний процесс вставляет и сообщает о каждой
+    // подтвержденной вставке, на полпути делает контрольную точку и получает SIGKILL
+    const int CHECKPOINT_AT = 1500;
+    const int KILL_AFTER = 3000;
+    unlink(TREE_FILE);
+    unlink(WAL_FILE);
+    int fds[2];
+    if (pipe(fds) != 0) {
+        printf("ОШИБКА: pipe\n\n");
+        return;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        DurableBPlusTree<WalTree> db;
+        if (!durable_bplus_open(&db, TREE_FILE, WAL_FILE, WAL_SYNC_FDATASYNC)) _exit(1);
+        for (int i = 0; ; i++) {
+            if (!durable_bplus_insert(&db, i, i * 3)) _exit(1);
+            if (write(fds[1], &i, sizeof(i)) != sizeof(i)) _exit(1);
+            if (i == CHECKPOINT_AT && !durable_bplus_checkpoint(&db)) _exit(1);
+        }
+    }
+    close(fds[1]);
+    int acked = 0, last;
+    while (acked < KILL_AFTER && read(fds[0], &last, sizeof(last)) == sizeof(last)) acked = last + 1;
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    while (read(fds[0], &last, sizeof(last)) == sizeof(last)) acked = last + 1;
+    close(fds[0]);
+    
+    // Оборванная запись в хвосте журнала, как при падении посреди write()
+    int wal_fd = open(WAL_FILE, O_WRONLY | O_APPEND);
+    if (wal_fd >= 0) {
+        const char torn[] = "\x07\x00\x00\x00\x10";
+        if (write(wal_fd, torn, sizeof(torn) - 1) < 0) printf("ОШИБКА: не удалось дописать хвост журнала\n");
+        close(wal_fd);
+    }
+    
+    DurableBPlusTree<WalTree> db;
+    if (!durable_bplus_open(&db, TREE_FILE, WAL_FILE, WAL_SYNC_FDATASYNC)) {
+        printf("ОШИБКА: восстановление после SIGKILL не удалось\n\n");
+    } else {
+        int lost = 0;
+        for (int i = 0; i < acked; i++) {
+            int value;
+            if (!bplus_search(&db.tree, i, &value) || value != i * 3) lost++;
+        }
+        printf("\nkill -9 после %d подтвержденных вставок (контрольная точка на %d):\n", acked, CHECKPOINT_AT + 1);
+        printf("  из контрольной точки %lld, проиграно из журнала %lld, потеряно подтвержденных %d\n",
+               db.tree.key_count - db.replayed, db.replayed, lost);
+        if (lost > 0) printf("ОШИБКА: потеряны подтвержденные вставки\n");
+        durable_bplus_close(&db);
+    }
+    printf("(SIGKILL проверяет журнал и проигрыш; сбой питания он не имитирует - для этого и нужен sync)\n\n");
+    unlink(TREE_FILE);
+    unlink(WAL_FILE);
+}
+
+// ==================== COPY-ON-WRITE: СНИМКИ ПРОТИВ БЛОКИРОВКИ ====================
+
+typedef CacheLineCowBPlusTree<int, int, 4> SnapshotCowTree;
+
+// Четные ключи загружены заранее; писатель добавляет нечетные парами
+// 4m + 1 и 4m + 3 одним пакетом (или под одной блокировкой). Снимок
+// согласован, если в окне [4a, 4b + 3] все четные ключи на месте и пары не разорваны.
+struct SnapshotReader {
+    SnapshotCowTree* cow_tree;      // NULL - читаем locked_tree под rwlock
+    SharedLockedTree* locked_tree;
+    std::shared_mutex* lock;
+    int slot;                       // слот эпохи в cow_tree
+    int preload;
+    int scans;
+    int scan_keys;                  // четных ключей в окне скана
+    int lookups_per_scan;
+    unsigned long long seed;
+    int* buffer;
+    double* lookup_us;
+    double* scan_us;
+    long long violations;
+};
+
+struct SnapshotWriter {
+    SnapshotCowTree* cow_tree;
+    SharedLockedTree* locked_tree;
+    std::shared_mutex* lock;
+    int preload;
+    std::atomic<bool>* stop;
+    unsigned long long seed;
+    long long batches;
+};
+
+static long long snapshot_scan(SnapshotReader* r, int start, int end) {
+    if (r->cow_tree != NULL) {
+        CowSnapshot<SnapshotCowTree> snapshot;
+        cow_bplus_snapshot_begin(r->cow_tree, r->slot, &snapshot);
+        long long count = cow_bplus_snapshot_range(&snapshot, start, end, r->buffer, (int*)NULL,
+                                                   2LL * r->scan_keys);
+        cow_bplus_snapshot_end(&snapshot);
+        return count;
+    }
+    std::shared_lock<std::shared_mutex> guard(*r->lock);
+    BPlusCursor<SharedLockedTree> cursor;
+    BPlusSpan<SharedLockedTree> span;
+    long long count = 0;
+    bplus_cursor_seek(r->locked_tree, &cursor, start, end);
+    while (bplus_cursor_next_n(&cursor, (int)(2LL * r->scan_keys - count), &span) > 0) {
+        memcpy(r->buffer + count, span.keys, sizeof(int) * span.count);
+        count += span.count;
+    }
+    bplus_cursor_close(&cursor);
+    return count;
+}
+
+static void snapshot_reader_run(SnapshotReader* r) {
+    unsigned long long state = r->seed;
+    for (int s = 0; s < r->scans; s++) {
+        int start = 4 * (int)(concurrent_next(&state) % (r->preload / 2 - r->scan_keys / 2));
+        double begin = wall_seconds();
+        long long count = snapshot_scan(r, start, start + 2 * r->scan_keys - 1);
+        r->scan_us[s] = (wall_seconds() - begin) * 1e6;
+        
+        long long evens = 0;
+        for (long long j = 0; j < count; j++) {
+            int key = r->buffer[j];
+            if (j > 0 && key <= r->buffer[j - 1]) r->violations++;
+            if (key % 2 == 0) evens++;
+            else if (key % 4 == 1 && (j + 2 >= count || r->buffer[j + 2] != key + 2)) r->violations++;
+            else if (key % 4 == 3 && (j < 2 || r->buffer[j - 2] != key - 2)) r->violations++;
+        }
+        if (evens != r->scan_keys) r->violations++;
+        
+        for (int i = 0; i < r->lookups_per_scan; i++) {
+            int key = 2 * (int)(concurrent_next(&state) % r->preload);
+            int value = -1;
+            bool found;
+            begin = wall_seconds();
+            if (r->cow_tree != NULL) {
+                found = cow_bplus_search(r->cow_tree, r->slot, key, &value);
+            } else {
+                std::shared_lock<std::shared_mutex> guard(*r->lock);
+                found = bplus_search(r->locked_tree, key, &value);
+            }
+            r->lookup_us[s * r->lookups_per_scan + i] = (wall_seconds() - begin) * 1e6;
+            if (!found || value != key) r->violations++;
+        }
+    }
+}
+
+static void snapshot_writer_run(SnapshotWriter* w) {
+    unsigned long long state = w->seed;
+    while (!w->stop->load(std::memory_order_relaxed)) {
+        // Пакет: вставить одну пару и удалить другую (если она была)
+        int key = 4 * (int)(concurrent_next(&state) % (w->preload / 2)) + 1;
+        int gone = 4 * (int)(concurrent_next(&state) % (w->preload / 2)) + 1;
+        if (w->cow_tree != NULL) {
+            cow_bplus_batch_begin(w->cow_tree);
+            cow_bplus_batch_insert(w->cow_tree, key, key);
+            cow_bplus_batch_insert(w->cow_tree, key + 2, key + 2);
+            if (gone != key) {
+                cow_bplus_batch_delete(w->cow_tree, gone);
+                cow_bplus_batch_delete(w->cow_tree, gone + 2);
+            }
+            cow_bplus_batch_commit(w->cow_tree);
+        } else {
+            std::unique_lock<std::shared_mutex> guard(*w->lock);
+            bplus_insert(w->locked_tree, key, key);
+            bplus_insert(w->locked_tree, key + 2, key + 2);
+            if (gone != key) {
+                bplus_delete(w->locked_tree, gone);
+                bplus_delete(w->locked_tree, gone + 2);
+            }
+        }
+        w->batches++;
+    }
+}
+
+// Читатели сканируют и ищут, пока писатель (если есть) вставляет пары.
+// Латентности всех читателей сливаются в lookup_us / scan_us.
+static double snapshot_run(SnapshotCowTree* cow_tree, SharedLockedTree* locked_tree, bool with_writer,
+                           int readers, int preload, int scans, int scan_keys, int lookups_per_scan,
+                           double* lookup_us, double* scan_us, long long* batches, long long* violations) {
+    std::shared_mutex lock;
+    std::atomic<bool> stop(false);
+    SnapshotReader* workers = (SnapshotReader*)malloc(sizeof(SnapshotReader) * readers);
+    std::thread* pool = new std::thread[readers];
+    for (int t = 0; t < readers; t++) {
+        workers[t].cow_tree = cow_tree;
+        workers[t].locked_tree = locked_tree;
+        workers[t].lock = &lock;
+        workers[t].preload = preload;
+        workers[t].scans = scans;
+        workers[t].scan_keys = scan_keys;
+        workers[t].lookups_per_scan = lookups_per_scan;
+        workers[t].seed = 0x9E3779B97F4A7C15ULL * (t + 1);
+        workers[t].buffer = (int*)malloc(sizeof(int) * 2 * scan_keys);
+        workers[t].lookup_us = lookup_us + (long long)t * scans * lookups_per_scan;
+        workers[t].scan_us = scan_us + (long long)t * scans;
+        workers[t].violations = 0;
+        workers[t].slot = cow_tree != NULL ? cow_bplus_reader_register(cow_tree) : -1;
+    }
+    SnapshotWriter writer = {cow_tree, locked_tree, &lock, preload, &stop, 0xD1B54A32D192ED03ULL, 0};
+    
+    double start = wall_seconds();
+    std::thread writer_thread;
+    if (with_writer) writer_thread = std::thread(snapshot_writer_run, &writer);
+    for (int t = 0; t < readers; t++) pool[t] = std::thread(snapshot_reader_run, &workers[t]);
+    for (int t = 0; t < readers; t++) pool[t].join();
+    stop.store(true);
+    if (with_writer) writer_thread.join();
+    double elapsed = wall_seconds() - start;
+    
+    *violations = 0;
+    for (int t = 0; t < readers; t++) {
+        *violations += workers[t].violations;
+        if (cow_tree != NULL) cow_bplus_reader_unregister(cow_tree, workers[t].slot);
+        free(workers[t].buffer);
+    }
+    *batches = writer.batches;
+    delete[] pool;
+    free(workers);
+    return elapsed;
+}
+
+// Латентность читателей при параллельной записи: снимки copy-on-write
+// без блокировок против B+-дерева под блокировкой чтения-записи
+void benchmark_cow_snapshots() {
+    printf("=== Copy-on-write дерево: снимки без блокировок ===\n\n");
+    
+    const int PRELOAD = 1000000;
+    const int READERS = 2;
+    const int SCANS = 40;
+    const int SCAN_KEYS = 20000;
+    const int LOOKUPS = 200;
+    int* keys = make_shuffled_keys(PRELOAD);
+    
+    SnapshotCowTree cow_tree;
+    cow_bplus_init(&cow_tree);
+    cow_bplus_batch_begin(&cow_tree);
+    for (int i = 0; i < PRELOAD; i++) cow_bplus_batch_insert(&cow_tree, 2 * keys[i], 2 * keys[i]);
+    cow_bplus_batch_commit(&cow_tree);
+    SharedLockedTree locked_tree;
+    bplus_tree_init(&locked_tree);
+    for (int i = 0; i < PRELOAD; i++) bplus_insert(&locked_tree, 2 * keys[i], 2 * keys[i]);
+    free(keys);
+    
+    printf("Аппаратных потоков: %u; %d ключей, %d читателя: скан %d ключей и %d поисков по очереди, %d раз;\n",
+           std::thread::hardware_concurrency(), PRELOAD, READERS, SCAN_KEYS, LOOKUPS, SCANS);
+    printf("писатель одним пакетом вставляет пару ключей и удаляет другую, пока читатели работают\n\n");
+    printf("%-22s | %-10s | %-10s | %-10s | %-10s | %-11s | %-13s\n",
+           "Дерево", "Поиск p50", "Поиск p99", "Скан p50", "Скан p99", "Скан max", "Пакетов/с");
+    printf("%-22s | %-10s | %-10s | %-10s | %-10s | %-11s | %-13s\n",
+           "", "мкс", "мкс", "мкс", "мкс", "мкс", "писателя");
+    printf("-----------------------|------------|------------|------------|------------|-------------|--------------\n");
+    
+    long long lookup_total = (long long)READERS * SCANS * LOOKUPS;
+    long long scan_total = (long long)READERS * SCANS;
+    double* lookup_us = (double*)malloc(sizeof(double) * lookup_total);
+    double* scan_us = (double*)malloc(sizeof(double) * scan_total);
+    for (int config = 0; config < 4; config++) {
+        bool cow = config < 2;
+        bool with_writer = config % 2 == 1;
+        long long batches, violations;
+        double seconds = snapshot_run(cow ? &cow_tree : NULL, cow ? NULL : &locked_tree, with_writer,
+                                      READERS, PRELOAD, SCANS, SCAN_KEYS, LOOKUPS,
+                                      lookup_us, scan_us, &batches, &violations);
+        qsort(lookup_us, lookup_total, sizeof(double), compare_doubles);
+        qsort(scan_us, scan_total, sizeof(double), compare_doubles);
+        char name[64];
+        snprintf(name, sizeof(name), "%s%s", cow ? "COW, снимки" : "rwlock", with_writer ? " + писатель" : "");
+        char rate[32];
+        if (with_writer) snprintf(rate, sizeof(rate), "%.0f", batches / seconds);
+        else snprintf(rate, sizeof(rate), "-");
+        printf("%-22s | %-10.2f | %-10.2f | %-10.0f | %-10.0f | %-11.0f | %-13s\n",
+               name, lookup_us[lookup_total / 2], lookup_us[lookup_total * 99 / 100],
+               scan_us[scan_total / 2], scan_us[scan_total * 99 / 100], scan_us[scan_total - 1], rate);
+        if (violations > 0) printf("ОШИБКА: %lld несогласованных результатов чтения\n", violations);
+    }
+    free(lookup_us);
+    free(scan_us);
+    
+    // Читателей больше нет: все старые версии можно освободить
+    std::unique_lock<std::mutex> guard(cow_tree.writer);
+    cow_bplus_reclaim(&cow_tree);
+    guard.unlock();
+    printf("\nCOW: освобождено узлов старых версий %lld, ждут освобождения %lld, узлов в дереве %lld\n",
+           cow_tree.freed.load(), cow_bplus_retired(&cow_tree), cow_tree.node_count.load());
+    // Пары вставляются и удаляются целиком, поэтому новых ключей в каждом дереве четное число
+    if (!cow_bplus_check(&cow_tree) || (cow_tree.key_count - PRELOAD) % 2 != 0) {
+        printf("ОШИБКА: COW-дерево повреждено\n");
+    }
+    if ((locked_tree.key_count - PRELOAD) % 2 != 0) printf("ОШИБКА: дерево под rwlock потеряло вставки\n");
+    printf("\n");
+    cow_bplus_free(&cow_tree);
+    bplus_tree_free(&locked_tree);
+}
+
+// Пакетный поиск: общий спуск по отсортированным ключам и групповая
+// упреждающая выборка против поиска по одному ключу
+void benchmark_batch_lookup() {
+    printf("=== Пакетный поиск: общий спуск и групповой prefetch ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> BatchTree;
+    const int SIZE = 4000000;
+    const int PROBES = 1 << 20;
+    const int RANGE_WIDTH = 16;
+    int* keys = make_shuffled_keys(SIZE);
+    BatchTree tree;
+    bplus_tree_init(&tree);
+    for (int i = 0; i < SIZE; i++) bplus_insert(&tree, 2 * keys[i], 2 * keys[i]);
+    free(keys);
+    
+    int* probes = (int*)malloc(sizeof(int) * PROBES);
+    int* ends = (int*)malloc(sizeof(int) * PROBES);
+    int* values = (int*)malloc(sizeof(int) * PROBES);
+    bool* found = (bool*)malloc(sizeof(bool) * PROBES);
+    BPlusCursor<BatchTree>* cursors = (BPlusCursor<BatchTree>*)malloc(sizeof(BPlusCursor<BatchTree>) * 1024);
+    
+    printf("%d ключей (%d уровней), %d запросов на прогон; диапазоны по %d ключей\n",
+           SIZE, tree.height, PROBES, RANGE_WIDTH);
+    printf("Ключи пакета: по всему дереву или в окне 4 * пакет (соседние запросы делят путь).\n");
+    printf("Млн запросов/с; \"Сортировка\" - сортировка пакета и общий спуск:\n\n");
+    printf("%-10s | %-6s | %-10s | %-12s | %-11s | %-12s | %-12s\n",
+           "Ключи", "Пакет", "По одному", "Чередование", "Сортировка", "Диап. по 1", "Диап. пакет");
+    printf("-----------|--------|------------|--------------|-------------|--------------|-------------\n");
+    
+    int batch_sizes[] = {1, 4, 16, 64, 256, 1024};
+    for (int clustered = 0; clustered < 2; clustered++) {
+        for (int b = 0; b < 6; b++) {
+            int batch = batch_sizes[b];
+            // Нечетные ключи отсутствуют: попаданий около половины
+            for (int first = 0; first < PROBES; first += batch) {
+                int base = rand() % (2 * SIZE - 8 * batch);
+                for (int i = first; i < first + batch; i++) {
+                    probes[i] = clustered ? base + rand() % (4 * batch) : rand() % (2 * SIZE);
+                    ends[i] = probes[i] + 2 * RANGE_WIDTH - 1;
+                }
+            }
+            double rates[5];
+            long long checks[5];
+            for (int mode = 0; mode < 5; mode++) {
+                long long check = 0;
+                double start = wall_seconds();
+                for (int first = 0; first < PROBES; first += batch) {
+                    const int* batch_keys = probes + first;
+                    if (mode == 0) {
+                        for (int i = 0; i < batch; i++) {
+                            found[first + i] = bplus_search(&tree, batch_keys[i], &values[first + i]);
+                        }
+                    } else if (mode == 1) {
+                        bplus_search_interleaved(&tree, batch_keys, batch, values + first, found + first);
+                    } else if (mode == 2) {
+                        bplus_search_batch(&tree, batch_keys, batch, values + first, found + first);
+                    } else {
+                        if (mode == 3) {
+                            for (int i = 0; i < batch; i++) {
+                                bplus_cursor_seek(&tree, &cursors[i], batch_keys[i], ends[first + i]);
+                            }
+                        } else {
+                            bplus_cursor_seek_batch(&tree, cursors, batch_keys, ends + first, batch);
+                        }
+                        for (int i = 0; i < batch; i++) {
+                            BPlusSpan<BatchTree> span;
+                            while (bplus_cursor_next_n(&cursors[i], RANGE_WIDTH, &span) > 0) {
+                                for (int j = 0; j < span.count; j++) check += span.keys[j];
+                            }
+                        }
+                    }
+                }
+                rates[mode] = PROBES / (wall_seconds() - start) / 1e6;
+                if (mode < 3) {
+                    for (int i = 0; i < PROBES; i++) {
+                        if (found[i]) check += values[i] + 1;
+                        if (found[i] != (probes[i] % 2 == 0) || (found[i] && values[i] != probes[i])) check = -1;
+                    }
+                }
+                checks[mode] = check;
+            }
+            printf("%-10s | %-6d | %-10.2f | %-12.2f | %-11.2f | %-12.2f | %-12.2f\n",
+                   clustered ? "окно" : "все дерево", batch, rates[0], rates[1], rates[2], rates[3], rates[4]);
+            if (checks[0] < 0 || checks[1] != checks[0] || checks[2] != checks[0] || checks[4] != checks[3]) {
+                printf("ОШИБКА: пакетный поиск разошелся с поиском по одному ключу\n");
+            }
+        }
+    }
+    printf("\n");
+    
+    free(cursors);
+    free(found);
+    free(values);
+    free(ends);
+    free(probes);
+    bplus_tree_free(&tree);
+}
+
+// Скан count диапазонов по width ключей: нс на выданный ключ
+template <typename Tree>
+static double churn_bplus_scan_ns(Tree* tree, int max_key, int count, int width, long long* sum) {
+    double start = wall_seconds();
+    long long keys = 0;
+    for (int q = 0; q < count; q++) {
+        int from = (int)((long long)max_key * q / count);
+        BPlusCursor<Tree> cursor;
+        BPlusSpan<Tree> span;
+        bplus_cursor_seek(tree, &cursor, from, from + width - 1);
+        while (bplus_cursor_next_n(&cursor, 256, &span) > 0) {
+            for (int i = 0; i < span.count; i++) *sum += span.keys[i];
+            keys += span.count;
+        }
+    }
+    return (wall_seconds() - start) * 1e9 / (keys > 0 ? keys : 1);
+}
+
+template <typename Tree>
+static double churn_btree_scan_ns(Tree* tree, int max_key, int count, int width, long long* sum) {
+    double start = wall_seconds();
+    long long keys = 0;
+    for (int q = 0; q < count; q++) {
+        int from = (int)((long long)max_key * q / count);
+        BTreeCursor<Tree> cursor;
+        BTreeSpan<Tree> span;
+        btree_cursor_seek(tree, &cursor, from, from + width - 1);
+        while (btree_cursor_next_n(&cursor, 256, &span) > 0) {
+            for (int i = 0; i < span.count; i++) *sum += span.keys[i];
+            keys += span.count;
+        }
+    }
+    return (wall_seconds() - start) * 1e9 / (keys > 0 ? keys : 1);
+}
+
+// Долгая смесь вставок и удалений: заполненность, число узлов и цена
+// скана у B+-дерева без уплотнения, с онлайн-уплотнением листьев и у B-дерева
+void benchmark_delete_churn() {
+    printf("=== Удаление: заимствование, слияние и уплотнение листьев ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> ChurnBPlusTree;
+    typedef CacheLineBTree<int, int, 4> ChurnBTree;
+    const int SIZE = 500000;
+    const int ROUNDS = 10;
+    const int CHURN = SIZE / 4;        // удалений и вставок за раунд
+    const int SCANS = 200;
+    const int SCAN_WIDTH = 20000;
+    const double COMPACT_FILL = 0.9;
+    
+    int* live = make_shuffled_keys(SIZE);
+    int live_count = SIZE;
+    int next_key = SIZE;
+    double* step_us = NULL;
+    long long step_capacity = 0;
+    ChurnBPlusTree plain, compacted;
+    ChurnBTree btree;
+    bplus_tree_init(&plain);
+    bplus_tree_init(&compacted);
+    btree_tree_init(&btree);
+    for (int i = 0; i < SIZE; i++) {
+        bplus_insert(&plain, live[i], live[i]);
+        bplus_insert(&compacted, live[i], live[i]);
+        btree_insert(&btree, live[i], live[i]);
+    }
+    
+    printf("%d ключей; раунд: удалить %d случайных ключей и дописать столько же новых в конец\n",
+           SIZE, CHURN);
+    printf("Уплотнение - проход по листьям шагами (один родитель за шаг) до %.0f%% после раунда\n",
+           COMPACT_FILL * 100);
+    printf("Скан: %d диапазонов по %d значений ключа, нс на ключ\n\n", SCANS, SCAN_WIDTH);
+    printf("%-5s | %-21s | %-32s | %-21s\n", "", "B+", "B+ с уплотнением", "B");
+    printf("%-5s | %-6s %-7s %-6s | %-6s %-7s %-6s %-10s | %-6s %-7s %-6s\n",
+           "Раунд", "Запол%", "Узлов", "Скан", "Запол%", "Узлов", "Скан", "Шаг p99,мкс",
+           "Запол%", "Узлов", "Скан");
+    printf("------|-----------------------|----------------------------------|----------------------\n");
+    
+    for (int round = 0; round <= ROUNDS; round++) {
+        double step_p99 = 0;
+        long long step_count = 0;
+        if (round > 0) {
+            for (int i = 0; i < CHURN; i++) {
+                int victim = rand() % live_count;
+                int key = live[victim];
+                live[victim] = live[--live_count];
+                bool a = bplus_delete(&plain, key);
+                bool b = bplus_delete(&compacted, key);
+                bool c = btree_delete(&btree, key);
+                if (!a || !b || !c) printf("ОШИБКА: ключ %d не удален\n", key);
+            }
+            for (int i = 0; i < CHURN; i++) {
+                int key = next_key++;
+                live[live_count++] = key;
+                bplus_insert(&plain, key, key);
+                bplus_insert(&compacted, key, key);
+                btree_insert(&btree, key, key);
+            }
+            // Шаги между запросами: важна задержка одного шага, а не всего прохода
+            BPlusCompactor<ChurnBPlusTree> compactor;
+            bplus_compact_begin(&compacted, &compactor, COMPACT_FILL);
+            bool more = true;
+            while (more) {
+                double start = wall_seconds();
+                more = bplus_compact_step(&compacted, &compactor);
+                if (step_count == step_capacity) {
+                    step_capacity = step_capacity > 0 ? step_capacity * 2 : 1024;
+                    step_us = (double*)realloc(step_us, sizeof(double) * step_capacity);
+                }
+                step_us[step_count++] = (wall_seconds() - start) * 1e6;
+            }
+            qsort(step_us, step_count, sizeof(double), compare_doubles);
+            step_p99 = step_us[step_count * 99 / 100];
+        }
+        
+        long long sums[3] = {0, 0, 0};
+        double plain_ns = churn_bplus_scan_ns(&plain, next_key, SCANS, SCAN_WIDTH, &sums[0]);
+        double compacted_ns = churn_bplus_scan_ns(&compacted, next_key, SCANS, SCAN_WIDTH, &sums[1]);
+        double btree_ns = churn_btree_scan_ns(&btree, next_key, SCANS, SCAN_WIDTH, &sums[2]);
+        const int leaf_keys = ChurnBPlusTree::order - 1;
+        printf("%-5d | %-6.1f %-7lld %-6.2f | %-6.1f %-7lld %-6.2f %-11.1f | %-6.1f %-7lld %-6.2f\n",
+               round, 100.0 * plain.key_count / (plain.leaf_count * leaf_keys), plain.node_count, plain_ns,
+               100.0 * compacted.key_count / (compacted.leaf_count * leaf_keys), compacted.node_count,
+               compacted_ns, step_p99,
+               100.0 * btree.key_count / (btree.node_count * (ChurnBTree::order - 1)), btree.node_count, btree_ns);
+        if (sums[0] != sums[1] || sums[0] != sums[2]) printf("ОШИБКА: сканы деревьев разошлись\n");
+    }
+    
+    int missing = 0;
+    for (int i = 0; i < live_count; i += 97) {
+        if (!bplus_search(&plain, live[i], NULL) || !bplus_search(&compacted, live[i], NULL)
+            || !btree_search(&btree, live[i], NULL)) {
+            missing++;
+        }
+    }
+    if (missing > 0 || plain.key_count != live_count || compacted.key_count != live_count
+        || btree.key_count != live_count) {
+        printf("ОШИБКА: после смеси вставок и удалений деревья потеряли ключи\n");
+    }
+    printf("\n");
+    
+    free(step_us);
+    free(live);
+    bplus_tree_free(&plain);
+    bplus_tree_free(&compacted);
+    btree_tree_free(&btree);
+}
+
+#if TREE_STATS
+// Хук трассировки для демонстрации: самая медленная операция каждого вида
+struct StatsSlowest {
+    long long latency_ns[STAT_OP_COUNT];
+    int nodes[STAT_OP_COUNT];
+};
+
+static void stats_trace_slowest(void* context, StatOp op, long long latency_ns, int nodes) {
+    StatsSlowest* slowest = (StatsSlowest*)context;
+    if (latency_ns > slowest->latency_ns[op]) {
+        slowest->latency_ns[op] = latency_ns;
+        slowest->nodes[op] = nodes;
+    }
+}
+
+// Средний узлов на операцию range с последнего stats_reset()
+static double stats_range_nodes() {
+    StatsSnapshot snapshot;
+    stats_snapshot(&snapshot);
+    return snapshot.ops[STAT_OP_RANGE] > 0
+        ? (double)snapshot.nodes[STAT_OP_RANGE] / snapshot.ops[STAT_OP_RANGE] : -1;
+}
+#endif // TREE_STATS
+
+void benchmark_tree_stats() {
+    printf("=== Встроенная статистика: счетчики, гистограммы узлов, трассировка ===\n\n");
+    
+#if !TREE_STATS
+    printf("Сборка с TREE_STATS=0: хуки статистики удалены из кода деревьев\n\n");
+#else
+    // 1. Сценарий из README: 1000 ключей, порядок 100; оценки - прежние, до измерений
+    typedef BTree<int, int, 100> ReadmeBTree;
+    typedef BPlusTree<int, int, 100> ReadmeBPlusTree;
+    ReadmeBTree btree;
+    ReadmeBPlusTree bplus;
+    btree_tree_init(&btree);
+    bplus_tree_init(&bplus);
+    for (int key = 1; key <= 1000; key++) {
+        btree_insert(&btree, key, key);
+        bplus_insert(&bplus, key, key);
+    }
+    
+    const int ranges[3][2] = {{50, 59}, {400, 499}, {1, 500}};
+    const char* readme_btree[3] = {"~3-4", "~13-19", "~53-64"};
+    const char* readme_bplus[3] = {"~3-4", "~5-7", "~13-16"};
+    stats_enable(true);
+    printf("README: 1000 ключей 1..1000, порядок %d; высота B - %d, B+ - %d\n",
+           ReadmeBTree::order, btree.height, bplus.height);
+    printf("Узлов на запрос: измерено курсорами против прежней оценки из README\n\n");
+    printf("%-16s | %-10s | %-10s | %-10s | %-10s\n", "Запрос", "B изм.", "B оценка", "B+ изм.", "B+ оценка");
+    printf("-----------------|------------|------------|------------|-----------\n");
+    for (int q = 0; q < 3; q++) {
+        long long sums[2] = {0, 0};
+        const int* key;
+        const int* value;
+        stats_reset();
+        BTreeCursor<ReadmeBTree> btree_cursor;
+        btree_cursor_seek(&btree, &btree_cursor, ranges[q][0], ranges[q][1]);
+        while (btree_cursor_next(&btree_cursor, &key, &value)) sums[0] += *key;
+        double btree_nodes = stats_range_nodes();
+        stats_reset();
+        BPlusCursor<ReadmeBPlusTree> bplus_cursor;
+        bplus_cursor_seek(&bplus, &bplus_cursor, ranges[q][0], ranges[q][1]);
+        while (bplus_cursor_next(&bplus_cursor, &key, &value)) sums[1] += *key;
+        double bplus_nodes = stats_range_nodes();
+        char name[32];
+        snprintf(name, sizeof(name), "[%d, %d]", ranges[q][0], ranges[q][1]);
+        printf("%-16s | %-10.0f | %-10s | %-10.0f | %-10s\n",
+               name, btree_nodes, readme_btree[q], bplus_nodes, readme_bplus[q]);
+        if (sums[0] != sums[1]) printf("ОШИБКА: B и B+ вернули разные диапазоны\n");
+    }
+    printf("\n");
+    btree_tree_free(&btree);
+    bplus_tree_free(&bplus);
+    
+    // 2. Смешанная нагрузка на большом дереве: отчет целиком
+    typedef CacheLineBPlusTree<int, int, 4> StatsTree;
+    const int SIZE = 200000;
+    const int OPS = 200000;
+    int* keys = make_shuffled_keys(SIZE);
+    StatsTree tree;
+    bplus_tree_init(&tree);
+    StatsSlowest slowest;
+    memset(&slowest, 0, sizeof(slowest));
+    stats_reset();
+    stats_set_trace_hook(stats_trace_slowest, &slowest);
+    for (int i = 0; i < SIZE; i++) bplus_insert(&tree, keys[i], keys[i]);
+    long long sum = 0;
+    for (int i = 0; i < OPS; i++) {
+        int r = rand() % 100;
+        int key = keys[rand() % SIZE];
+        if (r < 70) {
+            bplus_search(&tree, key, NULL);
+        } else if (r < 85) {
+            bplus_delete(&tree, key);
+        } else if (r < 95) {
+            bplus_insert(&tree, key, key);
+        } else {
+            BPlusCursor<StatsTree> cursor;
+            const int* k;
+            const int* v;
+            bplus_cursor_seek(&tree, &cursor, key, key + 1000);
+            while (bplus_cursor_next(&cursor, &k, &v)) sum += *k;
+        }
+    }
+    stats_set_trace_hook(NULL, NULL);
+    StatsSnapshot snapshot;
+    stats_snapshot(&snapshot);
+    printf("B+ (%d байт на узел): %d вставок, затем %d операций: 70%% поиск, 15%% удаление,\n"
+           "10%% вставка, 5%% диапазон в 1000 значений ключа\n\n", (int)sizeof(StatsTree::Node), SIZE, OPS);
+    stats_print_text(stdout, &snapshot);
+    printf("\nСамые медленные из замеренных операций (хук трассировки):");
+    for (int op = 0; op < STAT_OP_COUNT; op++) {
+        if (snapshot.ops[op] > 0) {
+            printf(" %s %lld нс/%d узлов", stat_op_name(op), slowest.latency_ns[op], slowest.nodes[op]);
+        }
+    }
+    printf("\n\nJSON:\n");
+    stats_print_json(stdout, &snapshot);
+    // Узел дают расщепление и рост корня, забирают слияние и сжатие корня
+    if (snapshot.counters[STAT_SPLITS] - snapshot.counters[STAT_MERGES] + tree.height != tree.node_count) {
+        printf("ОШИБКА: счетчики расщеплений и слияний не сходятся с числом узлов\n");
+    }
+    printf("\n");
+    
+    // 3. Дерево на диске: счетчики пула и страниц против счетчиков самих структур
+    typedef PageBPlusTree<int, int> StatsDiskTree;
+    const char* FILE_NAME = "bplus_stats.db";
+    StatsDiskTree disk_tree;
+    bplus_tree_init(&disk_tree);
+    for (int i = 0; i < SIZE; i++) bplus_insert(&disk_tree, keys[i], keys[i]);
+    struct DiskSimulator disk;
+    stats_reset();
+    if (!disk_open(&disk, FILE_NAME, true) || !bplus_persist(&disk_tree, &disk)) {
+        printf("ОШИБКА: не удалось записать дерево на диск\n\n");
+    } else {
+        struct DiskTreeHeader header;
+        bplus_disk_open<StatsDiskTree>(&disk, &header);
+        struct BufferPool pool;
+        buffer_pool_init(&pool, &disk, (int)(disk.page_count / 10), EVICT_CLOCK);
+        int* results = (int*)malloc(sizeof(int) * 1000);
+        for (int q = 0; q < 1000; q++) {
+            int from = keys[q] % (SIZE - 1000);
+            bplus_disk_range_query<StatsDiskTree>(&pool, &header, from, from + 999, results, 1000);
+        }
+        stats_snapshot(&snapshot);
+        printf("На диске (%lld страниц, пул 10%%): 1000 диапазонов по 1000 ключей\n", disk.page_count);
+        printf("%-16s | %-12s | %-12s\n", "Счетчик", "Статистика", "Структура");
+        printf("-----------------|--------------|-------------\n");
+        printf("%-16s | %-12lld | %-12lld\n", "pool_hits", snapshot.counters[STAT_POOL_HITS], pool.hits);
+        printf("%-16s | %-12lld | %-12lld\n", "pool_misses", snapshot.counters[STAT_POOL_MISSES], pool.misses);
+        printf("%-16s | %-12lld | %-12lld\n", "bytes_read", snapshot.counters[STAT_BYTES_READ], disk.bytes_read);
+        printf("%-16s | %-12lld | %-12lld\n", "bytes_written", snapshot.counters[STAT_BYTES_WRITTEN],
+               disk.bytes_written);
+        if (snapshot.counters[STAT_POOL_HITS] != pool.hits || snapshot.counters[STAT_POOL_MISSES] != pool.misses
+            || snapshot.counters[STAT_BYTES_READ] != disk.bytes_read) {
+            printf("ОШИБКА: счетчики статистики разошлись со счетчиками пула и диска\n");
+        }
+        printf("\n");
+        free(results);
+        buffer_pool_destroy(&pool);
+        disk_close(&disk);
+    }
+    unlink(FILE_NAME);
+    bplus_tree_free(&disk_tree);
+    
+    // 4. Цена сбора: точечный поиск без статистики, с выборкой замеров и с замером каждой операции
+    const int LOOKUPS = 2000000;
+    const unsigned int periods[3] = {0, STAT_DEFAULT_SAMPLING, 1};
+    double base_ns = 0;
+    printf("%-28s | %-10s | %-10s\n", "Точечный поиск", "нс/поиск", "Прибавка");
+    printf("-----------------------------|------------|-----------\n");
+    for (int mode = 0; mode < 3; mode++) {
+        stats_enable(periods[mode] > 0);
+        if (periods[mode] > 0) stats_set_latency_sampling(periods[mode]);
+        int found = 0;
+        double start = wall_seconds();
+        for (int i = 0; i < LOOKUPS; i++) found += bplus_search(&tree, keys[i % SIZE], NULL);
+        double ns = (wall_seconds() - start) * 1e9 / LOOKUPS;
+        if (mode == 0) base_ns = ns;
+        char name[48];
+        if (periods[mode] == 0) snprintf(name, sizeof(name), "статистика выключена");
+        else snprintf(name, sizeof(name), "замер времени 1 из %u", periods[mode]);
+        char extra[16];
+        snprintf(extra, sizeof(extra), "%+.0f%%", 100.0 * (ns - base_ns) / base_ns);
+        printf("%-28s | %-10.1f | %-10s\n", name, ns, extra);
+        if (found == 0) printf("ОШИБКА: поиск ничего не нашел\n");
+    }
+    printf("Сборка с -DTREE_STATS=0 убирает и проверку флага\n\n");
+    
+    stats_set_latency_sampling(STAT_DEFAULT_SAMPLING);
+    stats_enable(false);
+    stats_reset();
+    free(keys);
+    bplus_tree_free(&tree);
+    (void)sum;
+#endif
+}
+
+// Строка отчета о загрузке: скорость, заполненность листьев, скан
+template <typename Tree>
+static void append_ingest_row(const char* name, Tree* tree, int n, double seconds, const BPlusAppender<Tree>* appender) {
+    const int leaf_keys = Tree::order - 1;
+    BPlusCursor<Tree> cursor;
+    const int* key;
+    const int* value;
+    long long count = 0, sum = 0;
+    int previous = -1;
+    bool ordered = true;
+    double start = wall_seconds();
+    bplus_cursor_seek(tree, &cursor, 0, n);
+    while (bplus_cursor_next(&cursor, &key, &value)) {
+        if (*key <= previous) ordered = false;
+        previous = *key;
+        sum += *value;
+        count++;
+    }
+    double scan_ns = (wall_seconds() - start) * 1e9 / (count > 0 ? count : 1);
+    char direct[16];
+    if (appender != NULL) snprintf(direct, sizeof(direct), "%.1f%%", 100.0 * appender->appended / n);
+    else snprintf(direct, sizeof(direct), "-");
+    printf("%-34s | %-10.2f | %-8.1f | %-8lld | %-6d | %-10s | %-8.2f\n",
+           name, n / seconds / 1e6, 100.0 * tree->key_count / (tree->leaf_count * leaf_keys),
+           tree->leaf_count, tree->height, direct, scan_ns);
+    if (count != n || tree->key_count != n || !ordered || sum != (long long)n * (n - 1) / 2) {
+        printf("ОШИБКА: после загрузки в дереве не те ключи\n");
+    }
+}
+
+struct IngestArrival {
+    int time;
+    int key;
+};
+
+static int compare_arrivals(const void* a, const void* b) {
+    const IngestArrival* x = (const IngestArrival*)a;
+    const IngestArrival* y = (const IngestArrival*)b;
+    if (x->time != y->time) return x->time < y->time ? -1 : 1;
+    return x->key < y->key ? -1 : (x->key > y->key ? 1 : 0);
+}
+
+void benchmark_append_ingest() {
+    printf("=== Дописывание в конец: загрузка временных меток ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> IngestTree;
+    const int SIZE = 2000000;
+    const int LATE_PERCENT = 1;       // доля меток, пришедших с опозданием
+    const int LATE_WINDOW = 1000;     // опоздание - до стольких позиций
+    
+    int* shuffled = make_shuffled_keys(SIZE);
+    int* ascending = (int*)malloc(sizeof(int) * SIZE);
+    for (int i = 0; i < SIZE; i++) ascending[i] = i;
+    // Метка i приходит в момент i, опоздавшая - на 1..LATE_WINDOW позже
+    IngestArrival* arrivals = (IngestArrival*)malloc(sizeof(IngestArrival) * SIZE);
+    for (int i = 0; i < SIZE; i++) {
+        arrivals[i].time = i + (rand() % 100 < LATE_PERCENT ? 1 + rand() % LATE_WINDOW : 0);
+        arrivals[i].key = i;
+    }
+    qsort(arrivals, SIZE, sizeof(IngestArrival), compare_arrivals);
+    int* late = (int*)malloc(sizeof(int) * SIZE);
+    for (int i = 0; i < SIZE; i++) late[i] = arrivals[i].key;
+    free(arrivals);
+    
+    printf("%d ключей, узел %d байт (порядок %d); значение = ключ\n", SIZE,
+           (int)sizeof(IngestTree::Node), IngestTree::order);
+    printf("Опоздания: %d%% меток приходят на 1..%d позиций позже своего места\n\n", LATE_PERCENT, LATE_WINDOW);
+    printf("%-34s | %-10s | %-8s | %-8s | %-6s | %-10s | %-8s\n",
+           "Загрузка", "Мключ/с", "Запол%", "Листьев", "Высота", "Без спуска", "Скан,нс");
+    printf("-----------------------------------|------------|----------|----------|--------|------------|---------\n");
+    
+    const char* names[3] = {"bplus_insert, случайный порядок", "bplus_insert, по возрастанию",
+                            "bplus_insert, с опозданиями"};
+    const int* orders[3] = {shuffled, ascending, late};
+    for (int mode = 0; mode < 3; mode++) {
+        IngestTree tree;
+        bplus_tree_init(&tree);
+        double start = wall_seconds();
+        for (int i = 0; i < SIZE; i++) bplus_insert(&tree, orders[mode][i], orders[mode][i]);
+        append_ingest_row(names[mode], &tree, SIZE, wall_seconds() - start, (BPlusAppender<IngestTree>*)NULL);
+        bplus_tree_free(&tree);
+    }
+    
+    const double fills[2] = {0.9, 1.0};
+    for (int f = 0; f < 2; f++) {
+        for (int late_keys = 0; late_keys < 2; late_keys++) {
+            const int* keys = late_keys ? late : ascending;
+            IngestTree tree;
+            BPlusAppender<IngestTree> appender;
+            bplus_tree_init(&tree);
+            double start = wall_seconds();
+            bplus_append_begin(&tree, &appender, fills[f]);
+            for (int i = 0; i < SIZE; i++) bplus_append(&tree, &appender, keys[i], keys[i]);
+            double seconds = wall_seconds() - start;
+            char name[64];
+            snprintf(name, sizeof(name), "bplus_append %.0f/%.0f, %s", fills[f] * 100, 100 - fills[f] * 100,
+                     late_keys ? "с опозданиями" : "по возрастанию");
+            append_ingest_row(name, &tree, SIZE, seconds, &appender);
+            bplus_tree_free(&tree);
+        }
+    }
+    printf("\n");
+    
+    free(shuffled);
+    free(ascending);
+    free(late);
+}
+
+// Файл индекса через mmap: старт без перестройки дерева
+void benchmark_mapped_index() {
+    printf("=== Индекс в файле через mmap: старт без перестройки ===\n\n");
+    
+    typedef CacheLineBPlusTree<int, int, 4> MutableTree;
+    typedef StaticBPlusTree<int, int> FrozenTree;
+    typedef MappedTree<int, int> MappedIndex;
+    const char* INDEX_FILE = "mapped_index.db";
+    const int LOOKUPS = 10000;
+    const int QUERIES = 200;
+    int sizes[] = {1000000, 10000000};
+    
+    printf("Перестройка: из сырых пар (ключ, 2*ключ+1) в изменяемое дерево, затем заморозка\n");
+    printf("mmap: открытие файла замороженного дерева; холодный - файл выгружен из кэша ОС\n");
+    printf("Старт - до готовности отвечать, %d поисков - сразу после первого,\n", LOOKUPS);
+    printf("в кэше ОС - доля файла в кэше сразу после старта\n\n");
+    printf("%-9s | %-20s | %-10s | %-17s | %-15s | %-13s\n",
+           "Ключей", "Старт", "Старт, мс", "Первый поиск, мкс", "10000 поисков, мс", "В кэше ОС, %");
+    printf("----------|----------------------|------------|-------------------|-----------------|--------------\n");
+    
+    for (int s = 0; s < 2; s++) {
+        int size = sizes[s];
+        int* raw = make_shuffled_keys(size);
+        int* probes = make_shuffled_keys(size);
+        
+        // Эталон и файл: один раз, как при выкладке индекса
+        FrozenTree reference;
+        MutableTree tree;
+        bplus_tree_init(&tree);
+        for (int i = 0; i < size; i++) bplus_insert(&tree, raw[i], 2 * raw[i] + 1);
+        bool frozen_ok = bplus_tree_freeze(&tree, &reference);
+        bplus_tree_free(&tree);
+        if (!frozen_ok) {
+            printf("ОШИБКА: не хватило памяти на заморозку %d ключей\n", size);
+            free(raw);
+            free(probes);
+            continue;
+        }
+        double start = wall_seconds();
+        if (!static_tree_write_file(&reference, INDEX_FILE)) {
+            printf("ОШИБКА: не удалось записать %s\n", INDEX_FILE);
+            static_tree_free(&reference);
+            free(raw);
+            free(probes);
+            continue;
+        }
+        double write_ms = (wall_seconds() - start) * 1000;
+        
+        // Полная проверка читает весь файл, после нее он целиком в кэше ОС
+        MappedIndex mapped;
+        start = wall_seconds();
+        bool verified = mapped_tree_open(&mapped, INDEX_FILE) && mapped_tree_verify(&mapped);
+        double verify_ms = (wall_seconds() - start) * 1000;
+        long long file_bytes = (long long)mapped.size;
+        mapped_tree_close(&mapped);
+        if (!verified) printf("ОШИБКА: контрольная сумма данных не сошлась\n");
+        
+        // 0, 1 - перестройка вставками и сортировкой с bulk load, 2 - теплый mmap, 3 - холодный
+        const char* names[4] = {"перестройка вставкой", "перестройка bulk", "mmap теплый", "mmap холодный"};
+        int mismatches = 0;
+        for (int mode = 0; mode < 4; mode++) {
+            FrozenTree rebuilt;
+            mapped_tree_init(&mapped);
+            if (mode == 3) mapped_file_drop_cache(INDEX_FILE);
+            
+            start = wall_seconds();
+            bool ready;
+            if (mode == 0) {
+                MutableTree fresh;
+                bplus_tree_init(&fresh);
+                for (int i = 0; i < size; i++) bplus_insert(&fresh, raw[i], 2 * raw[i] + 1);
+                ready = bplus_tree_freeze(&fresh, &rebuilt);
+                bplus_tree_free(&fresh);
+            } else if (mode == 1) {
+                int* sorted = (int*)malloc(sizeof(int) * size);
+                int* values = (int*)malloc(sizeof(int) * size);
+                memcpy(sorted, raw, sizeof(int) * size);
+                std::sort(sorted, sorted + size);
+                for (int i = 0; i < size; i++) values[i] = 2 * sorted[i] + 1;
+                MutableTree fresh;
+                bplus_bulk_load(&fresh, sorted, values, size, 1.0);
+                ready = bplus_tree_freeze(&fresh, &rebuilt);
+                bplus_tree_free(&fresh);
+                free(sorted);
+                free(values);
+            } else {
+                ready = mapped_tree_open(&mapped, INDEX_FILE);
+            }
+            double startup_ms = (wall_seconds() - start) * 1000;
+            if (!ready) {
+                printf("ОШИБКА: режим \"%s\" не смог подготовить индекс\n", names[mode]);
+                continue;
+            }
+            const FrozenTree* index = mode < 2 ? &rebuilt : &mapped.tree;
+            double resident = mode < 2 ? 100 : mapped_tree_resident(&mapped) * 100;
+            
+            int value = 0;
+            start = wall_seconds();
+            bool found = static_tree_search(index, probes[0], &value);
+            double first_us = (wall_seconds() - start) * 1e6;
+            if (!found || value != 2 * probes[0] + 1) mismatches++;
+            
+            start = wall_seconds();
+            for (int i = 1; i <= LOOKUPS; i++) {
+                int key = probes[i % size];
+                if (!static_tree_search(index, key, &value) || value != 2 * key + 1) mismatches++;
+            }
+            double lookups_ms = (wall_seconds() - start) * 1000;
+            
+            // Диапазоны и отсутствующие ключи - против эталона
+            for (int q = 0; q < QUERIES; q++) {
+                int from = probes[q] % (size - 1000);
+                long long first, last, ref_first, ref_last;
+                static_tree_range_bounds(index, from, from + 999, &first, &last);
+                static_tree_range_bounds(&reference, from, from + 999, &ref_first, &ref_last);
+                if (first != ref_first || last != ref_last) mismatches++;
+                else if (last > first && (index->keys[last - 1] != reference.keys[last - 1] ||
+                                          index->values[first] != reference.values[first])) mismatches++;
+            }
+            if (static_tree_search(index, -1, (int*)NULL) || static_tree_search(index, size, (int*)NULL)) {
+                mismatches++;
+            }
+            
+            char size_text[16], startup_text[16];
+            snprintf(size_text, sizeof(size_text), "%d", size);
+            snprintf(startup_text, sizeof(startup_text), mode < 2 ? "%.1f" : "%.3f", startup_ms);
+            printf("%-9s | %-20s | %-10s | %-17.1f | %-15.2f | %-13.0f\n",
+                   mode == 0 ? size_text : "", names[mode], startup_text,
+                   first_us, lookups_ms, resident);
+            
+            if (mode < 2) static_tree_free(&rebuilt);
+            mapped_tree_close(&mapped);
+        }
+        printf("%-9s   файл %.1f МБ, запись %.1f мс, полная проверка контрольной суммы %.1f мс\n", "",
+               (double)file_bytes / (1024 * 1024), write_ms, verify_ms);
+        
+        if (mismatches > 0) printf("ОШИБКА: %d расхождений с эталонным деревом\n", mismatches);
+        
+        // Поврежденный заголовок и чужие типы не открываются, порча данных видна проверке
+        if (s == 0) {
+            MappedTree<long long, int> wrong_type;
+            if (mapped_tree_open(&wrong_type, INDEX_FILE)) {
+                printf("ОШИБКА: файл открылся с другим типом ключа\n");
+                mapped_tree_close(&wrong_type);
+            }
+            int fd = open(INDEX_FILE, O_RDWR);
+            unsigned char byte;
+            long long data_byte = DISK_PAGE_SIZE + 100;
+            bool header_rejected = false, data_detected = false;
+            if (fd >= 0 && pread(fd, &byte, 1, 8) == 1) {
+                byte ^= 1;
+                pwrite(fd, &byte, 1, 8);
+                header_rejected = !mapped_tree_open(&mapped, INDEX_FILE);
+                mapped_tree_close(&mapped);
+                byte ^= 1;
+                pwrite(fd, &byte, 1, 8);
+            }
+            if (fd >= 0 && pread(fd, &byte, 1, data_byte) == 1) {
+                byte ^= 1;
+                pwrite(fd, &byte, 1, data_byte);
+                data_detected = mapped_tree_open(&mapped, INDEX_FILE) && !mapped_tree_verify(&mapped);
+                mapped_tree_close(&mapped);
+            }
+            if (fd >= 0) close(fd);
+            if (!header_rejected || !data_detected) {
+                printf("ОШИБКА: повреждение файла не обнаружено (заголовок: %s, данные: %s)\n",
+                       header_rejected ? "да" : "нет", data_detected ? "да" : "нет");
+            }
+        }
+        
+        unlink(INDEX_FILE);
+        static_tree_free(&reference);
+        free(raw);
+        free(probes);
+    }
+    printf("\n");
 }
 
 int main() {
@@ -327,6 +2826,26 @@ int main() {
     printf(" КЕЙС 5: B+-ДЕРЕВО - ПОЛНЫЙ АНАЛИЗ \n\n");
     
     benchmark_range_queries();           // Основной benchmark
+    benchmark_cursor_scans();            // Курсоры без копирования
+    benchmark_bulk_load();               // Пакетная загрузка
+    benchmark_order_sweep();             // Перебор порядков
+    benchmark_simd_search();             // SIMD-поиск в узле
+    benchmark_disk_storage();            // Деревья в файле страниц
+    benchmark_buffer_pool();             // Буферный пул
+    benchmark_read_ahead();              // Упреждающее чтение листьев
+    benchmark_node_arena();              // Арена узлов
+    benchmark_concurrent_bplus();        // Параллельный доступ
+    benchmark_parallel_range();          // Параллельные диапазоны
+    benchmark_static_tree();             // Замороженное S+-дерево
+    benchmark_compressed_leaves();       // Сжатые листья
+    benchmark_lsm_tree();                // LSM-дерево
+    benchmark_wal();                     // Журнал и групповая фиксация
+    benchmark_cow_snapshots();           // Copy-on-write и снимки
+    benchmark_batch_lookup();            // Пакетный поиск
+    benchmark_delete_churn();            // Удаление и уплотнение
+    benchmark_tree_stats();              // Встроенная статистика
+    benchmark_append_ingest();           // Дописывание в конец
+    benchmark_mapped_index();            // Индекс в файле через mmap
     test_structure_comparison();         // Тест 1
     test_memory_efficiency();            // Тест 2
     test_operation_performance();        // Тест 3
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+
+#include "disk.h"
+#include "static_tree.h"
+
+// Файл индекса только для чтения, открываемый через mmap.
+// Узлы BPlusNode/BTreeNode ссылаются друг на друга указателями, поэтому
+// после перезапуска дерево приходится строить заново. Замороженное
+// S+-дерево (static_tree.h) указателей не содержит: листья, значения и
+// неявный индекс - три сплошных массива, а ребенок узла вычисляется.
+// Такие массивы можно записать в файл как есть и при открытии лишь
+// направить указатели StaticBPlusTree внутрь отображения:
+//   * страница 0 - заголовок с версией, размерами типов, геометрией
+//     индекса и смещениями секций; заголовок защищен контрольной суммой;
+//   * дальше секции ключей листьев, значений и внутренних уровней, каждая
+//     с начала страницы; все ссылки - смещения от начала файла, поэтому
+//     файл не зависит от адреса, по которому он отображен.
+// Открытие - это mmap и проверка одной страницы, O(1) от размера индекса:
+// данные подгружает кэш страниц ОС по мере обращений. Порядок байтов -
+// родной для машины; на машине с другим порядком не совпадет magic.
+
+#define MAPPED_TREE_MAGIC 0x4D4D5453   // "STMM"
+#define MAPPED_TREE_VERSION 1
+
+// Тип ключа влияет на порядок сравнения, одного размера мало
+#define MAPPED_KEY_UNSIGNED 0
+#define MAPPED_KEY_SIGNED 1
+#define MAPPED_KEY_FLOAT 2
+
+struct MappedTreeHeader {
+    unsigned int magic;
+    int version;
+    int page_size;
+    int key_type;              // MAPPED_KEY_*
+    int key_size;
+    int value_size;
+    int block;                 // ключей в узле
+    int height;
+    long long count;
+    long long leaf_blocks;
+    long long index_keys;
+    long long level_offset[STATIC_TREE_MAX_HEIGHT];
+    long long keys_offset;     // смещения секций в байтах, кратны page_size
+    long long values_offset;
+    long long index_offset;
+    long long file_size;
+    unsigned int data_checksum;    // по всем секциям, см. mapped_tree_verify()
+    unsigned int header_checksum;  // по всем полям выше
+};
+
+static_assert(sizeof(MappedTreeHeader) <= DISK_PAGE_SIZE, "заголовок должен помещаться в страницу");
+
+// Отображенный индекс. tree указывает внутрь отображения - его нельзя
+// передавать в static_tree_free(), только в функции поиска.
+template <typename K, typename V>
+struct MappedTree {
+    typedef K Key;
+    typedef V Value;
+    typedef StaticBPlusTree<K, V> Static;
+
+    Static tree;
+    void* base;                // начало отображения или NULL
+    size_t size;
+};
+
+// FNV-1a, как у записей журнала (wal.h); hash - значение для продолжения
+inline unsigned int mapped_checksum(const void* data, size_t size, unsigned int hash) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+inline unsigned int mapped_header_checksum(const struct MappedTreeHeader* header) {
+    return mapped_checksum(header, offsetof(MappedTreeHeader, header_checksum), 2166136261u);
+}
+
+template <typename K>
+inline int mapped_key_type() {
+    if (std::is_floating_point<K>::value) return MAPPED_KEY_FLOAT;
+    return std::is_signed<K>::value ? MAPPED_KEY_SIGNED : MAPPED_KEY_UNSIGNED;
+}
+
+inline long long mapped_page_align(long long bytes) {
+    return (bytes + DISK_PAGE_SIZE - 1) / DISK_PAGE_SIZE * DISK_PAGE_SIZE;
+}
+
+// Размеры секций в байтах (без выравнивания)
+template <typename Static>
+inline void mapped_section_bytes(const Static* tree, long long* keys, long long* values, long long* index) {
+    *keys = (long long)sizeof(typename Static::Key) * tree->leaf_blocks * Static::block;
+    *values = (long long)sizeof(typename Static::Value) * tree->count;
+    *index = (long long)sizeof(typename Static::Key) * tree->index_keys;
+}
+
+inline bool mapped_write_all(int fd, const void* data, long long bytes, long long offset) {
+    const char* p = (const char*)data;
+    while (bytes > 0) {
+        ssize_t written = pwrite(fd, p, (size_t)bytes, (off_t)offset);
+        if (written <= 0) return false;
+        p += written;
+        offset += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+// ---------- Запись ----------
+
+// Записать замороженное дерево в файл path. Пишется во временный файл,
+// который после fdatasync переименовывается: читатели видят либо старый
+// индекс, либо новый целиком. false - ошибка ввода-вывода.
+template <typename Static>
+bool static_tree_write_file(const Static* tree, const char* path) {
+    long long key_bytes, value_bytes, index_bytes;
+    mapped_section_bytes(tree, &key_bytes, &value_bytes, &index_bytes);
+
+    struct MappedTreeHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MAPPED_TREE_MAGIC;
+    header.version = MAPPED_TREE_VERSION;
+    header.page_size = DISK_PAGE_SIZE;
+    header.key_type = mapped_key_type<typename Static::Key>();
+    header.key_size = sizeof(typename Static::Key);
+    header.value_size = sizeof(typename Static::Value);
+    header.block = Static::block;
+    header.height = tree->height;
+    header.count = tree->count;
+    header.leaf_blocks = tree->leaf_blocks;
+    header.index_keys = tree->index_keys;
+    for (int h = 1; h < tree->height; h++) header.level_offset[h] = tree->level_offset[h];
+    header.keys_offset = DISK_PAGE_SIZE;
+    header.values_offset = header.keys_offset + mapped_page_align(key_bytes);
+    header.index_offset = header.values_offset + mapped_page_align(value_bytes);
+    header.file_size = header.index_offset + mapped_page_align(index_bytes);
+    unsigned int hash = mapped_checksum(tree->keys, key_bytes, 2166136261u);
+    hash = mapped_checksum(tree->values, value_bytes, hash);
+    header.data_checksum = mapped_checksum(tree->index, index_bytes, hash);
+    header.header_checksum = mapped_header_checksum(&header);
+
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) return false;
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    alignas(CACHE_LINE_SIZE) unsigned char page[DISK_PAGE_SIZE] = {0};
+    memcpy(page, &header, sizeof(header));
+    // Хвосты секций остаются дырами и читаются нулями
+    bool ok = mapped_write_all(fd, page, DISK_PAGE_SIZE, 0) &&
+              mapped_write_all(fd, tree->keys, key_bytes, header.keys_offset) &&
+              mapped_write_all(fd, tree->values, value_bytes, header.values_offset) &&
+              mapped_write_all(fd, tree->index, index_bytes, header.index_offset) &&
+              ftruncate(fd, (off_t)header.file_size) == 0 &&
+              fdatasync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok) ok = rename(temp_path, path) == 0;
+    if (!ok) unlink(temp_path);
+    return ok;
+}
+
+// ---------- Открытие ----------
+
+template <typename Mapped>
+void mapped_tree_init(Mapped* mapped) {
+    static_tree_init(&mapped->tree);
+    mapped->base = NULL;
+    mapped->size = 0;
+}
+
+// Заголовок подходит типам дерева и согласован сам с собой: геометрия
+// индекса пересчитывается по leaf_blocks, секции лежат внутри файла
+template <typename Static>
+bool mapped_header_valid(const struct MappedTreeHeader* header, long long file_size) {
+    typedef typename Static::Key K;
+    const int B = Static::block;
+    if (header->magic != MAPPED_TREE_MAGIC || header->version != MAPPED_TREE_VERSION ||
+        header->header_checksum != mapped_header_checksum(header)) return false;
+    if (header->page_size != DISK_PAGE_SIZE || header->key_type != mapped_key_type<K>() ||
+        header->key_size != (int)sizeof(K) || header->value_size != (int)sizeof(typename Static::Value) ||
+        header->block != B || header->file_size != file_size) return false;
+    if (header->count < 0 || header->leaf_blocks != (header->count > 0 ? (header->count + B - 1) / B : 1)) {
+        return false;
+    }
+
+    Static expected;
+    long long nodes[STATIC_TREE_MAX_HEIGHT];
+    expected.leaf_blocks = header->leaf_blocks;
+    expected.count = header->count;
+    static_tree_layout(&expected, nodes);
+    if (expected.height != header->height || expected.index_keys != header->index_keys) return false;
+    for (int h = 1; h < expected.height; h++) {
+        if (expected.level_offset[h] != header->level_offset[h]) return false;
+    }
+
+    long long key_bytes, value_bytes, index_bytes;
+    mapped_section_bytes(&expected, &key_bytes, &value_bytes, &index_bytes);
+    long long offsets[3] = {header->keys_offset, header->values_offset, header->index_offset};
+    long long bytes[3] = {key_bytes, value_bytes, index_bytes};
+    for (int i = 0; i < 3; i++) {
+        if (offsets[i] < DISK_PAGE_SIZE || offsets[i] % DISK_PAGE_SIZE != 0 ||
+            offsets[i] > file_size || bytes[i] > file_size - offsets[i]) return false;
+    }
+    return true;
+}
+
+// Открыть индекс: mmap файла и проверка заголовка, данные не читаются.
+// false - файла нет, он поврежден или записан для других типов/версии.
+template <typename Mapped>
+bool mapped_tree_open(Mapped* mapped, const char* path) {
+    typedef typename Mapped::Key K;
+    typedef typename Mapped::Value V;
+    mapped_tree_init(mapped);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < DISK_PAGE_SIZE) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);   // отображение держит файл само
+    if (base == MAP_FAILED) return false;
+
+    const struct MappedTreeHeader* header = (const struct MappedTreeHeader*)base;
+    if (!mapped_header_valid<typename Mapped::Static>(header, (long long)st.st_size)) {
+        munmap(base, (size_t)st.st_size);
+        return false;
+    }
+
+    mapped->base = base;
+    mapped->size = (size_t)st.st_size;
+    typename Mapped::Static* tree = &mapped->tree;
+    tree->keys = (K*)((char*)base + header->keys_offset);
+    tree->values = (V*)((char*)base + header->values_offset);
+    tree->index = (K*)((char*)base + header->index_offset);
+    tree->count = header->count;
+    tree->leaf_blocks = header->leaf_blocks;
+    tree->height = header->height;
+    tree->index_keys = header->index_keys;
+    for (int h = 1; h < header->height; h++) tree->level_offset[h] = header->level_offset[h];
+
+    // Внутренние уровни нужны любому запросу - их стоит подкачать заранее,
+    // листья читаются вразнобой
+    long long index_bytes = (long long)sizeof(K) * header->index_keys;
+    if (index_bytes > 0) madvise((char*)base + header->index_offset, mapped_page_align(index_bytes), MADV_WILLNEED);
+    madvise((char*)base + header->keys_offset, header->index_offset - header->keys_offset, MADV_RANDOM);
+    return true;
+}
+
+template <typename Mapped>
+void mapped_tree_close(Mapped* mapped) {
+    if (mapped->base != NULL) munmap(mapped->base, mapped->size);
+    mapped_tree_init(mapped);
+}
+
+// Полная проверка данных по контрольной сумме: читает весь файл, O(n).
+// Открытие ее не делает, чтобы старт не зависел от размера индекса.
+template <typename Mapped>
+bool mapped_tree_verify(const Mapped* mapped) {
+    if (mapped->base == NULL) return false;
+    const struct MappedTreeHeader* header = (const struct MappedTreeHeader*)mapped->base;
+    long long key_bytes, value_bytes, index_bytes;
+    mapped_section_bytes(&mapped->tree, &key_bytes, &value_bytes, &index_bytes);
+    unsigned int hash = mapped_checksum(mapped->tree.keys, key_bytes, 2166136261u);
+    hash = mapped_checksum(mapped->tree.values, value_bytes, hash);
+    hash = mapped_checksum(mapped->tree.index, index_bytes, hash);
+    return hash == header->data_checksum;
+}
+
+// ---------- Поиск: прямо по отображению ----------
+
+template <typename Mapped>
+inline bool mapped_tree_search(const Mapped* mapped, typename Mapped::Key key, typename Mapped::Value* value) {
+    return static_tree_search(&mapped->tree, key, value);
+}
+
+// Range query [start_key, end_key]: отрезок [*first, *last) массивов
+// mapped->tree.keys/values, как у static_tree_range_bounds()
+template <typename Mapped>
+inline void mapped_tree_range_bounds(const Mapped* mapped, typename Mapped::Key start_key,
+                                     typename Mapped::Key end_key, long long* first, long long* last) {
+    static_tree_range_bounds(&mapped->tree, start_key, end_key, first, last);
+}
+
+// Выгрузить файл из кэша ОС (для замеров "холодного" старта), как disk_drop_cache()
+inline void mapped_file_drop_cache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Доля страниц отображения, которые сейчас в кэше ОС
+template <typename Mapped>
+double mapped_tree_resident(const Mapped* mapped) {
+    if (mapped->base == NULL) return 0;
+    size_t pages = (mapped->size + DISK_PAGE_SIZE - 1) / DISK_PAGE_SIZE;
+    unsigned char* vec = (unsigned char*)malloc(pages);
+    if (vec == NULL || mincore(mapped->base, mapped->size, vec) != 0) {
+        free(vec);
+        return 0;
+    }
+    size_t resident = 0;
+    for (size_t i = 0; i < pages; i++) resident += vec[i] & 1;
+    free(vec);
+    return (double)resident / pages;
+}
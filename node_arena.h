@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "disk.h"
+
+// Арена узлов: вместо отдельного malloc на каждый узел узлы нарезаются из
+// больших блоков, выровненных по кэш-линии. Соседние по времени создания
+// узлы лежат рядом в памяти, сплит не ходит в системный аллокатор, а
+// дерево освобождается одним node_arena_destroy() - по блоку за раз.
+
+// Размещение узлов по блокам
+enum ArenaPlacement {
+    ARENA_MIXED,            // все узлы подряд в порядке создания
+    ARENA_LEAF_CONTIGUOUS   // листья и внутренние узлы в разных блоках
+};
+
+inline const char* arena_placement_name(ArenaPlacement placement) {
+    return placement == ARENA_MIXED ? "общие блоки" : "листья отдельно";
+}
+
+// Слаб: блоки по nodes_per_block слотов одного размера
+struct NodeSlab {
+    unsigned char** blocks;
+    int block_count;
+    int block_capacity;
+    int used_in_last;         // занято слотов в последнем блоке
+    void* free_list;          // освобожденные слоты (ссылка в первых байтах слота)
+};
+
+struct NodeArena {
+    size_t slot_size;         // размер узла, округленный до кэш-линии
+    int nodes_per_block;
+    ArenaPlacement placement;
+    struct NodeSlab inner;
+    struct NodeSlab leaves;   // при ARENA_MIXED не используется
+    long long node_allocations;   // выдано узлов
+    long long block_allocations;  // обращений к системному аллокатору
+    long long bytes_reserved;
+};
+
+// Блок по умолчанию - около 1 МБ
+#define NODE_ARENA_BLOCK_BYTES (1 << 20)
+
+inline void node_slab_init(struct NodeSlab* slab) {
+    slab->blocks = NULL;
+    slab->block_count = 0;
+    slab->block_capacity = 0;
+    slab->used_in_last = 0;
+    slab->free_list = NULL;
+}
+
+// nodes_per_block = 0 - столько узлов, сколько влезает в NODE_ARENA_BLOCK_BYTES
+inline void node_arena_init(struct NodeArena* arena, size_t node_size, int nodes_per_block,
+                            ArenaPlacement placement) {
+    arena->slot_size = (node_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    if (nodes_per_block <= 0) nodes_per_block = (int)(NODE_ARENA_BLOCK_BYTES / arena->slot_size);
+    arena->nodes_per_block = nodes_per_block > 1 ? nodes_per_block : 1;
+    arena->placement = placement;
+    node_slab_init(&arena->inner);
+    node_slab_init(&arena->leaves);
+    arena->node_allocations = 0;
+    arena->block_allocations = 0;
+    arena->bytes_reserved = 0;
+}
+
+inline struct NodeSlab* node_arena_slab(struct NodeArena* arena, bool is_leaf) {
+    return (is_leaf && arena->placement == ARENA_LEAF_CONTIGUOUS) ? &arena->leaves : &arena->inner;
+}
+
+// Слот под узел; NULL - не хватило памяти
+inline void* node_arena_alloc(struct NodeArena* arena, bool is_leaf) {
+    struct NodeSlab* slab = node_arena_slab(arena, is_leaf);
+    arena->node_allocations++;
+
+    if (slab->free_list != NULL) {
+        void* slot = slab->free_list;
+        slab->free_list = *(void**)slot;
+        return slot;
+    }
+
+    if (slab->block_count == 0 || slab->used_in_last == arena->nodes_per_block) {
+        if (slab->block_count == slab->block_capacity) {
+            int capacity = slab->block_capacity > 0 ? slab->block_capacity * 2 : 16;
+            unsigned char** blocks = (unsigned char**)realloc(slab->blocks, sizeof(unsigned char*) * capacity);
+            if (blocks == NULL) return NULL;
+            slab->blocks = blocks;
+            slab->block_capacity = capacity;
+        }
+        size_t bytes = arena->slot_size * arena->nodes_per_block;
+        unsigned char* block = (unsigned char*)aligned_alloc(CACHE_LINE_SIZE, bytes);
+        if (block == NULL) return NULL;
+        slab->blocks[slab->block_count++] = block;
+        slab->used_in_last = 0;
+        arena->block_allocations++;
+        arena->bytes_reserved += bytes;
+    }
+    return slab->blocks[slab->block_count - 1] + arena->slot_size * slab->used_in_last++;
+}
+
+// Вернуть слот в арену для повторного использования
+inline void node_arena_release(struct NodeArena* arena, void* node, bool is_leaf) {
+    struct NodeSlab* slab = node_arena_slab(arena, is_leaf);
+    *(void**)node = slab->free_list;
+    slab->free_list = node;
+}
+
+inline void node_slab_destroy(struct NodeSlab* slab) {
+    for (int i = 0; i < slab->block_count; i++) free(slab->blocks[i]);
+    free(slab->blocks);
+    node_slab_init(slab);
+}
+
+// Освободить все узлы разом
+inline void node_arena_destroy(struct NodeArena* arena) {
+    node_slab_destroy(&arena->inner);
+    node_slab_destroy(&arena->leaves);
+    arena->bytes_reserved = 0;
+}
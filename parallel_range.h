@@ -0,0 +1,203 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <type_traits>
+
+#include "bplus_tree.h"
+#include "work_pool.h"
+
+// Параллельное выполнение больших range queries над B+-деревом.
+// Диапазон [start_key, end_key] режется на поддиапазоны по разделяющим
+// ключам внутренних узлов: спуск идет по уровням, пока поддиапазонов не
+// станет не меньше желаемого числа задач (или пока не дойдем до листьев).
+// Каждый поддиапазон - отдельная задача пула с перехватом; агрегаты
+// (count/sum/min/max по значениям) считаются на лету, без выдачи записей.
+
+template <typename Tree>
+struct RangeAggregate {
+    // Сумма целых значений копится в long long, остальных - в double
+    typedef typename std::conditional<std::is_integral<typename Tree::Value>::value,
+                                      long long, double>::type Sum;
+
+    long long count;
+    Sum sum;
+    typename Tree::Value min;  // определены при count > 0
+    typename Tree::Value max;
+};
+
+template <typename Tree>
+void range_aggregate_init(RangeAggregate<Tree>* agg) {
+    agg->count = 0;
+    agg->sum = 0;
+    agg->min = typename Tree::Value();
+    agg->max = typename Tree::Value();
+}
+
+template <typename Tree>
+void range_aggregate_merge(RangeAggregate<Tree>* into, const RangeAggregate<Tree>* part) {
+    if (part->count == 0) return;
+    if (into->count == 0 || part->min < into->min) into->min = part->min;
+    if (into->count == 0 || into->max < part->max) into->max = part->max;
+    into->count += part->count;
+    into->sum += part->sum;
+}
+
+// Агрегат по записям листа [from, to)
+template <typename Tree>
+inline void range_aggregate_leaf(RangeAggregate<Tree>* agg, const typename Tree::Node* leaf, int from, int to) {
+    if (from >= to) return;
+    typename RangeAggregate<Tree>::Sum sum = 0;
+    typename Tree::Value lo = leaf->data[from], hi = leaf->data[from];
+    for (int i = from; i < to; i++) {
+        typename Tree::Value v = leaf->data[i];
+        sum += v;
+        if (v < lo) lo = v;
+        if (hi < v) hi = v;
+    }
+    if (agg->count == 0 || lo < agg->min) agg->min = lo;
+    if (agg->count == 0 || agg->max < hi) agg->max = hi;
+    agg->count += to - from;
+    agg->sum += sum;
+}
+
+// Последовательный агрегат по [lo, hi): has_hi = false - до end_key включительно
+template <typename Tree>
+void bplus_range_aggregate_part(Tree* tree, typename Tree::Key lo, bool has_hi, typename Tree::Key hi,
+                                typename Tree::Key end_key, RangeAggregate<Tree>* agg) {
+    typedef typename Tree::Node Node;
+    Node* leaf = tree->root;
+    while (!leaf->is_leaf) {
+        leaf = (Node*)leaf->children[node_upper_bound(leaf->keys, leaf->key_count, lo)];
+    }
+    int pos = node_lower_bound(leaf->keys, leaf->key_count, lo);
+    while (leaf != NULL) {
+        int n = leaf->key_count;
+        int stop = has_hi ? pos + node_lower_bound(leaf->keys + pos, n - pos, hi)
+                          : pos + node_upper_bound(leaf->keys + pos, n - pos, end_key);
+        range_aggregate_leaf(agg, leaf, pos, stop);
+        if (stop < n) return;
+        leaf = leaf->next_leaf;
+        pos = 0;
+    }
+}
+
+// Последовательный вариант для сравнения
+template <typename Tree>
+RangeAggregate<Tree> bplus_range_aggregate(Tree* tree, typename Tree::Key start_key, typename Tree::Key end_key) {
+    RangeAggregate<Tree> agg;
+    range_aggregate_init(&agg);
+    if (!(end_key < start_key)) bplus_range_aggregate_part(tree, start_key, false, start_key, end_key, &agg);
+    return agg;
+}
+
+// Разделители поддиапазонов: ключи внутренних узлов из (start_key, end_key],
+// по возрастанию. Уровень за уровнем, пока их меньше target - 1.
+// Возвращает число разделителей; *out выделяется через malloc.
+template <typename Tree>
+int bplus_range_split(Tree* tree, typename Tree::Key start_key, typename Tree::Key end_key,
+                      int target, typename Tree::Key** out) {
+    typedef typename Tree::Node Node;
+    typedef typename Tree::Key Key;
+    int level_count = 1;
+    Node** level = (Node**)malloc(sizeof(Node*));
+    level[0] = tree->root;
+    Key* separators = NULL;
+    int separator_count = 0;
+
+    while (level_count > 0 && !level[0]->is_leaf) {
+        // Разделители текущего уровня внутри диапазона, слитые с разделителями
+        // верхних уровней (границами между узлами этого уровня)
+        int capacity = separator_count;
+        for (int i = 0; i < level_count; i++) capacity += level[i]->key_count;
+        Key* keys = (Key*)malloc(sizeof(Key) * (capacity > 0 ? capacity : 1));
+        int count = 0;
+        for (int i = 0; i < level_count; i++) {
+            Node* node = level[i];
+            int first = node_upper_bound(node->keys, node->key_count, start_key);
+            int last = node_upper_bound(node->keys, node->key_count, end_key);
+            for (int j = first; j < last; j++) keys[count++] = node->keys[j];
+            // После i-го узла уровня идет i-я граница сверху
+            if (i < separator_count) keys[count++] = separators[i];
+        }
+        free(separators);
+        separators = keys;
+        separator_count = count;
+        if (separator_count + 1 >= target) break;
+
+        // Следующий уровень: дети, пересекающиеся с диапазоном
+        int next_count = 0;
+        int next_capacity = level_count + separator_count + 1;
+        Node** next = (Node**)malloc(sizeof(Node*) * next_capacity);
+        for (int i = 0; i < level_count; i++) {
+            Node* node = level[i];
+            int first = node_upper_bound(node->keys, node->key_count, start_key);
+            int last = node_upper_bound(node->keys, node->key_count, end_key);
+            for (int j = first; j <= last; j++) next[next_count++] = (Node*)node->children[j];
+        }
+        free(level);
+        level = next;
+        level_count = next_count;
+    }
+    free(level);
+    *out = separators;
+    return separator_count;
+}
+
+// Контекст одного параллельного запроса
+template <typename Tree>
+struct ParallelRangeJob {
+    Tree* tree;
+    typename Tree::Key start_key;
+    typename Tree::Key end_key;
+    const typename Tree::Key* separators;
+    int separator_count;
+    RangeAggregate<Tree>* partials;   // по одному на поток, каждый на своей кэш-линии
+    size_t partial_stride;
+};
+
+// Задача task: [separators[task-1], separators[task]) с краями start/end
+template <typename Tree>
+void parallel_range_task(void* context, int task, int worker) {
+    ParallelRangeJob<Tree>* job = (ParallelRangeJob<Tree>*)context;
+    typename Tree::Key lo = task == 0 ? job->start_key : job->separators[task - 1];
+    bool has_hi = task < job->separator_count;
+    typename Tree::Key hi = has_hi ? job->separators[task] : job->end_key;
+    RangeAggregate<Tree>* agg =
+        (RangeAggregate<Tree>*)((char*)job->partials + job->partial_stride * worker);
+    bplus_range_aggregate_part(job->tree, lo, has_hi, hi, job->end_key, agg);
+}
+
+// Параллельный агрегат по [start_key, end_key]. tasks_per_thread задач на
+// поток дают пулу материал для перехвата, если поддиапазоны неравны.
+template <typename Tree>
+RangeAggregate<Tree> bplus_parallel_range_aggregate(Tree* tree, struct WorkPool* pool,
+                                                    typename Tree::Key start_key, typename Tree::Key end_key,
+                                                    int tasks_per_thread = 4) {
+    RangeAggregate<Tree> result;
+    range_aggregate_init(&result);
+    if (end_key < start_key) return result;
+
+    ParallelRangeJob<Tree> job;
+    job.tree = tree;
+    job.start_key = start_key;
+    job.end_key = end_key;
+    typename Tree::Key* separators;
+    job.separator_count = bplus_range_split(tree, start_key, end_key,
+                                            pool->threads * tasks_per_thread, &separators);
+    job.separators = separators;
+    job.partial_stride = (sizeof(RangeAggregate<Tree>) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    job.partials = (RangeAggregate<Tree>*)aligned_alloc(CACHE_LINE_SIZE, job.partial_stride * pool->threads);
+    for (int i = 0; i < pool->threads; i++) {
+        range_aggregate_init((RangeAggregate<Tree>*)((char*)job.partials + job.partial_stride * i));
+    }
+
+    work_pool_run(pool, job.separator_count + 1, parallel_range_task<Tree>, &job);
+
+    for (int i = 0; i < pool->threads; i++) {
+        range_aggregate_merge(&result, (RangeAggregate<Tree>*)((char*)job.partials + job.partial_stride * i));
+    }
+    free(job.partials);
+    free(separators);
+    return result;
+}
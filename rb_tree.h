@@ -0,0 +1,351 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "stats.h"
+
+// Красно-черное дерево (по Кормену): двоичное дерево поиска, в котором
+// ни один путь от корня до листа не длиннее другого больше чем вдвое.
+// Балансировка слабее, чем у AVL (высота до 2 log2(n)), зато вставка и
+// удаление делают не больше 2-3 поворотов. Вместо NULL у листьев - общий
+// черный узел nil, поэтому при починке не нужны проверки на NULL.
+// Нужно для сравнения с B- и B+-деревьями (см. help.cpp).
+
+template <typename K, typename V>
+struct RbNode {
+    typedef K Key;
+    typedef V Value;
+
+    K key;
+    V value;
+    bool red;
+    RbNode* left;
+    RbNode* right;
+    RbNode* parent;
+};
+
+template <typename K, typename V>
+struct RbTree {
+    typedef K Key;
+    typedef V Value;
+    typedef RbNode<K, V> Node;
+
+    Node* root;
+    Node* nil;           // общий черный лист
+    long long node_count;
+    long long key_count;
+};
+
+template <typename Tree>
+void rb_tree_init(Tree* tree) {
+    typedef typename Tree::Node Node;
+    tree->nil = (Node*)malloc(sizeof(Node));
+    tree->nil->red = false;
+    tree->nil->left = tree->nil;
+    tree->nil->right = tree->nil;
+    tree->nil->parent = tree->nil;
+    tree->root = tree->nil;
+    tree->node_count = 0;
+    tree->key_count = 0;
+}
+
+template <typename Tree>
+void rb_rotate_left(Tree* tree, typename Tree::Node* node) {
+    typedef typename Tree::Node Node;
+    Node* right = node->right;
+    node->right = right->left;
+    if (right->left != tree->nil) right->left->parent = node;
+    right->parent = node->parent;
+    if (node->parent == tree->nil) tree->root = right;
+    else if (node == node->parent->left) node->parent->left = right;
+    else node->parent->right = right;
+    right->left = node;
+    node->parent = right;
+}
+
+template <typename Tree>
+void rb_rotate_right(Tree* tree, typename Tree::Node* node) {
+    typedef typename Tree::Node Node;
+    Node* left = node->left;
+    node->left = left->right;
+    if (left->right != tree->nil) left->right->parent = node;
+    left->parent = node->parent;
+    if (node->parent == tree->nil) tree->root = left;
+    else if (node == node->parent->right) node->parent->right = left;
+    else node->parent->left = left;
+    left->right = node;
+    node->parent = left;
+}
+
+// Новый красный узел мог оказаться под красным родителем
+template <typename Tree>
+void rb_insert_fixup(Tree* tree, typename Tree::Node* node) {
+    typedef typename Tree::Node Node;
+    while (node->parent->red) {
+        Node* parent = node->parent;
+        Node* grandparent = parent->parent;
+        if (parent == grandparent->left) {
+            Node* uncle = grandparent->right;
+            if (uncle->red) {
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->right) {
+                node = parent;
+                rb_rotate_left(tree, node);
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rb_rotate_right(tree, grandparent);
+        } else {
+            Node* uncle = grandparent->left;
+            if (uncle->red) {
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->left) {
+                node = parent;
+                rb_rotate_right(tree, node);
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rb_rotate_left(tree, grandparent);
+        }
+    }
+    tree->root->red = false;
+}
+
+// Возвращает false, если ключ уже был (значение обновляется)
+template <typename Tree>
+bool rb_insert(Tree* tree, typename Tree::Key key, typename Tree::Value value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_INSERT);
+    Node* parent = tree->nil;
+    Node* current = tree->root;
+    while (current != tree->nil) {
+        STATS_VISIT(stat, 1);
+        parent = current;
+        if (key < current->key) {
+            current = current->left;
+        } else if (current->key < key) {
+            current = current->right;
+        } else {
+            current->value = value;
+            STATS_END(stat);
+            return false;
+        }
+    }
+    Node* node = (Node*)malloc(sizeof(Node));
+    node->key = key;
+    node->value = value;
+    node->red = true;
+    node->left = tree->nil;
+    node->right = tree->nil;
+    node->parent = parent;
+    if (parent == tree->nil) tree->root = node;
+    else if (key < parent->key) parent->left = node;
+    else parent->right = node;
+    rb_insert_fixup(tree, node);
+    tree->node_count++;
+    tree->key_count++;
+    STATS_END(stat);
+    return true;
+}
+
+template <typename Tree>
+bool rb_search(Tree* tree, typename Tree::Key key, typename Tree::Value* value) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_SEARCH);
+    Node* node = tree->root;
+    while (node != tree->nil) {
+        STATS_VISIT(stat, 1);
+        if (key < node->key) {
+            node = node->left;
+        } else if (node->key < key) {
+            node = node->right;
+        } else {
+            if (value != NULL) *value = node->value;
+            break;
+        }
+    }
+    STATS_END(stat);
+    return node != tree->nil;
+}
+
+// Поставить поддерево to на место поддерева from
+template <typename Tree>
+void rb_transplant(Tree* tree, typename Tree::Node* from, typename Tree::Node* to) {
+    if (from->parent == tree->nil) tree->root = to;
+    else if (from == from->parent->left) from->parent->left = to;
+    else from->parent->right = to;
+    to->parent = from->parent;
+}
+
+// На месте удаленного черного узла node несет "лишний черный"
+template <typename Tree>
+void rb_delete_fixup(Tree* tree, typename Tree::Node* node) {
+    typedef typename Tree::Node Node;
+    while (node != tree->root && !node->red) {
+        Node* parent = node->parent;
+        if (node == parent->left) {
+            Node* sibling = parent->right;
+            if (sibling->red) {
+                sibling->red = false;
+                parent->red = true;
+                rb_rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (!sibling->left->red && !sibling->right->red) {
+                sibling->red = true;
+                node = parent;
+                continue;
+            }
+            if (!sibling->right->red) {
+                sibling->left->red = false;
+                sibling->red = true;
+                rb_rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->right->red = false;
+            rb_rotate_left(tree, parent);
+        } else {
+            Node* sibling = parent->left;
+            if (sibling->red) {
+                sibling->red = false;
+                parent->red = true;
+                rb_rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (!sibling->left->red && !sibling->right->red) {
+                sibling->red = true;
+                node = parent;
+                continue;
+            }
+            if (!sibling->left->red) {
+                sibling->right->red = false;
+                sibling->red = true;
+                rb_rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->left->red = false;
+            rb_rotate_right(tree, parent);
+        }
+        node = tree->root;
+    }
+    node->red = false;
+}
+
+template <typename Tree>
+bool rb_delete(Tree* tree, typename Tree::Key key) {
+    typedef typename Tree::Node Node;
+    STATS_TIMER(stat, STAT_OP_DELETE);
+    Node* node = tree->root;
+    while (node != tree->nil) {
+        STATS_VISIT(stat, 1);
+        if (key < node->key) node = node->left;
+        else if (node->key < key) node = node->right;
+        else break;
+    }
+    if (node == tree->nil) {
+        STATS_END(stat);
+        return false;
+    }
+
+    // removed - узел, который уходит из дерева физически
+    Node* removed = node;
+    bool removed_red = removed->red;
+    Node* child;
+    if (node->left == tree->nil) {
+        child = node->right;
+        rb_transplant(tree, node, node->right);
+    } else if (node->right == tree->nil) {
+        child = node->left;
+        rb_transplant(tree, node, node->left);
+    } else {
+        removed = node->right;
+        while (removed->left != tree->nil) {
+            STATS_VISIT(stat, 1);
+            removed = removed->left;
+        }
+        removed_red = removed->red;
+        child = removed->right;
+        if (removed->parent == node) {
+            child->parent = removed;
+        } else {
+            rb_transplant(tree, removed, removed->right);
+            removed->right = node->right;
+            removed->right->parent = removed;
+        }
+        rb_transplant(tree, node, removed);
+        removed->left = node->left;
+        removed->left->parent = removed;
+        removed->red = node->red;
+    }
+    free(node);
+    if (!removed_red) rb_delete_fixup(tree, child);
+    tree->node_count--;
+    tree->key_count--;
+    STATS_END(stat);
+    return true;
+}
+
+template <typename Tree>
+void rb_range_from(Tree* tree, const typename Tree::Node* node,
+                   typename Tree::Key start_key, typename Tree::Key end_key,
+                   typename Tree::Key* results, int* result_count, int max_results, int* visits) {
+    if (node == tree->nil || *result_count >= max_results) return;
+    (*visits)++;
+    if (start_key < node->key) {
+        rb_range_from(tree, node->left, start_key, end_key, results, result_count, max_results, visits);
+    }
+    if (!(node->key < start_key) && !(end_key < node->key) && *result_count < max_results) {
+        results[(*result_count)++] = node->key;
+    }
+    if (node->key < end_key) {
+        rb_range_from(tree, node->right, start_key, end_key, results, result_count, max_results, visits);
+    }
+}
+
+// Ключи из [start_key, end_key] по возрастанию, не больше max_results
+template <typename Tree>
+int rb_range_query(Tree* tree, typename Tree::Key start_key, typename Tree::Key end_key,
+                   typename Tree::Key* results, int max_results) {
+    STATS_TIMER(stat, STAT_OP_RANGE);
+    int count = 0;
+    int visits = 0;
+    rb_range_from(tree, tree->root, start_key, end_key, results, &count, max_results, &visits);
+    STATS_VISIT(stat, visits);
+    STATS_END(stat);
+    return count;
+}
+
+template <typename Tree>
+void rb_free_node(Tree* tree, typename Tree::Node* node) {
+    if (node == tree->nil) return;
+    rb_free_node(tree, node->left);
+    rb_free_node(tree, node->right);
+    free(node);
+}
+
+template <typename Tree>
+void rb_tree_free(Tree* tree) {
+    rb_free_node(tree, tree->root);
+    free(tree->nil);
+    tree->root = NULL;
+    tree->nil = NULL;
+    tree->node_count = 0;
+    tree->key_count = 0;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+// Поиск внутри узла: ключи узла отсортированы, поэтому
+//   node_upper_bound(key) = число ключей <= key = индекс ребенка при спуске,
+//   node_lower_bound(key) = число ключей <  key = позиция вставки / начало диапазона.
+// Для int и long long есть SIMD-версии (AVX2 и SSE4.2), выбираемые во время
+// выполнения; для остальных типов ключей используется скалярный цикл.
+
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE42 = 1,
+    SIMD_AVX2 = 2
+};
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2: return "AVX2";
+        case SIMD_SSE42: return "SSE4.2";
+        default: return "scalar";
+    }
+}
+
+// Лучший доступный уровень на этом процессоре
+inline SimdLevel simd_detect() {
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SIMD_SSE42;
+#endif
+    return SIMD_SCALAR;
+}
+
+inline SimdLevel g_simd_level = simd_detect();
+
+// Принудительный выбор уровня (для сравнения в бенчмарке); уровень выше
+// поддерживаемого процессором не включается
+inline bool simd_set_level(SimdLevel level) {
+    if (level > simd_detect()) return false;
+    g_simd_level = level;
+    return true;
+}
+
+// ---------- Скалярные версии ----------
+
+template <typename K>
+inline int node_upper_bound_scalar(const K* keys, int count, K key) {
+    int i = 0;
+    while (i < count && key >= keys[i]) i++;
+    return i;
+}
+
+template <typename K>
+inline int node_lower_bound_scalar(const K* keys, int count, K key) {
+    int i = 0;
+    while (i < count && keys[i] < key) i++;
+    return i;
+}
+
+#if SIMD_X86
+
+// ---------- int32 ----------
+
+__attribute__((target("avx2")))
+inline int node_upper_bound_avx2(const int* keys, int count, int key) {
+    __m256i k = _mm256_set1_epi32(key);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        int gt = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k)));
+        if (gt) return i + __builtin_ctz(gt);
+    }
+    while (i < count && key >= keys[i]) i++;
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline int node_lower_bound_avx2(const int* keys, int count, int key) {
+    __m256i k = _mm256_set1_epi32(key);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        int lt = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v)));
+        if (lt != 0xff) return i + __builtin_ctz(~lt);
+    }
+    while (i < count && keys[i] < key) i++;
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+inline int node_upper_bound_sse42(const int* keys, int count, int key) {
+    __m128i k = _mm_set1_epi32(key);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        int gt = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k)));
+        if (gt) return i + __builtin_ctz(gt);
+    }
+    while (i < count && key >= keys[i]) i++;
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+inline int node_lower_bound_sse42(const int* keys, int count, int key) {
+    __m128i k = _mm_set1_epi32(key);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        int lt = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v)));
+        if (lt != 0xf) return i + __builtin_ctz(~lt);
+    }
+    while (i < count && keys[i] < key) i++;
+    return i;
+}
+
+// ---------- int64 ----------
+
+__attribute__((target("avx2")))
+inline int node_upper_bound_avx2(const long long* keys, int count, long long key) {
+    __m256i k = _mm256_set1_epi64x(key);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        int gt = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, k)));
+        if (gt) return i + __builtin_ctz(gt);
+    }
+    while (i < count && key >= keys[i]) i++;
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline int node_lower_bound_avx2(const long long* keys, int count, long long key) {
+    __m256i k = _mm256_set1_epi64x(key);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        int lt = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v)));
+        if (lt != 0xf) return i + __builtin_ctz(~lt);
+    }
+    while (i < count && keys[i] < key) i++;
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+inline int node_upper_bound_sse42(const long long* keys, int count, long long key) {
+    __m128i k = _mm_set1_epi64x(key);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        int gt = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, k)));
+        if (gt) return i + __builtin_ctz(gt);
+    }
+    while (i < count && key >= keys[i]) i++;
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+inline int node_lower_bound_sse42(const long long* keys, int count, long long key) {
+    __m128i k = _mm_set1_epi64x(key);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        int lt = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(k, v)));
+        if (lt != 0x3) return i + __builtin_ctz(~lt);
+    }
+    while (i < count && keys[i] < key) i++;
+    return i;
+}
+
+#endif // SIMD_X86
+
+// ---------- Диспетчеризация ----------
+
+template <typename K>
+inline int node_upper_bound(const K* keys, int count, K key) {
+    return node_upper_bound_scalar(keys, count, key);
+}
+
+template <typename K>
+inline int node_lower_bound(const K* keys, int count, K key) {
+    return node_lower_bound_scalar(keys, count, key);
+}
+
+#if SIMD_X86
+
+inline int node_upper_bound(const int* keys, int count, int key) {
+    if (g_simd_level == SIMD_AVX2) return node_upper_bound_avx2(keys, count, key);
+    if (g_simd_level == SIMD_SSE42) return node_upper_bound_sse42(keys, count, key);
+    return node_upper_bound_scalar(keys, count, key);
+}
+
+inline int node_lower_bound(const int* keys, int count, int key) {
+    if (g_simd_level == SIMD_AVX2) return node_lower_bound_avx2(keys, count, key);
+    if (g_simd_level == SIMD_SSE42) return node_lower_bound_sse42(keys, count, key);
+    return node_lower_bound_scalar(keys, count, key);
+}
+
+inline int node_upper_bound(const long long* keys, int count, long long key) {
+    if (g_simd_level == SIMD_AVX2) return node_upper_bound_avx2(keys, count, key);
+    if (g_simd_level == SIMD_SSE42) return node_upper_bound_sse42(keys, count, key);
+    return node_upper_bound_scalar(keys, count, key);
+}
+
+inline int node_lower_bound(const long long* keys, int count, long long key) {
+    if (g_simd_level == SIMD_AVX2) return node_lower_bound_avx2(keys, count, key);
+    if (g_simd_level == SIMD_SSE42) return node_lower_bound_sse42(keys, count, key);
+    return node_lower_bound_scalar(keys, count, key);
+}
+
+#endif // SIMD_X86
+
+// Фильтр листа по диапазону [start_key, end_key]: так как ключи отсортированы,
+// подходящие ключи занимают отрезок [*first, *last)
+template <typename K>
+inline void node_range_bounds(const K* keys, int count, K start_key, K end_key,
+                              int* first, int* last) {
+    *first = node_lower_bound(keys, count, start_key);
+    *last = *first + node_upper_bound(keys + *first, count - *first, end_key);
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits>
+#include <type_traits>
+
+#include "disk.h"
+#include "simd_search.h"
+#include "bplus_tree.h"
+
+// Статическое B+-дерево (S+-дерево) для индексов "почти только чтение".
+// bplus_tree_freeze() переносит построенное B+-дерево в неизменяемую
+// раскладку без указателей:
+//   * ключи и значения - два сплошных отсортированных массива; ключи
+//     разбиты на блоки по одной кэш-линии (листья), соседние листья
+//     соседствуют в памяти, поэтому range query - это отрезок массива;
+//   * над листьями - неявный индекс (B-арный вариант раскладки Эйтцингера):
+//     узел - одна кэш-линия из block ключей и block + 1 детей, номер
+//     ребенка вычисляется как k * (block + 1) + i, а не читается из узла.
+// Внутри узла ищется ранг без ветвлений: фиксированное число сравнений
+// на всю кэш-линию независимо от ключа. Пакетные изменения - повторная
+// заморозка изменяемого дерева.
+
+#define STATIC_TREE_MAX_HEIGHT 32
+
+template <typename K, typename V>
+struct StaticBPlusTree {
+    static_assert(std::is_arithmetic<K>::value, "добивка узлов использует максимум типа ключа");
+    static_assert(CACHE_LINE_SIZE % sizeof(K) == 0, "ключи должны ровно заполнять кэш-линию");
+
+    typedef K Key;
+    typedef V Value;
+    static const int block = CACHE_LINE_SIZE / sizeof(K);   // ключей в узле
+
+    K* keys;                  // count ключей + добивка максимумом до целого блока
+    V* values;
+    K* index;                 // внутренние уровни, корень первым
+    long long count;
+    long long leaf_blocks;
+    int height;               // уровней вместе с листовым (1 = только листья)
+    long long level_offset[STATIC_TREE_MAX_HEIGHT];   // начало уровня h в index, в ключах
+    long long index_keys;
+};
+
+// ---------- Ранг в узле: число ключей < key (UPPER: <= key) ----------
+
+template <bool UPPER, typename K>
+inline int static_block_rank_scalar(const K* node, K key) {
+    int rank = 0;
+    for (int i = 0; i < (int)(CACHE_LINE_SIZE / sizeof(K)); i++) {
+        rank += UPPER ? node[i] <= key : node[i] < key;
+    }
+    return rank;
+}
+
+#if SIMD_X86
+
+__attribute__((target("avx2,popcnt")))
+inline int static_block_rank_avx2(const int* node, int key, bool upper) {
+    __m256i k = _mm256_set1_epi32(key);
+    int greater = 0, less = 0;
+    for (int i = 0; i < CACHE_LINE_SIZE / 4; i += 8) {
+        __m256i v = _mm256_load_si256((const __m256i*)(node + i));
+        greater += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k))));
+        less += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+    }
+    return upper ? CACHE_LINE_SIZE / 4 - greater : less;
+}
+
+__attribute__((target("avx2,popcnt")))
+inline int static_block_rank_avx2(const long long* node, long long key, bool upper) {
+    __m256i k = _mm256_set1_epi64x(key);
+    int greater = 0, less = 0;
+    for (int i = 0; i < CACHE_LINE_SIZE / 8; i += 4) {
+        __m256i v = _mm256_load_si256((const __m256i*)(node + i));
+        greater += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, k))));
+        less += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v))));
+    }
+    return upper ? CACHE_LINE_SIZE / 8 - greater : less;
+}
+
+#endif // SIMD_X86
+
+template <bool UPPER, typename K>
+inline int static_block_rank(const K* node, K key) {
+    return static_block_rank_scalar<UPPER>(node, key);
+}
+
+#if SIMD_X86
+
+template <bool UPPER>
+inline int static_block_rank(const int* node, int key) {
+    if (g_simd_level == SIMD_AVX2) return static_block_rank_avx2(node, key, UPPER);
+    return static_block_rank_scalar<UPPER>(node, key);
+}
+
+template <bool UPPER>
+inline int static_block_rank(const long long* node, long long key) {
+    if (g_simd_level == SIMD_AVX2) return static_block_rank_avx2(node, key, UPPER);
+    return static_block_rank_scalar<UPPER>(node, key);
+}
+
+#endif // SIMD_X86
+
+// ---------- Построение ----------
+
+template <typename Static>
+void static_tree_init(Static* tree) {
+    tree->keys = NULL;
+    tree->values = NULL;
+    tree->index = NULL;
+    tree->count = 0;
+    tree->leaf_blocks = 0;
+    tree->height = 0;
+    tree->index_keys = 0;
+}
+
+template <typename Static>
+void static_tree_free(Static* tree) {
+    free(tree->keys);
+    free(tree->values);
+    free(tree->index);
+    static_tree_init(tree);
+}
+
+// Память под count ключей: листья добиваются до целого блока
+template <typename Static>
+bool static_tree_alloc(Static* tree, long long count) {
+    typedef typename Static::Key K;
+    typedef typename Static::Value V;
+    const int B = Static::block;
+    static_tree_init(tree);
+    tree->count = count;
+    tree->leaf_blocks = count > 0 ? (count + B - 1) / B : 1;
+    tree->keys = (K*)aligned_alloc(CACHE_LINE_SIZE, sizeof(K) * tree->leaf_blocks * B);
+    size_t value_bytes = (sizeof(V) * (count > 0 ? count : 1) + CACHE_LINE_SIZE - 1)
+                         / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    tree->values = (V*)aligned_alloc(CACHE_LINE_SIZE, value_bytes);
+    if (tree->keys == NULL || tree->values == NULL) {
+        static_tree_free(tree);
+        return false;
+    }
+    for (long long i = count; i < tree->leaf_blocks * B; i++) tree->keys[i] = std::numeric_limits<K>::max();
+    return true;
+}
+
+// Раскладка индекса по числу листов: height, level_offset, index_keys
+// и число узлов каждого уровня в nodes. Зависит только от leaf_blocks.
+template <typename Static>
+void static_tree_layout(Static* tree, long long* nodes) {
+    const int B = Static::block;
+    nodes[0] = tree->leaf_blocks;
+    tree->height = 1;
+    while (nodes[tree->height - 1] > 1) {
+        nodes[tree->height] = (nodes[tree->height - 1] + B) / (B + 1);
+        tree->height++;
+    }
+
+    long long offset = 0;
+    for (int h = tree->height - 1; h >= 1; h--) {
+        tree->level_offset[h] = offset;
+        offset += nodes[h] * B;
+    }
+    tree->index_keys = offset;
+}
+
+// Внутренние уровни над заполненными листьями. Ключ i узла j уровня h -
+// минимальный ключ ребенка i + 1, то есть первый ключ самого левого листа
+// его поддерева; несуществующим детям соответствует максимум типа.
+template <typename Static>
+bool static_tree_build_index(Static* tree) {
+    typedef typename Static::Key K;
+    const int B = Static::block;
+
+    long long nodes[STATIC_TREE_MAX_HEIGHT];
+    static_tree_layout(tree, nodes);
+    long long offset = tree->index_keys;
+    tree->index = (K*)aligned_alloc(CACHE_LINE_SIZE, sizeof(K) * (offset > 0 ? offset : B));
+    if (tree->index == NULL) return false;
+
+    long long span = 1;   // листов в поддереве ребенка узла уровня h
+    for (int h = 1; h < tree->height; h++) {
+        K* level = tree->index + tree->level_offset[h];
+        for (long long j = 0; j < nodes[h]; j++) {
+            for (int i = 0; i < B; i++) {
+                long long leaf = (j * (B + 1) + i + 1) * span;
+                level[j * B + i] = leaf < tree->leaf_blocks ? tree->keys[leaf * B]
+                                                            : std::numeric_limits<K>::max();
+            }
+        }
+        span *= B + 1;
+    }
+    return true;
+}
+
+// Заморозка: листья изменяемого дерева по цепочке next_leaf копируются
+// в сплошные массивы, затем над ними строится индекс.
+// Изменяемое дерево не трогается; false - не хватило памяти.
+template <typename Tree>
+bool bplus_tree_freeze(Tree* tree, StaticBPlusTree<typename Tree::Key, typename Tree::Value>* frozen) {
+    typedef typename Tree::Node Node;
+    if (!static_tree_alloc(frozen, tree->key_count)) return false;
+
+    Node* leaf = tree->root;
+    while (!leaf->is_leaf) leaf = (Node*)leaf->children[0];
+    long long pos = 0;
+    for (; leaf != NULL; leaf = leaf->next_leaf) {
+        memcpy(frozen->keys + pos, leaf->keys, sizeof(typename Tree::Key) * leaf->key_count);
+        memcpy(frozen->values + pos, leaf->data, sizeof(typename Tree::Value) * leaf->key_count);
+        pos += leaf->key_count;
+    }
+
+    if (!static_tree_build_index(frozen)) {
+        static_tree_free(frozen);
+        return false;
+    }
+    return true;
+}
+
+// Занимаемая память: листья, значения и индекс
+template <typename Static>
+long long static_tree_bytes(const Static* tree) {
+    return (long long)sizeof(typename Static::Key) * (tree->leaf_blocks * Static::block + tree->index_keys)
+           + (long long)sizeof(typename Static::Value) * tree->count;
+}
+
+// ---------- Поиск ----------
+
+// Позиция в keys: число ключей < key (UPPER: <= key). Спуск - height
+// загрузок по одной кэш-линии без ветвлений, зависящих от данных.
+template <bool UPPER, typename Static>
+inline long long static_tree_rank(const Static* tree, typename Static::Key key) {
+    const int B = Static::block;
+    // Добивка равна максимуму: при UPPER она сама попала бы в ранг
+    if (UPPER && key == std::numeric_limits<typename Static::Key>::max()) return tree->count;
+    long long k = 0;
+    for (int h = tree->height - 1; h > 0; h--) {
+        k = k * (B + 1) + static_block_rank<UPPER>(tree->index + tree->level_offset[h] + k * B, key);
+    }
+    return k * B + static_block_rank<UPPER>(tree->keys + k * B, key);
+}
+
+template <typename Static>
+inline long long static_tree_lower_bound(const Static* tree, typename Static::Key key) {
+    return static_tree_rank<false>(tree, key);
+}
+
+template <typename Static>
+inline long long static_tree_upper_bound(const Static* tree, typename Static::Key key) {
+    return static_tree_rank<true>(tree, key);
+}
+
+template <typename Static>
+bool static_tree_search(const Static* tree, typename Static::Key key, typename Static::Value* value) {
+    long long pos = static_tree_lower_bound(tree, key);
+    if (pos >= tree->count || tree->keys[pos] != key) return false;
+    if (value != NULL) *value = tree->values[pos];
+    return true;
+}
+
+// Range query [start_key, end_key]: записи занимают отрезок [*first, *last)
+// массивов keys/values, поэтому результат не копируется и не собирается по листьям
+template <typename Static>
+inline void static_tree_range_bounds(const Static* tree, typename Static::Key start_key,
+                                     typename Static::Key end_key, long long* first, long long* last) {
+    *first = static_tree_lower_bound(tree, start_key);
+    *last = end_key < start_key ? *first : static_tree_upper_bound(tree, end_key);
+}
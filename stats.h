@@ -0,0 +1,325 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+// Встроенная статистика деревьев: число операций, гистограммы латентности
+// и числа посещенных узлов на операцию, счетчики расщеплений/слияний,
+// попаданий в буферный пул и прочитанных байт.
+// Каждый поток пишет в собственный блок счетчиков (один писатель - без
+// атомарных read-modify-write и без общей кэш-линии), снимок суммирует
+// блоки всех потоков. Сбор включается во время работы (stats_enable);
+// выключенный стоит одной проверки флага на операцию. Число операций,
+// узлов и счетчики точные, а латентность замеряется у каждой
+// stats_set_latency_sampling()-й операции потока: пара чтений часов
+// дороже самого поиска в дереве. Сборка с -DTREE_STATS=0 убирает хуки
+// из кода деревьев полностью.
+
+#ifndef TREE_STATS
+#define TREE_STATS 1
+#endif
+
+enum StatOp {
+    STAT_OP_SEARCH = 0,
+    STAT_OP_INSERT,
+    STAT_OP_DELETE,
+    STAT_OP_RANGE,
+    STAT_OP_COUNT
+};
+
+enum StatCounter {
+    STAT_SPLITS = 0,
+    STAT_MERGES,
+    STAT_BORROWS,
+    STAT_POOL_HITS,
+    STAT_POOL_MISSES,
+    STAT_PAGES_READ,
+    STAT_PAGES_WRITTEN,
+    STAT_BYTES_READ,
+    STAT_BYTES_WRITTEN,
+    STAT_COUNTER_COUNT
+};
+
+inline const char* stat_op_name(int op) {
+    static const char* names[STAT_OP_COUNT] = {"search", "insert", "delete", "range"};
+    return names[op];
+}
+
+inline const char* stat_counter_name(int counter) {
+    static const char* names[STAT_COUNTER_COUNT] = {
+        "splits", "merges", "borrows", "pool_hits", "pool_misses",
+        "pages_read", "pages_written", "bytes_read", "bytes_written"};
+    return names[counter];
+}
+
+#define STAT_LATENCY_BUCKETS 40   // корзина i: [2^(i-1), 2^i) нс, 0 - ноль
+#define STAT_NODE_BUCKETS 128     // корзина i: ровно i узлов, последняя - не меньше
+
+// Блок счетчиков одного потока; пишет только владелец
+struct alignas(64) StatShard {
+    std::atomic<long long> ops[STAT_OP_COUNT];
+    std::atomic<long long> nodes[STAT_OP_COUNT];
+    std::atomic<long long> latency[STAT_OP_COUNT][STAT_LATENCY_BUCKETS];
+    std::atomic<long long> visits[STAT_OP_COUNT][STAT_NODE_BUCKETS];
+    std::atomic<long long> counters[STAT_COUNTER_COUNT];
+    unsigned int tick;     // операций потока - для выборки замеров латентности
+    StatShard* next;
+};
+
+// Сумма по всем потокам на момент stats_snapshot()
+struct StatsSnapshot {
+    long long ops[STAT_OP_COUNT];
+    long long nodes[STAT_OP_COUNT];
+    long long latency[STAT_OP_COUNT][STAT_LATENCY_BUCKETS];
+    long long visits[STAT_OP_COUNT][STAT_NODE_BUCKETS];
+    long long counters[STAT_COUNTER_COUNT];
+};
+
+// Хук трассировки: вызывается в конце каждой учтенной операции;
+// latency_ns = -1, если операция не попала в выборку замеров
+typedef void (*StatTraceHook)(void* context, StatOp op, long long latency_ns, int nodes);
+
+#define STAT_DEFAULT_SAMPLING 16
+
+struct StatsRegistry {
+    std::atomic<bool> enabled;
+    std::atomic<unsigned int> sampling_mask;   // замер при (tick & mask) == 0
+    std::mutex lock;               // только для списка блоков
+    StatShard* shards;
+    std::atomic<StatTraceHook> trace_hook;
+    void* trace_context;
+};
+
+inline StatsRegistry g_stats;
+inline thread_local StatShard* t_stat_shard = NULL;
+
+// Блоки потоков не освобождаются: после завершения потока его вклад
+// остается в снимках
+inline StatShard* stats_shard() {
+    if (t_stat_shard == NULL) {
+        StatShard* shard = (StatShard*)aligned_alloc(alignof(StatShard), sizeof(StatShard));
+        new (shard) StatShard();
+        for (int op = 0; op < STAT_OP_COUNT; op++) {
+            shard->ops[op].store(0);
+            shard->nodes[op].store(0);
+            for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) shard->latency[op][i].store(0);
+            for (int i = 0; i < STAT_NODE_BUCKETS; i++) shard->visits[op][i].store(0);
+        }
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++) shard->counters[i].store(0);
+        shard->tick = 0;
+        std::lock_guard<std::mutex> guard(g_stats.lock);
+        shard->next = g_stats.shards;
+        g_stats.shards = shard;
+        t_stat_shard = shard;
+    }
+    return t_stat_shard;
+}
+
+// Прибавление в счетчик своего потока: обычные load/store, не lock-инструкция
+inline void stat_add(std::atomic<long long>& counter, long long n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline bool stats_enabled() {
+    return g_stats.enabled.load(std::memory_order_relaxed);
+}
+
+inline void stats_enable(bool enabled) {
+    g_stats.enabled.store(enabled);
+}
+
+// Замерять латентность каждой period-й операции (округляется вниз до
+// степени двойки; 1 - каждую). До первого вызова - STAT_DEFAULT_SAMPLING.
+inline void stats_set_latency_sampling(unsigned int period) {
+    unsigned int power = 1;
+    while (power * 2 <= period) power *= 2;
+    g_stats.sampling_mask.store((power - 1) | 0x80000000u);
+}
+
+inline unsigned int stats_sampling_mask() {
+    unsigned int mask = g_stats.sampling_mask.load(std::memory_order_relaxed);
+    return mask != 0 ? mask & 0x7fffffffu : STAT_DEFAULT_SAMPLING - 1;
+}
+
+// context передается хуку как есть; NULL-хук выключает трассировку
+inline void stats_set_trace_hook(StatTraceHook hook, void* context) {
+    g_stats.trace_context = context;
+    g_stats.trace_hook.store(hook);
+}
+
+inline long long stats_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+inline void stats_count(StatCounter counter, long long n) {
+    if (stats_enabled()) stat_add(stats_shard()->counters[counter], n);
+}
+
+// ---------- Замер одной операции ----------
+
+struct StatOpTimer {
+    StatOp op;
+    int nodes;             // посещено узлов
+    long long start_ns;    // 0 - сбор был выключен в начале операции,
+                           // -1 - операция учитывается без замера времени
+};
+
+inline void stats_op_begin(StatOpTimer* timer, StatOp op) {
+    timer->op = op;
+    timer->nodes = 0;
+    timer->start_ns = 0;
+    if (!stats_enabled()) return;
+    StatShard* shard = stats_shard();
+    timer->start_ns = (shard->tick++ & stats_sampling_mask()) == 0 ? stats_now_ns() : -1;
+}
+
+inline int stats_latency_bucket(long long ns) {
+    int bucket = ns > 0 ? 64 - __builtin_clzll((unsigned long long)ns) : 0;
+    return bucket < STAT_LATENCY_BUCKETS ? bucket : STAT_LATENCY_BUCKETS - 1;
+}
+
+inline void stats_op_end(StatOpTimer* timer) {
+    if (timer->start_ns == 0 || !stats_enabled()) return;
+    long long ns = timer->start_ns > 0 ? stats_now_ns() - timer->start_ns : -1;
+    StatShard* shard = stats_shard();
+    int op = timer->op;
+    stat_add(shard->ops[op], 1);
+    stat_add(shard->nodes[op], timer->nodes);
+    if (ns >= 0) stat_add(shard->latency[op][stats_latency_bucket(ns)], 1);
+    stat_add(shard->visits[op][timer->nodes < STAT_NODE_BUCKETS ? timer->nodes : STAT_NODE_BUCKETS - 1], 1);
+    StatTraceHook hook = g_stats.trace_hook.load(std::memory_order_acquire);
+    if (hook != NULL) hook(g_stats.trace_context, timer->op, ns, timer->nodes);
+    timer->start_ns = 0;
+}
+
+// Хуки в коде деревьев; при TREE_STATS=0 исчезают вместе с полями таймеров
+#if TREE_STATS
+#define STATS_TIMER(timer, op) StatOpTimer timer; stats_op_begin(&timer, op)
+#define STATS_BEGIN(timer, op) stats_op_begin(&(timer), op)
+#define STATS_VISIT(timer, n) ((timer).nodes += (n))
+#define STATS_END(timer) stats_op_end(&(timer))
+#define STATS_COUNT(counter, n) stats_count(counter, n)
+#else
+#define STATS_TIMER(timer, op) ((void)0)
+#define STATS_BEGIN(timer, op) ((void)0)
+#define STATS_VISIT(timer, n) ((void)0)
+#define STATS_END(timer) ((void)0)
+#define STATS_COUNT(counter, n) ((void)0)
+#endif
+
+// ---------- Снимок и экспорт ----------
+
+inline void stats_snapshot(StatsSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    std::lock_guard<std::mutex> guard(g_stats.lock);
+    for (StatShard* shard = g_stats.shards; shard != NULL; shard = shard->next) {
+        for (int op = 0; op < STAT_OP_COUNT; op++) {
+            snapshot->ops[op] += shard->ops[op].load(std::memory_order_relaxed);
+            snapshot->nodes[op] += shard->nodes[op].load(std::memory_order_relaxed);
+            for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) {
+                snapshot->latency[op][i] += shard->latency[op][i].load(std::memory_order_relaxed);
+            }
+            for (int i = 0; i < STAT_NODE_BUCKETS; i++) {
+                snapshot->visits[op][i] += shard->visits[op][i].load(std::memory_order_relaxed);
+            }
+        }
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+            snapshot->counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Обнуление всех блоков. Прибавления, идущие в этот момент в других
+// потоках, могут перезаписать ноль - сбрасывать лучше между фазами работы.
+inline void stats_reset() {
+    std::lock_guard<std::mutex> guard(g_stats.lock);
+    for (StatShard* shard = g_stats.shards; shard != NULL; shard = shard->next) {
+        for (int op = 0; op < STAT_OP_COUNT; op++) {
+            shard->ops[op].store(0, std::memory_order_relaxed);
+            shard->nodes[op].store(0, std::memory_order_relaxed);
+            for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) shard->latency[op][i].store(0, std::memory_order_relaxed);
+            for (int i = 0; i < STAT_NODE_BUCKETS; i++) shard->visits[op][i].store(0, std::memory_order_relaxed);
+        }
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++) shard->counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// Перцентиль латентности операции среди замеренных: верхняя граница корзины, нс
+inline long long stats_latency_percentile(const StatsSnapshot* snapshot, int op, double p) {
+    long long sampled = 0;
+    for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) sampled += snapshot->latency[op][i];
+    if (sampled == 0) return 0;
+    long long rank = (long long)(p * sampled);
+    long long seen = 0;
+    for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) {
+        seen += snapshot->latency[op][i];
+        if (seen > rank) return i > 0 ? 1LL << i : 0;
+    }
+    return 1LL << (STAT_LATENCY_BUCKETS - 1);
+}
+
+// Перцентиль числа посещенных узлов (точный до STAT_NODE_BUCKETS - 1)
+inline int stats_nodes_percentile(const StatsSnapshot* snapshot, int op, double p) {
+    long long rank = (long long)(p * snapshot->ops[op]);
+    long long seen = 0;
+    for (int i = 0; i < STAT_NODE_BUCKETS; i++) {
+        seen += snapshot->visits[op][i];
+        if (seen > rank) return i;
+    }
+    return STAT_NODE_BUCKETS - 1;
+}
+
+inline void stats_print_text(FILE* out, const StatsSnapshot* snapshot) {
+    fprintf(out, "%-8s | %-10s | %-10s | %-10s | %-10s | %-11s | %-11s\n",
+            "Операция", "Число", "Узлов/оп", "Узлов p50", "Узлов p99", "p50, нс", "p99, нс");
+    for (int op = 0; op < STAT_OP_COUNT; op++) {
+        if (snapshot->ops[op] == 0) continue;
+        fprintf(out, "%-8s | %-10lld | %-10.2f | %-10d | %-10d | %-11lld | %-11lld\n",
+                stat_op_name(op), snapshot->ops[op], (double)snapshot->nodes[op] / snapshot->ops[op],
+                stats_nodes_percentile(snapshot, op, 0.5), stats_nodes_percentile(snapshot, op, 0.99),
+                stats_latency_percentile(snapshot, op, 0.5), stats_latency_percentile(snapshot, op, 0.99));
+    }
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+        fprintf(out, "%s=%lld%s", stat_counter_name(i), snapshot->counters[i],
+                i + 1 < STAT_COUNTER_COUNT ? " " : "\n");
+    }
+}
+
+// JSON: по объекту на операцию (гистограммы - непустые корзины) и счетчики
+inline void stats_print_json(FILE* out, const StatsSnapshot* snapshot) {
+    fprintf(out, "{\"ops\":{");
+    bool first_op = true;
+    for (int op = 0; op < STAT_OP_COUNT; op++) {
+        if (snapshot->ops[op] == 0) continue;
+        fprintf(out, "%s\"%s\":{\"count\":%lld,\"nodes\":%lld,\"latency_ns\":{", first_op ? "" : ",",
+                stat_op_name(op), snapshot->ops[op], snapshot->nodes[op]);
+        first_op = false;
+        bool first = true;
+        for (int i = 0; i < STAT_LATENCY_BUCKETS; i++) {
+            if (snapshot->latency[op][i] == 0) continue;
+            fprintf(out, "%s\"%lld\":%lld", first ? "" : ",", i > 0 ? 1LL << i : 0, snapshot->latency[op][i]);
+            first = false;
+        }
+        fprintf(out, "},\"nodes_visited\":{");
+        first = true;
+        for (int i = 0; i < STAT_NODE_BUCKETS; i++) {
+            if (snapshot->visits[op][i] == 0) continue;
+            fprintf(out, "%s\"%d\":%lld", first ? "" : ",", i, snapshot->visits[op][i]);
+            first = false;
+        }
+        fprintf(out, "}}");
+    }
+    fprintf(out, "},\"counters\":{");
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+        fprintf(out, "%s\"%s\":%lld", i > 0 ? "," : "", stat_counter_name(i), snapshot->counters[i]);
+    }
+    fprintf(out, "}}\n");
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "disk.h"
+#include "bplus_tree.h"
+#include "disk_tree.h"
+
+// Журнал упреждающей записи (WAL) и B+-дерево с долговечными вставками.
+// Изменение сначала дописывается в журнал, затем применяется к дереву;
+// вставка подтверждается только после того, как ее запись журнала
+// сброшена на диск. Страницы дерева попадают в файл лишь на контрольной
+// точке (durable_bplus_checkpoint), после чего журнал обрезается.
+// При открытии дерево загружается из последней контрольной точки и
+// журнал проигрывается поверх него; оборванный хвост журнала отбрасывается.
+//
+// Групповая фиксация: потоки дописывают записи в общий буфер, а первый
+// из ожидающих (лидер) пишет весь накопленный буфер одним write() и
+// одним fsync. Лидер может подождать до group_wait_us, пока в группе не
+// наберется group_size записей.
+
+enum WalSyncPolicy {
+    WAL_SYNC_NONE = 0,         // только write(): переживает падение процесса, но не ОС
+    WAL_SYNC_FDATASYNC = 1,
+    WAL_SYNC_FSYNC = 2
+};
+
+inline const char* wal_sync_policy_name(WalSyncPolicy policy) {
+    switch (policy) {
+        case WAL_SYNC_FDATASYNC: return "fdatasync";
+        case WAL_SYNC_FSYNC: return "fsync";
+        default: return "без sync";
+    }
+}
+
+// Запись журнала: заголовок + payload_size байт
+struct WalRecordHeader {
+    unsigned int checksum;     // FNV-1a по lsn, размеру и данным
+    int payload_size;
+    long long lsn;
+};
+
+// Буфер записей, ожидающих сброса
+struct WalBuffer {
+    unsigned char* data;
+    size_t used;
+    size_t capacity;
+    int records;
+};
+
+struct WriteAheadLog {
+    int fd;
+    WalSyncPolicy policy;
+    int group_size;            // записей в группе, которых ждет лидер
+    int group_wait_us;         // сколько лидер готов ждать группу
+
+    std::mutex lock;
+    std::condition_variable arrived;   // в буфер добавлена запись
+    std::condition_variable durable;   // продвинулся durable_lsn
+    struct WalBuffer active;   // сюда дописывают
+    struct WalBuffer flushing; // это пишет лидер
+    bool flush_in_progress;
+    bool failed;               // группа не записалась: журнал больше ничего не подтверждает
+    long long next_lsn;
+    long long durable_lsn;     // все записи с lsn <= durable_lsn на диске
+
+    long long syncs;
+    long long records;
+    long long bytes;
+};
+
+inline unsigned int wal_checksum(const struct WalRecordHeader* header, const void* payload) {
+    unsigned int hash = 2166136261u;
+    const unsigned char* parts[2] = {(const unsigned char*)&header->payload_size, (const unsigned char*)payload};
+    size_t sizes[2] = {sizeof(header->payload_size) + sizeof(header->lsn), (size_t)header->payload_size};
+    for (int p = 0; p < 2; p++) {
+        for (size_t i = 0; i < sizes[p]; i++) hash = (hash ^ parts[p][i]) * 16777619u;
+    }
+    return hash;
+}
+
+inline void wal_buffer_init(struct WalBuffer* buffer) {
+    buffer->data = NULL;
+    buffer->used = 0;
+    buffer->capacity = 0;
+    buffer->records = 0;
+}
+
+// Открыть журнал для дописывания (файл создается, если его нет)
+inline bool wal_open(struct WriteAheadLog* wal, const char* path, WalSyncPolicy policy,
+                     int group_size, int group_wait_us) {
+    wal->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (wal->fd < 0) return false;
+    wal->policy = policy;
+    wal->group_size = group_size > 0 ? group_size : 1;
+    wal->group_wait_us = group_wait_us;
+    wal_buffer_init(&wal->active);
+    wal_buffer_init(&wal->flushing);
+    wal->flush_in_progress = false;
+    wal->failed = false;
+    wal->next_lsn = 1;
+    wal->durable_lsn = 0;
+    wal->syncs = 0;
+    wal->records = 0;
+    wal->bytes = 0;
+    return true;
+}
+
+inline void wal_close(struct WriteAheadLog* wal) {
+    if (wal->fd >= 0) close(wal->fd);
+    wal->fd = -1;
+    free(wal->active.data);
+    free(wal->flushing.data);
+    wal_buffer_init(&wal->active);
+    wal_buffer_init(&wal->flushing);
+}
+
+// Дописать запись в буфер; возвращает ее lsn. На диск она попадет в wal_commit.
+// -1 - журнал уже в состоянии ошибки (см. wal_commit).
+inline long long wal_append(struct WriteAheadLog* wal, const void* payload, int payload_size) {
+    std::lock_guard<std::mutex> guard(wal->lock);
+    if (wal->failed) return -1;
+    struct WalBuffer* buffer = &wal->active;
+    size_t need = sizeof(struct WalRecordHeader) + payload_size;
+    if (buffer->used + need > buffer->capacity) {
+        buffer->capacity = (buffer->used + need) * 2 > 65536 ? (buffer->used + need) * 2 : 65536;
+        buffer->data = (unsigned char*)realloc(buffer->data, buffer->capacity);
+    }
+    struct WalRecordHeader header;
+    header.payload_size = payload_size;
+    header.lsn = wal->next_lsn++;
+    header.checksum = wal_checksum(&header, payload);
+    memcpy(buffer->data + buffer->used, &header, sizeof(header));
+    memcpy(buffer->data + buffer->used + sizeof(header), payload, payload_size);
+    buffer->used += need;
+    buffer->records++;
+    if (buffer->records >= wal->group_size) wal->arrived.notify_one();
+    return header.lsn;
+}
+
+inline bool wal_sync(struct WriteAheadLog* wal) {
+    if (wal->policy == WAL_SYNC_FDATASYNC) return fdatasync(wal->fd) == 0;
+    if (wal->policy == WAL_SYNC_FSYNC) return fsync(wal->fd) == 0;
+    return true;
+}
+
+// Дождаться, пока запись lsn окажется на диске. Первый ожидающий
+// становится лидером и сбрасывает всю накопленную группу.
+// Если write или sync группы не удался, записи группы потеряны, а за ними
+// в журнале не может быть подтвержденных: файл обрезается до начала
+// группы, журнал помечается failed, и этот и все следующие wal_commit
+// (кроме уже подтвержденных lsn) возвращают false до повторного открытия.
+inline bool wal_commit(struct WriteAheadLog* wal, long long lsn) {
+    std::unique_lock<std::mutex> guard(wal->lock);
+    while (wal->durable_lsn < lsn) {
+        if (wal->failed || lsn < 0) return false;
+        if (wal->flush_in_progress) {
+            wal->durable.wait(guard);
+            continue;
+        }
+        wal->flush_in_progress = true;
+        if (wal->active.records < wal->group_size && wal->group_wait_us > 0) {
+            wal->arrived.wait_for(guard, std::chrono::microseconds(wal->group_wait_us),
+                                  [&] { return wal->active.records >= wal->group_size; });
+        }
+        // Группа забирается целиком, новые записи копятся во втором буфере
+        struct WalBuffer group = wal->active;
+        wal->active = wal->flushing;
+        wal->active.used = 0;
+        wal->active.records = 0;
+        long long group_lsn = wal->next_lsn - 1;
+        guard.unlock();
+
+        off_t group_start = lseek(wal->fd, 0, SEEK_END);
+        bool ok = group_start >= 0;
+        size_t written = 0;
+        while (ok && written < group.used) {
+            ssize_t done = write(wal->fd, group.data + written, group.used - written);
+            if (done <= 0) ok = false;
+            else written += done;
+        }
+        ok = ok && wal_sync(wal);
+        // Оборванная запись остановила бы проигрыш на себе
+        if (!ok && group_start >= 0 && ftruncate(wal->fd, group_start) == 0) wal_sync(wal);
+
+        guard.lock();
+        wal->flushing = group;
+        wal->flush_in_progress = false;
+        if (ok) {
+            wal->durable_lsn = group_lsn;
+            wal->syncs++;
+            wal->records += group.records;
+            wal->bytes += group.used;
+        } else {
+            wal->failed = true;
+        }
+        wal->durable.notify_all();
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// Проиграть журнал: apply(context, payload, size) для каждой целой записи.
+// Оборванная или испорченная запись в конце и все после нее отрезаются.
+// Возвращает число проигранных записей, -1 - ошибка чтения.
+inline long long wal_replay(struct WriteAheadLog* wal, void (*apply)(void* context, const void* payload, int size),
+                            void* context) {
+    struct stat st;
+    if (fstat(wal->fd, &st) != 0) return -1;
+    unsigned char* data = (unsigned char*)malloc(st.st_size > 0 ? st.st_size : 1);
+    if (pread(wal->fd, data, st.st_size, 0) != st.st_size) {
+        free(data);
+        return -1;
+    }
+
+    long long replayed = 0;
+    size_t pos = 0;
+    while (pos + sizeof(struct WalRecordHeader) <= (size_t)st.st_size) {
+        struct WalRecordHeader header;
+        memcpy(&header, data + pos, sizeof(header));
+        if (header.payload_size < 0 || pos + sizeof(header) + header.payload_size > (size_t)st.st_size) break;
+        const unsigned char* payload = data + pos + sizeof(header);
+        if (header.checksum != wal_checksum(&header, payload)) break;
+        // После обрезки журнал начинается с продолжения нумерации
+        if (replayed > 0 && header.lsn != wal->next_lsn) break;
+        apply(context, payload, header.payload_size);
+        wal->next_lsn = header.lsn + 1;
+        replayed++;
+        pos += sizeof(header) + header.payload_size;
+    }
+    free(data);
+    if (pos < (size_t)st.st_size && (ftruncate(wal->fd, pos) != 0 || !wal_sync(wal))) return -1;
+    wal->durable_lsn = wal->next_lsn - 1;
+    return replayed;
+}
+
+// Дождаться, пока на диске окажутся все добавленные записи.
+// false - журнал в состоянии ошибки (см. wal_commit).
+inline bool wal_flush_all(struct WriteAheadLog* wal) {
+    long long lsn;
+    {
+        std::lock_guard<std::mutex> guard(wal->lock);
+        if (wal->failed) return false;
+        lsn = wal->next_lsn - 1;
+    }
+    return wal_commit(wal, lsn);
+}
+
+// Обрезать журнал после контрольной точки; нумерация lsn продолжается
+inline bool wal_truncate(struct WriteAheadLog* wal) {
+    std::lock_guard<std::mutex> guard(wal->lock);
+    if (ftruncate(wal->fd, 0) != 0 || fsync(wal->fd) != 0) return false;
+    return true;
+}
+
+// fsync каталога, в котором лежит path: без него rename может не пережить сбой ОС
+inline bool wal_sync_directory(const char* path) {
+    char dir[256];
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL) snprintf(dir, sizeof(dir), ".");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path > 0 ? slash - path : 1), path);
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// ==================== ДОЛГОВЕЧНОЕ B+-ДЕРЕВО ====================
+
+template <typename Tree>
+struct DurableBPlusTree {
+    Tree tree;
+    std::mutex tree_lock;      // порядок в журнале = порядок применения
+    struct WriteAheadLog wal;
+    char tree_path[256];
+    char wal_path[256];
+    long long replayed;        // записей проиграно при открытии
+};
+
+template <typename Tree>
+struct WalInsertRecord {
+    typename Tree::Key key;
+    typename Tree::Value value;
+};
+
+template <typename Tree>
+void durable_bplus_apply(void* context, const void* payload, int size) {
+    WalInsertRecord<Tree> record;
+    if (size != (int)sizeof(record)) return;
+    memcpy(&record, payload, sizeof(record));
+    bplus_insert((Tree*)context, record.key, record.value);
+}
+
+// Открыть (или создать) дерево: последняя контрольная точка + проигрыш журнала
+template <typename Tree>
+bool durable_bplus_open(DurableBPlusTree<Tree>* db, const char* tree_path, const char* wal_path,
+                        WalSyncPolicy policy, int group_size = 1, int group_wait_us = 0) {
+    snprintf(db->tree_path, sizeof(db->tree_path), "%s", tree_path);
+    snprintf(db->wal_path, sizeof(db->wal_path), "%s", wal_path);
+
+    struct DiskSimulator disk;
+    if (access(tree_path, F_OK) == 0) {
+        bool loaded = disk_open(&disk, tree_path, false) && bplus_load(&db->tree, &disk);
+        disk_close(&disk);
+        if (!loaded) return false;
+    } else {
+        bplus_tree_init(&db->tree);
+    }
+
+    if (!wal_open(&db->wal, wal_path, policy, group_size, group_wait_us)) {
+        bplus_tree_free(&db->tree);
+        return false;
+    }
+    db->replayed = wal_replay(&db->wal, durable_bplus_apply<Tree>, &db->tree);
+    if (db->replayed < 0) {
+        wal_close(&db->wal);
+        bplus_tree_free(&db->tree);
+        return false;
+    }
+    return true;
+}
+
+// Вставка возвращает управление, когда запись журнала на диске.
+// Дерево в памяти меняется до wal_commit: после false от журнала в нем
+// могут остаться неподтвержденные вставки, поэтому дерево нужно закрыть
+// и заново открыть с диска (durable_bplus_close + durable_bplus_open).
+template <typename Tree>
+bool durable_bplus_insert(DurableBPlusTree<Tree>* db, typename Tree::Key key, typename Tree::Value value) {
+    WalInsertRecord<Tree> record;
+    memset(&record, 0, sizeof(record));
+    record.key = key;
+    record.value = value;
+    long long lsn;
+    {
+        std::lock_guard<std::mutex> guard(db->tree_lock);
+        lsn = wal_append(&db->wal, &record, sizeof(record));
+        if (lsn < 0) return false;
+        bplus_insert(&db->tree, key, value);
+    }
+    return wal_commit(&db->wal, lsn);
+}
+
+// Контрольная точка: дерево пишется во временный файл, который атомарно
+// заменяет прежний, затем журнал обрезается. Падение между rename и
+// обрезкой безопасно: проигрыш повторит вставки, а они идемпотентны.
+// Сначала на диск сбрасываются все записи, уже примененные к дереву; если
+// журнал в состоянии ошибки, дерево содержит отвергнутые вставки и
+// контрольная точка не пишется (false).
+template <typename Tree>
+bool durable_bplus_checkpoint(DurableBPlusTree<Tree>* db) {
+    std::lock_guard<std::mutex> guard(db->tree_lock);
+    if (!wal_flush_all(&db->wal)) return false;
+    char temp_path[300];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", db->tree_path);
+    struct DiskSimulator disk;
+    bool ok = disk_open(&disk, temp_path, true) && bplus_persist(&db->tree, &disk);
+    disk_close(&disk);
+    if (!ok || rename(temp_path, db->tree_path) != 0) {
+        unlink(temp_path);
+        return false;
+    }
+    return wal_sync_directory(db->tree_path) && wal_truncate(&db->wal);
+}
+
+template <typename Tree>
+void durable_bplus_close(DurableBPlusTree<Tree>* db) {
+    wal_close(&db->wal);
+    bplus_tree_free(&db->tree);
+}
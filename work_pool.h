@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "disk.h"
+
+// Пул потоков с перехватом задач (work stealing).
+// Задачи - номера 0..task_count-1. Каждый поток получает свою очередь
+// соседних задач и берет их с хвоста; опустевший поток забирает задачи
+// с головы чужих очередей. Вызывающий поток работает как поток 0, так
+// что пул из одного потока - обычный последовательный цикл.
+
+typedef void (*WorkTaskFn)(void* context, int task, int worker);
+
+struct alignas(CACHE_LINE_SIZE) WorkQueue {
+    std::mutex lock;
+    int* tasks;
+    int capacity;
+    int head;                  // отсюда крадут
+    int tail;                  // отсюда берет владелец
+};
+
+struct WorkPool {
+    int threads;               // вместе с вызывающим потоком
+    std::thread* workers;      // threads - 1 фоновых потоков
+    WorkQueue* queues;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    long long generation;      // номер текущего запуска
+    int active;                // фоновых потоков, еще не закончивших запуск
+    bool stop;
+
+    WorkTaskFn fn;
+    void* context;
+    std::atomic<long long> steals;
+};
+
+// Взять задачу: своя очередь с хвоста, иначе чужие с головы; -1 - задач нет
+inline int work_pool_take(struct WorkPool* pool, int worker) {
+    WorkQueue* own = &pool->queues[worker];
+    {
+        std::lock_guard<std::mutex> guard(own->lock);
+        if (own->head < own->tail) return own->tasks[--own->tail];
+    }
+    for (int i = 1; i < pool->threads; i++) {
+        WorkQueue* victim = &pool->queues[(worker + i) % pool->threads];
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (victim->head < victim->tail) {
+            pool->steals.fetch_add(1, std::memory_order_relaxed);
+            return victim->tasks[victim->head++];
+        }
+    }
+    return -1;
+}
+
+inline void work_pool_drain(struct WorkPool* pool, int worker) {
+    int task;
+    while ((task = work_pool_take(pool, worker)) != -1) pool->fn(pool->context, task, worker);
+}
+
+inline void work_pool_thread(struct WorkPool* pool, int worker) {
+    long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(pool->lock);
+            pool->wake.wait(guard, [&] { return pool->stop || pool->generation != seen; });
+            if (pool->stop) return;
+            seen = pool->generation;
+        }
+        work_pool_drain(pool, worker);
+        std::lock_guard<std::mutex> guard(pool->lock);
+        if (--pool->active == 0) pool->done.notify_one();
+    }
+}
+
+inline void work_pool_init(struct WorkPool* pool, int threads) {
+    pool->threads = threads > 0 ? threads : 1;
+    pool->queues = new WorkQueue[pool->threads];
+    for (int i = 0; i < pool->threads; i++) {
+        pool->queues[i].tasks = NULL;
+        pool->queues[i].capacity = 0;
+        pool->queues[i].head = pool->queues[i].tail = 0;
+    }
+    pool->generation = 0;
+    pool->active = 0;
+    pool->stop = false;
+    pool->fn = NULL;
+    pool->context = NULL;
+    pool->steals.store(0);
+    pool->workers = new std::thread[pool->threads - 1];
+    for (int i = 1; i < pool->threads; i++) {
+        pool->workers[i - 1] = std::thread(work_pool_thread, pool, i);
+    }
+}
+
+// Выполнить задачи 0..task_count-1 и дождаться всех. Поток i получает
+// i-й непрерывный отрезок номеров: соседние задачи (соседние поддиапазоны)
+// обрабатываются одним потоком, пока их не перехватят.
+inline void work_pool_run(struct WorkPool* pool, int task_count, WorkTaskFn fn, void* context) {
+    for (int i = 0; i < pool->threads; i++) {
+        WorkQueue* queue = &pool->queues[i];
+        int first = (int)((long long)task_count * i / pool->threads);
+        int last = (int)((long long)task_count * (i + 1) / pool->threads);
+        if (queue->capacity < last - first) {
+            free(queue->tasks);
+            queue->capacity = last - first;
+            queue->tasks = (int*)malloc(sizeof(int) * queue->capacity);
+        }
+        // Владелец берет с хвоста: кладем в обратном порядке, чтобы он шел слева направо
+        for (int t = first; t < last; t++) queue->tasks[last - 1 - t] = t;
+        queue->head = 0;
+        queue->tail = last - first;
+    }
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->fn = fn;
+        pool->context = context;
+        pool->active = pool->threads - 1;
+        pool->generation++;
+    }
+    pool->wake.notify_all();
+
+    work_pool_drain(pool, 0);
+
+    std::unique_lock<std::mutex> guard(pool->lock);
+    pool->done.wait(guard, [&] { return pool->active == 0; });
+}
+
+inline void work_pool_destroy(struct WorkPool* pool) {
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->stop = true;
+    }
+    pool->wake.notify_all();
+    for (int i = 0; i < pool->threads - 1; i++) pool->workers[i].join();
+    delete[] pool->workers;
+    for (int i = 0; i < pool->threads; i++) free(pool->queues[i].tasks);
+    delete[] pool->queues;
+}